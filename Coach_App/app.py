@@ -1,15 +1,22 @@
 import streamlit as st
-import requests
 import base64
 import json
 import time
 import os
+import re
+from collections import deque
+
+import coach_pipeline as cp
+from coach_cache import RantCache, cache_key, cached_discovery
+import coach_history as ch
+from telemetry import TelemetryReader
+from run_ledger import RunLedger, LocalDevnet
 
 # --- CONFIGURATION ---
 st.set_page_config(page_title="Biathlon Coach", page_icon="❄️", layout="centered")
 
 # --- DARK ICE THEME CSS ---
-st.markdown("""
+THEME_CSS = """
 <style>
     /* 1. MAIN BACKGROUND */
     .stApp {
@@ -121,7 +128,14 @@ st.markdown("""
         white-space: pre-wrap; /* Keeps text formatting */
     }
 </style>
-""", unsafe_allow_html=True)
+"""
+
+# The theme has to be re-sent on every rerun; minify it once per process
+@st.cache_resource
+def theme_css():
+    css = re.sub(r"/\*.*?\*/", "", THEME_CSS, flags=re.S)
+    return re.sub(r"\s*([{};:,>])\s*", r"\1", re.sub(r"\s+", " ", css)).strip()
+st.markdown(theme_css(), unsafe_allow_html=True)
 
 # Check for keys
 if "GOOGLE_API_KEY" not in st.secrets:
@@ -161,79 +175,244 @@ Keep it under 60 words. ALL CAPS.
 
 API_KEY = st.secrets["GOOGLE_API_KEY"]
 
+# BACKENDS: environment beats secrets.toml beats the real services.
+# Point these at mock_servers.py to run the whole app offline.
+def setting(name, default=None):
+    return os.environ.get(name) or st.secrets.get(name, default)
+
+OPENROUTER_BASE_URL = setting("OPENROUTER_BASE_URL", cp.OPENROUTER_BASE_URL)
+ELEVENLABS_BASE_URL = setting("ELEVENLABS_BASE_URL", cp.ELEVENLABS_BASE_URL)
+GEMINI_BASE_URL = setting("GEMINI_BASE_URL")
+ELEVENLABS_TTS_URL = cp.elevenlabs_url(ELEVENLABS_BASE_URL)
+LLM_TIMEOUT_S = float(setting("LLM_TIMEOUT_S", cp.LLM_TIMEOUT_S))
+TTS_TIMEOUT_S = float(setting("TTS_TIMEOUT_S", cp.TTS_TIMEOUT_S))
+TTS_WORKERS = int(setting("TTS_WORKERS", 2))
+
+# HTTP CLIENTS: one keep-alive pool per backend for the whole process, shared by all sessions
+@st.cache_resource
+def get_http_sessions(tts_workers):
+    return {"llm": cp.new_session(pool_size=4), "tts": cp.new_session(pool_size=tts_workers + 2)}
+HTTP = get_http_sessions(TTS_WORKERS)
+
 # API SETUP
 if USE_OPENROUTER:
-    OPENROUTER_API_URL = "https://openrouter.ai/api/v1/chat/completions"
+    OPENROUTER_API_URL = cp.openrouter_url(OPENROUTER_BASE_URL)
     MODEL_NAME = "google/gemini-2.0-flash-001"
 else:
     import google.generativeai as genai
-    genai.configure(api_key=API_KEY)
-    @st.cache_data
-    def get_available_model():
+    @st.cache_resource
+    def get_gemini_model(api_key, base_url):
+        """Configure, discover and build the model once per process instead of on every rerun."""
+        if base_url: genai.configure(api_key=api_key, transport="rest", client_options={"api_endpoint": base_url})
+        else: genai.configure(api_key=api_key)
+        def discover():
+            supported_models = [m for m in genai.list_models() if 'generateContent' in m.supported_generation_methods]
+            return supported_models[0].name.split('/')[-1] if supported_models else None
         try:
-            available_models = list(genai.list_models())
-            supported_models = [m for m in available_models if 'generateContent' in m.supported_generation_methods]
-            if not supported_models: return None, "No models found"
-            return supported_models[0].name.split('/')[-1], None
-        except Exception as e: return None, str(e)
-    model_name_used, error = get_available_model()
-    if not model_name_used: st.stop()
-    try: model = genai.GenerativeModel(model_name_used, system_instruction=SYSTEM_PROMPT)
-    except: model = genai.GenerativeModel(model_name_used)
+            # Persisted on disk, so a cold start doesn't list every model again
+            name, _ = cached_discovery(f"gemini\0{base_url}\0{api_key}", discover)
+        except Exception as e: return None, None, str(e)
+        if not name: return None, None, "No models found"
+        try: model = genai.GenerativeModel(name, system_instruction=SYSTEM_PROMPT)
+        except: model = genai.GenerativeModel(name)
+        return model, name, None
+    model, model_name_used, error = get_gemini_model(API_KEY, GEMINI_BASE_URL)
+    if not model_name_used:
+        get_gemini_model.clear()   # Don't keep a failed setup for the life of the process
+        st.stop()
+
+# --- RANT CACHE (shared by every session in this process) ---
+@st.cache_resource
+def get_rant_cache():
+    return RantCache(ttl_s=float(st.secrets.get("CACHE_TTL_HOURS", 168)) * 3600,
+                     max_bytes=int(float(st.secrets.get("CACHE_MAX_MB", 50)) * 1024 * 1024))
+rant_cache = get_rant_cache()
+
+# --- RUN LEDGER (every finished run from telemetry, hash-chained on disk) ---
+@st.cache_resource
+def get_run_ledger():
+    devnet = setting("LEDGER_DEVNET")   # Path of the local devnet anchor log, if anchoring
+    return RunLedger(devnet=LocalDevnet(devnet) if devnet else None)
+run_ledger = get_run_ledger()
 
 if 'conversation_messages' not in st.session_state: st.session_state.conversation_messages = []
 if 'chat_session' not in st.session_state: st.session_state.chat_session = None
+if 'history_digest' not in st.session_state: st.session_state.history_digest = ch.new_digest()
+if 'show_full_log' not in st.session_state: st.session_state.show_full_log = False
+if 'telemetry' not in st.session_state: st.session_state.telemetry = None
 
 # --- FUNCTIONS ---
+def telemetry_summary():
+    reader = st.session_state.telemetry
+    return reader.summary() if reader else None
+
+def format_input(user_input):
+    # Attach what the robot actually did, so the diagnosis comes from data
+    summary = telemetry_summary()
+    if summary: return f"Rookie Status: {user_input}\n\n{summary}"
+    return f"Rookie Status: {user_input}"
+
+def build_openrouter_messages(formatted_input):
+    # The newest entry is the message being answered; it goes in as formatted_input
+    history = st.session_state.conversation_messages[:-1]
+    return ch.openrouter_messages(SYSTEM_PROMPT, history, st.session_state.history_digest, formatted_input)
+
 def get_coach_rant(user_input, chat_session=None, is_first_message=False):
-    formatted_input = f"Rookie Status: {user_input}"
+    formatted_input = format_input(user_input)
     try:
         if USE_OPENROUTER:
-            messages = [{"role": "system", "content": SYSTEM_PROMPT}]
-            if 'conversation_messages' in st.session_state:
-                for msg in st.session_state.conversation_messages:
-                    role = "assistant" if msg['role'] == 'coach' else "user"
-                    messages.append({"role": role, "content": msg['content']})
-            messages.append({"role": "user", "content": formatted_input})
-            headers = {"Authorization": f"Bearer {API_KEY}", "Content-Type": "application/json", "HTTP-Referer": "https://streamlit.io/", "X-Title": "Biathlon Coach"}
-            payload = {"model": MODEL_NAME, "messages": messages}
-            response = requests.post(OPENROUTER_API_URL, headers=headers, json=payload, timeout=10)
-            if response.status_code == 200: return response.json()["choices"][0]["message"]["content"]
-            else: return "I'M TOO ANGRY TO CONNECT! (API Error)"
+            try: return cp.fetch_openrouter(build_openrouter_messages(formatted_input), API_KEY, MODEL_NAME, OPENROUTER_API_URL, LLM_TIMEOUT_S, HTTP["llm"])
+            except cp.CoachAPIError: return "I'M TOO ANGRY TO CONNECT! (API Error)"
         else:
-            if chat_session: response = chat_session.send_message(formatted_input)
-            else: response = model.generate_content(formatted_input)
+            opts = {"timeout": LLM_TIMEOUT_S}
+            if chat_session: response = chat_session.send_message(formatted_input, request_options=opts)
+            else: response = model.generate_content(formatted_input, request_options=opts)
             return response.text
     except Exception as e: return f"SYSTEM FAILURE! {e}"
 
+def stream_coach_rant(user_input, chat_session=None):
+    """Same as get_coach_rant, but yields text as the model produces it."""
+    formatted_input = format_input(user_input)
+    if USE_OPENROUTER:
+        yield from cp.stream_openrouter(build_openrouter_messages(formatted_input), API_KEY, MODEL_NAME, OPENROUTER_API_URL, LLM_TIMEOUT_S, HTTP["llm"])
+    else:
+        opts = {"timeout": LLM_TIMEOUT_S}
+        if chat_session: response = chat_session.send_message(formatted_input, stream=True, request_options=opts)
+        else: response = model.generate_content(formatted_input, stream=True, request_options=opts)
+        for chunk in response:
+            yield chunk.text
+
 def speak_text(text):
     if "ELEVENLABS_API_KEY" not in st.secrets:
         st.warning("No ElevenLabs Key found. Audio disabled.")
         return None
-        
-    url = f"https://api.elevenlabs.io/v1/text-to-speech/{VOICE_ID}"
-    headers = {
-        "xi-api-key": st.secrets["ELEVENLABS_API_KEY"], 
-        "Content-Type": "application/json"
-    }
-    data = {
-        "text": text,
-        "model_id": "eleven_flash_v2_5", 
-        "voice_settings": {"stability": 0.5, "similarity_boost": 0.8}
-    }
     try:
-        response = requests.post(url, json=data, headers=headers, timeout=5)
-        if response.status_code == 200:
-            return response.content
-        else:
-            st.error(f"Voice Error: {response.text}")
-            return None
+        return cp.synthesize(text, st.secrets["ELEVENLABS_API_KEY"], VOICE_ID, ELEVENLABS_TTS_URL, TTS_TIMEOUT_S, HTTP["tts"])
+    except cp.CoachAPIError as e:
+        st.error(f"Voice Error: {e}")
+        return None
     except Exception as e:
         st.error(f"Connection Error: {e}")
         return None
 
+def play_audio(audio_data):
+    audio_base64 = base64.b64encode(audio_data).decode('utf-8')
+    audio_html = f"""
+        <audio autoplay>
+            <source src="data:audio/mp3;base64,{audio_base64}" type="audio/mp3">
+        </audio>
+    """
+    st.markdown(audio_html, unsafe_allow_html=True)
+
+def coach_streaming(user_input):
+    """
+    PIPELINED MODE: tokens show up as they stream, each finished sentence is
+    voiced on a worker thread, and clips are queued back-to-back so the first
+    one starts playing while the rest of the rant is still being written.
+    Returns the full rant text, the clips in order, and whether every
+    sentence was voiced (only then is the rant worth caching).
+    """
+    eleven_key = st.secrets.get("ELEVENLABS_API_KEY")
+    if not eleven_key: st.warning("No ElevenLabs Key found. Audio disabled.")
+    speak = (lambda chunk: cp.synthesize(chunk, eleven_key, VOICE_ID, ELEVENLABS_TTS_URL, TTS_TIMEOUT_S, HTTP["tts"])) if eleven_key else (lambda chunk: None)
+
+    st.markdown("### 🗣️ COACH IS SCREAMING:")
+    text_box = st.empty()
+    audio_area = st.container()
+    full_text = ""
+    clips = deque()
+    all_clips = []
+    voiced = bool(eleven_key)
+    chunks = 0
+    audio_free_at = 0.0   # When the clip currently playing should be finished
+
+    def pump_audio():
+        nonlocal audio_free_at
+        now = time.perf_counter()
+        if clips and now >= audio_free_at:
+            clip = clips.popleft()
+            with audio_area: play_audio(clip)
+            audio_free_at = now + cp.mp3_duration_s(clip)
+
+    for kind, value in cp.run_pipeline(stream_coach_rant(user_input, st.session_state.chat_session), speak, TTS_WORKERS):
+        if kind == "text":
+            full_text += value
+            text_box.markdown(f'<div class="typing-box">{full_text}</div>', unsafe_allow_html=True)
+        elif kind == "audio" and value:
+            clips.append(value)
+            all_clips.append(value)
+        elif kind == "audio":
+            voiced = False
+        elif kind == "error":
+            if value.stage == "tts":
+                voiced = False
+                st.error(f"Voice Error: {value}")
+            elif not full_text:
+                full_text = f"SYSTEM FAILURE! {value}"
+                text_box.markdown(f'<div class="typing-box">{full_text}</div>', unsafe_allow_html=True)
+            else:
+                st.error(f"Connection Error: {value}")
+        elif kind == "done":
+            st.session_state.last_pipeline_stats = value
+            chunks = value["chunks"]
+        pump_audio()
+
+    # Keep the script alive until every queued clip has been handed to the browser
+    while clips:
+        time.sleep(max(0.0, audio_free_at - time.perf_counter()))
+        pump_audio()
+    return full_text, all_clips, voiced and len(all_clips) == chunks > 0
+
 # --- APP UI START ---
 
+# 0. SIDEBAR
+PIPELINE_MODE = st.sidebar.checkbox("⚡ STREAMING PIPELINE", value=True,
+    help="Stream the rant and voice it sentence by sentence. Off = old fetch-then-speak path.")
+if st.session_state.get('last_pipeline_stats'):
+    stats = st.session_state.last_pipeline_stats
+    st.sidebar.caption(f"First word: {stats['first_token_s'] or 0:.2f}s · First audio: {stats['first_audio_s'] or 0:.2f}s · Total: {stats['total_s']:.2f}s")
+
+cache_stats = rant_cache.stats()
+st.sidebar.markdown("#### 🧊 RANT CACHE")
+st.sidebar.metric("Hit rate", f"{cache_stats['hit_rate']:.0%}", help=f"{cache_stats['hits']} hits / {cache_stats['misses']} misses")
+st.sidebar.caption(f"{cache_stats['entries']} rants · {cache_stats['bytes'] / 1e6:.1f} / {cache_stats['max_bytes'] / 1e6:.0f} MB · {cache_stats['evictions']} evicted")
+if st.sidebar.button("🗑️ CLEAR CACHE"):
+    rant_cache.clear()
+    st.rerun()
+
+st.sidebar.markdown("#### 📡 ROBOT TELEMETRY")
+reader = st.session_state.telemetry
+if reader is None:
+    source = st.sidebar.text_input("Serial port or log file", value=setting("TELEMETRY_SOURCE", ""), placeholder="COM3, /dev/ttyACM0, run.log or ring:robot.ring")
+    record = st.sidebar.text_input("Record live run to", value=setting("TELEMETRY_RECORD", ""), placeholder="optional, e.g. run.log")
+    if st.sidebar.button("🔌 CONNECT") and source:
+        st.session_state.telemetry = TelemetryReader(source, record=record or None, on_run=run_ledger.append)
+        st.rerun()
+else:
+    status = f"⚠️ {reader.error}" if reader.error else ("🟢 " if reader.connected else "⏳ ") + reader.source
+    st.sidebar.caption(status)
+    st.sidebar.code(reader.summary() or "(waiting for robot...)", language=None)
+    if st.sidebar.button("⏏️ DISCONNECT"):
+        reader.close()
+        st.session_state.telemetry = None
+        st.rerun()
+
+st.sidebar.markdown("#### 🏁 RUN LEDGER")
+ok, bad = run_ledger.verify()
+st.sidebar.caption(f"{run_ledger.count()} runs · " + ("⛓️ chain verified" if ok else f"⚠️ chain broken at run #{bad}"))
+for section, best in run_ledger.best_times().items():
+    line = f"Section {section} best: {best['duration_ms'] / 1000:.1f}s"
+    regress = run_ledger.regression(section)
+    if regress and regress['delta_ms'] is not None:
+        line += f" · new firmware {regress['delta_ms'] / 1000:+.1f}s" + (" ⚠️" if regress['regressed'] else "")
+    st.sidebar.caption(line)
+timeout_states = run_ledger.timeout_states()
+if timeout_states:
+    with st.sidebar.expander("Runs that timed out in..."):
+        state = st.selectbox("State", timeout_states, label_visibility="collapsed")
+        for run in run_ledger.runs_with_timeout(state, limit=10):
+            st.caption(f"#{run['seq']} S{run['section']} {run['outcome']} {run['duration_ms'] / 1000:.1f}s · fw {run['firmware'] or '-'}")
+
 # 1. HEADER
 col1, col2, col3 = st.columns([1, 2, 1])
 with col2:
@@ -251,25 +430,13 @@ st.markdown("""
 </div>
 """, unsafe_allow_html=True)
 
-# 2. CHAT HISTORY (Shows only PREVIOUS messages)
+# 2. CHAT HISTORY (Shows only PREVIOUS messages, newest CHAT_WINDOW of them)
 if st.session_state.conversation_messages:
-    chat_html = '<div class="chat-container">'
-    for msg in st.session_state.conversation_messages:
-        if msg['role'] == 'user':
-            chat_html += f"""
-<div class="user-row">
-    <div class="user-avatar">🎿</div>
-    <div class="user-bubble">{msg['content']}</div>
-</div>
-"""
-        else:
-            chat_html += f"""
-<div class="coach-row">
-    <div class="coach-avatar">📢</div>
-    <div class="coach-bubble"><b>COACH:</b><br>{msg['content']}</div>
-</div>
-"""
-    chat_html += '</div>'
+    window = None if st.session_state.show_full_log else ch.CHAT_WINDOW
+    chat_html, hidden = ch.render_window(st.session_state.conversation_messages, window)
+    if hidden and st.button(f"⋯ SHOW {hidden} OLDER MESSAGES", type="secondary"):
+        st.session_state.show_full_log = True
+        st.rerun()
     st.markdown(chat_html, unsafe_allow_html=True)
 
 # 3. RESPONSE PLACEHOLDER (Active Rant appears here)
@@ -286,6 +453,8 @@ with st.container():
     if st.button("🔄 RESET", type="secondary"):
         st.session_state.conversation_messages = []
         st.session_state.chat_session = None
+        st.session_state.history_digest = ch.new_digest()
+        st.session_state.show_full_log = False
         st.rerun()
 
 # --- LOGIC ---
@@ -294,54 +463,79 @@ if submit_btn and user_input:
         try: st.session_state.chat_session = model.start_chat()
         except: pass
 
-    # 1. Update History (Backend)
+    # 1. Look up the cache BEFORE this message joins the history (it's part of the key)
+    fingerprint = st.session_state.telemetry.fingerprint() if st.session_state.telemetry else ""
+    key = cache_key(user_input, st.session_state.conversation_messages, MODEL_NAME if USE_OPENROUTER else model_name_used, fingerprint)
+    cached = rant_cache.get(key)
+
+    # Update History (Backend)
     st.session_state.conversation_messages.append({'role': 'user', 'content': user_input})
-    
-    # 2. Get Response
-    with response_placeholder.container():
-        # Show User Input immediately in the active area
-        st.markdown(f'<div class="user-row"><div class="user-avatar">🎿</div><div class="user-bubble">{user_input}</div></div>', unsafe_allow_html=True)
-        
-        with st.spinner("❄️ Coach is sharpening his skates..."):
-            rant_text = get_coach_rant(user_input, st.session_state.chat_session)
-            
-    # 3. Get Audio
-    with response_placeholder.container():
-        # Keep user input visible
-        st.markdown(f'<div class="user-row"><div class="user-avatar">🎿</div><div class="user-bubble">{user_input}</div></div>', unsafe_allow_html=True)
-        
-        with st.spinner("🔊 Generating Scream..."):
-            audio_data = speak_text(rant_text)
-
-    # 4. Show Result (No Rerun)
-    with response_placeholder.container():
-        # A. Show User Input (Again, to keep it stable)
-        st.markdown(f'<div class="user-row"><div class="user-avatar">🎿</div><div class="user-bubble">{user_input}</div></div>', unsafe_allow_html=True)
-        
-        st.markdown("### 🗣️ COACH IS SCREAMING:")
-        
-        # B. Play Audio
-        if audio_data:
-            audio_base64 = base64.b64encode(audio_data).decode('utf-8')
-            audio_html = f"""
-                <audio autoplay>
-                    <source src="data:audio/mp3;base64,{audio_base64}" type="audio/mp3">
-                </audio>
-            """
-            st.markdown(audio_html, unsafe_allow_html=True)
-        
-        # C. Python Typing Effect (INSIDE BOX + SLOWER)
-        text_box = st.empty()
-        full_text = ""
-        
-        # Speed: 0.35s is ideal for "Angry Coach" pace
-        for word in rant_text.split():
-            full_text += word + " "
-            # This HTML string updates the same box over and over
-            text_box.markdown(f'<div class="typing-box">{full_text}</div>', unsafe_allow_html=True)
-            time.sleep(0.35) 
-            
+
+    if cached:
+        # 2-4. Heard this one before: same words, same MP3, no API calls
+        rant_text, audio_data = cached
+        with response_placeholder.container():
+            st.markdown(f'<div class="user-row"><div class="user-avatar">🎿</div><div class="user-bubble">{user_input}</div></div>', unsafe_allow_html=True)
+            st.markdown("### 🗣️ COACH IS SCREAMING (AGAIN):")
+            if audio_data: play_audio(audio_data)
+            st.markdown(f'<div class="typing-box">{rant_text}</div>', unsafe_allow_html=True)
+    elif PIPELINE_MODE:
+        # 2-4. Stream text and audio together (see coach_streaming)
+        with response_placeholder.container():
+            st.markdown(f'<div class="user-row"><div class="user-avatar">🎿</div><div class="user-bubble">{user_input}</div></div>', unsafe_allow_html=True)
+            rant_text, clips, voiced = coach_streaming(user_input)
+        # MP3 frames concatenate cleanly, so the clips are stored as one file
+        audio_data = b"".join(clips) if voiced else None
+    else:
+        # 2. Get Response
+        with response_placeholder.container():
+            # Show User Input immediately in the active area
+            st.markdown(f'<div class="user-row"><div class="user-avatar">🎿</div><div class="user-bubble">{user_input}</div></div>', unsafe_allow_html=True)
+
+            with st.spinner("❄️ Coach is sharpening his skates..."):
+                rant_text = get_coach_rant(user_input, st.session_state.chat_session)
+
+        # 3. Get Audio
+        with response_placeholder.container():
+            # Keep user input visible
+            st.markdown(f'<div class="user-row"><div class="user-avatar">🎿</div><div class="user-bubble">{user_input}</div></div>', unsafe_allow_html=True)
+
+            with st.spinner("🔊 Generating Scream..."):
+                audio_data = speak_text(rant_text)
+
+        # 4. Show Result (No Rerun)
+        with response_placeholder.container():
+            # A. Show User Input (Again, to keep it stable)
+            st.markdown(f'<div class="user-row"><div class="user-avatar">🎿</div><div class="user-bubble">{user_input}</div></div>', unsafe_allow_html=True)
+
+            st.markdown("### 🗣️ COACH IS SCREAMING:")
+
+            # B. Play Audio
+            if audio_data:
+                play_audio(audio_data)
+
+            # C. Python Typing Effect (INSIDE BOX + SLOWER)
+            text_box = st.empty()
+            full_text = ""
+
+            # Speed: 0.35s is ideal for "Angry Coach" pace
+            for word in rant_text.split():
+                full_text += word + " "
+                # This HTML string updates the same box over and over
+                text_box.markdown(f'<div class="typing-box">{full_text}</div>', unsafe_allow_html=True)
+                time.sleep(0.35)
+
     # 5. Save to History (So it appears in the top log NEXT time)
     st.session_state.conversation_messages.append({'role': 'coach', 'content': rant_text})
-    
-    # NO ST.RERUN() - This keeps the audio player alive!
\ No newline at end of file
+
+    # Gemini keeps its own history inside the chat session; restart it from the digest when it gets long
+    chat = st.session_state.chat_session
+    if chat is not None and len(chat.history) > 2 * ch.CHAT_WINDOW:
+        try: st.session_state.chat_session = model.start_chat(history=ch.gemini_history(st.session_state.conversation_messages, st.session_state.history_digest))
+        except: pass
+
+    # 6. Remember it (failures are not worth repeating, nor a rant with its voice missing)
+    if not cached and audio_data and not rant_text.startswith(("SYSTEM FAILURE!", "I'M TOO ANGRY")):
+        rant_cache.put(key, user_input, rant_text, audio_data)
+
+    # NO ST.RERUN() - This keeps the audio player alive!
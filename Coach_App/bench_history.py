@@ -0,0 +1,105 @@
+"""
+Per-turn cost of a long session: full history vs windowed log + budgeted prompt.
+
+    python bench_history.py
+    python bench_history.py --sizes 10 50 200 --prompt-per-ktoken 0.15
+
+For each session length it measures, for the turn that comes next:
+  * render:  building the chat-log HTML Streamlit sends on every rerun
+  * prompt:  tokens sent to the LLM (chars / 4)
+  * LLM:     round trip to a local OpenRouter stand-in whose time to first
+             token grows with prompt size (see mock_servers.Profile)
+"""
+
+import argparse
+import random
+import statistics
+import time
+
+import coach_history as ch
+import coach_pipeline as cp
+from mock_servers import RANT, Profile, make_server
+
+SYSTEM_PROMPT = "You are COACH AVALANCHE. " * 40   # About the size of the real one
+
+PROBLEMS = ["THE ROBOT MISSED THE GREEN LINE", "SERVO IS TWITCHING WHEN THE MOTORS START",
+            "ULTRASONIC SAYS 999 ALL THE TIME", "IT KEEPS REBOOTING ON THE RAMP",
+            "CLAW DROPS THE BOX HALFWAY", "IT TURNS RIGHT WHEN IT SHOULD GO LEFT"]
+
+
+def make_session(n, seed=1):
+    rng = random.Random(seed)
+    msgs = []
+    for i in range(n):
+        if i % 2 == 0:
+            msgs.append({'role': 'user', 'content': rng.choice(PROBLEMS)})
+        else:
+            msgs.append({'role': 'coach', 'content': RANT})
+    return msgs
+
+
+def old_render(messages):
+    html = '<div class="chat-container">'
+    for msg in messages:
+        html += ch.bubble_html(msg)
+    return html + '</div>'
+
+
+def old_prompt(messages, formatted_input):
+    out = [{"role": "system", "content": SYSTEM_PROMPT}]
+    for msg in messages:
+        out.append({"role": "assistant" if msg['role'] == 'coach' else "user", "content": msg['content']})
+    out.append({"role": "user", "content": formatted_input})
+    return out
+
+
+def timed(fn, reps):
+    t = []
+    for _ in range(reps):
+        start = time.perf_counter()
+        result = fn()
+        t.append(time.perf_counter() - start)
+    return statistics.median(t), result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--sizes", type=int, nargs="+", default=[10, 50, 200])
+    parser.add_argument("--reps", type=int, default=3)
+    parser.add_argument("--first-token", type=float, default=0.3)
+    parser.add_argument("--prompt-per-ktoken", type=float, default=0.15, help="Extra LLM latency per 1k prompt tokens (s)")
+    args = parser.parse_args()
+
+    server = make_server(Profile(first_token=args.first_token, token_gap=0.0,
+                                 prompt_per_ktoken=args.prompt_per_ktoken))
+    url = cp.openrouter_url(server.base_url)
+    tokens = lambda prompt: sum(ch.estimate_tokens(m['content']) for m in prompt)
+    llm = lambda prompt: cp.fetch_openrouter(prompt, "mock", "mock", url=url)
+
+    print(f"{'msgs':>5} | {'render ms':>17} | {'log KB':>13} | {'prompt tokens':>15} | {'LLM s':>13}")
+    print(f"{'':>5} | {'full':>8} {'window':>8} | {'full':>6} {'window':>6} | {'full':>7} {'budget':>7} | {'full':>6} {'budget':>6}")
+    for n in args.sizes:
+        session = make_session(n)
+        user_input = "Rookie Status: " + PROBLEMS[0]
+
+        # Replay the session turn by turn so the digest is built the way the app builds it
+        digest = ch.new_digest()
+        for i in range(2, n + 1, 2):
+            ch.recent_turns(session[:i], digest)
+
+        r_old, html_old = timed(lambda: old_render(session), args.reps)
+        ch.render_window(session)   # First render memoizes bubbles; later reruns are what we time
+        r_new, (html_new, _) = timed(lambda: ch.render_window(session), args.reps)
+
+        p_old = old_prompt(session, user_input)
+        p_new = ch.openrouter_messages(SYSTEM_PROMPT, session, digest, user_input)
+        l_old, _ = timed(lambda: llm(p_old), args.reps)
+        l_new, _ = timed(lambda: llm(p_new), args.reps)
+
+        print(f"{n:>5} | {r_old * 1e3:>8.3f} {r_new * 1e3:>8.3f} | {len(html_old) / 1e3:>6.1f} {len(html_new) / 1e3:>6.1f} "
+              f"| {tokens(p_old):>7} {tokens(p_new):>7} | {l_old:>6.2f} {l_new:>6.2f}")
+    server.shutdown()
+
+
+if __name__ == "__main__":
+    main()
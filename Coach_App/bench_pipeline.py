@@ -0,0 +1,67 @@
+"""
+Time-to-first-word / time-to-first-audio: sequential vs pipelined coach.
+
+Runs both code paths from coach_pipeline.py against the local stand-ins in
+mock_servers.py (no keys, no network).
+
+    python bench_pipeline.py              # defaults below
+    python bench_pipeline.py --runs 10 --first-token 1.2 --token-gap 0.04
+
+"Sequential" mirrors what app.py did before: nothing is shown until both the
+full rant and the full MP3 are back, and the first audible word is at the
+same moment as the first visible one.
+"""
+
+import argparse
+import statistics
+import time
+
+import coach_pipeline as cp
+from mock_servers import RANT, Profile, make_server
+
+def run_sequential(base):
+    start = time.perf_counter()
+    text = cp.fetch_openrouter([{"role": "user", "content": "x"}], "mock", "mock", url=cp.openrouter_url(base))
+    cp.synthesize(text, "mock", "voice", url=cp.elevenlabs_url(base))
+    ready = time.perf_counter() - start
+    return {"first_word": ready, "first_audio": ready, "total": ready}
+
+
+def run_pipelined(base):
+    tokens = cp.stream_openrouter([{"role": "user", "content": "x"}], "mock", "mock", url=cp.openrouter_url(base))
+    speak = lambda chunk: cp.synthesize(chunk, "mock", "voice", url=cp.elevenlabs_url(base))
+    stats = None
+    for kind, value in cp.run_pipeline(tokens, speak):
+        if kind == "error":
+            raise value
+        if kind == "done":
+            stats = value
+    return {"first_word": stats["first_token_s"], "first_audio": stats["first_audio_s"], "total": stats["total_s"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("--first-token", type=float, default=0.8, help="LLM time to first token (s)")
+    parser.add_argument("--token-gap", type=float, default=0.03, help="LLM time between tokens (s)")
+    parser.add_argument("--tts-base", type=float, default=0.35, help="TTS fixed latency (s)")
+    parser.add_argument("--tts-per-char", type=float, default=0.004, help="TTS latency per character (s)")
+    args = parser.parse_args()
+
+    profile = Profile(first_token=args.first_token, token_gap=args.token_gap,
+                      tts_base=args.tts_base, tts_per_char=args.tts_per_char)
+    server = make_server(profile)
+    base = server.base_url
+
+    print(f"{len(RANT.split())}-word rant, {args.runs} runs each, profile {profile}\n")
+    print(f"{'mode':<12}{'first word':>12}{'first audio':>13}{'all done':>11}")
+    for name, fn in (("sequential", run_sequential), ("pipelined", run_pipelined)):
+        rows = [fn(base) for _ in range(args.runs)]
+        med = {k: statistics.median(r[k] for r in rows) for k in rows[0]}
+        print(f"{name:<12}{med['first_word']:>11.2f}s{med['first_audio']:>12.2f}s{med['total']:>10.2f}s")
+    print("\n(sequential also spent 0.35 s/word in the typing loop after this point)")
+    server.shutdown()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,105 @@
+"""
+Cold-start and per-interaction overhead: before vs after shared clients.
+
+Runs against mock_servers.py (no keys, no network), with a per-connection
+delay standing in for the TCP + TLS handshake to the real APIs.
+
+    python bench_startup.py
+    python bench_startup.py --connect-delay 0.15 --list-latency 0.8 --turns 10
+
+Measured:
+  * model discovery on a cold start: listing models over the network (what
+    st.cache_data did on every new process) vs the disk cache
+  * one coaching turn (1 LLM call + 3 TTS sentences): a fresh connection per
+    call vs the pooled keep-alive sessions app.py now shares
+  * theme CSS re-sent on every rerun: as written vs minified once
+"""
+
+import argparse
+import os
+import re
+import statistics
+import tempfile
+import time
+
+import requests
+
+import coach_pipeline as cp
+from coach_cache import cached_discovery
+from mock_servers import Profile, make_server
+
+SENTENCES = ["LISTEN UP ROOKIE!", "CALIBRATE THE GREEN THRESHOLD UNDER VENUE LIGHTING!",
+             "NOW GET BACK ON THAT TRACK!"]
+
+
+def list_models(base, session=None):
+    reply = (session or requests).get(f"{base}/v1beta/models", timeout=10).json()
+    supported = [m for m in reply["models"] if "generateContent" in m["supportedGenerationMethods"]]
+    return supported[0]["name"].split("/")[-1] if supported else None
+
+
+def turn(base, llm=None, tts=None):
+    start = time.perf_counter()
+    cp.fetch_openrouter([{"role": "user", "content": "x"}], "mock", "mock", cp.openrouter_url(base), session=llm)
+    for sentence in SENTENCES:
+        cp.synthesize(sentence, "mock", "voice", cp.elevenlabs_url(base), session=tts)
+    return time.perf_counter() - start
+
+
+def theme_sizes():
+    """Bytes of the <style> block in app.py, raw and after theme_css()'s minification."""
+    src = open(os.path.join(os.path.dirname(os.path.abspath(__file__)), "app.py"), encoding="utf-8").read()
+    raw = re.search(r'THEME_CSS = """(.*?)"""', src, re.S)[1]
+    css = re.sub(r"/\*.*?\*/", "", raw, flags=re.S)
+    css = re.sub(r"\s*([{};:,>])\s*", r"\1", re.sub(r"\s+", " ", css)).strip()
+    return len(raw.encode()), len(css.encode())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--turns", type=int, default=8)
+    parser.add_argument("--connect-delay", type=float, default=0.12, help="Per-connection handshake (s)")
+    parser.add_argument("--list-latency", type=float, default=0.6, help="Model listing latency (s)")
+    parser.add_argument("--first-token", type=float, default=0.2)
+    parser.add_argument("--tts-base", type=float, default=0.1)
+    args = parser.parse_args()
+
+    profile = Profile(first_token=args.first_token, token_gap=0.0, tts_base=args.tts_base, tts_per_char=0.0,
+                      connect_delay=args.connect_delay, list_latency=args.list_latency)
+    server = make_server(profile)
+    base = server.base_url
+    print(f"profile: handshake {args.connect_delay}s, model list {args.list_latency}s, "
+          f"LLM {args.first_token}s, TTS {args.tts_base}s per sentence\n")
+
+    # 1. Cold start: model discovery
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "discovery.json")
+        start = time.perf_counter()
+        cached_discovery("bench", lambda: list_models(base), path=path)       # First ever start: network
+        network = time.perf_counter() - start
+        start = time.perf_counter()
+        _, from_disk = cached_discovery("bench", lambda: list_models(base), path=path)
+        disk = time.perf_counter() - start
+    print(f"{'cold start, model discovery':<36}{network * 1000:>9.1f} ms -> {disk * 1000:7.2f} ms"
+          f"  ({'disk hit' if from_disk else 'MISS'})")
+
+    # 2. Per interaction: fresh connection per call vs pooled sessions
+    conns = server.stats.counts.get("connections", 0)
+    fresh = [turn(base) for _ in range(args.turns)]
+    fresh_conns = server.stats.counts.get("connections", 0) - conns
+    llm, tts = cp.new_session(pool_size=4), cp.new_session(pool_size=4)
+    conns = server.stats.counts.get("connections", 0)
+    pooled = [turn(base, llm, tts) for _ in range(args.turns)]
+    pooled_conns = server.stats.counts.get("connections", 0) - conns
+    print(f"{'one turn (1 LLM + 3 TTS), median':<36}{statistics.median(fresh) * 1000:>9.1f} ms -> "
+          f"{statistics.median(pooled) * 1000:7.1f} ms")
+    print(f"{'  connections opened':<36}{fresh_conns:>12} -> {pooled_conns:>7}   ({args.turns} turns)")
+
+    # 3. Per rerun: theme CSS
+    raw, small = theme_sizes()
+    print(f"{'theme CSS per rerun':<36}{raw:>10} B -> {small:>6} B")
+    server.shutdown()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,171 @@
+"""
+On-disk cache of coach rants and their MP3s.
+
+Teams keep asking the same things ("robot missed the green line", "servo
+twitching"), so a repeat question is answered from SQLite instead of paying
+for another LLM round trip and another voice synthesis.
+
+Key = normalized prompt + hash of the last few conversation turns (+ the
+robot telemetry fingerprint, when attached), so the same question gets a
+fresh answer once the conversation or the robot's behaviour has moved on.
+Audio is stored exactly as ElevenLabs returned it and handed straight back.
+"""
+
+import hashlib
+import json
+import os
+import re
+import sqlite3
+import threading
+import time
+from contextlib import contextmanager
+
+DEFAULT_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), ".coach_cache.sqlite3")
+DEFAULT_TTL_S = 7 * 24 * 3600
+DEFAULT_MAX_BYTES = 50 * 1024 * 1024
+CONTEXT_TURNS = 2   # Previous messages that take part in the key
+
+DISCOVERY_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), ".model_discovery.json")
+DISCOVERY_TTL_S = 24 * 3600
+
+# Words that don't change what the coach should say
+_FILLER = {"a", "an", "the", "my", "our", "is", "are", "it", "its", "just", "again",
+           "so", "very", "really", "please", "coach", "help", "keeps", "kept"}
+
+
+def normalize_prompt(text):
+    """
+    'The robot MISSED the green line!!' -> 'robot missed green line'
+
+    Word order stays: "turn left not right" and "turn right not left" are
+    different questions.
+    """
+    words = re.sub(r"[^a-z0-9 ]+", " ", text.lower()).split()
+    return " ".join(w for w in words if w not in _FILLER)
+
+
+def context_hash(messages, turns=CONTEXT_TURNS):
+    """Hash of the last `turns` messages (role + normalized content)."""
+    h = hashlib.sha256()
+    for msg in messages[-turns:] if turns else []:
+        h.update(msg['role'].encode())
+        h.update(b"\0")
+        h.update(normalize_prompt(msg['content']).encode())
+        h.update(b"\0")
+    return h.hexdigest()[:16]
+
+
+def cache_key(prompt, messages, model="", telemetry=""):
+    raw = f"{model}\0{normalize_prompt(prompt)}\0{context_hash(messages)}\0{telemetry}"
+    return hashlib.sha256(raw.encode()).hexdigest()
+
+
+class RantCache:
+    """
+    SQLite store with a TTL and an LRU size cap.
+
+    One short-lived connection per call keeps it safe across Streamlit's
+    session threads; the lock only serializes writers inside this process.
+    """
+
+    def __init__(self, path=DEFAULT_PATH, ttl_s=DEFAULT_TTL_S, max_bytes=DEFAULT_MAX_BYTES):
+        self.path = path
+        self.ttl_s = ttl_s
+        self.max_bytes = max_bytes
+        self.lock = threading.Lock()
+        with self._db() as db:
+            db.execute("PRAGMA journal_mode=WAL")
+            db.execute("""CREATE TABLE IF NOT EXISTS rants (
+                key TEXT PRIMARY KEY, prompt TEXT, rant TEXT, audio BLOB,
+                size INTEGER, created REAL, last_used REAL, hits INTEGER DEFAULT 0)""")
+            db.execute("CREATE INDEX IF NOT EXISTS rants_last_used ON rants(last_used)")
+            db.execute("CREATE TABLE IF NOT EXISTS counters (name TEXT PRIMARY KEY, value INTEGER)")
+
+    @contextmanager
+    def _db(self):
+        db = sqlite3.connect(self.path, timeout=5)
+        try:
+            with db:   # Commits on success, rolls back on error
+                yield db
+        finally:
+            db.close()
+
+    def _bump(self, db, name):
+        db.execute("INSERT INTO counters VALUES (?, 1) ON CONFLICT(name) DO UPDATE SET value = value + 1", (name,))
+
+    def get(self, key):
+        """Returns (rant, audio_bytes_or_None), or None on a miss/expired entry."""
+        now = time.time()
+        with self.lock, self._db() as db:
+            row = db.execute("SELECT rant, audio, created FROM rants WHERE key = ?", (key,)).fetchone()
+            if row and now - row[2] > self.ttl_s:
+                db.execute("DELETE FROM rants WHERE key = ?", (key,))
+                row = None
+            if row is None:
+                self._bump(db, "misses")
+                return None
+            db.execute("UPDATE rants SET last_used = ?, hits = hits + 1 WHERE key = ?", (now, key))
+            self._bump(db, "hits")
+            return row[0], row[1]
+
+    def put(self, key, prompt, rant, audio):
+        size = len(rant.encode()) + (len(audio) if audio else 0)
+        if size > self.max_bytes:
+            return
+        now = time.time()
+        with self.lock, self._db() as db:
+            db.execute("INSERT OR REPLACE INTO rants (key, prompt, rant, audio, size, created, last_used) "
+                       "VALUES (?, ?, ?, ?, ?, ?, ?)", (key, prompt, rant, audio, size, now, now))
+            db.execute("DELETE FROM rants WHERE created < ?", (now - self.ttl_s,))
+            # Evict least recently used until we fit
+            total = db.execute("SELECT COALESCE(SUM(size), 0) FROM rants").fetchone()[0]
+            while total > self.max_bytes:
+                victim = db.execute("SELECT key, size FROM rants ORDER BY last_used LIMIT 1").fetchone()
+                db.execute("DELETE FROM rants WHERE key = ?", (victim[0],))
+                self._bump(db, "evictions")
+                total -= victim[1]
+
+    def stats(self):
+        with self._db() as db:
+            counters = dict(db.execute("SELECT name, value FROM counters").fetchall())
+            entries, total = db.execute("SELECT COUNT(*), COALESCE(SUM(size), 0) FROM rants").fetchone()
+        hits, misses = counters.get("hits", 0), counters.get("misses", 0)
+        lookups = hits + misses
+        return {
+            "hits": hits, "misses": misses, "evictions": counters.get("evictions", 0),
+            "hit_rate": hits / lookups if lookups else 0.0,
+            "entries": entries, "bytes": total, "max_bytes": self.max_bytes,
+        }
+
+    def clear(self):
+        with self.lock, self._db() as db:
+            db.execute("DELETE FROM rants")
+            db.execute("DELETE FROM counters")
+
+
+def cached_discovery(key, discover, path=DISCOVERY_PATH, ttl_s=DISCOVERY_TTL_S):
+    """
+    Disk-backed memo for slow startup lookups (which model to use).
+
+    st.cache_data only lives as long as the process, so every cold start
+    listed all models over the network again. The result is stored under a
+    hash of `key` (which may contain an API key) for `ttl_s`. Failures and
+    empty results are not stored. Returns (value, from_disk).
+    """
+    slot = hashlib.sha256(key.encode()).hexdigest()[:16]
+    try:
+        with open(path, encoding="utf-8") as f:
+            entries = json.load(f)
+    except (OSError, ValueError):
+        entries = {}
+    hit = entries.get(slot)
+    if hit and time.time() - hit["ts"] < ttl_s:
+        return hit["value"], True
+    value = discover()
+    if value:
+        entries[slot] = {"value": value, "ts": time.time()}
+        tmp = f"{path}.{os.getpid()}.tmp"
+        with open(tmp, "w", encoding="utf-8") as f:
+            json.dump(entries, f)
+        os.replace(tmp, path)   # Atomic, so a concurrent cold start never reads half a file
+    return value, False
@@ -0,0 +1,135 @@
+"""
+Keeps long coaching sessions cheap.
+
+Two things grew with every message before this:
+  * the chat log: every rerun rebuilt and re-sent the HTML for ALL bubbles
+  * the prompt:   OpenRouter got the full history on every request
+
+Now only the last `window` bubbles are rendered (each bubble's HTML is built
+once and memoized on the message), and the prompt keeps the newest turns
+that fit a token budget. Turns that fall out of the budget are folded, once,
+into a short digest that rides along as a system message.
+"""
+
+import re
+
+CHAT_WINDOW = 12            # Bubbles rendered in the log
+HISTORY_TOKEN_BUDGET = 800  # Recent turns sent verbatim
+DIGEST_TOKEN_BUDGET = 200   # Summary of everything older
+DIGEST_LINE_CHARS = 90
+
+CHARS_PER_TOKEN = 4         # Rough, but the same on both sides of every comparison
+
+
+def estimate_tokens(text):
+    return len(text) // CHARS_PER_TOKEN + 1
+
+
+# --- RENDERING ---
+
+def bubble_html(msg):
+    if msg['role'] == 'user':
+        return f"""
+<div class="user-row">
+    <div class="user-avatar">🎿</div>
+    <div class="user-bubble">{msg['content']}</div>
+</div>
+"""
+    return f"""
+<div class="coach-row">
+    <div class="coach-avatar">📢</div>
+    <div class="coach-bubble"><b>COACH:</b><br>{msg['content']}</div>
+</div>
+"""
+
+
+def render_window(messages, window=CHAT_WINDOW):
+    """Returns (chat_html, hidden_count). window=None renders everything."""
+    start = 0 if window is None else max(0, len(messages) - window)
+    parts = ['<div class="chat-container">']
+    for msg in messages[start:]:
+        if 'html' not in msg:
+            msg['html'] = bubble_html(msg)
+        parts.append(msg['html'])
+    parts.append('</div>')
+    return "".join(parts), start
+
+
+# --- PROMPT HISTORY ---
+
+def new_digest():
+    return {"upto": 0, "lines": []}
+
+
+def _digest_line(msg):
+    who = "COACH" if msg['role'] == 'coach' else "ROOKIE"
+    text = msg['content'].strip()
+    if msg['role'] == 'coach':
+        # The first sentence of a rant is usually the diagnosis
+        text = re.split(r"(?<=[.!?])\s", text, maxsplit=1)[0]
+    if len(text) > DIGEST_LINE_CHARS:
+        text = text[:DIGEST_LINE_CHARS - 3] + "..."
+    return f"- {who}: {text}"
+
+
+def _fold(digest, messages, cut):
+    """Fold messages[digest.upto:cut] into the digest, dropping the oldest lines past the budget."""
+    for msg in messages[digest["upto"]:cut]:
+        digest["lines"].append(_digest_line(msg))
+    digest["upto"] = max(digest["upto"], cut)
+    while len(digest["lines"]) > 1 and estimate_tokens("\n".join(digest["lines"])) > DIGEST_TOKEN_BUDGET:
+        digest["lines"].pop(0)
+
+
+def digest_text(digest):
+    if not digest["lines"]:
+        return None
+    return "EARLIER IN THIS SESSION (summary, oldest first):\n" + "\n".join(digest["lines"])
+
+
+def recent_turns(messages, digest, budget=HISTORY_TOKEN_BUDGET):
+    """
+    Newest messages that fit `budget` tokens; everything older goes into `digest`.
+
+    Messages are only ever appended, so the cut point only moves forward and
+    each message is summarized at most once over a whole session.
+    """
+    used = 0
+    cut = len(messages)
+    while cut > digest["upto"]:
+        cost = estimate_tokens(messages[cut - 1]['content'])
+        if used + cost > budget:
+            break
+        used += cost
+        cut -= 1
+    # Keep the verbatim part starting on a user turn so roles still alternate
+    while cut < len(messages) and messages[cut]['role'] != 'user':
+        cut += 1
+    _fold(digest, messages, cut)
+    return messages[cut:]
+
+
+def openrouter_messages(system_prompt, history, digest, formatted_input, budget=HISTORY_TOKEN_BUDGET):
+    messages = [{"role": "system", "content": system_prompt}]
+    recent = recent_turns(history, digest, budget)
+    summary = digest_text(digest)
+    if summary:
+        messages.append({"role": "system", "content": summary})
+    for msg in recent:
+        role = "assistant" if msg['role'] == 'coach' else "user"
+        messages.append({"role": role, "content": msg['content']})
+    messages.append({"role": "user", "content": formatted_input})
+    return messages
+
+
+def gemini_history(history, digest, budget=HISTORY_TOKEN_BUDGET):
+    """Seed history for model.start_chat() when a Gemini chat session grows too long."""
+    recent = recent_turns(history, digest, budget)
+    seeded = []
+    summary = digest_text(digest)
+    if summary:
+        seeded.append({"role": "user", "parts": [summary]})
+        seeded.append({"role": "model", "parts": ["NOTED. NOW WHAT'S BROKEN?"]})
+    for msg in recent:
+        seeded.append({"role": "model" if msg['role'] == 'coach' else "user", "parts": [msg['content']]})
+    return seeded
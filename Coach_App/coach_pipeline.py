@@ -0,0 +1,262 @@
+"""
+Network side of the coach: LLM and TTS calls, plus the streaming pipeline.
+
+Nothing in here touches Streamlit, so the same code paths that app.py runs
+can be driven by bench_pipeline.py against local mock servers.
+
+Two ways to get a rant on screen:
+  * SEQUENTIAL: fetch the whole reply, then synthesize the whole reply.
+  * PIPELINED:  stream LLM tokens, cut them into sentences as they arrive,
+                and synthesize each sentence on a worker thread while the
+                next one is still being generated. Audio comes back in order.
+"""
+
+import json
+import queue
+import re
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import requests
+
+OPENROUTER_BASE_URL = "https://openrouter.ai/api"
+ELEVENLABS_BASE_URL = "https://api.elevenlabs.io"
+
+
+def openrouter_url(base=OPENROUTER_BASE_URL):
+    return base.rstrip("/") + "/v1/chat/completions"
+
+
+def elevenlabs_url(base=ELEVENLABS_BASE_URL):
+    return base.rstrip("/") + "/v1/text-to-speech/{voice_id}"
+
+
+OPENROUTER_API_URL = openrouter_url()
+ELEVENLABS_TTS_URL = elevenlabs_url()
+
+TTS_MODEL_ID = "eleven_flash_v2_5"
+TTS_OUTPUT_FORMAT = "mp3_44100_128"   # Fixed bitrate so we can estimate clip length
+TTS_BITRATE_BPS = 128000
+
+LLM_TIMEOUT_S = 10
+TTS_TIMEOUT_S = 5
+
+
+def new_session(pool_size=4):
+    """
+    Keep-alive HTTP client. Reusing one skips the TCP + TLS handshake on
+    every call after the first; pool_size should cover the concurrent
+    callers (TTS workers). Every call below takes `session=`, and falls
+    back to a one-shot connection without it.
+    """
+    session = requests.Session()
+    adapter = requests.adapters.HTTPAdapter(pool_connections=2, pool_maxsize=pool_size)
+    session.mount("https://", adapter)
+    session.mount("http://", adapter)
+    return session
+
+
+class CoachAPIError(Exception):
+    """Raised when a backend answers with something other than 200."""
+
+    def __init__(self, message, status=None):
+        super().__init__(message)
+        self.status = status
+
+
+# --- LLM ---
+
+def openrouter_headers(api_key):
+    return {
+        "Authorization": f"Bearer {api_key}",
+        "Content-Type": "application/json",
+        "HTTP-Referer": "https://streamlit.io/",
+        "X-Title": "Biathlon Coach",
+    }
+
+
+def fetch_openrouter(messages, api_key, model, url=OPENROUTER_API_URL, timeout=LLM_TIMEOUT_S, session=None):
+    """Blocking chat completion. Returns the full reply text."""
+    payload = {"model": model, "messages": messages}
+    response = (session or requests).post(url, headers=openrouter_headers(api_key), json=payload, timeout=timeout)
+    if response.status_code != 200:
+        raise CoachAPIError(f"LLM HTTP {response.status_code}", response.status_code)
+    return response.json()["choices"][0]["message"]["content"]
+
+
+def stream_openrouter(messages, api_key, model, url=OPENROUTER_API_URL, timeout=LLM_TIMEOUT_S, session=None):
+    """Streaming chat completion (server-sent events). Yields text deltas."""
+    payload = {"model": model, "messages": messages, "stream": True}
+    with (session or requests).post(url, headers=openrouter_headers(api_key), json=payload,
+                                    timeout=timeout, stream=True) as response:
+        if response.status_code != 200:
+            raise CoachAPIError(f"LLM HTTP {response.status_code}", response.status_code)
+        response.encoding = "utf-8"
+        for line in response.iter_lines(decode_unicode=True):
+            # Blank lines separate events; lines starting with ':' are keep-alives
+            if not line or not line.startswith("data:"):
+                continue
+            data = line[5:].strip()
+            if data == "[DONE]":
+                break
+            delta = json.loads(data)["choices"][0].get("delta", {}).get("content")
+            if delta:
+                yield delta
+
+
+# --- TTS ---
+
+def synthesize(text, api_key, voice_id, url=ELEVENLABS_TTS_URL, timeout=TTS_TIMEOUT_S, session=None):
+    """Text -> MP3 bytes via ElevenLabs."""
+    headers = {"xi-api-key": api_key, "Content-Type": "application/json"}
+    data = {
+        "text": text,
+        "model_id": TTS_MODEL_ID,
+        "voice_settings": {"stability": 0.5, "similarity_boost": 0.8},
+    }
+    response = (session or requests).post(url.format(voice_id=voice_id), params={"output_format": TTS_OUTPUT_FORMAT},
+                                          json=data, headers=headers, timeout=timeout)
+    if response.status_code != 200:
+        raise CoachAPIError(response.text, response.status_code)
+    return response.content
+
+
+def mp3_duration_s(mp3_bytes):
+    """Playback length of a constant-bitrate clip, good enough for scheduling."""
+    return len(mp3_bytes) * 8 / TTS_BITRATE_BPS
+
+
+# --- SENTENCE SPLITTING ---
+
+# End of sentence: run of .!? optionally followed by a closing quote/bracket, then whitespace
+_SENTENCE_END = re.compile(r"[.!?]+[\"')\]]*\s+")
+
+
+class SentenceSplitter:
+    """
+    Incrementally cuts a token stream into TTS-sized chunks.
+
+    A chunk is emitted at a sentence boundary once it holds at least
+    `min_chars` characters (so "NO!" doesn't become its own request), or
+    at the last space once it grows past `max_chars` (so a run-on rant
+    still starts talking early).
+    """
+
+    def __init__(self, min_chars=12, max_chars=160):
+        self.min_chars = min_chars
+        self.max_chars = max_chars
+        self.buf = ""
+
+    def feed(self, text):
+        self.buf += text
+        chunks = []
+        while True:
+            cut = None
+            for m in _SENTENCE_END.finditer(self.buf):
+                if m.end() >= self.min_chars:
+                    cut = m.end()
+                    break
+            if cut is None and len(self.buf) > self.max_chars:
+                space = self.buf.rfind(" ", 0, self.max_chars)
+                cut = space + 1 if space > 0 else self.max_chars
+            if cut is None:
+                return chunks
+            chunk = self.buf[:cut].strip()
+            self.buf = self.buf[cut:]
+            if chunk:
+                chunks.append(chunk)
+
+    def flush(self):
+        chunk, self.buf = self.buf.strip(), ""
+        return chunk or None
+
+
+# --- PIPELINE ---
+
+def run_pipeline(tokens, speak, tts_workers=2, tick_s=0.05):
+    """
+    Drive LLM streaming and TTS concurrently; yield UI events in the caller's thread.
+
+    `tokens` is any iterator of text deltas (it is consumed on a background
+    thread), `speak` turns one chunk of text into MP3 bytes. Streamlit
+    elements can only be touched from the script thread, so everything the
+    UI needs comes back through this generator:
+
+        ("text",  delta)          new LLM text
+        ("audio", mp3_bytes)      next clip, always in sentence order
+        ("error", exception)      LLM or TTS failure (the pipeline keeps going);
+                                  exception.stage is "llm" or "tts"
+        ("tick",  None)           nothing new for `tick_s`; lets the UI animate
+        ("done",  stats)          last event; stats holds the latency breakdown
+    """
+    events = queue.Queue()
+    pool = ThreadPoolExecutor(max_workers=tts_workers)
+    start = time.perf_counter()
+
+    def submit(index, chunk):
+        future = pool.submit(speak, chunk)
+        future.add_done_callback(lambda f, i=index: events.put(("tts", i, f)))
+
+    def produce():
+        splitter = SentenceSplitter()
+        count = 0
+        try:
+            for delta in tokens:
+                events.put(("text", delta))
+                for chunk in splitter.feed(delta):
+                    submit(count, chunk)
+                    count += 1
+        except Exception as e:
+            e.stage = "llm"
+            events.put(("error", e))
+        tail = splitter.flush()
+        if tail:
+            submit(count, tail)
+            count += 1
+        events.put(("llm_done", count))
+
+    threading.Thread(target=produce, daemon=True).start()
+
+    stats = {"first_token_s": None, "first_audio_s": None, "llm_s": None, "total_s": None, "chunks": 0}
+    ready = {}
+    next_clip = 0
+    total_clips = None
+    try:
+        while total_clips is None or next_clip < total_clips:
+            try:
+                event = events.get(timeout=tick_s)
+            except queue.Empty:
+                yield ("tick", None)
+                continue
+
+            kind = event[0]
+            if kind == "text":
+                if stats["first_token_s"] is None:
+                    stats["first_token_s"] = time.perf_counter() - start
+                yield event
+            elif kind == "error":
+                yield event
+            elif kind == "llm_done":
+                total_clips = event[1]
+                stats["llm_s"] = time.perf_counter() - start
+                stats["chunks"] = total_clips
+            elif kind == "tts":
+                ready[event[1]] = event[2]
+
+            # Release finished clips strictly in order
+            while next_clip in ready:
+                future = ready.pop(next_clip)
+                next_clip += 1
+                if future.exception() is not None:
+                    future.exception().stage = "tts"
+                    yield ("error", future.exception())
+                    continue
+                if stats["first_audio_s"] is None:
+                    stats["first_audio_s"] = time.perf_counter() - start
+                yield ("audio", future.result())
+    finally:
+        pool.shutdown(wait=False)
+
+    stats["total_s"] = time.perf_counter() - start
+    yield ("done", stats)
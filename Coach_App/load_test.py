@@ -0,0 +1,143 @@
+"""
+Load test: many coaching sessions at once against the mock backends.
+
+    python load_test.py --concurrency 1 8 32 --sessions 32 --turns 3
+    python load_test.py --error-rate 0.05 --hang-rate 0.02 --llm-timeout 4 --tts-timeout 3
+    python load_test.py --base-url http://127.0.0.1:8765     # an already running mock_servers.py
+
+Each simulated session sends `turns` questions with a little think time in
+between, through the same coach_pipeline.py calls the app makes (OpenRouter
++ ElevenLabs; the Gemini SDK path is not driven here). Failures are handled
+the way app.py handles them: an LLM failure becomes the fallback rant, a TTS
+failure leaves that clip silent. Both are counted, by cause.
+"""
+
+import argparse
+import random
+import statistics
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import requests
+
+import coach_pipeline as cp
+from mock_servers import Profile, make_server
+
+
+def classify(exc):
+    if isinstance(exc, requests.Timeout):
+        return "timeout"
+    if isinstance(exc, requests.ConnectionError):
+        return "conn"
+    if isinstance(exc, cp.CoachAPIError):
+        return f"http_{exc.status}"
+    return type(exc).__name__
+
+
+def one_turn(base, args, messages):
+    """Returns (turn_s, first_audio_s or None, llm_error or None, tts_errors)."""
+    llm_url, tts_url = cp.openrouter_url(base), cp.elevenlabs_url(base)
+    speak = lambda text: cp.synthesize(text, "mock", "voice", tts_url, args.tts_timeout)
+    start = time.perf_counter()
+
+    if args.mode == "sequential":
+        try:
+            text = cp.fetch_openrouter(messages, "mock", "mock", llm_url, args.llm_timeout)
+        except Exception as e:
+            return time.perf_counter() - start, None, classify(e), []
+        try:
+            speak(text)
+            return time.perf_counter() - start, time.perf_counter() - start, None, []
+        except Exception as e:
+            return time.perf_counter() - start, None, None, [classify(e)]
+
+    llm_error, tts_errors, first_audio = None, [], None
+    tokens = cp.stream_openrouter(messages, "mock", "mock", llm_url, args.llm_timeout)
+    for kind, value in cp.run_pipeline(tokens, speak, args.tts_workers):
+        if kind == "audio" and first_audio is None:
+            first_audio = time.perf_counter() - start
+        elif kind == "error":
+            if value.stage == "llm":
+                llm_error = classify(value)
+            else:
+                tts_errors.append(classify(value))
+    return time.perf_counter() - start, first_audio, llm_error, tts_errors
+
+
+def run_level(base, args, concurrency):
+    results = []
+    lock = threading.Lock()
+
+    def session(i):
+        rng = random.Random(i)
+        messages = [{"role": "system", "content": "You are COACH AVALANCHE."}]
+        for _ in range(args.turns):
+            messages.append({"role": "user", "content": "Rookie Status: the robot missed the green line"})
+            r = one_turn(base, args, messages)
+            messages.append({"role": "assistant", "content": "GET BACK OUT THERE!"})
+            with lock:
+                results.append(r)
+            time.sleep(rng.uniform(0, args.think))
+
+    sessions = max(args.sessions, concurrency)
+    start = time.perf_counter()
+    with ThreadPoolExecutor(max_workers=concurrency) as pool:
+        list(pool.map(session, range(sessions)))
+    return results, time.perf_counter() - start
+
+
+def pct(values, p):
+    if not values:
+        return float("nan")
+    values = sorted(values)
+    return values[min(len(values) - 1, int(round(p / 100 * (len(values) - 1))))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--base-url", help="Use a running mock (or real) backend instead of starting one")
+    parser.add_argument("--mode", choices=["pipelined", "sequential"], default="pipelined")
+    parser.add_argument("--concurrency", type=int, nargs="+", default=[1, 8, 32])
+    parser.add_argument("--sessions", type=int, default=32)
+    parser.add_argument("--turns", type=int, default=3)
+    parser.add_argument("--think", type=float, default=0.5, help="Max pause between turns (s)")
+    parser.add_argument("--llm-timeout", type=float, default=cp.LLM_TIMEOUT_S)
+    parser.add_argument("--tts-timeout", type=float, default=cp.TTS_TIMEOUT_S)
+    parser.add_argument("--tts-workers", type=int, default=2)
+    Profile.add_arguments(parser)
+    args = parser.parse_args()
+
+    server = None
+    base = args.base_url
+    if not base:
+        args.hang_s = min(args.hang_s, max(args.llm_timeout, args.tts_timeout) + 1)
+        server = make_server(Profile.from_args(args), seed=0)
+        base = server.base_url
+
+    print(f"mode={args.mode} turns/session={args.turns} llm_timeout={args.llm_timeout}s "
+          f"tts_timeout={args.tts_timeout}s tts_workers={args.tts_workers}\n")
+    print(f"{'conc':>5} {'turns':>6} {'ok':>6} | {'turn p50':>8} {'p90':>6} {'p99':>6} | "
+          f"{'audio p50':>9} {'p99':>6} | {'turn/s':>6} | errors")
+    for concurrency in args.concurrency:
+        results, wall = run_level(base, args, concurrency)
+        turn = [r[0] for r in results]
+        audio = [r[1] for r in results if r[1] is not None]
+        errors = {}
+        for r in results:
+            if r[2]:
+                errors["llm_" + r[2]] = errors.get("llm_" + r[2], 0) + 1
+            for e in r[3]:
+                errors["tts_" + e] = errors.get("tts_" + e, 0) + 1
+        clean = sum(1 for r in results if not r[2] and not r[3])
+        err_text = " ".join(f"{k}={v}" for k, v in sorted(errors.items())) or "-"
+        print(f"{concurrency:>5} {len(results):>6} {clean / len(results):>6.0%} | {pct(turn, 50):>7.2f}s "
+              f"{pct(turn, 90):>5.2f}s {pct(turn, 99):>5.2f}s | {pct(audio, 50):>8.2f}s {pct(audio, 99):>5.2f}s | "
+              f"{len(results) / wall:>6.1f} | {err_text}")
+    if server:
+        print(f"\nmock: peak in flight {server.stats.peak_inflight}, {server.stats.counts}")
+        server.shutdown()
+
+
+if __name__ == "__main__":
+    main()
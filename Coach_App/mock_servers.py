@@ -0,0 +1,263 @@
+"""
+Offline stand-ins for the three backends the coach talks to.
+
+One HTTP server answers all of them (their paths don't overlap):
+
+    OpenRouter   POST /v1/chat/completions               (JSON or SSE stream)
+    Gemini       GET  /v1beta/models
+                 POST /v1beta/models/<m>:generateContent
+                 POST /v1beta/models/<m>:streamGenerateContent   (?alt=sse or JSON array)
+    ElevenLabs   POST /v1/text-to-speech/<voice_id>
+
+Latency and failures are driven by a Profile, so timeouts and concurrency can
+be tuned without keys or network. Run it standalone and point the app at it:
+
+    python mock_servers.py --port 8765 --error-rate 0.05 --hang-rate 0.02
+
+    # .streamlit/secrets.toml
+    OPENROUTER_BASE_URL = "http://127.0.0.1:8765"
+    GEMINI_BASE_URL     = "http://127.0.0.1:8765"
+    ELEVENLABS_BASE_URL = "http://127.0.0.1:8765"
+"""
+
+import argparse
+import json
+import random
+import threading
+import time
+from dataclasses import dataclass, fields
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+RANT = ("LISTEN UP ROOKIE! YOUR COLOR SENSOR IS STARING AT THE FLOOR LIKE A SEAL ON ICE. "
+        "CALIBRATE THE GREEN THRESHOLD UNDER VENUE LIGHTING! SHIELD IT FROM THE SUN. "
+        "AND CHECK THOSE 9V BATTERIES, THEY DIE FASTER THAN YOUR DREAMS OF GOLD! "
+        "NOW GET BACK ON THAT TRACK AND DO IT AGAIN UNTIL IT IS PERFECT!")
+
+MOCK_MODEL = "gemini-mock-flash"
+
+
+@dataclass
+class Profile:
+    """How slow and how flaky the fake backends are. Times in seconds."""
+    first_token: float = 0.8         # LLM time to first token
+    token_gap: float = 0.03          # LLM time between tokens
+    prompt_per_ktoken: float = 0.0   # Extra time to first token per 1k prompt tokens (chars / 4)
+    tts_base: float = 0.35           # TTS fixed latency
+    tts_per_char: float = 0.004      # TTS latency per input character
+    jitter: float = 0.0              # Every delay is scaled by uniform(1 - j, 1 + j)
+    error_rate: float = 0.0          # Fraction of requests answered with HTTP 500
+    hang_rate: float = 0.0           # Fraction of requests that stall for `hang_s` (client timeouts)
+    hang_s: float = 30.0
+    max_inflight: int = 0            # > 0: requests past this many in flight get HTTP 429
+    connect_delay: float = 0.0       # Per new connection, stands in for the TCP + TLS handshake
+    list_latency: float = 0.0        # Gemini model listing (GET /v1beta/models)
+
+    @classmethod
+    def add_arguments(cls, parser):
+        for f in fields(cls):
+            parser.add_argument("--" + f.name.replace("_", "-"), type=type(f.default), default=f.default)
+
+    @classmethod
+    def from_args(cls, args):
+        return cls(**{f.name: getattr(args, f.name) for f in fields(cls)})
+
+
+class MockStats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.inflight = 0
+        self.peak_inflight = 0
+        self.counts = {}
+
+    def bump(self, name):
+        with self.lock:
+            self.counts[name] = self.counts.get(name, 0) + 1
+
+
+def make_server(profile, host="127.0.0.1", port=0, seed=None):
+    """Start the mock on a daemon thread. Returns the server; `server.stats` has counters."""
+    if isinstance(profile, dict):
+        profile = Profile(**profile)
+    rng = random.Random(seed)
+    rng_lock = threading.Lock()
+    stats = MockStats()
+
+    def roll():
+        with rng_lock:
+            return rng.random()
+
+    def wait(seconds):
+        if profile.jitter:
+            with rng_lock:
+                seconds *= rng.uniform(1 - profile.jitter, 1 + profile.jitter)
+        time.sleep(max(0.0, seconds))
+
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def log_message(self, *args):
+            pass
+
+        def setup(self):
+            # Once per connection: keep-alive clients pay this only on the first request
+            super().setup()
+            stats.bump("connections")
+            wait(profile.connect_delay)
+
+        # --- plumbing ---
+
+        def send_json(self, obj, status=200):
+            body = json.dumps(obj).encode()
+            self.send_response(status)
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def start_stream(self, content_type):
+            self.send_response(200)
+            self.send_header("Content-Type", content_type)
+            self.send_header("Connection", "close")
+            self.end_headers()
+            self.close_connection = True
+
+        def push(self, data):
+            self.wfile.write(data.encode() if isinstance(data, str) else data)
+            self.wfile.flush()
+
+        def handle_request(self, route):
+            with stats.lock:
+                stats.inflight += 1
+                stats.peak_inflight = max(stats.peak_inflight, stats.inflight)
+                over = profile.max_inflight and stats.inflight > profile.max_inflight
+            try:
+                if over:
+                    stats.bump("429")
+                    return self.send_json({"error": "rate limited"}, 429)
+                if roll() < profile.hang_rate:
+                    stats.bump("hang")
+                    time.sleep(profile.hang_s)
+                if roll() < profile.error_rate:
+                    stats.bump("500")
+                    return self.send_json({"error": "mock failure"}, 500)
+                stats.bump("ok")
+                route()
+            except (BrokenPipeError, ConnectionResetError):
+                stats.bump("client_gone")   # Client gave up (timeout) mid-response
+            finally:
+                with stats.lock:
+                    stats.inflight -= 1
+
+        def body(self):
+            length = int(self.headers.get("Content-Length", 0))
+            return json.loads(self.rfile.read(length) or b"{}")
+
+        # --- routing ---
+
+        def do_GET(self):
+            url = urlparse(self.path)
+            if url.path.startswith("/v1beta/models"):
+                models = {"models": [{"name": f"models/{MOCK_MODEL}", "displayName": "Mock",
+                                      "supportedGenerationMethods": ["generateContent", "countTokens"]}]}
+                self.handle_request(lambda: (wait(profile.list_latency), self.send_json(models)))
+            else:
+                self.send_error(404)
+
+        def do_POST(self):
+            url = urlparse(self.path)
+            body = self.body()
+            if url.path == "/v1/chat/completions":
+                self.handle_request(lambda: self.openrouter(body))
+            elif url.path.startswith("/v1/text-to-speech/"):
+                self.handle_request(lambda: self.elevenlabs(body))
+            elif url.path.startswith("/v1beta/models/") and ":" in url.path:
+                method = url.path.rsplit(":", 1)[1]
+                sse = parse_qs(url.query).get("alt", [""])[0] == "sse"
+                self.handle_request(lambda: self.gemini(body, method, sse))
+            else:
+                self.send_error(404)
+
+        # --- backends ---
+
+        def think(self, prompt_chars):
+            wait(profile.first_token + profile.prompt_per_ktoken * prompt_chars / 4000)
+
+        def words(self):
+            return [w + " " for w in RANT.split()]
+
+        def openrouter(self, body):
+            self.think(sum(len(m.get("content", "")) for m in body.get("messages", [])))
+            words = self.words()
+            if not body.get("stream"):
+                wait(profile.token_gap * (len(words) - 1))
+                return self.send_json({"choices": [{"message": {"role": "assistant", "content": RANT}}]})
+            self.start_stream("text/event-stream")
+            for i, w in enumerate(words):
+                if i:
+                    wait(profile.token_gap)
+                self.push(f"data: {json.dumps({'choices': [{'delta': {'content': w}}]})}\n\n")
+            self.push("data: [DONE]\n\n")
+
+        def gemini(self, body, method, sse):
+            prompt = "".join(p.get("text", "") for c in body.get("contents", []) for p in c.get("parts", []))
+            self.think(len(prompt))
+            words = self.words()
+            chunk = lambda text: {"candidates": [{"content": {"role": "model", "parts": [{"text": text}]},
+                                                  "index": 0}]}
+            if method == "generateContent":
+                wait(profile.token_gap * (len(words) - 1))
+                reply = chunk(RANT)
+                reply["candidates"][0]["finishReason"] = "STOP"
+                return self.send_json(reply)
+            # Gemini streams a few words per chunk
+            groups = ["".join(words[i:i + 4]) for i in range(0, len(words), 4)]
+            self.start_stream("text/event-stream" if sse else "application/json")
+            if not sse:
+                self.push("[")
+            for i, text in enumerate(groups):
+                if i:
+                    wait(profile.token_gap * 4)
+                payload = json.dumps(chunk(text))
+                self.push(f"data: {payload}\r\n\r\n" if sse else ("," if i else "") + payload)
+            if not sse:
+                self.push("]")
+
+        def elevenlabs(self, body):
+            text = body.get("text", "")
+            wait(profile.tts_base + profile.tts_per_char * len(text))
+            # ~15 chars/s of speech at 128 kbps -> 16 kB per second of audio
+            audio = b"\xff\xfb" * int(len(text) / 15 * 8000)
+            self.send_response(200)
+            self.send_header("Content-Type", "audio/mpeg")
+            self.send_header("Content-Length", str(len(audio)))
+            self.end_headers()
+            self.wfile.write(audio)
+
+    server = ThreadingHTTPServer((host, port), Handler)
+    server.daemon_threads = True
+    server.stats = stats
+    server.base_url = f"http://{host}:{server.server_port}"
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8765)
+    Profile.add_arguments(parser)
+    args = parser.parse_args()
+
+    server = make_server(Profile.from_args(args), args.host, args.port)
+    print(f"Mock OpenRouter / Gemini / ElevenLabs on {server.base_url}  (Ctrl+C to stop)")
+    try:
+        while True:
+            time.sleep(5)
+            print(f"  inflight={server.stats.inflight} peak={server.stats.peak_inflight} {server.stats.counts}")
+    except KeyboardInterrupt:
+        server.shutdown()
+
+
+if __name__ == "__main__":
+    main()
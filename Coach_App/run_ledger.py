@@ -0,0 +1,264 @@
+"""
+Append-only, hash-chained record of every robot run.
+
+Each finished run from telemetry.py (timings per state, outcome, compiled-in
+parameters, firmware hash) becomes one row. A row's hash covers its record
+and the previous row's hash, so editing or dropping an old run breaks every
+hash after it; verify() walks the chain. SQLite triggers refuse UPDATE and
+DELETE, and side tables index timeouts and parameters so the questions teams
+actually ask are single indexed queries:
+
+    best time per section          best_times()
+    did the new firmware regress?  regression(section)
+    runs that timed out in X       runs_with_timeout("FIND_BLUE")
+    runs built with SPEED=150      runs_with_param("SPEED_NORMAL", "150")
+
+Everything is local. LocalDevnet is an optional stand-in for the Solana
+devnet: it "confirms" each new chain head as a memo transaction in its own
+append-only file (slot, signature), so anchoring can be exercised offline.
+
+    python run_ledger.py import run.log     # add the runs in a telemetry log
+    python run_ledger.py best
+    python run_ledger.py regress 1
+    python run_ledger.py timeouts FIND_BLUE
+    python run_ledger.py verify
+"""
+
+import argparse
+import hashlib
+import json
+import os
+import sqlite3
+import statistics
+import threading
+import time
+from contextlib import contextmanager
+
+DEFAULT_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), ".run_ledger.sqlite3")
+GENESIS = "0" * 64
+
+
+def canonical(record):
+    return json.dumps(record, sort_keys=True, separators=(",", ":"))
+
+
+def chain_hash(prev_hash, body):
+    return hashlib.sha256(f"{prev_hash}\0{body}".encode()).hexdigest()
+
+
+class LocalDevnet:
+    """
+    Offline stand-in for posting the chain head as a Solana devnet memo.
+
+    Anchors are JSON lines {slot, memo, signature}; each signature covers the
+    previous one, so the anchor log is itself a chain.
+    """
+
+    def __init__(self, path):
+        self.path = path
+        self.lock = threading.Lock()
+
+    def _anchors(self):
+        if not os.path.exists(self.path):
+            return []
+        with open(self.path, encoding="utf-8") as f:
+            return [json.loads(line) for line in f if line.strip()]
+
+    def anchor(self, memo):
+        """Returns the signature of the memo transaction."""
+        with self.lock:
+            anchors = self._anchors()
+            prev = anchors[-1]["signature"] if anchors else GENESIS
+            tx = {"slot": len(anchors) + 1, "ts": time.time(), "memo": memo,
+                  "signature": chain_hash(prev, memo)}
+            with open(self.path, "a", encoding="utf-8") as f:
+                f.write(json.dumps(tx) + "\n")
+            return tx["signature"]
+
+    def confirmed(self):
+        """{signature: memo} for every anchor whose own chain is intact."""
+        out, prev = {}, GENESIS
+        for tx in self._anchors():
+            if chain_hash(prev, tx["memo"]) != tx["signature"]:
+                break
+            out[tx["signature"]] = tx["memo"]
+            prev = tx["signature"]
+        return out
+
+
+class RunLedger:
+    """SQLite ledger; one short-lived connection per call, like RantCache."""
+
+    def __init__(self, path=DEFAULT_PATH, devnet=None):
+        self.path = path
+        self.devnet = devnet
+        self.lock = threading.Lock()
+        with self._db() as db:
+            db.execute("PRAGMA journal_mode=WAL")
+            db.execute("""CREATE TABLE IF NOT EXISTS runs (
+                seq INTEGER PRIMARY KEY, ts REAL, section INTEGER, outcome TEXT,
+                duration_ms INTEGER, firmware TEXT, record TEXT,
+                prev_hash TEXT, hash TEXT UNIQUE, anchor TEXT)""")
+            db.execute("CREATE INDEX IF NOT EXISTS runs_best ON runs(section, outcome, duration_ms)")
+            db.execute("CREATE INDEX IF NOT EXISTS runs_firmware ON runs(section, firmware, seq)")
+            db.execute("CREATE TABLE IF NOT EXISTS run_timeouts (seq INTEGER, state TEXT, hits INTEGER)")
+            db.execute("CREATE INDEX IF NOT EXISTS run_timeouts_state ON run_timeouts(state, seq)")
+            db.execute("CREATE TABLE IF NOT EXISTS run_params (seq INTEGER, name TEXT, value TEXT)")
+            db.execute("CREATE INDEX IF NOT EXISTS run_params_name ON run_params(name, value, seq)")
+            for table in ("runs", "run_timeouts", "run_params"):
+                for op in ("UPDATE", "DELETE"):
+                    db.execute(f"""CREATE TRIGGER IF NOT EXISTS {table}_no_{op.lower()}
+                        BEFORE {op} ON {table} BEGIN SELECT RAISE(ABORT, 'run ledger is append-only'); END""")
+
+    @contextmanager
+    def _db(self):
+        db = sqlite3.connect(self.path, timeout=5)
+        db.row_factory = sqlite3.Row
+        try:
+            with db:
+                yield db
+        finally:
+            db.close()
+
+    def append(self, record):
+        """Chain and store one run record (a dict from telemetry.RunMetrics.record)."""
+        body = canonical(record)
+        with self.lock, self._db() as db:
+            row = db.execute("SELECT hash FROM runs ORDER BY seq DESC LIMIT 1").fetchone()
+            prev = row["hash"] if row else GENESIS
+            digest = chain_hash(prev, body)
+            anchor = self.devnet.anchor(digest) if self.devnet else None
+            cur = db.execute("INSERT INTO runs (ts, section, outcome, duration_ms, firmware, record, prev_hash, hash, anchor) "
+                             "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)",
+                             (time.time(), record.get("section"), record.get("outcome"), record.get("duration_ms"),
+                              record.get("firmware"), body, prev, digest, anchor))
+            seq = cur.lastrowid
+            db.executemany("INSERT INTO run_timeouts VALUES (?, ?, ?)",
+                           [(seq, state, n) for state, n in record.get("timeouts", {}).items()])
+            db.executemany("INSERT INTO run_params VALUES (?, ?, ?)",
+                           [(seq, k, str(v)) for k, v in record.get("params", {}).items()])
+        return {"seq": seq, "hash": digest, "anchor": anchor}
+
+    def verify(self):
+        """(ok, first_bad_seq). Also checks anchors when a devnet is attached."""
+        confirmed = self.devnet.confirmed() if self.devnet else None
+        prev = GENESIS
+        with self._db() as db:
+            for row in db.execute("SELECT seq, record, prev_hash, hash, anchor FROM runs ORDER BY seq"):
+                if row["prev_hash"] != prev or chain_hash(prev, row["record"]) != row["hash"]:
+                    return False, row["seq"]
+                if confirmed is not None and row["anchor"] and confirmed.get(row["anchor"]) != row["hash"]:
+                    return False, row["seq"]
+                prev = row["hash"]
+        return True, None
+
+    # --- queries ---
+
+    def _runs(self, rows):
+        return [dict(r) | {"record": json.loads(r["record"])} for r in rows]
+
+    def count(self):
+        with self._db() as db:
+            return db.execute("SELECT COUNT(*) FROM runs").fetchone()[0]
+
+    def recent(self, n=10):
+        with self._db() as db:
+            return self._runs(db.execute("SELECT * FROM runs ORDER BY seq DESC LIMIT ?", (n,)))
+
+    def best_times(self):
+        """{section: fastest completed run}."""
+        with self._db() as db:
+            rows = db.execute("""SELECT r.* FROM runs r JOIN (
+                    SELECT section, MIN(duration_ms) AS best FROM runs WHERE outcome = 'complete' GROUP BY section
+                ) b ON r.section = b.section AND r.duration_ms = b.best AND r.outcome = 'complete'
+                GROUP BY r.section ORDER BY r.section""")
+            return {r["section"]: r for r in self._runs(rows)}
+
+    def regression(self, section):
+        """
+        Latest firmware vs the one before it, for one section: run count,
+        completion rate and median completed time. None until two firmwares exist.
+        """
+        with self._db() as db:
+            firmwares = [r[0] for r in db.execute(
+                "SELECT firmware, MAX(seq) AS last FROM runs WHERE section = ? AND firmware IS NOT NULL "
+                "GROUP BY firmware ORDER BY last DESC LIMIT 2", (section,))]
+            if len(firmwares) < 2:
+                return None
+            out = {}
+            for label, fw in zip(("current", "previous"), firmwares):
+                rows = db.execute("SELECT outcome, duration_ms FROM runs WHERE section = ? AND firmware = ?",
+                                  (section, fw)).fetchall()
+                times = [r["duration_ms"] for r in rows if r["outcome"] == "complete"]
+                out[label] = {"firmware": fw, "runs": len(rows), "completion": len(times) / len(rows),
+                              "median_ms": statistics.median(times) if times else None}
+        cur, prev = out["current"]["median_ms"], out["previous"]["median_ms"]
+        out["delta_ms"] = cur - prev if cur is not None and prev is not None else None
+        out["regressed"] = (out["current"]["completion"] < out["previous"]["completion"]
+                            or (out["delta_ms"] is not None and out["delta_ms"] > 0))
+        return out
+
+    def runs_with_timeout(self, state, section=None, limit=50):
+        sql = "SELECT r.* FROM run_timeouts t JOIN runs r ON r.seq = t.seq WHERE t.state = ?"
+        args = [state]
+        if section is not None:
+            sql += " AND r.section = ?"
+            args.append(section)
+        with self._db() as db:
+            return self._runs(db.execute(sql + " ORDER BY r.seq DESC LIMIT ?", (*args, limit)))
+
+    def runs_with_param(self, name, value=None, limit=50):
+        sql = "SELECT r.* FROM run_params p JOIN runs r ON r.seq = p.seq WHERE p.name = ?"
+        args = [name]
+        if value is not None:
+            sql += " AND p.value = ?"
+            args.append(str(value))
+        with self._db() as db:
+            return self._runs(db.execute(sql + " ORDER BY r.seq DESC LIMIT ?", (*args, limit)))
+
+    def timeout_states(self):
+        with self._db() as db:
+            return [r[0] for r in db.execute("SELECT DISTINCT state FROM run_timeouts ORDER BY state")]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--db", default=DEFAULT_PATH)
+    parser.add_argument("--devnet", help="Anchor log file for the local devnet stand-in")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    sub.add_parser("import").add_argument("log")
+    sub.add_parser("best")
+    sub.add_parser("regress").add_argument("section", type=int)
+    sub.add_parser("timeouts").add_argument("state")
+    p = sub.add_parser("param")
+    p.add_argument("name")
+    p.add_argument("value", nargs="?")
+    sub.add_parser("verify")
+    args = parser.parse_args()
+
+    ledger = RunLedger(args.db, LocalDevnet(args.devnet) if args.devnet else None)
+    show = lambda r: print(f"#{r['seq']:<5} section {r['section']} {r['outcome']:<9} "
+                           f"{r['duration_ms'] / 1000:7.1f}s  fw {r['firmware'] or '-'}  {r['hash'][:12]}")
+    if args.cmd == "import":
+        from telemetry import replay
+        added = []
+        replay(args.log, lambda rec: added.append(ledger.append(rec)))
+        print(f"{len(added)} runs added, {ledger.count()} in ledger")
+    elif args.cmd == "best":
+        for run in ledger.best_times().values():
+            show(run)
+    elif args.cmd == "regress":
+        print(json.dumps(ledger.regression(args.section), indent=2))
+    elif args.cmd == "timeouts":
+        for run in ledger.runs_with_timeout(args.state):
+            show(run)
+    elif args.cmd == "param":
+        for run in ledger.runs_with_param(args.name, args.value):
+            show(run)
+    elif args.cmd == "verify":
+        ok, bad = ledger.verify()
+        print(f"chain OK ({ledger.count()} runs)" if ok else f"chain BROKEN at run #{bad}")
+
+
+if __name__ == "__main__":
+    main()
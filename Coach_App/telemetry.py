@@ -0,0 +1,429 @@
+"""
+Live robot telemetry for the coach.
+
+The sketches in standalone/ print, at 9600 baud:
+
+    SECTION 1: START                       banner (once per boot)
+    FW: Mar  3 2026 14:02:11               build stamp
+    PARAMS: SPEED_NORMAL=150,...           tuning constants compiled in
+    STATE: 5 FOLLOW_GREEN ms=15180         every state transition (robot millis)
+    T:15230,5,4,23.4                       every few ticks: millis, state, color, distance
+    Obstacles avoided: 2                   section 3
+    BOOT: ready_ms=450 start_ms=1011 motion_ms=1042 not_ready=0   reset to first motion
+    BUDGET: budget_ms=18000 elapsed_ms=9021 progress=29% ...     time used vs. the section's budget
+    SECTION 1 COMPLETE! / COMPETITION COMPLETE!
+
+A TelemetryReader follows a serial port (pyserial) or a recorded log file on
+a background thread and turns those lines into run metrics: time and visits
+per state, timeouts hit, a color histogram, the closest distance seen and
+mid-run resets. summary() is a short block of text for the prompt,
+fingerprint() is a coarse tag for the rant cache key, and every finished
+run (completed, or cut short by a reset) is handed to `on_run` as a plain
+dict for the run ledger.
+
+Log files are plain serial output. Lines may start with "<host ms>\\t"; live
+sessions are recorded that way so replays keep real timing. A ring file
+written by host/serial_capture is read in place (source "ring:robot.ring"),
+so the app can watch alongside other tools instead of holding the port.
+
+    python telemetry.py run.log                      # replay, print summary
+    python telemetry.py --port COM3 --record run.log # live, record, print every 5 s
+"""
+
+import argparse
+import hashlib
+import os
+import mmap
+import re
+import struct
+import threading
+import time
+
+BAUD = 9600
+MAX_SUMMARY_CHARS = 600
+TOP_STATES = 6
+
+COLORS = ["NONE", "BLACK", "WHITE", "RED", "GREEN", "BLUE"]
+
+SECTIONS = {
+    1: ("START", ["FOLLOW_BLACK", "APPROACH_BOX", "PICKUP", "FIND_INTERSECTION", "SELECT_GREEN",
+                  "FOLLOW_GREEN", "APPROACH_BLUE", "DROP", "TO_REUPLOAD", "COMPLETE", "TURN"]),
+    2: ("TARGET", ["CLIMB_RAMP", "ON_TARGET", "NAV_BLUE", "NAV_RED", "NAV_GREEN", "REACH_CENTER",
+                   "FIND_BALL", "SHOOT", "RETURN", "COMPLETE", "TURN"]),
+    3: ("OBSTACLE", ["FIND_RED", "FOLLOW_RED", "APPROACH_BOX", "PICKUP", "TO_OBSTACLES", "AVOID_OBS",
+                     "FIND_BLUE", "DROP", "FIND_BLACK", "RETURN_HOME", "COMPLETE"]),
+}
+
+# Give-up timers in the sketches (ms). Leaving one of these states after at
+# least this long means the robot timed out instead of seeing what it wanted.
+TIMEOUTS_MS = {
+    2: {"CLIMB_RAMP": 5000, "FIND_BALL": 3000},
+    3: {"FIND_RED": 3000, "FIND_BLUE": 5000, "FIND_BLACK": 5000, "RETURN_HOME": 5000},
+}
+TIMEOUT_SLACK = 0.95    # Loop ticks are 50 ms+, so allow a little early
+
+RE_STAMP = re.compile(r"^(\d+)\t(.*)$")
+RE_BANNER = re.compile(r"SECTION (\d):")
+RE_STATE = re.compile(r"^STATE:\s*(\d+)(?:\s+(\w+))?(?:\s+ms=(\d+))?")
+RE_TELEM = re.compile(r"^T:(\d+),(\d+),(\d+),(-?[\d.]+)")
+RE_OBSTACLES = re.compile(r"Obstacles avoided:\s*(\d+)")
+RE_COMPLETE = re.compile(r"(SECTION \d|COMPETITION) COMPLETE")
+# host/ring_file.h layout
+RING_MAGIC = b"RBTRING1"
+RING_HEADER = struct.Struct("<8sII4Q")        # magic, version, -, dataOffset, dataCapacity, indexCapacity, startNs
+RING_HEAD, RING_FRAMES = 64, 128
+RING_INDEX, RING_ENTRY = 256, struct.Struct("<QQQI4x")   # seq, timeNs, offset, length
+
+RE_FIRMWARE = re.compile(r"^FW:\s*(.+?)\s*$")
+RE_PARAMS = re.compile(r"^PARAMS:\s*(.+?)\s*$")
+RE_BOOT = re.compile(r"^BOOT:\s*(.+?)\s*$")
+RE_BUDGET = re.compile(r"^BUDGET:\s*(.+?)\s*$")
+
+
+class RunMetrics:
+    """Metrics for the current boot of the robot. Feed it one serial line at a time."""
+
+    def __init__(self):
+        self.section = None
+        self.state = None
+        self.state_since = None
+        self.first_ms = None
+        self.now_ms = None
+        self.dwell_ms = {}      # state -> total ms
+        self.visits = {}        # state -> count
+        self.timeouts = {}      # state -> count
+        self.colors = [0] * len(COLORS)
+        self.min_distance = None
+        self.obstacles = 0
+        self.complete = False
+        self.firmware = None    # Build stamp + params, hashed
+        self.params = {}
+        self.boot = {}          # BOOT: line, ms since reset (ready_ms, start_ms, motion_ms)
+        self.budget = {}        # Latest BUDGET: line (budget_ms, elapsed_ms, spare_ms, ...)
+        self.lines = 0
+
+    def state_name(self, index):
+        names = SECTIONS.get(self.section, (None, []))[1]
+        return names[index] if index < len(names) else f"STATE_{index}"
+
+    def _tick(self, t_ms):
+        if t_ms is None:
+            return
+        if self.first_ms is None:
+            self.first_ms = t_ms
+        self.now_ms = t_ms if self.now_ms is None else max(self.now_ms, t_ms)
+
+    def _leave_state(self):
+        if self.state is None or self.state_since is None or self.now_ms is None:
+            return
+        spent = self.now_ms - self.state_since
+        self.dwell_ms[self.state] = self.dwell_ms.get(self.state, 0) + spent
+        limit = TIMEOUTS_MS.get(self.section, {}).get(self.state)
+        if limit and spent >= limit * TIMEOUT_SLACK:
+            self.timeouts[self.state] = self.timeouts.get(self.state, 0) + 1
+
+    def feed(self, line, t_ms=None):
+        """Returns "banner" when the line starts a new boot, else None."""
+        self.lines += 1
+        if m := RE_TELEM.match(line):
+            # Robot clock is the best we have when the log carries no host stamps
+            self._tick(t_ms if t_ms is not None else int(m[1]))
+            color = int(m[3])
+            if color < len(COLORS):
+                self.colors[color] += 1
+            dist = float(m[4])
+            if 0 < dist < 400 and (self.min_distance is None or dist < self.min_distance):
+                self.min_distance = dist
+            if self.state is None:
+                self.state, self.state_since = self.state_name(int(m[2])), self.now_ms
+                self.visits[self.state] = 1
+            return None
+        state = RE_STATE.match(line)
+        # Robot clock again: blocking states print no T: lines, only their STATE: line
+        self._tick(t_ms if t_ms is not None or not (state and state[3]) else int(state[3]))
+        if m := RE_BANNER.search(line):
+            if RE_COMPLETE.search(line):
+                self.complete = True
+                return None
+            return "banner"
+        if m := state:
+            self._leave_state()
+            self.state = m[2] or self.state_name(int(m[1]))
+            self.state_since = self.now_ms
+            self.visits[self.state] = self.visits.get(self.state, 0) + 1
+        elif m := RE_OBSTACLES.search(line):
+            self.obstacles = int(m[1])
+        elif m := RE_FIRMWARE.match(line):
+            self.firmware = m[1]
+        elif m := RE_PARAMS.match(line):
+            self.params = dict(kv.split("=", 1) for kv in m[1].split(",") if "=" in kv)
+        elif m := RE_BOOT.match(line):
+            self.boot = {k: int(v) for k, v in (kv.split("=", 1) for kv in m[1].split()) if v.isdigit()}
+        elif m := RE_BUDGET.match(line):
+            self.budget = dict(kv.split("=", 1) for kv in m[1].split() if "=" in kv)
+        elif RE_COMPLETE.search(line):
+            self.complete = True
+        return None
+
+    def dwell(self):
+        """Time per state including the one the robot is in right now."""
+        out = dict(self.dwell_ms)
+        if self.state is not None and self.state_since is not None and self.now_ms is not None:
+            out[self.state] = out.get(self.state, 0) + self.now_ms - self.state_since
+        return out
+
+    def firmware_hash(self):
+        """Same build + same compiled-in constants -> same hash."""
+        if self.firmware is None and not self.params:
+            return None
+        params = ",".join(f"{k}={v}" for k, v in sorted(self.params.items()))
+        return hashlib.sha1(f"{self.section}|{self.firmware}|{params}".encode()).hexdigest()[:12]
+
+    def record(self, outcome):
+        """Plain-dict summary of this run for the ledger."""
+        timeouts = dict(self.timeouts)
+        if stuck := self.stuck():
+            timeouts[stuck[0]] = timeouts.get(stuck[0], 0) + 1
+        return {
+            "section": self.section,
+            "outcome": outcome,
+            "duration_ms": (self.now_ms - self.first_ms) if self.now_ms is not None else 0,
+            "firmware": self.firmware_hash(),
+            "build": self.firmware,
+            "params": dict(self.params),
+            "state_ms": self.dwell(),
+            "visits": dict(self.visits),
+            "timeouts": timeouts,
+            "colors": {COLORS[i]: n for i, n in enumerate(self.colors) if n},
+            "min_distance": self.min_distance,
+            "obstacles": self.obstacles,
+            "boot": dict(self.boot),
+            "budget": dict(self.budget),
+        }
+
+    def stuck(self):
+        """(state, ms) if the current state is already past its timeout."""
+        limit = TIMEOUTS_MS.get(self.section, {}).get(self.state)
+        if limit and self.state_since is not None and self.now_ms - self.state_since >= limit:
+            return self.state, self.now_ms - self.state_since
+        return None
+
+
+class TelemetryReader:
+    """
+    Follows a serial port or a log file on a daemon thread.
+
+    source: a path to an existing file (replayed, then tailed) or a serial
+    port name. record: optional path; live lines are appended with host
+    timestamps so the run can be replayed later. on_run(record_dict) is
+    called from the reader thread whenever a run finishes. follow=False
+    skips the thread; call feed() yourself (see replay()).
+    """
+
+    def __init__(self, source, record=None, baud=BAUD, on_run=None, follow=True):
+        self.source = source
+        self.record = record
+        self.baud = baud
+        self.on_run = on_run
+        self.lock = threading.Lock()
+        self.run = RunMetrics()
+        self.resets = 0         # Reboots before the run finished: brownouts, crashes
+        self.error = None
+        self.connected = False
+        self._reported = False  # Current run already handed to on_run
+        self._stop = threading.Event()
+        self._t0 = time.monotonic()
+        self._thread = threading.Thread(target=self._loop, daemon=True)
+        if follow:
+            self._thread.start()
+
+    @property
+    def is_file(self):
+        return os.path.isfile(self.source)
+
+    @property
+    def is_ring(self):
+        return self.source.startswith("ring:")
+
+    def close(self):
+        self._stop.set()
+        if self._thread.is_alive():
+            self._thread.join(timeout=2)
+
+    def feed(self, raw):
+        raw = raw.rstrip("\r\n")
+        t_ms = None
+        if m := RE_STAMP.match(raw):
+            t_ms, raw = int(m[1]), m[2]
+        finished = None
+        with self.lock:
+            if self.run.feed(raw, t_ms) == "banner":
+                section = int(RE_BANNER.search(raw)[1])
+                if self.run.visits and not self.run.complete:
+                    self.resets += 1
+                    finished = self.run.record("reset")
+                self.run = RunMetrics()
+                self.run.section = section
+                self.run._tick(t_ms)
+                self._reported = False
+            elif self.run.complete and not self._reported:
+                finished = self.run.record("complete")
+                self._reported = True
+        if finished and self.on_run:
+            self.on_run(finished)
+
+    def _loop(self):
+        try:
+            if self.is_ring:
+                self._follow_ring(self.source[5:])
+            elif self.is_file:
+                self._follow_file()
+            else:
+                self._follow_serial()
+        except Exception as e:
+            self.error = str(e)
+        self.connected = False
+
+    def _follow_file(self):
+        with open(self.source, encoding="utf-8", errors="replace") as f:
+            self.connected = True
+            while not self._stop.is_set():
+                line = f.readline()
+                if line:
+                    self.feed(line)
+                else:
+                    time.sleep(0.25)
+
+    def _follow_ring(self, path):
+        """Same protocol as ring::Cursor: skip frames the writer lapped."""
+        with open(path, "rb") as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as m:
+            magic, _, _, data_off, cap, index_cap, start_ns = RING_HEADER.unpack_from(m, 0)
+            if magic != RING_MAGIC:
+                raise ValueError(f"{path} is not a ring file")
+            u64 = lambda off: struct.unpack_from("<Q", m, off)[0]
+            frames = u64(RING_FRAMES)
+            nxt = frames - index_cap if frames > index_cap else 0
+            self.connected = True
+            while not self._stop.is_set():
+                if nxt >= u64(RING_FRAMES):
+                    time.sleep(0.05)
+                    continue
+                slot = RING_INDEX + (nxt % index_cap) * RING_ENTRY.size
+                seq, t_ns, offset, length = RING_ENTRY.unpack_from(m, slot)
+                start = offset % cap
+                end = start + length
+                raw = m[data_off + start:data_off + min(end, cap)] + m[data_off:data_off + max(0, end - cap)]
+                valid = RING_ENTRY.unpack_from(m, slot)[0] == seq == nxt + 1 and u64(RING_HEAD) - offset <= cap
+                nxt += 1
+                if valid:
+                    self.feed(f"{(t_ns - start_ns) // 1_000_000}\t{raw.decode('utf-8', errors='replace')}")
+
+    def _follow_serial(self):
+        import serial   # pyserial; only needed for live robots
+        log = open(self.record, "a", encoding="utf-8") if self.record else None
+        try:
+            with serial.Serial(self.source, self.baud, timeout=0.5) as port:
+                self.connected = True
+                while not self._stop.is_set():
+                    raw = port.readline()
+                    if not raw:
+                        continue
+                    line = raw.decode("utf-8", errors="replace").rstrip("\r\n")
+                    stamped = f"{int((time.monotonic() - self._t0) * 1000)}\t{line}"
+                    if log:
+                        log.write(stamped + "\n")
+                        log.flush()
+                    self.feed(stamped)
+        finally:
+            if log:
+                log.close()
+
+    # --- what the coach sees ---
+
+    def summary(self, max_chars=MAX_SUMMARY_CHARS):
+        """Compact, bounded description of the current run, or None before any data."""
+        with self.lock:
+            run = self.run
+            if not run.lines or (run.state is None and run.section is None):
+                return None
+            name = SECTIONS.get(run.section, ("?",))[0]
+            elapsed = (run.now_ms - run.first_ms) / 1000 if run.now_ms is not None else 0
+            lines = [f"ROBOT TELEMETRY: section {run.section or '?'} {name}, {elapsed:.1f}s"
+                     + (", COMPLETE" if run.complete else "")]
+            dwell = run.dwell()
+            if run.state:
+                lines.append(f"now: {run.state} for {(run.now_ms - run.state_since) / 1000:.1f}s")
+            top = sorted(dwell.items(), key=lambda kv: -kv[1])[:TOP_STATES]
+            if top:
+                lines.append("time per state: " + ", ".join(
+                    f"{s} {ms / 1000:.1f}s x{run.visits.get(s, 0)}" for s, ms in top))
+            timeouts = dict(run.timeouts)
+            if stuck := run.stuck():
+                timeouts[stuck[0]] = timeouts.get(stuck[0], 0) + 1
+            if timeouts:
+                lines.append("timeouts hit: " + ", ".join(f"{s} x{n}" for s, n in timeouts.items()))
+            total = sum(run.colors)
+            if total:
+                hist = sorted(((n, COLORS[i]) for i, n in enumerate(run.colors) if n), reverse=True)
+                lines.append("colors seen: " + " ".join(f"{c} {n / total:.0%}" for n, c in hist))
+            if run.min_distance is not None:
+                lines.append(f"closest object: {run.min_distance:.1f}cm")
+            if run.section == 3:
+                lines.append(f"obstacles avoided: {run.obstacles}")
+            if self.resets:
+                lines.append(f"robot RESET mid-run {self.resets}x (power/brownout?)")
+        text = "\n".join(lines)
+        return text if len(text) <= max_chars else text[:max_chars - 3] + "..."
+
+    def fingerprint(self):
+        """
+        Coarse run signature for the cache key: the same complaint about a
+        robot stuck in the same place hits the cache, a different failure misses.
+        """
+        with self.lock:
+            run = self.run
+            if run.state is None and run.section is None:
+                return ""
+            total = sum(run.colors)
+            dominant = COLORS[run.colors.index(max(run.colors))] if total else "-"
+            stuck = run.stuck()
+            parts = [str(run.section), run.state or "-", "done" if run.complete else "",
+                     ",".join(sorted(run.timeouts) + ([stuck[0]] if stuck else [])),
+                     dominant, "reset" if self.resets else ""]
+        return hashlib.sha1("|".join(parts).encode()).hexdigest()[:12]
+
+
+def replay(path, on_run):
+    """Feed a whole log synchronously; on_run gets every finished run."""
+    reader = TelemetryReader(path, on_run=on_run, follow=False)
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            reader.feed(line)
+    return reader
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", nargs="?", help="Recorded log to replay")
+    parser.add_argument("--port", help="Serial port of a live robot (e.g. COM3, /dev/ttyACM0)")
+    parser.add_argument("--record", help="Append live lines, timestamped, to this file")
+    args = parser.parse_args()
+    if not (args.log or args.port):
+        parser.error("give a log file or --port")
+
+    reader = TelemetryReader(args.port or args.log, record=args.record)
+    if args.log and not args.port:
+        time.sleep(0.5)     # Replay is instant; one read pass is enough
+        print(reader.error or reader.summary() or "(no telemetry in log)")
+        print(f"fingerprint: {reader.fingerprint()}")
+        return
+    try:
+        while True:
+            time.sleep(5)
+            print(reader.error or reader.summary() or "(waiting for robot...)", end="\n\n")
+    except KeyboardInterrupt:
+        reader.close()
+
+
+if __name__ == "__main__":
+    main()
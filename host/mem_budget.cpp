@@ -0,0 +1,429 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║                  MEM BUDGET: where did the SRAM go?                       ║
+ * ║                                                                           ║
+ * ║  Reads a sketch's linker map and prints static RAM per module (sketch,    ║
+ * ║  core, each library, toolchain), the biggest variables, and how much      ║
+ * ║  RAM is left once the stack is accounted for. Exits 1 when that           ║
+ * ║  headroom is under budget, so a build script can stop right there.        ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * WHAT COUNTS:
+ * ============
+ *   static    .data, .bss, .noinit and any other section placed in RAM
+ *   stack     the linker's stack section (UNO R4: .stack_dummy), or
+ *             --stack bytes when the toolchain has none (AVR), or the
+ *             measured high-water mark, whichever is largest
+ *   heap      not counted: it's whatever is left over, so it IS the headroom
+ *
+ *   headroom = RAM - static - stack   must be >= the configured minimum
+ *
+ * With a fixed stack section (R4) the measured high-water mark must also
+ * stay --stack-margin bytes below its top: past that the stack overflows
+ * into the heap no matter how much RAM is free.
+ *
+ * The measured stack comes from diagnostic.ino's "m" command, which paints
+ * the stack at boot and prints "STACK: used=<n> size=<n>". Save the serial
+ * output after running the tests and pass it with --stack-log.
+ *
+ * LINKER MAP:
+ * arduino-cli writes one into the build folder with
+ *   --build-property "compiler.c.elf.extra_flags=-Wl,-Map,{build.path}/{build.project_name}.map"
+ * (host/mem_report.sh does this for every sketch.)
+ *
+ * BUILD:  g++ -std=c++17 -O2 -Wall -o mem_budget mem_budget.cpp
+ *
+ * USAGE:
+ *   mem_budget build/start_section/start_section.ino.map
+ *   mem_budget --config mem_budget.cfg --sketch diagnostic --stack-log diag.log diagnostic.ino.map
+ *   mem_budget --ram 2048 --stack 512 --headroom 256 classic_uno.map
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                               SETTINGS                                     ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+constexpr long DEFAULT_HEADROOM = 1024;   // Bytes that must stay free
+constexpr long DEFAULT_MARGIN   = 256;    // Unused bytes a fixed stack section must keep
+constexpr int  TOP_SYMBOLS      = 12;     // Biggest variables listed
+
+struct Budget {
+  long ram = 0;        // 0 = size of the map's RAM region
+  long stack = 0;      // Stack to reserve when the map has no stack section
+  long headroom = DEFAULT_HEADROOM;
+  long stackMargin = DEFAULT_MARGIN;
+};
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                              MAP PARSING                                   ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+struct Region {
+  std::string name, attrs;
+  unsigned long origin = 0, length = 0;
+};
+
+struct Piece {
+  std::string output;    // Output section (.data, .bss, ...)
+  std::string input;     // Input section (.bss.lastColor, COMMON, *fill*)
+  std::string file;      // Object or archive(member); empty for fill
+  unsigned long addr = 0, size = 0;
+};
+
+struct OutputSection {
+  std::string name;
+  unsigned long addr = 0, size = 0;
+};
+
+struct LinkMap {
+  std::vector<Region> regions;
+  std::vector<OutputSection> sections;
+  std::vector<Piece> pieces;
+};
+
+static bool parseHex(const std::string& s, unsigned long& out) {
+  if (s.size() < 3 || s[0] != '0' || (s[1] != 'x' && s[1] != 'X')) return false;
+  char* end;
+  out = std::strtoul(s.c_str() + 2, &end, 16);
+  return *end == '\0';
+}
+
+static std::vector<std::string> splitWords(const std::string& line, int maxWords) {
+  std::vector<std::string> words;
+  size_t i = 0;
+  while (i < line.size()) {
+    while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) i++;
+    if (i >= line.size()) break;
+    if (int(words.size()) == maxWords - 1) {   // Last word takes the rest (paths with spaces)
+      size_t end = line.find_last_not_of(" \t\r");
+      words.push_back(line.substr(i, end + 1 - i));
+      break;
+    }
+    size_t start = i;
+    while (i < line.size() && line[i] != ' ' && line[i] != '\t' && line[i] != '\r') i++;
+    words.push_back(line.substr(start, i - start));
+  }
+  return words;
+}
+
+/**
+ * parseMap() - GNU ld map file (avr-gcc and arm-none-eabi-gcc write the
+ * same format). Three parts matter:
+ *
+ *   Memory Configuration           region name, origin, length
+ *   Linker script and memory map   ".bss  0x20000400  0x5f8"       output
+ *                                  " .bss.x  0x20000400  0x4 a.o"  input
+ *
+ * Long section names push address and size onto the next line; "Discarded
+ * input sections" (before the memory map) is skipped.
+ */
+static bool parseMap(const char* path, LinkMap& map) {
+  std::ifstream in(path);
+  if (!in) return false;
+  enum { PREAMBLE, MEMORY, LAYOUT } part = PREAMBLE;
+  std::string line, pendingName, output;
+  bool pendingIsOutput = false;
+
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.rfind("Memory Configuration", 0) == 0) { part = MEMORY; continue; }
+    if (line.rfind("Linker script and memory map", 0) == 0) { part = LAYOUT; continue; }
+
+    if (part == MEMORY) {
+      auto w = splitWords(line, 4);
+      Region r;
+      if (w.size() >= 3 && parseHex(w[1], r.origin) && parseHex(w[2], r.length) && w[0] != "*default*") {
+        r.name = w[0];
+        r.attrs = w.size() > 3 ? w[3] : "";
+        map.regions.push_back(r);
+      }
+      continue;
+    }
+    if (part != LAYOUT || line.empty()) continue;
+
+    // Continuation of a name that was too long for its column
+    if (!pendingName.empty()) {
+      std::string joined = (pendingIsOutput ? "" : " ") + pendingName + " " + line;
+      pendingName.clear();
+      line = joined;
+    }
+
+    if (line[0] == '.') {   // Output section
+      auto w = splitWords(line, 4);
+      OutputSection s;
+      if (w.size() == 1) { pendingName = w[0]; pendingIsOutput = true; continue; }
+      if (w.size() >= 3 && parseHex(w[1], s.addr) && parseHex(w[2], s.size)) {
+        s.name = w[0];
+        map.sections.push_back(s);
+        output = s.name;
+      }
+      continue;
+    }
+    if (line[0] != ' ' || line.size() < 2 || line[1] == ' ' || output.empty()) continue;
+
+    // Input section: " .bss.x 0x.. 0x.. file", " COMMON ...", " *fill* 0x.. 0x.."
+    auto w = splitWords(line, 4);
+    if (w.empty() || (w[0][0] == '*' && w[0] != "*fill*")) continue;   // " *(.bss*)" patterns
+    if (w.size() == 1) { pendingName = w[0]; pendingIsOutput = false; continue; }
+    Piece p;
+    if (w.size() >= 3 && parseHex(w[1], p.addr) && parseHex(w[2], p.size) && p.size > 0) {
+      p.output = output;
+      p.input = w[0];
+      p.file = w.size() > 3 ? w[3] : "";
+      map.pieces.push_back(p);
+    }
+  }
+  return !map.sections.empty();
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                              CLASSIFYING                                   ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+static std::string baseName(const std::string& path) {
+  size_t slash = path.find_last_of("/\\");
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+/**
+ * moduleOf() - Which part of the build an object came from. arduino-cli
+ * puts the sketch under sketch/, the board core under core/ (or core.a),
+ * libraries under libraries/<Name>/; everything else is the toolchain.
+ */
+static std::string moduleOf(const std::string& file) {
+  if (file.empty()) return "(alignment)";
+  std::string p = file;
+  std::replace(p.begin(), p.end(), '\\', '/');
+  size_t lib = p.find("/libraries/");
+  if (lib != std::string::npos) {
+    size_t start = lib + 11;
+    return "lib " + p.substr(start, p.find('/', start) - start);
+  }
+  if (p.find("/sketch/") != std::string::npos) return "sketch";
+  if (p.find("/core/") != std::string::npos || p.find("core.a(") != std::string::npos) return "core";
+  size_t paren = p.find('(');
+  std::string archive = baseName(paren == std::string::npos ? p : p.substr(0, paren));
+  return "toolchain " + archive;
+}
+
+static bool isStack(const std::string& s) { return s.find("stack") != std::string::npos; }
+static bool isHeap(const std::string& s) { return s.find("heap") != std::string::npos; }
+
+/** The RAM region: named RAM or data (AVR), else the first writable one. */
+static const Region* ramRegion(const LinkMap& map) {
+  for (const auto& r : map.regions) {
+    std::string n = r.name;
+    std::transform(n.begin(), n.end(), n.begin(), ::tolower);
+    if (n == "ram" || n == "data") return &r;
+  }
+  for (const auto& r : map.regions)
+    if (r.attrs.find('w') != std::string::npos) return &r;
+  return nullptr;
+}
+
+/** Largest "STACK: used=<n>" in a serial log, -1 if there is none. */
+static long measuredStack(const char* path) {
+  std::ifstream in(path);
+  std::string line;
+  long best = -1;
+  while (std::getline(in, line)) {
+    size_t at = line.find("STACK: used=");
+    if (at != std::string::npos) best = std::max(best, std::atol(line.c_str() + at + 12));
+  }
+  return best;
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                                CONFIG                                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/**
+ * loadConfig() - mem_budget.cfg lines: "<sketch|*> key=value ...", keys
+ * ram, stack, headroom, stack_margin. "*" applies to every sketch; a sketch's own line
+ * overrides it.
+ */
+static bool loadConfig(const char* path, const std::string& sketch, Budget& b) {
+  std::ifstream in(path);
+  if (!in) return false;
+  std::string line;
+  for (int pass = 0; pass < 2; pass++) {   // "*" first, then the sketch
+    in.clear();
+    in.seekg(0);
+    while (std::getline(in, line)) {
+      line = line.substr(0, line.find('#'));
+      std::istringstream words(line);
+      std::string who, kv;
+      if (!(words >> who) || who != (pass == 0 ? "*" : sketch)) continue;
+      while (words >> kv) {
+        size_t eq = kv.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = kv.substr(0, eq);
+        long value = std::atol(kv.c_str() + eq + 1);
+        if (key == "ram") b.ram = value;
+        else if (key == "stack") b.stack = value;
+        else if (key == "headroom") b.headroom = value;
+        else if (key == "stack_margin") b.stackMargin = value;
+      }
+    }
+  }
+  return true;
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                                REPORT                                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+struct Usage {
+  unsigned long data = 0, bss = 0;
+  unsigned long total() const { return data + bss; }
+};
+
+static bool inRegion(const Region* r, unsigned long addr) {
+  return !r || (addr >= r->origin && addr < r->origin + r->length);
+}
+
+/** Prints the report; returns false when a budget is violated. */
+static bool report(const LinkMap& map, const std::string& sketch, const Budget& budget, long measured) {
+  const Region* region = ramRegion(map);
+  long ram = budget.ram ? budget.ram : region ? long(region->length) : 0;
+  if (ram <= 0) {
+    std::fprintf(stderr, "mem_budget: no RAM region in the map; pass --ram BYTES\n");
+    return false;
+  }
+
+  // Output sections in RAM: static, stack or heap
+  unsigned long stackSection = 0, heapSection = 0;
+  std::map<std::string, bool> staticSections;
+  for (const auto& s : map.sections) {
+    if (!s.size || !inRegion(region, s.addr)) continue;
+    if (isStack(s.name)) stackSection += s.size;
+    else if (isHeap(s.name)) heapSection += s.size;
+    else staticSections[s.name] = true;
+  }
+
+  std::map<std::string, Usage> modules;
+  std::vector<const Piece*> symbols;
+  Usage all;
+  for (const auto& p : map.pieces) {
+    if (!staticSections.count(p.output) || !inRegion(region, p.addr)) continue;
+    bool zeroed = p.output.find("bss") != std::string::npos || p.output.find("noinit") != std::string::npos;
+    Usage& u = modules[moduleOf(p.file)];
+    (zeroed ? u.bss : u.data) += p.size;
+    (zeroed ? all.bss : all.data) += p.size;
+    if (!p.file.empty()) symbols.push_back(&p);
+  }
+  // Anything the output sections hold that no input line explained (linker padding, script symbols)
+  unsigned long sectionTotal = 0;
+  for (const auto& s : map.sections)
+    if (staticSections.count(s.name) && inRegion(region, s.addr)) sectionTotal += s.size;
+  if (sectionTotal > all.total()) {
+    modules["(alignment)"].bss += sectionTotal - all.total();
+    all.bss = sectionTotal - all.data;
+  }
+
+  std::printf("MEMORY REPORT: %s\n", sketch.c_str());
+  std::printf("RAM %ld bytes%s%s\n\n", ram, region ? " (region " : "", region ? (region->name + ")").c_str() : "");
+
+  std::vector<std::pair<std::string, Usage>> byModule(modules.begin(), modules.end());
+  std::stable_sort(byModule.begin(), byModule.end(),
+                   [](const auto& a, const auto& b) { return a.second.total() > b.second.total(); });
+  std::printf("  %-28s %8s %8s %8s %6s\n", "module", "data", "bss", "total", "RAM");
+  for (const auto& [name, u] : byModule)
+    std::printf("  %-28s %8lu %8lu %8lu %5.1f%%\n", name.c_str(), u.data, u.bss, u.total(), 100.0 * u.total() / ram);
+  std::printf("  %-28s %8lu %8lu %8lu %5.1f%%\n\n", "STATIC TOTAL", all.data, all.bss, all.total(),
+              100.0 * all.total() / ram);
+
+  std::stable_sort(symbols.begin(), symbols.end(), [](const Piece* a, const Piece* b) { return a->size > b->size; });
+  std::printf("  biggest variables:\n");
+  for (size_t i = 0; i < symbols.size() && i < size_t(TOP_SYMBOLS); i++)
+    std::printf("  %8lu  %-40s %s\n", symbols[i]->size, symbols[i]->input.c_str(), moduleOf(symbols[i]->file).c_str());
+  std::printf("\n");
+
+  // Stack: the reserved section (R4), the configured reserve (AVR), or what was measured
+  long stack = std::max({long(stackSection), budget.stack, measured});
+  const char* stackFrom = stack == measured ? "measured high-water mark"
+                        : stack == long(stackSection) && stackSection ? "linker stack section" : "configured reserve";
+  long headroom = ram - long(all.total()) - stack;
+  bool ok = headroom >= budget.headroom;
+  bool stackOk = !stackSection || measured < 0 || long(stackSection) - measured >= budget.stackMargin;
+
+  std::printf("  static       %8lu B\n", all.total());
+  std::printf("  stack        %8ld B   (%s)\n", stack, stackFrom);
+  if (measured >= 0) {
+    std::printf("  stack used   %8ld B   (painted, from the log)", measured);
+    if (stackSection) std::printf("  %.0f%% of the %lu B stack, margin >= %ld B   %s", 100.0 * measured / stackSection,
+                                  stackSection, budget.stackMargin, stackOk ? "OK" : "FAIL");
+    std::printf("\n");
+  }
+  if (heapSection) std::printf("  heap         %8lu B   (linker heap section, counted as free)\n", heapSection);
+  std::printf("  headroom     %8ld B   budget >= %ld B   %s\n", headroom, budget.headroom, ok ? "OK" : "FAIL");
+  return ok && stackOk;
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                                  MAIN                                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+static void usage() {
+  std::fprintf(stderr,
+    "usage: mem_budget [options] <sketch.map>\n"
+    "  --config FILE     budgets per sketch (see mem_budget.cfg)\n"
+    "  --sketch NAME     which config line applies (default: from the map name)\n"
+    "  --ram BYTES       RAM size (default: the map's RAM region)\n"
+    "  --stack BYTES     stack to reserve when the map has no stack section\n"
+    "  --headroom BYTES  minimum free RAM (default %ld)\n"
+    "  --stack-margin B  minimum unused stack section (default %ld)\n"
+    "  --stack-log FILE  serial log with diagnostic.ino's STACK: lines\n", DEFAULT_HEADROOM, DEFAULT_MARGIN);
+}
+
+int main(int argc, char** argv) {
+  const char* mapPath = nullptr;
+  const char* configPath = nullptr;
+  const char* stackLog = nullptr;
+  std::string sketch;
+  Budget cli{-1, -1, -1, -1};
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool more = i + 1 < argc;
+    if (a == "--config" && more) configPath = argv[++i];
+    else if (a == "--sketch" && more) sketch = argv[++i];
+    else if (a == "--ram" && more) cli.ram = std::atol(argv[++i]);
+    else if (a == "--stack" && more) cli.stack = std::atol(argv[++i]);
+    else if (a == "--headroom" && more) cli.headroom = std::atol(argv[++i]);
+    else if (a == "--stack-margin" && more) cli.stackMargin = std::atol(argv[++i]);
+    else if (a == "--stack-log" && more) stackLog = argv[++i];
+    else if (a[0] != '-' && !mapPath) mapPath = argv[i];
+    else { usage(); return 2; }
+  }
+  if (!mapPath) { usage(); return 2; }
+  if (sketch.empty()) sketch = baseName(mapPath).substr(0, baseName(mapPath).find('.'));
+
+  Budget budget;
+  if (configPath && !loadConfig(configPath, sketch, budget)) {
+    std::fprintf(stderr, "mem_budget: can't read %s\n", configPath);
+    return 2;
+  }
+  if (cli.ram >= 0) budget.ram = cli.ram;   // Command line beats the config file
+  if (cli.stack >= 0) budget.stack = cli.stack;
+  if (cli.headroom >= 0) budget.headroom = cli.headroom;
+  if (cli.stackMargin >= 0) budget.stackMargin = cli.stackMargin;
+
+  LinkMap map;
+  if (!parseMap(mapPath, map)) {
+    std::fprintf(stderr, "mem_budget: %s is not a GNU ld map file\n", mapPath);
+    return 2;
+  }
+  long measured = stackLog ? measuredStack(stackLog) : -1;
+  if (stackLog && measured < 0) std::fprintf(stderr, "mem_budget: no STACK: lines in %s\n", stackLog);
+  return report(map, sketch, budget, measured) ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#!/bin/sh
+# Build every sketch with arduino-cli, keep its linker map, and check its RAM
+# budget with mem_budget. Reports go to host/mem_reports/<sketch>.txt; the
+# script exits non-zero if any sketch is over budget.
+#
+#   ./mem_report.sh                         # UNO R4 Minima
+#   FQBN=arduino:avr:uno ./mem_report.sh    # classic Uno (set ram= in mem_budget.cfg)
+#   STACK_LOG=diag.log ./mem_report.sh      # also check diagnostic.ino's measured stack
+
+set -u
+cd "$(dirname "$0")"
+FQBN=${FQBN:-arduino:renesas_uno:minima}
+BUILD=${BUILD:-build}
+STACK_LOG=${STACK_LOG:-}
+
+[ -x mem_budget ] || g++ -std=c++17 -O2 -Wall -o mem_budget mem_budget.cpp || exit 2
+mkdir -p mem_reports
+
+failed=""
+for sketch in start_section target_section obstacle_section diagnostic; do
+  out="$BUILD/$sketch"
+  mkdir -p "$out"
+  if ! arduino-cli compile --fqbn "$FQBN" --build-path "$out" \
+       --build-property "compiler.c.elf.extra_flags=-Wl,-Map,{build.path}/{build.project_name}.map" \
+       "../standalone/$sketch" > "$out.log" 2>&1; then
+    echo "$sketch: compile failed, see $out.log"
+    failed="$failed $sketch"
+    continue
+  fi
+  set -- --config mem_budget.cfg --sketch "$sketch"
+  [ -n "$STACK_LOG" ] && [ "$sketch" = diagnostic ] && set -- "$@" --stack-log "$STACK_LOG"
+  ./mem_budget "$@" "$out/$sketch.ino.map" > "mem_reports/$sketch.txt"
+  status=$?
+  grep -E "headroom|FAIL" "mem_reports/$sketch.txt" | sort -u | sed "s/^ */$sketch: /"
+  [ $status -eq 0 ] || failed="$failed $sketch"
+done
+
+if [ -n "$failed" ]; then
+  echo "OVER BUDGET:$failed"
+  exit 1
+fi
+echo "all sketches within budget (reports in host/mem_reports/)"
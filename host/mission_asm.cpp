@@ -0,0 +1,411 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║               MISSION ASSEMBLER: route text -> robot program              ║
+ * ║                                                                           ║
+ * ║  Turns a route written one step per line into a mission sketch's         ║
+ * ║  bytecode (mission_program.h, in every mission folder) and loads it       ║
+ * ║  over the serial port, into the robot's EEPROM. No reflashing.            ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * THE LANGUAGE (one step per line, # starts a comment, cm/ms/deg optional).
+ * The start sketch (--sketch start, the default):
+ *
+ *   follow black until 15cm          line follow until something is that close
+ *   follow black until green|red     ...until one of these colors is under the sensor
+ *   follow green for 3000ms          ...for this long
+ *   approach 5cm                     drive at what's ahead, stop this far from it
+ *   past 8cm                         drive on, stop this far past the last follow's color
+ *   grip                             pick the box up
+ *   release                          put it down
+ *   branch green                     find that branch at the junction, face down it
+ *   turn -90deg                      pivot (+ = left)
+ *
+ * The target sketch (--sketch target):
+ *
+ *   climb 5000ms                     up the ramp until a color, this long at most
+ *   center                           ring by ring inward to the black center
+ *   seek 20cm                        creep until something is that close (the ball)
+ *   shoot                            ram it
+ *   turn -180deg                     on an arc (+ = left)
+ *   drive 4000ms                     straight ahead
+ *
+ * The obstacle sketch (--sketch obstacle):
+ *
+ *   find red                         look for that line (red, blue or black)
+ *   follow red until box             ...until the box, driving around anything else
+ *   follow red avoiding 2            ...around this many obstacles
+ *   approach 5cm, grip, release      as above
+ *   follow black for 5000ms          as above
+ *
+ * And all of them:
+ *
+ *   repeat 2                         the steps up to the matching `end`, twice
+ *   end
+ *   halt                             the mission is over (so is the end of the file)
+ *
+ * Lines: what the sketch's followers know (start: black or green; obstacle:
+ * red, and black for `for`). Colors: black, white, red, green, blue. A step
+ * of another sketch is an error here, and the robot would reject it too.
+ * The built-in programs (BUILTIN_PROGRAM in each sketch) are the routes in
+ * README "Mission Program".
+ *
+ * BUILD:  g++ -std=c++17 -O2 -Wall -o mission_asm mission_asm.cpp
+ *
+ * USAGE:
+ *   mission_asm route.txt                        # prints the PROG line
+ *   mission_asm route.txt --list                 # ...and the bytes per step (stderr)
+ *   mission_asm route.txt --sketch target        # a route for the target sketch
+ *   mission_asm route.txt --port /dev/ttyACM0    # loads it: the robot must be
+ *                                                #   waiting for its start cue
+ *   mission_asm --clear --port /dev/ttyACM0      # back to the built-in program
+ *   mission_asm route.txt > in.txt && sim/build/sim_start sim/scenes/start.scene --input in.txt
+ */
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                               SETTINGS                                     ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+// Keep these in sync with mission_program.h and the sketches' Color enum
+enum Op : uint8_t { OP_HALT, OP_FOLLOW, OP_NEAR, OP_FOR, OP_APPROACH, OP_PAST, OP_GRIP,
+                    OP_RELEASE, OP_BRANCH, OP_TURN, OP_REPEAT, OP_END,
+                    OP_FIND, OP_BOX, OP_AVOID, OP_CLIMB, OP_CENTER, OP_SEEK, OP_SHOOT, OP_DRIVE };
+constexpr const char* COLORS[] = {"none", "black", "white", "red", "green", "blue"};
+constexpr int COLOR_BLACK = 1, COLOR_RED = 3, COLOR_GREEN = 4, COLOR_BLUE = 5;
+constexpr size_t PROGRAM_CODE = 125;   // PROGRAM_BYTES - the header
+constexpr int PROGRAM_DEPTH = 4;
+
+constexpr int REPLY_MS  = 10000;   // Give up on the robot's answer after this
+constexpr int RESEND_MS = 2000;    // Send again this often (it may have been booting)
+
+// What each sketch runs: its STEP_OPS, and the lines its followers know
+struct Sketch {
+  const char* name;
+  uint32_t ops;         // Bit 1 << Op (REPEAT, END and HALT: all of them)
+  uint8_t timedLines;   // Lines `follow <line> for` takes (bit 1 << Color)
+  uint8_t untilLines;   // ...and `follow <line> until/avoiding`
+};
+constexpr uint32_t bit(int n) { return 1u << n; }
+constexpr Sketch SKETCHES[] = {
+  {"start", bit(OP_FOLLOW) | bit(OP_NEAR) | bit(OP_FOR) | bit(OP_APPROACH) | bit(OP_PAST) | bit(OP_GRIP) |
+            bit(OP_RELEASE) | bit(OP_BRANCH) | bit(OP_TURN),
+   bit(COLOR_BLACK) | bit(COLOR_GREEN), bit(COLOR_BLACK) | bit(COLOR_GREEN)},
+  {"target", bit(OP_CLIMB) | bit(OP_CENTER) | bit(OP_SEEK) | bit(OP_SHOOT) | bit(OP_TURN) | bit(OP_DRIVE), 0, 0},
+  {"obstacle", bit(OP_FIND) | bit(OP_BOX) | bit(OP_APPROACH) | bit(OP_GRIP) | bit(OP_AVOID) | bit(OP_RELEASE) |
+               bit(OP_FOR),
+   bit(COLOR_BLACK), bit(COLOR_RED)},
+};
+constexpr uint32_t FLOW_OPS = bit(OP_HALT) | bit(OP_REPEAT) | bit(OP_END);
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                               ASSEMBLER                                    ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+struct Program {
+  std::vector<uint8_t> code;
+  std::vector<std::pair<size_t, std::string>> listing;   // (offset, source line)
+  std::string error;                                      // "file:line: why"
+};
+
+static uint8_t crc8(const std::vector<uint8_t>& code) {
+  uint8_t crc = 0xFF;
+  for (uint8_t b : code) {
+    crc ^= b;
+    for (int i = 0; i < 8; i++) crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+  }
+  return crc;
+}
+
+static int colorIndex(const std::string& name) {
+  for (int i = 0; i < int(sizeof(COLORS) / sizeof(COLORS[0])); i++)
+    if (name == COLORS[i]) return i;
+  return -1;
+}
+
+/** A number with an optional unit suffix; false if it isn't one or is out of lo..hi. */
+static bool number(std::string s, const char* unit, long lo, long hi, long& out) {
+  size_t n = std::strlen(unit);
+  if (s.size() > n && s.compare(s.size() - n, n, unit) == 0) s.resize(s.size() - n);
+  char* end;
+  errno = 0;
+  out = std::strtol(s.c_str(), &end, 10);
+  return !s.empty() && !*end && !errno && out >= lo && out <= hi;
+}
+
+static Program assemble(std::istream& in, const std::string& name, const Sketch& sketch) {
+  Program p;
+  std::string line;
+  int lineNo = 0, depth = 0;
+  auto fail = [&](const std::string& why) {
+    p.error = name + ":" + std::to_string(lineNo) + ": " + why;
+    return p;
+  };
+  while (std::getline(in, line)) {
+    lineNo++;
+    std::string source = line.substr(0, line.find('#'));
+    source.erase(0, source.find_first_not_of(" \t"));
+    source.erase(source.find_last_not_of(" \t\r") + 1);
+    std::istringstream words(source);
+    std::vector<std::string> w;
+    for (std::string s; words >> s; ) w.push_back(s);
+    if (w.empty()) continue;
+    size_t at = p.code.size();
+    const std::string& op = w[0];
+    long v;
+
+    auto lineColor = [&](const std::string& s, uint8_t lines) {
+      int c = colorIndex(s);
+      return c > 0 && lines & bit(c) ? c : -1;
+    };
+    auto cantFollow = [&](const std::string& s) {
+      return fail("the " + std::string(sketch.name) + " sketch can't follow '" + s + "' here");
+    };
+
+    if (op == "follow" && w.size() == 4 && w[2] == "until" && w[3] == "box") {
+      int c = lineColor(w[1], sketch.untilLines);
+      if (c < 0) return cantFollow(w[1]);
+      p.code.insert(p.code.end(), {OP_BOX, uint8_t(c)});
+    } else if (op == "follow" && w.size() == 4 && w[2] == "avoiding") {
+      int c = lineColor(w[1], sketch.untilLines);
+      if (c < 0) return cantFollow(w[1]);
+      if (!number(w[3], "", 1, 255, v)) return fail("'avoiding' takes 1..255 obstacles");
+      p.code.insert(p.code.end(), {OP_AVOID, uint8_t(c), uint8_t(v)});
+    } else if (op == "follow" && w.size() == 4 && w[2] == "until") {
+      int c = lineColor(w[1], sketch.untilLines);
+      if (c < 0) return cantFollow(w[1]);
+      if (number(w[3], "cm", 1, 255, v)) {
+        p.code.insert(p.code.end(), {OP_NEAR, uint8_t(c), uint8_t(v)});
+      } else {
+        uint8_t colors = 0;
+        std::istringstream names(w[3]);
+        for (std::string s; std::getline(names, s, '|'); ) {
+          int k = colorIndex(s);
+          if (k <= 0) return fail("unknown color '" + s + "'");
+          colors |= 1 << k;
+        }
+        p.code.insert(p.code.end(), {OP_FOLLOW, uint8_t(c), colors});
+      }
+    } else if (op == "follow" && w.size() == 4 && w[2] == "for") {
+      int c = lineColor(w[1], sketch.timedLines);
+      if (c < 0) return cantFollow(w[1]);
+      if (!number(w[3], "ms", 1, 32767, v)) return fail("'for' takes 1..32767 ms");
+      p.code.insert(p.code.end(), {OP_FOR, uint8_t(c), uint8_t(v & 0xFF), uint8_t(v >> 8)});
+    } else if ((op == "climb" || op == "drive") && w.size() == 2) {
+      if (!number(w[1], "ms", 1, 32767, v)) return fail("'" + op + "' takes 1..32767 ms");
+      p.code.insert(p.code.end(), {uint8_t(op == "climb" ? OP_CLIMB : OP_DRIVE), uint8_t(v & 0xFF), uint8_t(v >> 8)});
+    } else if ((op == "approach" || op == "past" || op == "seek") && w.size() == 2) {
+      if (!number(w[1], "cm", 0, 255, v)) return fail("'" + op + "' takes 0..255 cm");
+      Op code = op == "approach" ? OP_APPROACH : op == "past" ? OP_PAST : OP_SEEK;
+      p.code.insert(p.code.end(), {uint8_t(code), uint8_t(v)});
+    } else if ((op == "grip" || op == "release" || op == "center" || op == "shoot" || op == "halt") &&
+               w.size() == 1) {
+      p.code.push_back(op == "grip" ? OP_GRIP : op == "release" ? OP_RELEASE : op == "center" ? OP_CENTER :
+                       op == "shoot" ? OP_SHOOT : OP_HALT);
+    } else if (op == "find" && w.size() == 2) {
+      int c = colorIndex(w[1]);   // The obstacle sketch's FIND_RED/BLUE/BLACK
+      if (c != COLOR_RED && c != COLOR_BLUE && c != COLOR_BLACK) return fail("can only find red, blue or black");
+      p.code.insert(p.code.end(), {OP_FIND, uint8_t(c)});
+    } else if (op == "branch" && w.size() == 2) {
+      int c = colorIndex(w[1]);
+      if (c <= 0) return fail("unknown color '" + w[1] + "'");
+      p.code.insert(p.code.end(), {OP_BRANCH, uint8_t(c)});
+    } else if (op == "turn" && w.size() == 2) {
+      if (!number(w[1], "deg", -32768, 32767, v)) return fail("'turn' takes degrees");
+      uint16_t u = uint16_t(int16_t(v));
+      p.code.insert(p.code.end(), {OP_TURN, uint8_t(u & 0xFF), uint8_t(u >> 8)});
+    } else if (op == "repeat" && w.size() == 2) {
+      if (!number(w[1], "", 0, 255, v)) return fail("'repeat' takes 0..255");
+      if (++depth > PROGRAM_DEPTH) return fail("repeats nest " + std::to_string(PROGRAM_DEPTH) + " deep at most");
+      p.code.insert(p.code.end(), {OP_REPEAT, uint8_t(v)});
+    } else if (op == "end" && w.size() == 1) {
+      if (!depth--) return fail("'end' without 'repeat'");
+      p.code.push_back(OP_END);
+    } else {
+      return fail("can't read '" + source + "'");
+    }
+    if (!((sketch.ops | FLOW_OPS) & bit(p.code[at])))
+      return fail("'" + op + "' isn't a step of the " + sketch.name + " sketch");
+    if (p.code.size() > PROGRAM_CODE) return fail("program over " + std::to_string(PROGRAM_CODE) + " bytes");
+    p.listing.push_back({at, source});
+  }
+  if (depth) return fail("'repeat' without 'end'");
+  return p;
+}
+
+static std::string progLine(const Program& p) {
+  std::string s = "PROG ";
+  char hex[3];
+  for (uint8_t b : p.code) {
+    std::snprintf(hex, sizeof(hex), "%02X", b);
+    s += hex;
+  }
+  std::snprintf(hex, sizeof(hex), "%02X", crc8(p.code));
+  return s + " " + hex;
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                              SERIAL PORT                                   ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/**
+ * baudConstant() - termios wants B9600-style constants, not numbers.
+ * Returns 0 for unsupported rates.
+ */
+static speed_t baudConstant(long baud) {
+  switch (baud) {
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    default:      return 0;
+  }
+}
+
+/** openSerial() - Open a tty for reading and writing, in raw mode. */
+static int openSerial(const std::string& path, speed_t speed) {
+  int fd = open(path.c_str(), O_RDWR | O_NOCTTY);
+  if (fd < 0 || !isatty(fd)) return fd;
+
+  termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  return fd;
+}
+
+/**
+ * send() - Write `line` until the robot answers with a "PROG:" line
+ * (printed) or REPLY_MS passes. The robot only listens while it waits
+ * for its start cue, and opening the port may have reset it: so the line
+ * goes out again every RESEND_MS. Loading the same program twice is
+ * harmless. Returns 0 loaded, 1 rejected or no answer.
+ */
+static int send(int fd, const std::string& line) {
+  std::string out = line + "\n", in;
+  int waited = 0, sinceSend = RESEND_MS;
+  while (waited < REPLY_MS) {
+    if (sinceSend >= RESEND_MS) {
+      if (write(fd, out.data(), out.size()) != ssize_t(out.size())) {
+        std::perror("write");
+        return 1;
+      }
+      sinceSend = 0;
+    }
+    pollfd pfd = {fd, POLLIN, 0};
+    int ready = poll(&pfd, 1, 100);
+    waited += 100;
+    sinceSend += 100;
+    if (ready <= 0) continue;
+    char buf[256];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n <= 0) continue;
+    in.append(buf, n);
+    for (size_t nl; (nl = in.find('\n')) != std::string::npos; in.erase(0, nl + 1)) {
+      std::string reply = in.substr(0, nl);
+      if (!reply.empty() && reply.back() == '\r') reply.pop_back();
+      if (reply.compare(0, 5, "PROG:") != 0) continue;
+      std::printf("%s\n", reply.c_str());
+      return reply.compare(0, 12, "PROG: loaded") == 0 || reply == "PROG: cleared" ? 0 : 1;
+    }
+  }
+  std::fprintf(stderr, "mission_asm: no answer (is the robot waiting for its start cue?)\n");
+  return 1;
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                                  MAIN                                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+static void usage() {
+  std::fprintf(stderr,
+    "usage: mission_asm <route file | -> [options]\n"
+    "       mission_asm --clear --port DEV\n"
+    "  --sketch S    the route is for start (default), target or obstacle\n"
+    "  --list        print each step's bytes to stderr\n"
+    "  --port DEV    load it into the robot (waiting for its start cue)\n"
+    "  --baud N      serial speed (default 9600)\n"
+    "  --clear       drop the robot's program: back to the built-in one\n");
+}
+
+int main(int argc, char** argv) {
+  std::string path, port;
+  long baud = 9600;
+  bool list = false, clear = false;
+  const Sketch* sketch = &SKETCHES[0];
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--list") list = true;
+    else if (a == "--sketch" && i + 1 < argc) {
+      std::string name = argv[++i];
+      sketch = nullptr;
+      for (const Sketch& s : SKETCHES)
+        if (name == s.name) sketch = &s;
+      if (!sketch) { usage(); return 2; }
+    }
+    else if (a == "--clear") clear = true;
+    else if (a == "--port" && i + 1 < argc) port = argv[++i];
+    else if (a == "--baud" && i + 1 < argc) baud = std::atol(argv[++i]);
+    else if (path.empty() && (a == "-" || a[0] != '-')) path = a;
+    else { usage(); return 2; }
+  }
+  if (clear == !path.empty() || (clear && port.empty())) { usage(); return 2; }
+
+  std::string line = "PROG clear";
+  if (!clear) {
+    std::ifstream file;
+    if (path != "-") {
+      file.open(path);
+      if (!file) { std::fprintf(stderr, "mission_asm: can't read %s\n", path.c_str()); return 2; }
+    }
+    Program p = assemble(path == "-" ? std::cin : file, path, *sketch);
+    if (!p.error.empty()) { std::fprintf(stderr, "%s\n", p.error.c_str()); return 1; }
+    if (list) {
+      for (size_t i = 0; i < p.listing.size(); i++) {
+        size_t end = i + 1 < p.listing.size() ? p.listing[i + 1].first : p.code.size();
+        std::string bytes;
+        char hex[4];
+        for (size_t k = p.listing[i].first; k < end; k++) {
+          std::snprintf(hex, sizeof(hex), "%02X ", p.code[k]);
+          bytes += hex;
+        }
+        std::fprintf(stderr, "%3zu  %-12s %s\n", p.listing[i].first, bytes.c_str(), p.listing[i].second.c_str());
+      }
+      std::fprintf(stderr, "%zu bytes, crc %02X\n", p.code.size(), crc8(p.code));
+    }
+    line = progLine(p);
+    if (port.empty()) {
+      std::printf("%s\n", line.c_str());
+      return 0;
+    }
+  }
+
+  speed_t speed = baudConstant(baud);
+  if (!speed) { std::fprintf(stderr, "unsupported baud rate %ld\n", baud); return 2; }
+  int fd = openSerial(port, speed);
+  if (fd < 0) { std::perror(port.c_str()); return 1; }
+  int result = send(fd, line);
+  close(fd);
+  return result;
+}
@@ -0,0 +1,291 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║                     RING FILE: shared telemetry buffer                    ║
+ * ║                                                                           ║
+ * ║  One writer (serial_capture) appends serial lines; any number of readers  ║
+ * ║  (ring_tail, the Coach App, analyzers) map the same file and read them    ║
+ * ║  in place. No locks, no copies, no socket in between.                     ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * FILE LAYOUT (little endian, all offsets fixed):
+ * ===============================================
+ *
+ *   0      header: magic, sizes, start time              (64 bytes)
+ *   64     head      bytes the writer may be touching     (own cache line)
+ *   128    frames    frames published so far              (own cache line)
+ *   192    committed end of the newest published frame    (own cache line)
+ *   256    index[indexCapacity]   one 32-byte entry per frame, round robin
+ *   dataOffset (page aligned)     data[dataCapacity]      raw serial bytes
+ *
+ * A "frame" is one serial line (without its '\n'). Frame n's index entry
+ * lives in slot n % indexCapacity and says where its bytes are and when the
+ * newline arrived (CLOCK_REALTIME, ns). Frames are in time order, so a
+ * timestamp lookup is a binary search over the live index window.
+ *
+ * ZERO COPY:
+ * The data region is mapped TWICE, back to back, so a frame that wraps past
+ * the end of the ring is still one contiguous span in memory. The writer
+ * read()s the serial port straight into the ring; readers get a pointer.
+ *
+ * CONSISTENCY (single writer, lock-free readers):
+ *   writer: raise head -> write bytes -> fill index entry -> frames++ (release)
+ *   reader: frames (acquire) -> copy entry -> use bytes -> re-check
+ * A frame is still valid after use if its entry's seq is unchanged and
+ * head has not moved more than dataCapacity past its start. Readers that
+ * fall that far behind skip ahead (they're told how many frames they lost).
+ *
+ * Header-only so the capture daemon and every reader agree on the format.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ring {
+
+constexpr char     MAGIC[8]      = {'R', 'B', 'T', 'R', 'I', 'N', 'G', '1'};
+constexpr uint32_t VERSION       = 1;
+constexpr uint64_t INDEX_OFFSET  = 256;
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                              ON-DISK LAYOUT                                ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+struct IndexEntry {
+  std::atomic<uint64_t> seq;   // Frame number + 1 (0 = never written)
+  uint64_t timeNs;             // When the newline arrived (CLOCK_REALTIME)
+  uint64_t offset;             // Absolute byte position of the first byte
+  uint32_t length;             // Bytes, without the '\n'
+  uint32_t reserved;
+};
+static_assert(sizeof(IndexEntry) == 32, "index entry layout is part of the file format");
+
+struct Header {
+  char     magic[8];
+  uint32_t version;
+  uint32_t reserved0;
+  uint64_t dataOffset;         // Page aligned
+  uint64_t dataCapacity;       // Power of two, multiple of the page size
+  uint64_t indexCapacity;      // Power of two
+  uint64_t startNs;            // When the capture started
+  uint32_t writerPid;
+  uint32_t reserved1[3];
+
+  alignas(64) std::atomic<uint64_t> head;
+  alignas(64) std::atomic<uint64_t> frames;
+  alignas(64) std::atomic<uint64_t> committed;
+};
+static_assert(sizeof(Header) == INDEX_OFFSET, "header layout is part of the file format");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "atomics must work across processes");
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                                 MAPPING                                    ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+inline uint64_t roundUp(uint64_t n, uint64_t to) { return (n + to - 1) / to * to; }
+
+inline uint64_t nextPow2(uint64_t n) {
+  uint64_t p = 1;
+  while (p < n) p <<= 1;
+  return p;
+}
+
+inline uint64_t nowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * Ring - A mapped ring file. create() is for the writer, open() for readers.
+ * On failure both return false and leave a message in error.
+ */
+class Ring {
+public:
+  Header*     header = nullptr;
+  IndexEntry* index  = nullptr;
+  uint8_t*    data   = nullptr;   // Valid for [0, 2 * dataCapacity)
+  std::string error;
+
+  ~Ring() { close(); }
+
+  bool create(const std::string& path, uint64_t dataBytes, uint64_t indexEntries) {
+    long page = sysconf(_SC_PAGESIZE);
+    uint64_t dataCap  = roundUp(nextPow2(dataBytes), page);
+    uint64_t indexCap = nextPow2(indexEntries);
+    uint64_t dataOff  = roundUp(INDEX_OFFSET + indexCap * sizeof(IndexEntry), page);
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return fail("open " + path);
+    if (ftruncate(fd, dataOff + dataCap) != 0) { ::close(fd); return fail("ftruncate"); }
+    if (!map(fd, dataOff, dataCap, true)) return false;
+
+    // Fresh file is all zeros: atomics start at 0, every index seq is "never written"
+    std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+    header->version       = VERSION;
+    header->dataOffset    = dataOff;
+    header->dataCapacity  = dataCap;
+    header->indexCapacity = indexCap;
+    header->startNs       = nowNs();
+    header->writerPid     = uint32_t(getpid());
+    return true;
+  }
+
+  bool open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return fail("open " + path);
+    Header probe;
+    if (pread(fd, &probe, sizeof(probe), 0) != sizeof(probe) ||
+        std::memcmp(probe.magic, MAGIC, sizeof(MAGIC)) != 0 || probe.version != VERSION) {
+      ::close(fd);
+      error = path + ": not a ring file (or a different version)";
+      return false;
+    }
+    return map(fd, probe.dataOffset, probe.dataCapacity, false);
+  }
+
+  void close() {
+    if (base_) munmap(base_, headerBytes_);
+    if (data) munmap(data, 2 * capacity_);
+    base_ = nullptr;
+    data = nullptr;
+    header = nullptr;
+    index = nullptr;
+  }
+
+  uint64_t capacity() const { return capacity_; }
+  uint64_t indexMask() const { return header->indexCapacity - 1; }
+  uint8_t* at(uint64_t absolute) const { return data + (absolute & (capacity_ - 1)); }
+
+private:
+  void*    base_ = nullptr;
+  uint64_t headerBytes_ = 0;
+  uint64_t capacity_ = 0;
+
+  bool fail(const std::string& what) {
+    error = what + ": " + std::strerror(errno);
+    return false;
+  }
+
+  /**
+   * map() - Header + index once, then the data region twice in a row.
+   * Reserve 2x the data size of address space first, then map the same
+   * file pages into both halves with MAP_FIXED.
+   */
+  bool map(int fd, uint64_t dataOff, uint64_t dataCap, bool writer) {
+    // Readers map read-only: the 64-bit atomics are lock-free, so loads are plain loads
+    int prot = writer ? PROT_READ | PROT_WRITE : PROT_READ;
+    base_ = mmap(nullptr, dataOff, prot, MAP_SHARED, fd, 0);
+    if (base_ == MAP_FAILED) { base_ = nullptr; ::close(fd); return fail("mmap header"); }
+    headerBytes_ = dataOff;
+
+    void* span = mmap(nullptr, 2 * dataCap, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (span == MAP_FAILED) { ::close(fd); return fail("reserve"); }
+    auto* lo = static_cast<uint8_t*>(span);
+    if (mmap(lo, dataCap, prot, MAP_SHARED | MAP_FIXED, fd, off_t(dataOff)) == MAP_FAILED ||
+        mmap(lo + dataCap, dataCap, prot, MAP_SHARED | MAP_FIXED, fd, off_t(dataOff)) == MAP_FAILED) {
+      munmap(span, 2 * dataCap);
+      ::close(fd);
+      return fail("mmap data");
+    }
+    ::close(fd);   // Mappings keep the file alive
+
+    header = static_cast<Header*>(base_);
+    index = reinterpret_cast<IndexEntry*>(static_cast<uint8_t*>(base_) + INDEX_OFFSET);
+    data = lo;
+    capacity_ = dataCap;
+    return true;
+  }
+};
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                                 READING                                    ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+struct Frame {
+  uint64_t       seq;      // Frame number (0-based)
+  uint64_t       timeNs;
+  const uint8_t* bytes;    // Points into the ring: valid until stillValid() says no
+  uint32_t       length;
+  uint64_t       offset;
+};
+
+/**
+ * Cursor - One reader's position. Each reader process keeps its own; the
+ * writer never waits for anybody.
+ */
+class Cursor {
+public:
+  explicit Cursor(const Ring& ring, uint64_t startFrame = 0) : ring_(ring), next_(startFrame) {}
+
+  uint64_t next() const { return next_; }
+  uint64_t lost() const { return lost_; }
+  void seek(uint64_t frame) { next_ = frame; }
+
+  /** Oldest frame that can still be read (index window and data window). */
+  uint64_t oldest() const {
+    uint64_t frames = ring_.header->frames.load(std::memory_order_acquire);
+    uint64_t cap = ring_.header->indexCapacity;
+    return frames > cap ? frames - cap : 0;
+  }
+
+  /**
+   * poll() - Fetch the next frame if one is published. Returns false when
+   * caught up. Skips (and counts) frames that were overwritten first.
+   */
+  bool poll(Frame& out) {
+    const Header* h = ring_.header;
+    for (;;) {
+      uint64_t frames = h->frames.load(std::memory_order_acquire);
+      if (next_ >= frames) return false;
+      if (next_ < oldest()) { lost_ += oldest() - next_; next_ = oldest(); continue; }
+
+      const IndexEntry& e = ring_.index[next_ & ring_.indexMask()];
+      uint64_t seq = e.seq.load(std::memory_order_acquire);
+      out.seq    = next_;
+      out.timeNs = e.timeNs;
+      out.offset = e.offset;
+      out.length = e.length;
+      out.bytes  = ring_.at(e.offset);
+      if (seq != next_ + 1 || !stillValid(out)) { lost_++; next_++; continue; }
+      next_++;
+      return true;
+    }
+  }
+
+  /** Call after using out.bytes: false means the writer lapped us meanwhile. */
+  bool stillValid(const Frame& f) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const IndexEntry& e = ring_.index[f.seq & ring_.indexMask()];
+    uint64_t head = ring_.header->head.load(std::memory_order_acquire);
+    return e.seq.load(std::memory_order_relaxed) == f.seq + 1 && head - f.offset <= ring_.capacity();
+  }
+
+  /** First frame at or after timeNs (binary search over the live window). */
+  uint64_t findTime(uint64_t timeNs) const {
+    uint64_t lo = oldest(), hi = ring_.header->frames.load(std::memory_order_acquire);
+    while (lo < hi) {
+      uint64_t mid = lo + (hi - lo) / 2;
+      if (ring_.index[mid & ring_.indexMask()].timeNs < timeNs) lo = mid + 1;
+      else hi = mid;
+    }
+    return lo;
+  }
+
+private:
+  const Ring& ring_;
+  uint64_t next_;
+  uint64_t lost_ = 0;
+};
+
+}  // namespace ring
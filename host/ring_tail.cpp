@@ -0,0 +1,105 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║                     RING TAIL: read a capture ring file                   ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * Prints lines from a ring written by serial_capture, as
+ *
+ *     <ms since capture start>\t<line>
+ *
+ * which is the timestamped log format Coach_App/telemetry.py reads. Run as
+ * many as you like at once; none of them slow the capture down.
+ *
+ * BUILD:  g++ -std=c++17 -O2 -Wall -o ring_tail ring_tail.cpp
+ *
+ * USAGE:
+ *   ring_tail robot.ring                 # everything still in the ring
+ *   ring_tail -n 20 -f robot.ring        # last 20 lines, then follow
+ *   ring_tail --since 30 robot.ring      # lines from the last 30 seconds
+ *   ring_tail --stats robot.ring         # sizes, rates, how full
+ */
+
+#include "ring_file.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <unistd.h>
+
+constexpr int IDLE_SLEEP_US = 2000;   // Poll period when caught up
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) { stopRequested = 1; }
+
+static void printStats(const ring::Ring& r) {
+  const ring::Header* h = r.header;
+  uint64_t frames = h->frames.load(std::memory_order_acquire);
+  uint64_t bytes = h->committed.load(std::memory_order_relaxed);
+  double seconds = (ring::nowNs() - h->startNs) / 1e9;
+  ring::Cursor c(r);
+  std::printf("writer pid   %u%s\n", h->writerPid, kill(pid_t(h->writerPid), 0) == 0 ? "" : " (not running)");
+  std::printf("running      %.1f s\n", seconds);
+  std::printf("frames       %llu (%.1f/s), oldest readable #%llu\n", (unsigned long long)frames,
+              seconds > 0 ? frames / seconds : 0.0, (unsigned long long)c.oldest());
+  std::printf("bytes        %llu (%.0f B/s), ring %llu KB %s\n", (unsigned long long)bytes,
+              seconds > 0 ? bytes / seconds : 0.0, (unsigned long long)(r.capacity() >> 10),
+              bytes > r.capacity() ? "(wrapped)" : "");
+}
+
+int main(int argc, char** argv) {
+  bool follow = false, stats = false;
+  long lastN = -1;
+  double sinceS = -1;
+  std::string path;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-f") follow = true;
+    else if (a == "-n" && i + 1 < argc) lastN = std::atol(argv[++i]);
+    else if (a == "--since" && i + 1 < argc) sinceS = std::atof(argv[++i]);
+    else if (a == "--stats") stats = true;
+    else path = a;
+  }
+  if (path.empty()) {
+    std::fprintf(stderr, "usage: ring_tail [-f] [-n N] [--since SECONDS] [--stats] <ring file>\n");
+    return 2;
+  }
+
+  ring::Ring r;
+  if (!r.open(path)) {
+    std::fprintf(stderr, "ring_tail: %s\n", r.error.c_str());
+    return 1;
+  }
+  if (stats) { printStats(r); return 0; }
+
+  ring::Cursor cursor(r);
+  uint64_t frames = r.header->frames.load(std::memory_order_acquire);
+  if (sinceS >= 0) cursor.seek(cursor.findTime(ring::nowNs() - uint64_t(sinceS * 1e9)));
+  else if (lastN >= 0) cursor.seek(frames > uint64_t(lastN) ? frames - lastN : 0);
+  else cursor.seek(cursor.oldest());
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, onSignal);
+  const uint64_t startNs = r.header->startNs;
+  ring::Frame f;
+  while (!stopRequested) {
+    if (!cursor.poll(f)) {
+      if (!follow) break;
+      std::fflush(stdout);
+      usleep(IDLE_SLEEP_US);
+      continue;
+    }
+    std::printf("%llu\t", (unsigned long long)((f.timeNs - startNs) / 1000000));
+    std::fwrite(f.bytes, 1, f.length, stdout);   // Straight from the mapping
+    std::fputc('\n', stdout);
+    if (!cursor.stillValid(f)) std::fprintf(stderr, "ring_tail: line #%llu was overwritten while printing\n",
+                                            (unsigned long long)f.seq);
+  }
+  std::fflush(stdout);
+  if (cursor.lost()) std::fprintf(stderr, "ring_tail: %llu lines overwritten before they could be read\n",
+                                  (unsigned long long)cursor.lost());
+  return 0;
+}
@@ -0,0 +1,510 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║                  RUN ANALYZER: where did the time go?                     ║
+ * ║                                                                           ║
+ * ║  Reads recorded runs and prints a timing breakdown per state and per      ║
+ * ║  course segment, blocking vs active time, timeout fallbacks taken, and    ║
+ * ║  how much runs vary. Thousands of logs parse in parallel in seconds.      ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * INPUTS (any mix, files or directories):
+ * =======================================
+ *   - Text logs of the robot's serial output. Each line may carry a time:
+ *       "15230\tSTATE: 5 FOLLOW_GREEN"         host ms (telemetry.py, ring_tail)
+ *       "14:02:11.123 -> STATE: 5"             Arduino IDE "Show timestamp"
+ *       "T:15230,5,4,23.4"                     robot millis from the T: line
+ *       "STATE: 5 FOLLOW_GREEN ms=15180"       robot millis from the STATE: line
+ *     Older "STATE: n" lines without any time are placed at the last T: time.
+ *   - Ring files written by serial_capture (binary; detected by magic).
+ *
+ * A banner ("SECTION 1: START") starts a new run; a banner before the
+ * previous run finished marks that run as RESET (brownout, crash).
+ *
+ * BLOCKING VS ACTIVE:
+ * The sketches print a T: line every few loop ticks. While a state runs a
+ * delay()-based sequence (pickup, drop, turns, shooting) the loop stops and
+ * the T: lines stop with it. Every gap longer than 1.5x the run's typical
+ * T: period counts as blocked for the state it started in (minus one normal
+ * period); everything else is active control. Logs without T: lines report
+ * no split.
+ *
+ * BUILD:  g++ -std=c++17 -O2 -Wall -pthread -o run_analyzer run_analyzer.cpp
+ *
+ * USAGE:
+ *   run_analyzer logs/                     # every file under logs/
+ *   run_analyzer -j 8 --csv runs.csv a.log b.log robot.ring
+ *   run_analyzer --section 3 old_logs/     # bare numeric logs with no banner
+ */
+
+#include "ring_file.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                     COURSE TABLES (mirror the sketches)                    ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+constexpr int MAX_STATES   = 16;
+constexpr int MAX_SECTIONS = 3;
+constexpr double GAP_FACTOR = 1.5;   // T: gap this much over normal = blocked
+
+struct Segment {
+  const char* name;
+  std::vector<int> states;
+};
+
+struct SectionInfo {
+  const char* name;
+  std::vector<const char*> states;             // Enum order
+  std::vector<std::pair<int, int>> timeouts;   // (state, ms) give-up timers
+  std::vector<Segment> segments;
+};
+
+static const SectionInfo SECTIONS[MAX_SECTIONS] = {
+  {"START",
+   {"FOLLOW_BLACK", "APPROACH_BOX", "PICKUP", "FIND_INTERSECTION", "SELECT_GREEN",
+    "FOLLOW_GREEN", "APPROACH_BLUE", "DROP", "TO_REUPLOAD", "COMPLETE", "TURN"},
+   {},   // TO_REUPLOAD's 3 s is its planned drive, not a give-up
+   {{"black line to box", {0, 1}}, {"pickup", {2}}, {"intersection", {3, 4}},
+    {"green path to blue", {5, 6}}, {"drop + handoff", {7, 8}}}},
+  {"TARGET",
+   {"CLIMB_RAMP", "ON_TARGET", "NAV_BLUE", "NAV_RED", "NAV_GREEN", "REACH_CENTER",
+    "FIND_BALL", "SHOOT", "RETURN", "COMPLETE", "TURN"},
+   {{0, 5000}, {6, 3000}},
+   {{"ramp", {0, 1}}, {"rings to center", {2, 3, 4, 5}}, {"ball + shot", {6, 7}}, {"return", {10, 8}}}},
+  {"OBSTACLE",
+   {"FIND_RED", "FOLLOW_RED", "APPROACH_BOX", "PICKUP", "TO_OBSTACLES", "AVOID_OBS",
+    "FIND_BLUE", "DROP", "FIND_BLACK", "RETURN_HOME", "COMPLETE"},
+   {{0, 3000}, {6, 5000}, {8, 5000}, {9, 5000}},
+   {{"red line to box", {0, 1, 2}}, {"pickup", {3}}, {"obstacles", {4, 5}},
+    {"blue drop", {6, 7}}, {"home", {8, 9}}}},
+};
+
+static int timeoutMs(int section, int state) {
+  for (auto& t : SECTIONS[section - 1].timeouts)
+    if (t.first == state) return t.second;
+  return 0;
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                                 ONE RUN                                    ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+enum Outcome { OUTCOME_COMPLETE, OUTCOME_RESET, OUTCOME_UNFINISHED };
+static const char* OUTCOME_NAMES[] = {"complete", "reset", "unfinished"};
+
+struct Run {
+  std::string file;
+  int section = 0;
+  Outcome outcome = OUTCOME_UNFINISHED;
+  double startMs = -1, endMs = -1;
+  std::array<double, MAX_STATES> stateMs{};
+  std::array<double, MAX_STATES> blockedMs{};
+  std::array<int, MAX_STATES> visits{};
+  std::array<int, MAX_STATES> timeouts{};
+  bool hasTelemetry = false;
+
+  double durationMs() const { return endMs > startMs ? endMs - startMs : 0; }
+};
+
+/**
+ * RunBuilder - Line-at-a-time state machine over one log. Finished runs
+ * are appended to `out`.
+ */
+class RunBuilder {
+public:
+  RunBuilder(const std::string& file, int defaultSection, std::vector<Run>& out)
+      : file_(file), defaultSection_(defaultSection), out_(out) {}
+
+  void line(std::string_view s, double timeMs) {
+    if (timeMs >= 0) hostTime_ = true;
+    // Section banner (but not "SECTION 1 COMPLETE!")
+    size_t b = s.find("SECTION ");
+    if (b != std::string_view::npos && b + 9 < s.size() && s[b + 9] == ':') {
+      int section = s[b + 8] - '0';
+      if (section >= 1 && section <= MAX_SECTIONS) { banner(section, timeMs); return; }
+    }
+    if (s.find(" COMPLETE") != std::string_view::npos &&
+        (s.find("SECTION") != std::string_view::npos || s.find("COMPETITION") != std::string_view::npos)) {
+      if (active_) finish(OUTCOME_COMPLETE);
+      return;
+    }
+    if (startsWith(s, "T:")) { telemetry(s.substr(2), timeMs); return; }
+    if (startsWith(s, "STATE:")) { state(s.substr(6), timeMs); return; }
+  }
+
+  void end() {
+    if (active_ && hasState_) finish(OUTCOME_UNFINISHED);
+  }
+
+private:
+  std::string file_;
+  int defaultSection_;
+  std::vector<Run>& out_;
+  Run run_;
+  bool active_ = false, hasState_ = false, hostTime_ = false;
+  int state_ = -1;
+  double stateSince_ = 0, nowMs_ = -1;
+  double lastT_ = -1;
+  std::vector<std::pair<double, double>> gaps_;   // (from, to) between consecutive T: lines
+  std::vector<std::pair<double, int>> entered_;   // (time, state) for every transition
+
+  static bool startsWith(std::string_view s, const char* p) { return s.rfind(p, 0) == 0; }
+
+  void tick(double t) {
+    if (t < 0) return;
+    if (run_.startMs < 0) run_.startMs = t;
+    nowMs_ = std::max(nowMs_, t);
+  }
+
+  void begin(int section) {
+    run_ = Run();
+    run_.file = file_;
+    run_.section = section;
+    active_ = true;
+    hasState_ = false;
+    state_ = -1;
+    nowMs_ = -1;
+    lastT_ = -1;
+    gaps_.clear();
+    entered_.clear();
+  }
+
+  void banner(int section, double t) {
+    if (active_ && hasState_) finish(OUTCOME_RESET);
+    begin(section);
+    tick(t);
+  }
+
+  void leaveState() {
+    if (state_ < 0 || nowMs_ < 0) return;
+    double spent = nowMs_ - stateSince_;
+    run_.stateMs[state_] += spent;
+    int limit = timeoutMs(run_.section, state_);
+    if (limit && spent >= limit * 0.95) run_.timeouts[state_]++;
+  }
+
+  void state(std::string_view s, double t) {
+    if (!active_) begin(defaultSection_);
+    if (!run_.section) run_.section = guessSection(s);
+    if (!run_.section) return;   // Can't name states without knowing the section
+    size_t ms = s.find("ms=");
+    if (!hostTime_ && ms != std::string_view::npos) t = std::atof(std::string(s.substr(ms + 3)).c_str());
+    tick(t);
+    int n = std::atoi(std::string(s).c_str());
+    if (n < 0 || n >= MAX_STATES) return;
+    leaveState();
+    state_ = n;
+    stateSince_ = nowMs_ < 0 ? 0 : nowMs_;
+    entered_.push_back({stateSince_, n});
+    run_.visits[n]++;
+    hasState_ = true;
+  }
+
+  void telemetry(std::string_view s, double t) {
+    // millis,state,color,distance
+    double robotMs = std::atof(std::string(s.substr(0, s.find(','))).c_str());
+    size_t c = s.find(',');
+    int tState = c == std::string_view::npos ? -1 : std::atoi(std::string(s.substr(c + 1)).c_str());
+    double when = hostTime_ ? t : robotMs;
+    if (!active_) begin(defaultSection_);
+    tick(when);
+    run_.hasTelemetry = true;
+    if (!hasState_ && run_.section && tState >= 0 && tState < MAX_STATES) {
+      state_ = tState;
+      stateSince_ = nowMs_;
+      entered_.push_back({stateSince_, tState});
+      run_.visits[tState]++;
+      hasState_ = true;
+    }
+    if (lastT_ >= 0 && when > lastT_) gaps_.push_back({lastT_, when});
+    lastT_ = when;
+  }
+
+  /** Bare numeric logs: a name on the STATE line identifies the section. */
+  int guessSection(std::string_view s) {
+    for (int sec = 0; sec < MAX_SECTIONS; sec++)
+      for (const char* name : SECTIONS[sec].states)
+        if (s.find(name) != std::string_view::npos && std::strcmp(name, "COMPLETE") &&
+            std::strcmp(name, "PICKUP") && std::strcmp(name, "APPROACH_BOX") &&
+            std::strcmp(name, "TURN"))   // Inside RETURN
+          return sec + 1;
+    return 0;
+  }
+
+  void finish(Outcome outcome) {
+    leaveState();
+    run_.endMs = nowMs_;
+    run_.outcome = outcome;
+    // Blocked time: T: gaps well above this run's typical period. The
+    // excess is split over whichever states were active during it.
+    if (gaps_.size() >= 3) {
+      std::vector<double> g;
+      for (auto& p : gaps_) g.push_back(p.second - p.first);
+      std::nth_element(g.begin(), g.begin() + g.size() / 2, g.end());
+      double normal = g[g.size() / 2];
+      for (auto& p : gaps_) {
+        if (p.second - p.first <= normal * GAP_FACTOR) continue;
+        double from = p.first + normal, to = p.second;
+        for (size_t i = 0; i < entered_.size(); i++) {
+          double a = std::max(from, entered_[i].first);
+          double b = std::min(to, i + 1 < entered_.size() ? entered_[i + 1].first : run_.endMs);
+          if (b > a) run_.blockedMs[entered_[i].second] += b - a;
+        }
+      }
+    }
+    if (run_.section) out_.push_back(run_);
+    active_ = false;
+    state_ = -1;
+  }
+};
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                                 PARSING                                    ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/** Leading "12345\t" (host ms) or "HH:MM:SS.mmm -> " (IDE). Returns -1 if none. */
+static double stripTime(std::string_view& s) {
+  size_t i = 0;
+  while (i < s.size() && s[i] >= '0' && s[i] <= '9') i++;
+  if (i && i < s.size() && s[i] == '\t') {
+    double ms = std::atof(std::string(s.substr(0, i)).c_str());
+    s.remove_prefix(i + 1);
+    return ms;
+  }
+  if (s.size() > 16 && s[2] == ':' && s[5] == ':' && s[8] == '.' && s.substr(12, 4) == " -> ") {
+    auto num = [&](size_t at, size_t n) { return std::atof(std::string(s.substr(at, n)).c_str()); };
+    double ms = ((num(0, 2) * 60 + num(3, 2)) * 60 + num(6, 2)) * 1000 + num(9, 3);
+    s.remove_prefix(16);
+    return ms;
+  }
+  return -1;
+}
+
+static void parseText(const std::string& file, std::string_view text, int section, std::vector<Run>& out) {
+  RunBuilder builder(file, section, out);
+  while (!text.empty()) {
+    size_t nl = text.find('\n');
+    std::string_view line = text.substr(0, nl);
+    text.remove_prefix(nl == std::string_view::npos ? text.size() : nl + 1);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    double t = stripTime(line);
+    builder.line(line, t);
+  }
+  builder.end();
+}
+
+static void parseRing(const std::string& file, int section, std::vector<Run>& out) {
+  ring::Ring r;
+  if (!r.open(file)) return;
+  RunBuilder builder(file, section, out);
+  ring::Cursor cursor(r);
+  cursor.seek(cursor.oldest());
+  ring::Frame f;
+  while (cursor.poll(f)) {
+    std::string_view line(reinterpret_cast<const char*>(f.bytes), f.length);
+    builder.line(line, (f.timeNs - r.header->startNs) / 1e6);
+  }
+  builder.end();
+}
+
+/** mmap the file; ring files go to parseRing, everything else is text. */
+static void parseFile(const std::string& file, int section, std::vector<Run>& out) {
+  int fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) { close(fd); return; }
+  void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) return;
+  std::string_view text(static_cast<const char*>(p), st.st_size);
+  if (text.size() >= 8 && std::memcmp(text.data(), ring::MAGIC, 8) == 0) {
+    munmap(p, st.st_size);
+    parseRing(file, section, out);
+    return;
+  }
+  madvise(p, st.st_size, MADV_SEQUENTIAL);
+  parseText(file, text, section, out);
+  munmap(p, st.st_size);
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                                STATISTICS                                  ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+struct Stat {
+  double n = 0, sum = 0, sumSq = 0, lo = INFINITY, hi = -INFINITY;
+  void add(double x) { n++; sum += x; sumSq += x * x; lo = std::min(lo, x); hi = std::max(hi, x); }
+  double mean() const { return n ? sum / n : 0; }
+  double sd() const { return n > 1 ? std::sqrt(std::max(0.0, (sumSq - sum * sum / n) / (n - 1))) : 0; }
+};
+
+static void report(const std::vector<Run>& runs) {
+  for (int sec = 1; sec <= MAX_SECTIONS; sec++) {
+    const SectionInfo& info = SECTIONS[sec - 1];
+    std::vector<const Run*> all, done;
+    for (auto& r : runs)
+      if (r.section == sec) {
+        all.push_back(&r);
+        if (r.outcome == OUTCOME_COMPLETE) done.push_back(&r);
+      }
+    if (all.empty()) continue;
+
+    int resets = 0, unfinished = 0;
+    for (auto* r : all) {
+      resets += r->outcome == OUTCOME_RESET;
+      unfinished += r->outcome == OUTCOME_UNFINISHED;
+    }
+    Stat total;
+    for (auto* r : done) total.add(r->durationMs() / 1000);
+    std::printf("\n=== SECTION %d: %s — %zu runs, %zu complete, %d reset, %d unfinished ===\n", sec, info.name,
+                all.size(), done.size(), resets, unfinished);
+    if (!done.empty())
+      std::printf("run time     mean %.2fs  sd %.2fs  (cv %.0f%%)  best %.2fs  worst %.2fs\n", total.mean(),
+                  total.sd(), total.mean() ? 100 * total.sd() / total.mean() : 0, total.lo, total.hi);
+
+    // Per state, over completed runs (all runs if none completed)
+    const auto& pool = done.empty() ? all : done;
+    double runMean = 0;
+    for (auto* r : pool) runMean += r->durationMs();
+    runMean /= pool.size();
+    std::printf("\n%-18s %9s %8s %7s %6s %10s %9s\n", "state", "mean s", "sd s", "share", "visits", "blocked", "timeouts");
+    for (size_t s = 0; s < info.states.size(); s++) {
+      Stat t, blocked;
+      int visits = 0, timeouts = 0, withT = 0;
+      for (auto* r : pool) {
+        t.add(r->stateMs[s] / 1000);
+        visits += r->visits[s];
+        timeouts += r->timeouts[s];
+        if (r->hasTelemetry) { blocked.add(r->blockedMs[s] / 1000); withT++; }
+      }
+      if (!visits) continue;
+      char blockedText[16] = "-";
+      if (withT && t.mean() > 0) std::snprintf(blockedText, sizeof(blockedText), "%.0f%%", 100 * blocked.mean() / t.mean());
+      char timeoutText[24] = "";
+      if (timeoutMs(sec, int(s)))
+        std::snprintf(timeoutText, sizeof(timeoutText), "%d/%zu", timeouts, pool.size());
+      std::printf("%-18s %9.2f %8.2f %6.0f%% %6.1f %10s %9s\n", info.states[s], t.mean(), t.sd(),
+                  runMean ? 100 * t.mean() * 1000 / runMean : 0, double(visits) / pool.size(), blockedText,
+                  timeoutText);
+    }
+
+    std::printf("\n%-22s %9s %8s %7s\n", "segment", "mean s", "sd s", "share");
+    for (auto& seg : info.segments) {
+      Stat t;
+      for (auto* r : pool) {
+        double ms = 0;
+        for (int s : seg.states) ms += r->stateMs[s];
+        t.add(ms / 1000);
+      }
+      std::printf("%-22s %9.2f %8.2f %6.0f%%\n", seg.name, t.mean(), t.sd(),
+                  runMean ? 100 * t.mean() * 1000 / runMean : 0);
+    }
+
+    Stat blocked, active;
+    int withT = 0;
+    for (auto* r : pool) {
+      if (!r->hasTelemetry) continue;
+      double b = 0;
+      for (double x : r->blockedMs) b += x;
+      blocked.add(b / 1000);
+      active.add(std::max(0.0, r->durationMs() - b) / 1000);
+      withT++;
+    }
+    if (withT)
+      std::printf("\nblocking delays %.2fs (%.0f%%), active control %.2fs per run  [%d runs with T: lines]\n",
+                  blocked.mean(), 100 * blocked.mean() / std::max(1e-9, blocked.mean() + active.mean()),
+                  active.mean(), withT);
+
+    bool anyTimeouts = false;
+    for (auto& t : info.timeouts) {
+      int taken = 0;
+      for (auto* r : all) taken += r->timeouts[t.first] > 0;
+      if (!taken) continue;
+      if (!anyTimeouts) std::printf("\ntimeout fallbacks taken (all runs):\n");
+      anyTimeouts = true;
+      std::printf("  %-16s %.1fs timer  %d of %zu runs\n", info.states[t.first], t.second / 1000.0, taken, all.size());
+    }
+  }
+}
+
+static void writeCsv(const char* path, const std::vector<Run>& runs) {
+  FILE* f = std::fopen(path, "w");
+  if (!f) { std::perror(path); return; }
+  std::fprintf(f, "file,section,outcome,duration_s");
+  for (int s = 0; s < MAX_STATES; s++) std::fprintf(f, ",state%d_s", s);
+  std::fprintf(f, "\n");
+  for (auto& r : runs) {
+    std::fprintf(f, "\"%s\",%d,%s,%.3f", r.file.c_str(), r.section, OUTCOME_NAMES[r.outcome], r.durationMs() / 1000);
+    for (int s = 0; s < MAX_STATES; s++) std::fprintf(f, ",%.3f", r.stateMs[s] / 1000);
+    std::fprintf(f, "\n");
+  }
+  std::fclose(f);
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                                  MAIN                                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+int main(int argc, char** argv) {
+  unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+  int section = 0;
+  const char* csv = nullptr;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-j" && i + 1 < argc) jobs = std::max(1, std::atoi(argv[++i]));
+    else if (a == "--section" && i + 1 < argc) section = std::atoi(argv[++i]);
+    else if (a == "--csv" && i + 1 < argc) csv = argv[++i];
+    else if (fs::is_directory(a)) {
+      for (auto& e : fs::recursive_directory_iterator(a))
+        if (e.is_regular_file()) files.push_back(e.path().string());
+    } else files.push_back(a);
+  }
+  if (files.empty()) {
+    std::fprintf(stderr, "usage: run_analyzer [-j N] [--section 1-3] [--csv out.csv] <logs or dirs...>\n");
+    return 2;
+  }
+  std::sort(files.begin(), files.end());
+
+  // Workers pull the next file index; each keeps its own run list (no locking while parsing)
+  auto start = std::chrono::steady_clock::now();
+  std::atomic<size_t> next{0};
+  std::vector<std::vector<Run>> perWorker(jobs);
+  std::vector<std::thread> workers;
+  for (unsigned w = 0; w < jobs; w++)
+    workers.emplace_back([&, w] {
+      for (size_t i; (i = next.fetch_add(1)) < files.size();)
+        parseFile(files[i], section, perWorker[w]);
+    });
+  for (auto& t : workers) t.join();
+
+  std::vector<Run> runs;
+  for (auto& v : perWorker) runs.insert(runs.end(), std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()));
+  std::stable_sort(runs.begin(), runs.end(), [](const Run& a, const Run& b) { return a.file < b.file; });
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("%zu files, %zu runs parsed in %.2fs on %u threads\n", files.size(), runs.size(), secs, jobs);
+
+  report(runs);
+  if (csv) writeCsv(csv, runs);
+  return 0;
+}
@@ -0,0 +1,308 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║                    SERIAL CAPTURE: robot -> ring file                     ║
+ * ║                                                                           ║
+ * ║  Reads the robot's serial stream and appends every line to a memory-      ║
+ * ║  mapped ring file (see ring_file.h), stamped with the time it arrived.    ║
+ * ║  Any number of readers can tail the file while this runs.                 ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * WHY NOT THE SERIAL MONITOR?
+ * ===========================
+ * - It can't keep up at high baud and drops lines while scrolling
+ * - It loses everything when the USB cable wiggles
+ * - Only one program can hold the port, so nothing else can watch the run
+ *
+ * This program holds the port, survives unplugging (it reopens the device and
+ * keeps the ring), and publishes lines for everyone else through the file.
+ *
+ * ZERO COPY: read() goes straight into the mapped ring (it's mapped twice back
+ * to back, so there is no wrap-around special case). The bytes are never
+ * moved again; readers see them at the same place.
+ *
+ * BUILD:  g++ -std=c++17 -O2 -Wall -o serial_capture serial_capture.cpp
+ *
+ * USAGE:
+ *   serial_capture /dev/ttyACM0 robot.ring --baud 9600
+ *   serial_capture --pty robot.ring          # prints a pty for simulated firmware
+ *   some_program | serial_capture - robot.ring
+ *
+ *   ring_tail -f robot.ring                  # watch it (any number at once)
+ */
+
+#include "ring_file.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                               SETTINGS                                     ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+constexpr uint64_t DEFAULT_RING_BYTES  = 16ull << 20;  // 16 MB: hours of 9600 baud
+constexpr uint64_t DEFAULT_INDEX       = 1ull << 20;   // Frames the index remembers
+constexpr uint64_t READ_CHUNK          = 4096;         // Max bytes per read()
+constexpr uint64_t MAX_LINE            = 4096;         // Longer "lines" are cut into frames
+constexpr int      POLL_MS             = 200;          // Wake up this often to check for Ctrl+C
+constexpr int      REOPEN_MS           = 500;          // Retry period after an unplug
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) { stopRequested = 1; }
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                              SERIAL PORT                                   ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/**
+ * baudConstant() - termios wants B9600-style constants, not numbers.
+ * Returns 0 for unsupported rates.
+ */
+static speed_t baudConstant(long baud) {
+  switch (baud) {
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+#ifdef B460800
+    case 460800:  return B460800;
+    case 500000:  return B500000;
+    case 921600:  return B921600;
+    case 1000000: return B1000000;
+    case 2000000: return B2000000;
+#endif
+    default:      return 0;
+  }
+}
+
+/**
+ * openSerial() - Open a tty in raw mode (no echo, no line editing, no
+ * CR/LF translation). Non-tty paths (files, FIFOs) are opened as-is.
+ */
+static int openSerial(const std::string& path, speed_t speed) {
+  int fd = open(path.c_str(), O_RDONLY | O_NOCTTY);
+  if (fd < 0 || !isatty(fd)) return fd;
+
+  termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  return fd;
+}
+
+/**
+ * openPty() - Create a pseudo-terminal. Simulated firmware writes to the
+ * slave side (its name is printed); we read the master side.
+ */
+static int openPty(std::string& slaveName) {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) return -1;
+  slaveName = ptsname(fd);
+
+  // Raw on the slave side too, or the line discipline rewrites "\n" to "\r\n"
+  int slave = open(slaveName.c_str(), O_RDWR | O_NOCTTY);
+  termios tio;
+  if (slave >= 0 && tcgetattr(slave, &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+  }
+  // Keep `slave` open: otherwise the master reads EIO until a writer shows up
+  return fd;
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                                WRITER                                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/**
+ * Writer - The single producer. pos = absolute bytes written so far,
+ * lineStart = where the line currently being received began.
+ */
+struct Writer {
+  ring::Ring& ring;
+  uint64_t pos = 0;
+  uint64_t lineStart = 0;
+  uint64_t frames = 0;
+
+  explicit Writer(ring::Ring& r) : ring(r) {}
+
+  /** Room for the next read(): never overwrite the unfinished line. */
+  uint64_t nextChunk() const {
+    uint64_t room = ring.capacity() - (pos - lineStart);
+    return room < READ_CHUNK ? room : READ_CHUNK;
+  }
+
+  /**
+   * publish() - Make bytes [lineStart, end) a frame. The entry's seq is
+   * cleared while it's being filled, so a reader racing us sees "stale"
+   * and skips it instead of reading half an entry.
+   */
+  void publish(uint64_t end, uint64_t timeNs) {
+    uint64_t length = end - lineStart;
+    if (length && *ring.at(end - 1) == '\r') length--;   // Serial.println() sends \r\n
+
+    ring::IndexEntry& e = ring.index[frames & ring.indexMask()];
+    e.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    e.timeNs = timeNs;
+    e.offset = lineStart;
+    e.length = uint32_t(length);
+    e.seq.store(frames + 1, std::memory_order_release);
+
+    frames++;
+    ring.header->committed.store(end, std::memory_order_relaxed);
+    ring.header->frames.store(frames, std::memory_order_release);
+  }
+
+  /**
+   * readOnce() - One read() straight into the ring, then publish every
+   * complete line in it. Returns read()'s result.
+   */
+  ssize_t readOnce(int fd) {
+    uint64_t chunk = nextChunk();
+    // Tell readers which bytes are about to change BEFORE changing them
+    ring.header->head.store(pos + chunk, std::memory_order_release);
+    ssize_t n = read(fd, ring.at(pos), chunk);
+    if (n <= 0) return n;
+
+    uint64_t now = ring::nowNs();
+    const uint8_t* p = ring.at(pos);
+    for (ssize_t i = 0; i < n; i++) {
+      uint64_t at = pos + i;
+      if (p[i] == '\n') {
+        publish(at, now);
+        lineStart = at + 1;
+      } else if (at + 1 - lineStart >= MAX_LINE) {
+        publish(at + 1, now);   // Binary garbage or a runaway print: cut it
+        lineStart = at + 1;
+      }
+    }
+    pos += n;
+    return n;
+  }
+};
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                                  MAIN                                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+static void usage() {
+  std::fprintf(stderr,
+    "usage: serial_capture <device | - | --pty> <ring file> [options]\n"
+    "  --baud N      serial speed (default 9600)\n"
+    "  --size BYTES  ring data size, K/M suffix ok (default 16M)\n"
+    "  --index N     frames kept in the index (default 1048576)\n"
+    "  --quiet       don't echo lines to stdout\n");
+}
+
+static uint64_t parseSize(const char* s) {
+  char* end;
+  uint64_t n = std::strtoull(s, &end, 10);
+  if (*end == 'K' || *end == 'k') n <<= 10;
+  if (*end == 'M' || *end == 'm') n <<= 20;
+  return n;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) { usage(); return 2; }
+  std::string device = argv[1];
+  std::string ringPath = argv[2];
+  long baud = 9600;
+  uint64_t ringBytes = DEFAULT_RING_BYTES;
+  uint64_t indexEntries = DEFAULT_INDEX;
+  bool echo = true;
+  for (int i = 3; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--baud" && i + 1 < argc) baud = std::atol(argv[++i]);
+    else if (a == "--size" && i + 1 < argc) ringBytes = parseSize(argv[++i]);
+    else if (a == "--index" && i + 1 < argc) indexEntries = parseSize(argv[++i]);
+    else if (a == "--quiet") echo = false;
+    else { usage(); return 2; }
+  }
+  speed_t speed = baudConstant(baud);
+  if (!speed) { std::fprintf(stderr, "unsupported baud rate %ld\n", baud); return 2; }
+
+  ring::Ring ring;
+  if (!ring.create(ringPath, ringBytes, indexEntries)) {
+    std::fprintf(stderr, "serial_capture: %s\n", ring.error.c_str());
+    return 1;
+  }
+  std::fprintf(stderr, "ring %s: %llu KB data, %llu index entries\n", ringPath.c_str(),
+               (unsigned long long)(ring.capacity() >> 10), (unsigned long long)ring.header->indexCapacity);
+
+  int fd;
+  bool reopenable = false;
+  if (device == "-") {
+    fd = STDIN_FILENO;
+  } else if (device == "--pty") {
+    std::string slave;
+    fd = openPty(slave);
+    if (fd < 0) { std::perror("pty"); return 1; }
+    std::printf("PTY %s\n", slave.c_str());   // First stdout line, for scripts
+    std::fflush(stdout);
+  } else {
+    fd = openSerial(device, speed);
+    if (fd < 0) { std::perror(device.c_str()); return 1; }
+    reopenable = isatty(fd);
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  Writer writer(ring);
+  uint64_t echoed = 0;
+  while (!stopRequested) {
+    pollfd pfd = {fd, POLLIN, 0};
+    int ready = poll(&pfd, 1, POLL_MS);
+    if (ready < 0 && errno != EINTR) break;
+    if (ready <= 0) continue;
+
+    ssize_t n = writer.readOnce(fd);
+    if (n > 0) {
+      // Echo from the ring itself (a line can be cut across reads; only whole frames are echoed)
+      for (; echo && echoed < writer.frames; echoed++) {
+        const ring::IndexEntry& e = ring.index[echoed & ring.indexMask()];
+        std::fwrite(ring.at(e.offset), 1, e.length, stdout);
+        std::fputc('\n', stdout);
+      }
+      if (echo) std::fflush(stdout);
+      continue;
+    }
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+
+    // EOF or EIO: pipe closed, or the USB cable came out
+    if (!reopenable) break;
+    std::fprintf(stderr, "serial_capture: %s disconnected, waiting...\n", device.c_str());
+    close(fd);
+    fd = -1;
+    while (!stopRequested && fd < 0) {
+      usleep(REOPEN_MS * 1000);
+      fd = openSerial(device, speed);
+    }
+    if (fd >= 0) std::fprintf(stderr, "serial_capture: %s back\n", device.c_str());
+    echoed = writer.frames;
+  }
+
+  double seconds = (ring::nowNs() - ring.header->startNs) / 1e9;
+  std::fprintf(stderr, "captured %llu lines, %llu bytes in %.1fs\n",
+               (unsigned long long)writer.frames, (unsigned long long)writer.pos, seconds);
+  if (fd >= 0) close(fd);
+  return 0;
+}
@@ -0,0 +1,98 @@
+/**
+ * Arduino API for sketches compiled into the simulator (see sim.h).
+ * Only what the mission sketches use; pins are the robot's real wiring.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW  0
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+#define CHANGE  1
+#define RISING  2
+#define FALLING 3
+#define NOT_AN_INTERRUPT -1
+#define DEC 10
+#define HEX 16
+
+enum { A0 = 14, A1, A2, A3, A4, A5 };
+#define LED_BUILTIN 13
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int level);
+int digitalRead(int pin);
+void analogWrite(int pin, int value);
+int analogRead(int pin);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis();
+unsigned long micros();
+unsigned long pulseIn(int pin, int level, unsigned long timeoutUs = 1000000UL);
+void noInterrupts();
+void interrupts();
+inline int digitalPinToInterrupt(int pin) { return pin; }
+void attachInterrupt(int interrupt, void (*isr)(), int mode);
+void detachInterrupt(int interrupt);
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+template <class T, class L, class H>
+auto constrain(T x, L lo, H hi) -> decltype(x + lo + hi) { return x < lo ? lo : (x > hi ? hi : x); }
+
+class SimSerial {
+public:
+  void begin(long) {}
+  void end() {}
+  operator bool() const { return true; }
+  int available();
+  int read();
+  int peek();
+  void flush() {}
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* p, size_t n);
+  size_t print(const __FlashStringHelper* s);
+  size_t print(const char* s);
+  size_t print(char c);
+  size_t print(unsigned char v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(int v, int base = DEC) { return print((long)v, base); }
+  size_t print(unsigned v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(long v, int base = DEC);
+  size_t print(unsigned long v, int base = DEC);
+  size_t print(double v, int digits = 2);
+
+  size_t println() { return write('\r') + write('\n'); }
+  template <class T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  template <class T> size_t println(T v, int arg) { size_t n = print(v, arg); return n + println(); }
+};
+
+extern SimSerial Serial;
+
+// RA4M1 reset status (the FSP's R_SYSTEM, which the R4's Arduino.h pulls in).
+// The sim boots cold: PORF set, CWSF clear; after a brownout, LVD0RF and the
+// CWSF the sketch left.
+struct R_SYSTEM_Type { uint8_t RSTSR0, RSTSR1, RSTSR2; };
+extern R_SYSTEM_Type* R_SYSTEM;
+#define R_SYSTEM_RSTSR0_PORF_Msk   0x01
+#define R_SYSTEM_RSTSR0_LVD0RF_Msk 0x02
+#define R_SYSTEM_RSTSR0_LVD1RF_Msk 0x04
+#define R_SYSTEM_RSTSR0_LVD2RF_Msk 0x08
+#define R_SYSTEM_RSTSR1_IWDTRF_Msk 0x01
+#define R_SYSTEM_RSTSR1_WDTRF_Msk  0x02
+#define R_SYSTEM_RSTSR1_SWRF_Msk   0x04
+#define R_SYSTEM_RSTSR2_CWSF_Msk   0x01
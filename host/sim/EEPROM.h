@@ -0,0 +1,33 @@
+/**
+ * UNO R4 EEPROM (emulated in the RA4M1's 8 KB data flash), for the simulator.
+ * Starts erased (0xFF) in every sim process, unless Options::eepromFile
+ * (--eeprom, --practice) carries it over from an earlier run, and survives a
+ * brownout (see sim.h). A byte write costs EEPROM_WRITE_US of virtual time;
+ * reads are free.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+class EEPROMClass {
+public:
+  uint8_t read(int idx);
+  void write(int idx, uint8_t value);
+  void update(int idx, uint8_t value) {
+    if (read(idx) != value) write(idx, value);
+  }
+  template <class T> T& get(int idx, T& t) {
+    uint8_t* p = (uint8_t*)&t;
+    for (unsigned i = 0; i < sizeof(T); i++) p[i] = read(idx + i);
+    return t;
+  }
+  template <class T> const T& put(int idx, const T& t) {
+    const uint8_t* p = (const uint8_t*)&t;
+    for (unsigned i = 0; i < sizeof(T); i++) update(idx + i, p[i]);
+    return t;
+  }
+  uint16_t length() { return 8192; }
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,35 @@
+/**
+ * UNO R4 FspTimer and the Cortex-M cycle counter, for the simulator.
+ * One periodic timer; its callback runs as an interrupt on the virtual clock.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+struct timer_callback_args_t {};
+enum timer_mode_t { TIMER_MODE_PERIODIC };
+typedef void (*GPTimerCbk_f)(timer_callback_args_t*);
+
+class FspTimer {
+public:
+  static int8_t get_available_timer(uint8_t& type, bool = false) { type = 0; return 0; }
+  bool begin(timer_mode_t mode, uint8_t type, uint8_t channel, float freqHz, float duty,
+             GPTimerCbk_f callback = nullptr, void* context = nullptr);
+  bool setup_overflow_irq(uint8_t = 12) { return true; }
+  bool open() { return true; }
+  bool start();
+  bool stop();
+
+private:
+  float freqHz_ = 0;
+  GPTimerCbk_f callback_ = nullptr;
+};
+
+struct DWT_Type { uint32_t CTRL; uint32_t CYCCNT; };
+struct CoreDebug_Type { uint32_t DEMCR; };
+extern DWT_Type* DWT;                 // CYCCNT follows the virtual clock
+extern CoreDebug_Type* CoreDebug;
+extern uint32_t SystemCoreClock;      // 48 MHz, like the R4
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk     1UL
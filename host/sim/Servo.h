@@ -0,0 +1,18 @@
+/** Servo library for the simulator: angles go to the simulated arm (see sim.h). */
+
+#pragma once
+
+#include <cstdint>
+
+class Servo {
+public:
+  uint8_t attach(int pin);
+  void detach() { pin_ = -1; }
+  bool attached() const { return pin_ >= 0; }
+  void write(int angle);
+  int read() const { return angle_; }
+
+private:
+  int pin_ = -1;
+  int angle_ = 90;
+};
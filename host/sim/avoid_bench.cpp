@@ -0,0 +1,156 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║        AVOID BENCH: around an obstacle with arcs vs stop-pivot-stop       ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * Drives the obstacle sketch's own avoidObstacle() in the simulator, both
+ * ways, from the same starts. Each run puts one 14 cm block on an empty
+ * floor, comes in at SPEED_NORMAL like TO_OBSTACLES until rangeAtStop() <
+ * DIST_OBSTACLE, goes around, then drives on at SPEED_NORMAL to a finish
+ * line FINISH_CM past the block. The robot starts up to 2 cm off the
+ * block's center line.
+ *
+ *   AVOID: pivot ms=6139/16 finish_ms=8079/1297 off_cm=8.1/47.5 heading_deg=2.8/20.0 collisions=2/60
+ *   AVOID: arc   ms=3429/10 finish_ms=4734/48 off_cm=-0.1/7.3 heading_deg=-0.1/6.3 collisions=0/60
+ *   AVOID: saved_ms=2710 per maneuver, 3346 to the finish line
+ *
+ * ms = avoidObstacle() itself (mean/sd); finish_ms = from the moment it
+ * was called to the finish line (the arcs end rolling and further on);
+ * off_cm = where the robot crossed the finish line, off the center line;
+ * heading_deg = its heading error there.
+ *
+ * BUILD: see build.sh (it includes ../../standalone/obstacle_section)
+ * USAGE: avoid_bench [--runs N] [--noise X]
+ */
+
+#include "Arduino.h"
+#include "obstacle_section.ino"
+
+#include "sim.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+constexpr double OBJECT_X = 120;    // Near face of the block
+constexpr double OBJECT_CM = 14;
+constexpr double FROM_CM = 45;      // Sonar to block at the start of a run
+constexpr double FINISH_CM = 60;    // Finish line past the block's far face
+constexpr uint64_t SETTLE_US = 600000;
+constexpr uint64_t GIVE_UP_US = 15000000;
+
+struct Run {
+  double ms, finishMs, offCm, headingDeg;
+  bool collided;
+};
+
+/** Empty floor with one block, its near face at OBJECT_X, centered on y = 0. */
+static void buildScene() {
+  sim::Scene& sc = sim::scene();
+  sc = sim::Scene();
+  sim::Solid s;
+  s.kind = sim::Solid::BLOCK;
+  s.a = {OBJECT_X + OBJECT_CM / 2, 0};
+  s.b = {OBJECT_CM, OBJECT_CM};
+  s.start = s.a;
+  sc.solids.push_back(s);
+}
+
+/** Approach, avoid, and drive on to the finish line. */
+static Run avoidRun(double offsetCm, bool arcs) {
+  sim::Pose p;
+  p.x = OBJECT_X - sim::physics().sonarFwdCm - FROM_CM;
+  p.y = offsetCm;
+  sim::placeRobot(p);
+  readDistance();
+
+  uint64_t start = sim::nowUs();
+  moveForward(SPEED_NORMAL);
+  while (sim::nowUs() - start < GIVE_UP_US) {
+    float dist = readDistance();
+    readColor();
+    float ahead = rangeAtStop(dist);
+    lastDistance = dist;
+    if (ahead > 0 && ahead < DIST_OBSTACLE) break;
+  }
+
+  Run r;
+  uint64_t t0 = sim::nowUs();
+  avoidObstacle(arcs);
+  r.ms = (sim::nowUs() - t0) / 1000.0;
+  moveForward(SPEED_NORMAL);
+  while (sim::pose().x < OBJECT_X + OBJECT_CM + FINISH_CM && sim::nowUs() - t0 < GIVE_UP_US) {
+    odometerCm();
+    delay(1);
+  }
+  r.finishMs = (sim::nowUs() - t0) / 1000.0;
+  r.offCm = sim::pose().y;
+  r.headingDeg = std::remainder(sim::pose().heading, 360.0);
+  r.collided = sim::stats().collisions > 0;
+  return r;
+}
+
+static void meanSd(const std::vector<double>& v, double& mean, double& sd) {
+  mean = sd = 0;
+  for (double x : v) mean += x / v.size();
+  for (double x : v) sd += (x - mean) * (x - mean);
+  sd = v.size() > 1 ? std::sqrt(sd / (v.size() - 1)) : 0;
+}
+
+int main(int argc, char** argv) {
+  int runs = 20;
+  sim::Options options;
+  options.echoSerial = false;
+  options.timeLimitS = 0;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--runs" && i + 1 < argc) runs = std::max(1, std::atoi(argv[++i]));
+    else if (a == "--noise" && i + 1 < argc) options.noise = std::atof(argv[++i]);
+    else {
+      std::fprintf(stderr, "usage: avoid_bench [--runs N] [--noise X]\n");
+      return 2;
+    }
+  }
+
+  buildScene();
+  sim::reset(options);
+  setup();   // Waits for the start cue
+  options.startCueS = -1;
+
+  std::printf("# ARC_RADIUS_CM=%d AVOID_SIDE_CM=%d AVOID_CLEAR_CM=%d DIST_OBSTACLE=%d runs=%d noise=%.2f\n",
+              ARC_RADIUS_CM, AVOID_SIDE_CM, AVOID_CLEAR_CM, DIST_OBSTACLE, runs, options.noise);
+  double meanMs[2], meanFinish[2];
+  for (bool arcs : {false, true}) {
+    std::vector<double> ms, finish, off, heading;
+    int collided = 0;
+    for (int r = 0; r < runs; r++) {
+      for (double offset : {-2.0, 0.0, 2.0}) {
+        stopMotors();
+        sim::run(SETTLE_US);
+        options.seed = 1 + r;
+        sim::reset(options);
+        Run run = avoidRun(offset, arcs);
+        ms.push_back(run.ms);
+        finish.push_back(run.finishMs);
+        off.push_back(run.offCm);
+        heading.push_back(run.headingDeg);
+        collided += run.collided;
+      }
+    }
+    double m, s, fm, fs, om, os, hm, hs;
+    meanSd(ms, m, s);
+    meanSd(finish, fm, fs);
+    meanSd(off, om, os);
+    meanSd(heading, hm, hs);
+    meanMs[arcs] = m;
+    meanFinish[arcs] = fm;
+    std::printf("AVOID: %-5s ms=%.0f/%.0f finish_ms=%.0f/%.0f off_cm=%.1f/%.1f heading_deg=%.1f/%.1f collisions=%d/%zu\n",
+                arcs ? "arc" : "pivot", m, s, fm, fs, om, os, hm, hs, collided, ms.size());
+    std::fflush(stdout);
+  }
+  std::printf("AVOID: saved_ms=%.0f per maneuver, %.0f to the finish line\n", meanMs[0] - meanMs[1],
+              meanFinish[0] - meanFinish[1]);
+  return 0;
+}
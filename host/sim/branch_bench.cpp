@@ -0,0 +1,190 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║         BRANCH BENCH: finding the green branch at the intersection        ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * Drives the start sketch's own code in the simulator on intersections of
+ * different shapes: the black line in, then a green and a red branch
+ * leaving the junction at the angles given (red on top, like the course).
+ * The robot drives in along the black line, 1 cm either side of it or on
+ * it, stops on the first green or red read like FIND_INTERSECTION, then
+ * picks the branch two ways:
+ *
+ *   blind  the old SELECT_GREEN: turn left 300ms, read once, else turn
+ *          right 600ms (and follow "green" either way)
+ *   scan   selectBranch() (the sketch now)
+ *
+ *   BRANCH: green=50 red=0 blind=0.90s,34/60,-43.1/53.4 scan=3.08s,58/60,-2.6/11.0
+ *   BRANCH: all blind=0.97s,130/420 scan=3.34s,390/420
+ *
+ * time = mean from the stop at the junction to standing still, aligned;
+ * then runs whose true heading ended within ALIGNED_DEG of the green
+ * branch, out of all; then the heading error mean/sd in degrees. The
+ * blind turn is quicker because it never checks: off the map's 50° left
+ * it's right only by luck.
+ *
+ * BUILD: see build.sh (it includes ../../standalone/start_section)
+ * USAGE: branch_bench [--runs N] [--noise X]
+ */
+
+#include "Arduino.h"
+#include "start_section.ino"
+
+#include "sim.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+constexpr double JUNCTION_X = 100;
+constexpr double BRANCH_CM = 60;
+constexpr double ALIGNED_DEG = 10;        // Close enough to follow it from there
+constexpr uint64_t SETTLE_US = 600000;
+constexpr uint64_t GIVE_UP_US = 5000000;
+constexpr uint64_t STILL_STEP_US = 5000;
+
+struct Junction {
+  double green, red;   // Branch headings, degrees
+};
+
+static const Junction JUNCTIONS[] = {
+  { 50, 0 }, { 30, 0 }, { 70, 0 }, { 90, 0 }, { -50, 0 }, { 0, 50 }, { 50, -50 },
+};
+
+static void branch(sim::Scene& sc, double deg, double width, sim::Paint color) {
+  sim::PaintOp p;
+  p.kind = sim::PaintOp::LINE;
+  p.a = {JUNCTION_X, 0};
+  p.b = {JUNCTION_X + BRANCH_CM * std::cos(deg * M_PI / 180), BRANCH_CM * std::sin(deg * M_PI / 180)};
+  p.size = width;
+  p.color = color;
+  sc.paint.push_back(p);
+}
+
+/** The black line in, then the two branches (widths as in start.scene). */
+static void buildScene(const Junction& j) {
+  sim::Scene& sc = sim::scene();
+  sc = sim::Scene();
+  sim::PaintOp black;
+  black.kind = sim::PaintOp::LINE;
+  black.a = {-80, 0};
+  black.b = {JUNCTION_X + 3, 0};
+  black.size = 3;
+  black.color = sim::BLACK;
+  sc.paint.push_back(black);
+  branch(sc, j.green, 4, sim::GREEN);
+  branch(sc, j.red, 3, sim::RED);
+}
+
+/** Let the robot roll to a standstill. */
+static void waitStill() {
+  while (std::fabs(sim::wheelSpeed(false)) + std::fabs(sim::wheelSpeed(true)) > 1.0) sim::run(STILL_STEP_US);
+}
+
+static double wrap(double deg) {
+  while (deg > 180) deg -= 360;
+  while (deg < -180) deg += 360;
+  return deg;
+}
+
+/** One arrival at the junction and branch pick; returns the heading error, sets the time. */
+static double branchRun(const Junction& j, double offsetCm, bool scan, double& seconds) {
+  sim::Pose p;
+  p.x = JUNCTION_X - 50;
+  p.y = offsetCm;
+  sim::placeRobot(p);
+
+  // FIND_INTERSECTION: drive in until green or red, then stop (onIntersection)
+  uint64_t start = sim::nowUs();
+  moveForward(SPEED_NORMAL);
+  while (sim::nowUs() - start < GIVE_UP_US) {
+    readDistance();
+    Color c = readColor();
+    if (c == COLOR_GREEN || c == COLOR_RED) break;
+  }
+  colorSeenUs = colorAtUs;
+  stopMotors();
+  uint64_t stopped = sim::nowUs();
+  readDistance();   // The next tick's reads, before SELECT_GREEN acts
+  readColor();
+
+  if (scan) {
+    selectBranch();
+  } else {
+    turnLeft(SPEED_TURN);
+    delay(300);
+    stopMotors();
+    if (readColor() != COLOR_GREEN) {
+      turnRight(SPEED_TURN);
+      delay(600);
+      stopMotors();
+    }
+  }
+  waitStill();
+  seconds = (sim::nowUs() - stopped) / 1e6;
+  return wrap(sim::pose().heading - j.green);
+}
+
+int main(int argc, char** argv) {
+  int runs = 20;
+  sim::Options options;
+  options.echoSerial = false;
+  options.timeLimitS = 0;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--runs" && i + 1 < argc) runs = std::max(1, std::atoi(argv[++i]));
+    else if (a == "--noise" && i + 1 < argc) options.noise = std::atof(argv[++i]);
+    else {
+      std::fprintf(stderr, "usage: branch_bench [--runs N] [--noise X]\n");
+      return 2;
+    }
+  }
+
+  buildScene(JUNCTIONS[0]);
+  sim::reset(options);
+  setup();   // Waits for the start cue
+  options.startCueS = -1;
+
+  std::printf("# SPEED_SCAN=%d BRANCH_SCAN_DEG=%d BRANCH_ALIGN_DEG=%d runs=%d noise=%.2f\n",
+              SPEED_SCAN, BRANCH_SCAN_DEG, BRANCH_ALIGN_DEG, runs, options.noise);
+  int total = 0, aligned[2] = {};
+  double seconds[2] = {};
+  for (const Junction& j : JUNCTIONS) {
+    buildScene(j);
+    std::printf("BRANCH: green=%.0f red=%.0f", j.green, j.red);
+    for (int scan = 0; scan < 2; scan++) {
+      std::vector<double> errors;
+      double time = 0;
+      int ok = 0;
+      for (int r = 0; r < runs; r++) {
+        for (double offset : {-1.0, 0.0, 1.0}) {
+          stopMotors();
+          sim::run(SETTLE_US);
+          options.seed = 1 + r;
+          sim::reset(options);
+          double s = 0;
+          double err = branchRun(j, offset, scan, s);
+          errors.push_back(err);
+          time += s;
+          ok += std::fabs(err) <= ALIGNED_DEG;
+        }
+      }
+      int n = errors.size();
+      double mean = 0, sd = 0;
+      for (double e : errors) mean += e / n;
+      for (double e : errors) sd += (e - mean) * (e - mean);
+      sd = n > 1 ? std::sqrt(sd / (n - 1)) : 0;
+      std::printf(" %s=%.2fs,%d/%d,%+.1f/%.1f", scan ? "scan" : "blind", time / n, ok, n, mean, sd);
+      aligned[scan] += ok;
+      seconds[scan] += time;
+      if (scan) total += n;
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+  }
+  std::printf("BRANCH: all blind=%.2fs,%d/%d scan=%.2fs,%d/%d\n", seconds[0] / total, aligned[0], total,
+              seconds[1] / total, aligned[1], total);
+  return 0;
+}
@@ -0,0 +1,37 @@
+#!/bin/sh
+# Build the simulator once per mission sketch, plus the benches, into
+# host/sim/build/. The sketches compile unchanged: this folder's Arduino.h,
+# Servo.h and FspTimer.h stand in for the board (see sim.h).
+#
+#   ./build.sh                  # sim_start, sim_target, sim_obstacle and the benches
+#   ./build.sh obstacle         # just sim_obstacle
+#   CXX=clang++ ./build.sh
+
+set -eu
+cd "$(dirname "$0")"
+CXX=${CXX:-g++}
+FLAGS="-std=gnu++17 -O2 -Wall -I."
+SKETCHES=../../standalone
+
+mkdir -p build
+$CXX $FLAGS -c sim.cpp -o build/sim.o
+
+for s in ${*:-start target obstacle}; do
+  dir=$SKETCHES/${s}_section
+  $CXX $FLAGS -I"$dir" -include Arduino.h -x c++ "$dir/${s}_section.ino" -x none \
+    sim_main.cpp build/sim.o -o "build/sim_$s"
+  echo "build/sim_$s"
+done
+
+# Benches include a sketch themselves (to call its functions)
+[ $# -gt 0 ] && exit 0
+$CXX $FLAGS -I$SKETCHES/start_section stop_bench.cpp build/sim.o -o build/stop_bench
+echo "build/stop_bench"
+$CXX $FLAGS -I$SKETCHES/obstacle_section classify_bench.cpp build/sim.o -o build/classify_bench
+echo "build/classify_bench"
+$CXX $FLAGS -I$SKETCHES/start_section branch_bench.cpp build/sim.o -o build/branch_bench
+echo "build/branch_bench"
+$CXX $FLAGS -I$SKETCHES/obstacle_section avoid_bench.cpp build/sim.o -o build/avoid_bench
+echo "build/avoid_bench"
+$CXX $FLAGS -I$SKETCHES/start_section power_bench.cpp build/sim.o -o build/power_bench
+echo "build/power_bench"
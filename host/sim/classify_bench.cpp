@@ -0,0 +1,157 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║          CLASSIFY BENCH: box or obstacle, on objects of every size        ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * Drives the obstacle sketch's own classifyObject() in the simulator. Each
+ * run puts one object on an empty floor, comes in at SPEED_NORMAL like
+ * FOLLOW_RED until rangeAtStop() < CLASSIFY_RANGE_CM, then stops and
+ * classifies. The robot starts up to 3 cm off the object's center line.
+ *
+ * Objects: boxes 5, 6 and 8 cm square; blocks 10, 14 and 20 cm wide; a
+ * 60 cm wall. Each is tried "near" the start of the red line (where the
+ * course says a box is likely) and "far" from it.
+ *
+ *   CLASSIFY: box6 near box=60/60 conf=0.99 width_cm=6.4/0.5 edges=2.0
+ *   CLASSIFY: near correct=382/420 box_as_obstacle=0 obstacle_as_box=38
+ *
+ * box = runs called BOX; conf = mean confidence in the class given;
+ * width_cm = mean/sd of the estimate; edges = mean clean edges seen. The
+ * 10 cm block is halfway between BOX_WIDTH_CM and OBSTACLE_WIDTH_CM on
+ * purpose: there the course position decides (a box 38/60 near, 17/60
+ * far). Up to 10 cm the width is right within 0.5 cm. Past that the
+ * 60° sweep runs out before the far edge does: 14 cm reads 13.3, 20 cm
+ * 16.7 and the wall 18.1, the most the sweep can see from 20 cm.
+ *
+ * BUILD: see build.sh (it includes ../../standalone/obstacle_section)
+ * USAGE: classify_bench [--runs N] [--noise X]
+ */
+
+#include "Arduino.h"
+#include "obstacle_section.ino"
+
+#include "sim.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+constexpr double OBJECT_X = 120;    // Near face of the object
+constexpr double FROM_CM = 45;      // Sonar to object at the start of a run
+constexpr uint64_t SETTLE_US = 600000;
+constexpr uint64_t GIVE_UP_US = 5000000;
+
+struct Object {
+  const char* name;
+  sim::Solid::Kind kind;
+  double width, depth;
+};
+
+static const Object OBJECTS[] = {
+  { "box5",     sim::Solid::BOX,   5,  5 },
+  { "box6",     sim::Solid::BOX,   6,  6 },
+  { "box8",     sim::Solid::BOX,   8,  8 },
+  { "block10",  sim::Solid::BLOCK, 10, 14 },
+  { "block14",  sim::Solid::BLOCK, 14, 14 },
+  { "block20",  sim::Solid::BLOCK, 20, 14 },
+  { "wall60",   sim::Solid::BLOCK, 60, 10 },
+};
+
+/** Empty floor with just `o`, its near face at OBJECT_X, centered on y = 0. */
+static void buildScene(const Object& o) {
+  sim::Scene& sc = sim::scene();
+  sc = sim::Scene();
+  sim::Solid s;
+  s.kind = o.kind;
+  s.a = {OBJECT_X + o.depth / 2, 0};
+  s.b = {o.depth, o.width};
+  s.start = s.a;
+  sc.solids.push_back(s);
+}
+
+/** One approach and look from `offsetCm` off the center line. */
+static ObjectView classifyRun(double offsetCm, bool nearRedStart) {
+  sim::Pose p;
+  p.x = OBJECT_X - sim::physics().sonarFwdCm - FROM_CM;
+  p.y = offsetCm;
+  sim::placeRobot(p);
+  readDistance();
+  holding = false;
+  redStartCm = odometerCm() - (nearRedStart ? 0 : 2 * BOX_WITHIN_CM);
+
+  uint64_t start = sim::nowUs();
+  moveForward(SPEED_NORMAL);
+  while (sim::nowUs() - start < GIVE_UP_US) {
+    float dist = readDistance();
+    readColor();
+    float ahead = rangeAtStop(dist);
+    if (ahead > 0 && ahead < CLASSIFY_RANGE_CM) break;
+  }
+  return classifyObject();
+}
+
+int main(int argc, char** argv) {
+  int runs = 20;
+  sim::Options options;
+  options.echoSerial = false;
+  options.timeLimitS = 0;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--runs" && i + 1 < argc) runs = std::max(1, std::atoi(argv[++i]));
+    else if (a == "--noise" && i + 1 < argc) options.noise = std::atof(argv[++i]);
+    else {
+      std::fprintf(stderr, "usage: classify_bench [--runs N] [--noise X]\n");
+      return 2;
+    }
+  }
+
+  buildScene(OBJECTS[0]);
+  sim::reset(options);
+  setup();   // Waits for the start cue
+  options.startCueS = -1;
+
+  std::printf("# CLASSIFY_RANGE_CM=%d SWEEP_DEG=%d BOX_WIDTH_CM=%d OBSTACLE_WIDTH_CM=%d runs=%d noise=%.2f\n",
+              CLASSIFY_RANGE_CM, SWEEP_DEG, BOX_WIDTH_CM, OBSTACLE_WIDTH_CM, runs, options.noise);
+  for (bool nearRedStart : {true, false}) {
+    const char* where = nearRedStart ? "near" : "far";
+    int correct = 0, total = 0, boxMissed = 0, obstacleTaken = 0;
+    for (const Object& o : OBJECTS) {
+      buildScene(o);
+      bool isBox = o.kind == sim::Solid::BOX;
+      int calledBox = 0, n = 0;
+      double conf = 0, edges = 0;
+      std::vector<double> widths;
+      for (int r = 0; r < runs; r++) {
+        for (double offset : {-3.0, 0.0, 3.0}) {
+          stopMotors();
+          sim::run(SETTLE_US);
+          options.seed = 1 + r;
+          sim::reset(options);
+          ObjectView v = classifyRun(offset, nearRedStart);
+          bool box = v.kind == OBJ_BOX;
+          calledBox += box;
+          conf += v.confidence;
+          edges += v.edges;
+          widths.push_back(v.widthCm);
+          n++;
+          if (box == isBox) correct++;
+          else if (isBox) boxMissed++;
+          else obstacleTaken++;
+          total++;
+        }
+      }
+      double mean = 0, sd = 0;
+      for (double w : widths) mean += w / n;
+      for (double w : widths) sd += (w - mean) * (w - mean);
+      sd = n > 1 ? std::sqrt(sd / (n - 1)) : 0;
+      std::printf("CLASSIFY: %s %s box=%d/%d conf=%.2f width_cm=%.1f/%.1f edges=%.1f\n", o.name, where, calledBox,
+                  n, conf / n, mean, sd, edges / n);
+      std::fflush(stdout);
+    }
+    std::printf("CLASSIFY: %s correct=%d/%d box_as_obstacle=%d obstacle_as_box=%d\n", where, correct, total,
+                boxMissed, obstacleTaken);
+  }
+  return 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║         POWER BENCH: motors and servos starting at once, arbitrated       ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * Runs the start sketch's own control interrupt and power arbiter in the
+ * simulator on moves where the motors and the servos want current at the
+ * same moment - the missions do theirs one after the other, so this is
+ * where the servo side of the arbiter gets tested. Each case starts from
+ * steady `before` motor outputs with the servos at rest, then at once sets
+ * the `after` outputs and sends the servos their moves:
+ *
+ *   go+grip       standing start at SPEED_NORMAL while the claw closes
+ *   reverse+lift  forward at SPEED_NORMAL thrown into reverse, arm raised
+ *   pivot+drop    pivot at SPEED_TURN from standing, arm lowered and claw opened
+ *
+ * once with an unlimited budget ("raw", just as without the arbiter) and
+ * once with POWER_BUDGET_MA ("arb"):
+ *
+ *   POWER: reverse+lift  raw peak_a=2.72 sags=3 servo_ms=153  arb peak_a=1.51 sags=0 servo_ms=282 added_ms=54
+ *
+ * peak_a and sags are the simulated battery's (see sim.h), servo_ms is
+ * until servosMoving() went false, and added_ms is how much later the
+ * wheels got where the raw run had them after AFTER_MS: the arbitrated
+ * run's travel deficit over its final wheel speed.
+ *
+ * BUILD: see build.sh (it includes ../../standalone/start_section)
+ * USAGE: power_bench [--noise X]
+ */
+
+#include "Arduino.h"
+#include "start_section.ino"
+
+#include "sim.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+constexpr uint32_t BEFORE_MS = 600;   // Settle into `before`
+constexpr uint32_t AFTER_MS = 1000;   // Then watch `after` this long
+constexpr uint16_t UNLIMITED_MA = 60000;
+
+struct Case {
+  const char* name;
+  int16_t before, after;          // Left wheel PWM (signed)...
+  int8_t turnBefore, turnAfter;   // ...the right's is that x this: 1 = straight, -1 = pivot
+  uint8_t armFrom, armTo, clampFrom, clampTo;
+};
+
+struct Result {
+  double peakA, servoMs, travelCm, speed;
+  uint32_t sags;
+};
+
+static void drive(int16_t left, int8_t turn) {
+  setDrive(left, (int16_t)(left * turn * SPEED_COMPENSATION));
+}
+
+static Result runCase(const Case& c, uint16_t budgetMa, const sim::Options& options) {
+  sim::reset(options);
+  power.begin(POWER_BUDGET_MA, DRIVE_DEADBAND, DRIVE_TAU_MS, CONTROL_HZ);
+  power.start(controlRunning);
+  power.attachServo(SERVO_ARM, baseServo, c.armFrom);
+  power.attachServo(SERVO_CLAMP, clampServo, c.clampFrom);
+  delay(BEFORE_MS);   // attachServo() doesn't wait: back to the start before the motors go
+  drive(c.before, c.turnBefore);
+  delay(BEFORE_MS);
+  uint32_t sagsBefore = sim::stats().sags;
+
+  power.begin(budgetMa, DRIVE_DEADBAND, DRIVE_TAU_MS, CONTROL_HZ);
+  drive(c.after, c.turnAfter);
+  if (c.armTo != c.armFrom) power.moveServo(SERVO_ARM, c.armTo);
+  if (c.clampTo != c.clampFrom) power.moveServo(SERVO_CLAMP, c.clampTo);
+  Result r = {0, 0, 0, 0, 0};
+  double signLeft = c.after < 0 ? -1 : 1, signRight = signLeft * c.turnAfter;
+  for (uint32_t ms = 1; ms <= AFTER_MS; ms++) {
+    delay(1);
+    double v = (sim::wheelSpeed(false) * signLeft + sim::wheelSpeed(true) * signRight) / 2;
+    r.travelCm += v / 1000;   // Toward the new command: backing off the old one counts against it
+    r.speed = v;
+    if (!r.servoMs && !power.servosMoving()) r.servoMs = ms;
+  }
+  r.peakA = sim::stats().peakA;
+  r.sags = sim::stats().sags - sagsBefore;
+  stopMotors();
+  delay(BEFORE_MS);
+  return r;
+}
+
+int main(int argc, char** argv) {
+  sim::Options options;
+  options.echoSerial = false;
+  options.timeLimitS = 0;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--noise" && i + 1 < argc) options.noise = std::atof(argv[++i]);
+    else {
+      std::fprintf(stderr, "usage: power_bench [--noise X]\n");
+      return 2;
+    }
+  }
+
+  sim::scene() = sim::Scene();   // An empty floor
+  sim::reset(options);
+  setup();   // Waits for the start cue
+  options.startCueS = -1;
+
+  const Case cases[] = {
+    {"go+grip",      0,           SPEED_NORMAL,  1,  1, SERVO_ARM_DOWN,  SERVO_ARM_DOWN,  SERVO_CLAMP_OPEN,   SERVO_CLAMP_CLOSED},
+    {"reverse+lift", SPEED_NORMAL, -SPEED_NORMAL, 1,  1, SERVO_ARM_DOWN,  SERVO_ARM_CARRY, SERVO_CLAMP_CLOSED, SERVO_CLAMP_CLOSED},
+    {"pivot+drop",   0,           SPEED_TURN,    1, -1, SERVO_ARM_CARRY, SERVO_ARM_DOWN,  SERVO_CLAMP_CLOSED, SERVO_CLAMP_OPEN},
+  };
+  std::printf("# POWER_BUDGET_MA=%d SPEED_NORMAL=%d SPEED_TURN=%d noise=%.2f\n", POWER_BUDGET_MA, SPEED_NORMAL,
+              SPEED_TURN, options.noise);
+  for (const Case& c : cases) {
+    options.seed = 1;
+    Result raw = runCase(c, UNLIMITED_MA, options);
+    Result arb = runCase(c, POWER_BUDGET_MA, options);
+    double addedMs = arb.speed > 0 ? std::round((raw.travelCm - arb.travelCm) / arb.speed * 1000) : 0;
+    addedMs = addedMs == 0 ? 0 : addedMs;   // Not "-0" when the arbiter cost nothing
+    std::printf("POWER: %-13s raw peak_a=%.2f sags=%u servo_ms=%.0f  arb peak_a=%.2f sags=%u servo_ms=%.0f added_ms=%.0f\n",
+                c.name, raw.peakA, raw.sags, raw.servoMs, arb.peakA, arb.sags, arb.servoMs, addedMs);
+    std::fflush(stdout);
+  }
+  return 0;
+}
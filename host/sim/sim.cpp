@@ -0,0 +1,954 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║          SIM CORE: virtual clock, Arduino API, robot and sensors          ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * Everything the sketch calls lands here. Time only moves when the sketch
+ * spends it: delay(), pulseIn() and a small cost per pin access or clock
+ * read (so busy-wait loops terminate). While time moves, advance() steps
+ * the physics, flips the echo pin, and runs pending interrupts.
+ */
+
+#include "sim.h"
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "FspTimer.h"
+#include "Servo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace sim {
+namespace {
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                               SETTINGS                                     ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+// Wiring (README "Hardware Wiring"): the same in every sketch
+constexpr int PIN_COLOR_S2 = 4, PIN_COLOR_S3 = 5, PIN_COLOR_OUT = 6;
+constexpr int PIN_ENA = 9, PIN_IN1 = 8, PIN_IN2 = 7;      // LEFT motor
+constexpr int PIN_ENB = 10, PIN_IN3 = 11, PIN_IN4 = 12;   // RIGHT motor
+constexpr int PIN_TRIG = A0, PIN_ECHO = A1, PIN_IR_LEFT = A2, PIN_IR_RIGHT = A3;
+constexpr int PIN_SERVO_CLAMP = A4, PIN_SERVO_BASE = A5;
+constexpr int PIN_START = 0;                               // Start button, to GND
+constexpr int PINS = 32;
+
+// Claw: the sketches use arm 0 = down, clamp 0 = closed / 90 = open
+constexpr double ARM_DOWN_BELOW = 15, CLAMP_CLOSED_BELOW = 20, CLAMP_OPEN_ABOVE = 60;
+constexpr double SERVO_DEG_PER_US = 60.0 / 150000;   // SG90: 0.15 s per 60°...
+constexpr double SERVO_TAU_US = 20000;               // ...closer in, its position loop: speed = error / tau
+
+// Power: one pack feeds the L298N, the servos and the board's regulator (A)
+constexpr double SUPPLY_V = 9.0, SUPPLY_OHM = 1.5;   // 6 x AA under load, wiring and switch included
+constexpr double SAG_V = 6.5;                        // VIN below this: the 5 V rail dips, the LVD resets the board
+constexpr double BOARD_A = 0.08;
+constexpr double MOTOR_STALL_A = 1.2;                // TT gearmotor, full PWM, not turning
+constexpr double MOTOR_FREE_A = 0.12;                // ...full PWM, free running
+constexpr double SERVO_MOVE_A = 0.65;                // SG90 slewing at full speed (stall 0.75)
+
+// What API calls cost on the virtual CPU (µs)
+constexpr uint64_t COST_PIN_US = 1;
+constexpr uint64_t COST_ANALOG_WRITE_US = 2;
+constexpr uint64_t COST_ANALOG_READ_US = 20;
+constexpr uint64_t COST_CLOCK_US = 1;
+constexpr uint64_t COST_PRINT_US = 20;
+constexpr uint64_t COST_ISR_ENTRY_US = 1;
+constexpr uint64_t PULSEIN_POLL_US = 2;
+constexpr uint64_t COST_EEPROM_WRITE_US = 1000;   // Per byte; a guess - the robot's CKPT: line has the real one
+
+constexpr uint64_t PHYSICS_STEP_US = 250;
+constexpr uint64_t POSE_LOG_US = 20000;
+constexpr uint32_t CPU_HZ = 48000000;
+
+// HC-SR04
+constexpr double SOUND_CM_PER_US = 0.0343;
+constexpr uint64_t SONAR_BURST_US = 460;     // Trigger to echo rising
+constexpr uint64_t SONAR_NOTHING_US = 38000; // Echo width with nothing in range
+constexpr double SONAR_MIN_CM = 2, SONAR_MAX_CM = 400;
+constexpr double SONAR_BEAM_DEG = 12;        // Half-angle of the rays cast
+constexpr double SONAR_NOISE_CM = 0.2;
+constexpr double HAND_CM = 6;                // The start cue's hand
+
+// TCS3200 LOW half-period (µs, 20% scaling) per floor color and filter
+//                                  red  green  blue  clear
+const double COLOR_PULSE_US[5][4] = {{ 40,  42,   36,   12},    // WHITE
+                                     {260, 275,  250,   90},    // BLACK
+                                     { 70, 190,  160,   30},    // RED
+                                     {170,  80,  140,   30},    // GREEN
+                                     {180, 140,   70,   30}};   // BLUE
+constexpr double COLOR_NOISE = 0.04;         // Relative
+constexpr double MOTOR_SPREAD = 0.01;        // Per-run gain mismatch left after SPEED_COMPENSATION
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                                 STATE                                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+struct ServoState {
+  double pos = 90, target = 90;
+};
+
+struct World {
+  Scene scene;
+  Physics nominal;
+  Physics truth;                 // nominal with this run's motor spread
+  Options options;
+  Stats stats;
+  std::mt19937 rng{1};
+
+  uint64_t now = 0;
+  uint64_t started = 0;
+  uint64_t deadline = 0;
+  uint64_t bootAt = 0;           // The board's clocks (millis() etc.) count from here
+  int64_t cueAt = -1;            // Start of the start cue (-1 = none)
+  uint64_t brownoutAt = 0;
+  uint64_t nextPhysics = 0, nextPoseLog = 0;
+
+  Pose pose;
+  double vLeft = 0, vRight = 0;
+  bool touching = false, shoving = false;
+  double servoA = 0;             // What the servos drew this physics step
+  bool sagging = false;
+  int held = -1;                 // Index of the box in the claw
+  double lastClamp = 90;
+
+  uint8_t level[PINS] = {};
+  uint8_t mode[PINS] = {};
+  int pwm[PINS] = {};
+  ServoState servo[PINS];
+
+  bool trigHigh = false, echoBusy = false, echoHigh = false;
+  uint64_t echoRise = 0, echoFall = 0;
+
+  bool irqEnabled = true, inIsr = false;
+  void (*echoIsr)() = nullptr;
+  bool echoPending = false;
+  GPTimerCbk_f timerCallback = nullptr;
+  uint64_t timerPeriod = 0, timerNext = 0;
+  bool timerPending = false;
+
+  std::string out;
+  std::string input;
+  size_t inputPos = 0;
+  std::vector<std::function<void(const std::string&)>> listeners;
+  std::string stateName = "-";
+  FILE* poseLog = nullptr;
+
+  std::vector<uint8_t> eeprom = std::vector<uint8_t>(8192, 0xFF);
+  R_SYSTEM_Type resetFlags = {R_SYSTEM_RSTSR0_PORF_Msk, 0, 0};
+};
+
+World& w() {
+  static World world;
+  return world;
+}
+
+/** The start cue is on (see sim.h). */
+bool cueNow() {
+  const World& s = w();
+  return s.cueAt >= 0 && s.now >= uint64_t(s.cueAt) && s.now < uint64_t(s.cueAt) + uint64_t(CUE_MS * 1000);
+}
+
+double gauss(double sd) {
+  if (sd <= 0) return 0;
+  std::normal_distribution<double> d(0, sd);
+  return d(w().rng);
+}
+
+double uniform(double lo, double hi) {
+  std::uniform_real_distribution<double> d(lo, hi);
+  return d(w().rng);
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                               GEOMETRY                                     ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+constexpr double DEG = M_PI / 180;
+
+Vec ahead(const Pose& p, double fwd, double left = 0) {
+  double h = p.heading * DEG;
+  return {p.x + fwd * std::cos(h) - left * std::sin(h), p.y + fwd * std::sin(h) + left * std::cos(h)};
+}
+
+double dot(Vec a, Vec b) { return a.x * b.x + a.y * b.y; }
+Vec sub(Vec a, Vec b) { return {a.x - b.x, a.y - b.y}; }
+
+Vec closestOnSegment(Vec p, Vec a, Vec b) {
+  Vec ab = sub(b, a);
+  double len2 = dot(ab, ab);
+  double t = len2 > 0 ? std::clamp(dot(sub(p, a), ab) / len2, 0.0, 1.0) : 0;
+  return {a.x + t * ab.x, a.y + t * ab.y};
+}
+
+/** Closest point of a solid's outline (or area) to p. */
+Vec closestOnSolid(const Solid& s, Vec p) {
+  switch (s.kind) {
+    case Solid::BOX:
+    case Solid::BLOCK:
+      return {std::clamp(p.x, s.a.x - s.b.x / 2, s.a.x + s.b.x / 2),
+              std::clamp(p.y, s.a.y - s.b.y / 2, s.a.y + s.b.y / 2)};
+    case Solid::WALL:
+      return closestOnSegment(p, s.a, s.b);
+    case Solid::BALL: {
+      Vec d = sub(p, s.a);
+      double len = std::hypot(d.x, d.y);
+      if (len <= s.b.x) return p;
+      return {s.a.x + d.x / len * s.b.x, s.a.y + d.y / len * s.b.x};
+    }
+  }
+  return p;
+}
+
+/** Ray from o along unit d to segment ab: distance, or -1. */
+double raySegment(Vec o, Vec d, Vec a, Vec b) {
+  Vec e = sub(b, a);
+  double den = d.x * e.y - d.y * e.x;
+  if (std::fabs(den) < 1e-12) return -1;
+  Vec ao = sub(a, o);
+  double t = (ao.x * e.y - ao.y * e.x) / den;
+  double u = (ao.x * d.y - ao.y * d.x) / den;
+  return t >= 0 && u >= 0 && u <= 1 ? t : -1;
+}
+
+double rayCircle(Vec o, Vec d, Vec c, double r) {
+  Vec oc = sub(o, c);
+  double b = dot(oc, d);
+  double disc = b * b - (dot(oc, oc) - r * r);
+  if (disc < 0) return -1;
+  double t = -b - std::sqrt(disc);
+  return t >= 0 ? t : -1;
+}
+
+double raySolid(Vec o, Vec d, const Solid& s) {
+  if (s.kind == Solid::BALL) return rayCircle(o, d, s.a, s.b.x);
+  if (s.kind == Solid::WALL) return raySegment(o, d, s.a, s.b);
+  double x0 = s.a.x - s.b.x / 2, x1 = s.a.x + s.b.x / 2, y0 = s.a.y - s.b.y / 2, y1 = s.a.y + s.b.y / 2;
+  const Vec corners[5] = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}, {x0, y0}};
+  double best = -1;
+  for (int i = 0; i < 4; i++) {
+    double t = raySegment(o, d, corners[i], corners[i + 1]);
+    if (t >= 0 && (best < 0 || t < best)) best = t;
+  }
+  return best;
+}
+
+/** Nearest solid along the sonar's beam (a fan of rays), or 999. */
+double sonarRange(const Pose& p) {
+  World& s = w();
+  Vec o = ahead(p, s.truth.sonarFwdCm);
+  double best = 999;
+  for (double a = -SONAR_BEAM_DEG; a <= SONAR_BEAM_DEG + 1e-9; a += SONAR_BEAM_DEG / 2) {
+    double h = (p.heading + a) * DEG;
+    Vec d = {std::cos(h), std::sin(h)};
+    for (const Solid& solid : s.scene.solids) {
+      if (solid.held) continue;
+      double t = raySolid(o, d, solid);
+      if (t >= 0 && t < best) best = t;
+    }
+  }
+  return best;
+}
+
+bool insidePaint(const PaintOp& op, Vec p) {
+  switch (op.kind) {
+    case PaintOp::RECT:
+      return p.x >= std::min(op.a.x, op.b.x) && p.x <= std::max(op.a.x, op.b.x) &&
+             p.y >= std::min(op.a.y, op.b.y) && p.y <= std::max(op.a.y, op.b.y);
+    case PaintOp::LINE: {
+      Vec c = closestOnSegment(p, op.a, op.b);
+      return std::hypot(p.x - c.x, p.y - c.y) <= op.size / 2;
+    }
+    case PaintOp::DISC:
+      return std::hypot(p.x - op.a.x, p.y - op.a.y) <= op.size;
+  }
+  return false;
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                               PHYSICS                                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/** Wheel speed (cm/s) the L298N pins ask for; equal IN levels brake. */
+/**
+ * A motor's current: the part of its PWM duty its back-EMF (speed) doesn't
+ * cancel drives the winding, so it peaks at a standing start and is
+ * double when it's thrown into reverse. Running faster than the PWM asks,
+ * it generates, and draws nothing.
+ */
+double motorCurrent(int en, int inA, int inB, double v, double gain, double deadband) {
+  World& s = w();
+  if (s.level[inA] == s.level[inB] || !s.pwm[en]) return 0;
+  double duty = s.pwm[en] / 255.0, dir = s.level[inA] == HIGH ? 1 : -1;
+  double emf = v / (gain * (255 - deadband));
+  return MOTOR_STALL_A * std::max(0.0, duty - emf * dir) + MOTOR_FREE_A * duty;
+}
+
+double motorTarget(int en, int inA, int inB, double gain, double deadband) {
+  World& s = w();
+  if (s.level[inA] == s.level[inB]) return 0;
+  double p = s.pwm[en];
+  double v = p > deadband ? gain * (p - deadband) : 0;
+  return s.level[inA] == HIGH ? v : -v;
+}
+
+/** Move the robot out of (or refuse to enter) solids; boxes and balls get shoved. */
+bool resolveContacts(const Pose& before) {
+  World& s = w();
+  bool blocked = false, shoved = false;
+  Vec c = {s.pose.x, s.pose.y};
+  for (Solid& solid : s.scene.solids) {
+    if (solid.held) continue;
+    Vec q = closestOnSolid(solid, c);
+    Vec d = sub(c, q);
+    double dist = std::hypot(d.x, d.y);
+    double overlap = s.truth.radiusCm - dist;
+    if (overlap <= 0) continue;
+    if (solid.kind == Solid::BOX || solid.kind == Solid::BALL) {
+      if (dist < 1e-9) d = sub(c, solid.a), dist = std::hypot(d.x, d.y);
+      if (dist < 1e-9) continue;
+      solid.a.x -= d.x / dist * overlap;
+      solid.a.y -= d.y / dist * overlap;
+      shoved = true;
+    } else {
+      blocked = true;
+    }
+  }
+  if (blocked) s.pose = before;
+  if (blocked && !s.touching) s.stats.collisions++;
+  if (shoved && !s.shoving) s.stats.pushes++;
+  s.touching = blocked;
+  s.shoving = shoved;
+  return blocked;
+}
+
+void updateClaw(double dtUs) {
+  World& s = w();
+  s.servoA = 0;
+  for (int pin : {PIN_SERVO_BASE, PIN_SERVO_CLAMP}) {
+    ServoState& sv = s.servo[pin];
+    double full = SERVO_DEG_PER_US * dtUs;
+    double step = std::min(full, std::fabs(sv.target - sv.pos) * dtUs / SERVO_TAU_US);
+    sv.pos = sv.pos < sv.target ? std::min(sv.target, sv.pos + step) : std::max(sv.target, sv.pos - step);
+    s.servoA += SERVO_MOVE_A * step / full;   // Current follows the speed it's driven at
+  }
+  double arm = s.servo[PIN_SERVO_BASE].pos, clamp = s.servo[PIN_SERVO_CLAMP].pos;
+  Vec claw = ahead(s.pose, s.truth.clawReachCm);
+  if (s.held < 0 && clamp < CLAMP_CLOSED_BELOW && s.lastClamp >= CLAMP_CLOSED_BELOW && arm < ARM_DOWN_BELOW) {
+    double best = 1e9, h = s.pose.heading * M_PI / 180;
+    for (size_t i = 0; i < s.scene.solids.size(); i++) {
+      const Solid& solid = s.scene.solids[i];
+      if (solid.kind != Solid::BOX || solid.held) continue;
+      Vec d = sub(solid.a, claw);
+      double along = d.x * std::cos(h) + d.y * std::sin(h), side = -d.x * std::sin(h) + d.y * std::cos(h);
+      if (std::fabs(along) > s.truth.grabToleranceCm || std::fabs(side) > s.truth.grabWidthCm) continue;
+      if (std::hypot(along, side) < best) best = std::hypot(along, side), s.held = int(i);
+    }
+    if (s.held >= 0) {
+      s.scene.solids[s.held].held = true;
+      s.stats.grabs++;
+    }
+  } else if (s.held >= 0 && clamp > CLAMP_OPEN_ABOVE) {
+    Solid& box = s.scene.solids[s.held];
+    box.held = false;
+    box.a = claw;
+    s.held = -1;
+    s.stats.drops++;
+  }
+  if (s.held >= 0) s.scene.solids[s.held].a = claw;
+  s.lastClamp = clamp;
+}
+
+void physicsStep() {
+  World& s = w();
+  const Physics& p = s.truth;
+  double dt = PHYSICS_STEP_US / 1e6;
+  double alpha = std::min(1.0, PHYSICS_STEP_US / (p.tauMs * 1000));
+  s.vLeft += (motorTarget(PIN_ENA, PIN_IN1, PIN_IN2, p.gainLeft, p.deadbandLeft) - s.vLeft) * alpha;
+  s.vRight += (motorTarget(PIN_ENB, PIN_IN3, PIN_IN4, p.gainRight, p.deadbandRight) - s.vRight) * alpha;
+
+  Pose before = s.pose;
+  double v = (s.vLeft + s.vRight) / 2;
+  double omega = (s.vRight - s.vLeft) / p.trackCm;   // rad/s
+  double mid = s.pose.heading * DEG + omega * dt / 2;
+  s.pose.x += v * std::cos(mid) * dt;
+  s.pose.y += v * std::sin(mid) * dt;
+  s.pose.heading = std::remainder(s.pose.heading + omega * dt / DEG, 360.0);
+  if (!resolveContacts(before)) s.stats.travelCm += std::fabs(v) * dt;
+  updateClaw(PHYSICS_STEP_US);
+
+  // The supply: what everything draws this step, and the sag it causes
+  double amps = BOARD_A + s.servoA + motorCurrent(PIN_ENA, PIN_IN1, PIN_IN2, s.vLeft, p.gainLeft, p.deadbandLeft) +
+                motorCurrent(PIN_ENB, PIN_IN3, PIN_IN4, s.vRight, p.gainRight, p.deadbandRight);
+  s.stats.peakA = std::max(s.stats.peakA, amps);
+  bool sag = SUPPLY_V - amps * SUPPLY_OHM < SAG_V;
+  if (sag && !s.sagging) {
+    s.stats.sags++;
+    if (s.options.sagResets && !s.brownoutAt) s.brownoutAt = s.now;   // The next API call resets the board
+  }
+  s.sagging = sag;
+
+  if (s.poseLog && s.now >= s.nextPoseLog) {
+    s.nextPoseLog += POSE_LOG_US;
+    std::fprintf(s.poseLog, "%.3f,%.2f,%.2f,%.1f,%s\n", (s.now - s.started) / 1e6, s.pose.x, s.pose.y,
+                 s.pose.heading, s.stateName.c_str());
+  }
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                          CLOCK & INTERRUPTS                                ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+void advance(uint64_t us);
+
+void serviceInterrupts() {
+  World& s = w();
+  while (s.irqEnabled && !s.inIsr && (s.timerPending || s.echoPending)) {
+    s.inIsr = true;
+    advance(COST_ISR_ENTRY_US);
+    if (s.timerPending) {   // Timer first: it has the higher priority on the robot too
+      s.timerPending = false;
+      if (s.timerCallback) s.timerCallback(nullptr);
+    } else {
+      s.echoPending = false;
+      if (s.echoIsr) s.echoIsr();
+    }
+    s.inIsr = false;
+  }
+}
+
+void advance(uint64_t us) {
+  World& s = w();
+  uint64_t end = s.now + us;
+  for (;;) {
+    uint64_t next = std::min(end, s.nextPhysics);
+    if (s.timerCallback) next = std::min(next, s.timerNext);
+    if (s.echoBusy) next = std::min(next, s.echoHigh ? s.echoFall : s.echoRise);
+    s.now = std::max(s.now, next);
+    DWT->CYCCNT = uint32_t((s.now - s.bootAt) * (CPU_HZ / 1000000));
+
+    if (s.now >= s.nextPhysics) {
+      s.nextPhysics += PHYSICS_STEP_US;
+      physicsStep();
+    }
+    if (s.echoBusy && !s.echoHigh && s.now >= s.echoRise) {
+      s.echoHigh = true;
+      s.echoPending = s.echoIsr != nullptr;
+    } else if (s.echoBusy && s.echoHigh && s.now >= s.echoFall) {
+      s.echoHigh = s.echoBusy = false;
+      s.echoPending = s.echoIsr != nullptr;
+    }
+    if (s.timerCallback && s.now >= s.timerNext) {
+      s.timerNext += s.timerPeriod;
+      s.timerPending = true;
+    }
+    serviceInterrupts();
+    if (s.now >= end) break;
+  }
+}
+
+void checkDeadline() {
+  World& s = w();
+  if (!s.inIsr && s.deadline && s.now >= s.deadline) throw Stop();
+  if (!s.inIsr && s.brownoutAt && s.now >= s.brownoutAt) {
+    s.brownoutAt = 0;
+    throw Brownout();
+  }
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                               SENSORS                                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+void sonarTrigger() {
+  World& s = w();
+  if (s.echoBusy) return;   // The HC-SR04 ignores triggers mid-measurement
+  double range = cueNow() ? HAND_CM : sonarRange(s.pose);
+  s.echoRise = s.now + SONAR_BURST_US;
+  if (range >= SONAR_MAX_CM) {
+    s.echoFall = s.echoRise + SONAR_NOTHING_US;
+  } else {
+    range = std::max(SONAR_MIN_CM, range + gauss(SONAR_NOISE_CM * s.options.noise));
+    s.echoFall = s.echoRise + uint64_t(2 * range / SOUND_CM_PER_US);
+  }
+  s.echoBusy = true;
+}
+
+int colorFilter() {
+  World& s = w();
+  bool s2 = s.level[PIN_COLOR_S2], s3 = s.level[PIN_COLOR_S3];
+  if (!s2 && !s3) return 0;   // Red
+  if (s2 && s3) return 1;     // Green
+  if (!s2 && s3) return 2;    // Blue
+  return 3;                   // Clear
+}
+
+int pinLevel(int pin) {
+  World& s = w();
+  if (pin == PIN_ECHO) return s.echoHigh;
+  if (pin == PIN_IR_LEFT || pin == PIN_IR_RIGHT) {
+    Vec p = ahead(s.pose, s.truth.irFwdCm, pin == PIN_IR_LEFT ? s.truth.irSideCm : -s.truth.irSideCm);
+    return floorAt(p) == BLACK ? LOW : HIGH;   // Reflective sensor: LOW over black
+  }
+  if (pin == PIN_COLOR_OUT) return HIGH;
+  if (pin == PIN_START) return !cueNow();
+  if (s.mode[pin] == INPUT_PULLUP) return HIGH;
+  return s.level[pin];
+}
+
+void emitLine() {
+  World& s = w();
+  std::string line = s.out;
+  s.out.clear();
+  if (!line.empty() && line.back() == '\r') line.pop_back();
+  if (s.options.echoSerial) {
+    std::fwrite(line.data(), 1, line.size(), stdout);
+    std::fputc('\n', stdout);
+  }
+  if (line.rfind("STATE: ", 0) == 0) {
+    size_t sp = line.find(' ', 7);
+    if (sp != std::string::npos) s.stateName = line.substr(sp + 1, line.find(' ', sp + 1) - sp - 1);
+  }
+  for (auto& listener : s.listeners) listener(line);
+}
+
+size_t serialWrite(const char* p, size_t n) {
+  World& s = w();
+  advance(COST_PRINT_US);
+  for (size_t i = 0; i < n; i++) {
+    if (p[i] == '\n') emitLine();
+    else s.out += p[i];
+  }
+  return n;
+}
+
+}  // namespace
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                              PUBLIC API                                    ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+bool loadScene(const std::string& path, std::string& error) {
+  std::ifstream in(path);
+  if (!in) {
+    error = path + ": cannot open";
+    return false;
+  }
+  Scene scene;
+  Physics& phys = w().nominal;
+  std::string line;
+  int lineNo = 0;
+  auto color = [](const std::string& name, Paint& out) {
+    static const char* names[] = {"white", "black", "red", "green", "blue"};
+    for (int i = 0; i < 5; i++)
+      if (name == names[i]) return out = Paint(i), true;
+    return false;
+  };
+  while (std::getline(in, line)) {
+    lineNo++;
+    line = line.substr(0, line.find('#'));
+    std::istringstream ss(line);
+    std::string op, c;
+    if (!(ss >> op)) continue;
+    bool ok = true;
+    if (op == "floor") {
+      ok = (ss >> c) && color(c, scene.floor);
+    } else if (op == "rect" || op == "line" || op == "disc") {
+      PaintOp p;
+      p.kind = op == "rect" ? PaintOp::RECT : op == "line" ? PaintOp::LINE : PaintOp::DISC;
+      if (p.kind == PaintOp::DISC) ok = bool(ss >> p.a.x >> p.a.y >> p.size);
+      else ok = bool(ss >> p.a.x >> p.a.y >> p.b.x >> p.b.y);
+      if (ok && p.kind == PaintOp::LINE) ok = bool(ss >> p.size);
+      ok = ok && (ss >> c) && color(c, p.color);
+      if (ok) scene.paint.push_back(p);
+    } else if (op == "box" || op == "block" || op == "wall" || op == "ball") {
+      Solid s;
+      s.kind = op == "box" ? Solid::BOX : op == "block" ? Solid::BLOCK : op == "wall" ? Solid::WALL : Solid::BALL;
+      if (s.kind == Solid::BALL) ok = bool(ss >> s.a.x >> s.a.y >> s.b.x);
+      else ok = bool(ss >> s.a.x >> s.a.y >> s.b.x >> s.b.y);
+      s.start = s.a;
+      if (ok) scene.solids.push_back(s);
+    } else if (op == "robot") {
+      ok = bool(ss >> scene.start.x >> scene.start.y >> scene.start.heading);
+    } else if (op == "param") {
+      std::string name;
+      double v;
+      ok = bool(ss >> name >> v);
+      double* field = name == "trackCm" ? &phys.trackCm : name == "gainLeft" ? &phys.gainLeft
+                    : name == "gainRight" ? &phys.gainRight : name == "deadbandLeft" ? &phys.deadbandLeft
+                    : name == "deadbandRight" ? &phys.deadbandRight : name == "tauMs" ? &phys.tauMs : nullptr;
+      if (ok && field) *field = v;
+      else ok = false;
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      error = path + ":" + std::to_string(lineNo) + ": can't read \"" + line + "\"";
+      return false;
+    }
+  }
+  w().scene = scene;
+  return true;
+}
+
+Scene& scene() { return w().scene; }
+Physics& physics() { return w().nominal; }
+
+void reset(const Options& options) {
+  World& s = w();
+  s.options = options;
+  s.rng.seed(options.robotSeed ? options.robotSeed : options.seed);
+  s.truth = s.nominal;
+  s.truth.gainLeft *= 1 + gauss(MOTOR_SPREAD * options.noise);
+  s.truth.gainRight *= 1 + gauss(MOTOR_SPREAD * options.noise);
+  if (options.robotSeed) s.rng.seed(options.seed);
+  if (!options.eepromFile.empty()) {
+    std::ifstream in(options.eepromFile, std::ios::binary);
+    std::fill(s.eeprom.begin(), s.eeprom.end(), 0xFF);
+    if (in) in.read((char*)s.eeprom.data(), s.eeprom.size());
+  }
+  for (Solid& solid : s.scene.solids) {
+    solid.a = solid.start;
+    solid.held = false;
+  }
+  s.held = -1;
+  s.pose = s.scene.start;
+  s.vLeft = s.vRight = 0;
+  s.touching = s.shoving = false;
+  s.stats = Stats();
+  s.sagging = false;
+  s.started = s.now;
+  s.nextPhysics = s.now + PHYSICS_STEP_US;
+  s.deadline = options.timeLimitS > 0 ? s.now + uint64_t(options.timeLimitS * 1e6) : 0;
+  if (s.poseLog) std::fclose(s.poseLog);
+  s.poseLog = options.poseLog.empty() ? nullptr : std::fopen(options.poseLog.c_str(), "w");
+  if (s.poseLog) std::fprintf(s.poseLog, "t,x,y,heading,state\n");
+  s.nextPoseLog = s.now;
+  s.cueAt = options.startCueS >= 0 ? int64_t(s.now + uint64_t(options.startCueS * 1e6)) : -1;
+}
+
+void brownoutAfter(uint64_t us) { w().brownoutAt = us ? w().now + us : 0; }
+
+bool saveBoard(const std::string& path) {
+  World& s = w();
+  FILE* f = std::fopen(path.c_str(), "w");
+  if (!f) return false;
+  std::fprintf(f, "clock %llu %llu\n", (unsigned long long)s.now, (unsigned long long)s.started);
+  std::fprintf(f, "pose %.17g %.17g %.17g %.17g %.17g\n", s.pose.x, s.pose.y, s.pose.heading, s.vLeft, s.vRight);
+  std::fprintf(f, "motors %.17g %.17g\n", s.truth.gainLeft, s.truth.gainRight);
+  std::fprintf(f, "claw %d %.17g %.17g %.17g\n", s.held, s.servo[PIN_SERVO_BASE].pos, s.servo[PIN_SERVO_CLAMP].pos,
+               s.lastClamp);
+  for (const Solid& solid : s.scene.solids) std::fprintf(f, "solid %.17g %.17g %d\n", solid.a.x, solid.a.y, solid.held);
+  const Stats& st = s.stats;
+  std::fprintf(f, "stats %u %u %u %u %.17g %u %.17g %u\n", st.collisions, st.pushes, st.grabs, st.drops, st.travelCm,
+               st.resets, st.peakA, st.sags);
+  std::fprintf(f, "cwsf %u\neeprom ", s.resetFlags.RSTSR2);
+  for (uint8_t b : s.eeprom) std::fprintf(f, "%02x", b);
+  std::fprintf(f, "\n");
+  return std::fclose(f) == 0;
+}
+
+bool saveEeprom(const std::string& path) {
+  std::ofstream out(path, std::ios::binary);
+  out.write((const char*)w().eeprom.data(), w().eeprom.size());
+  return bool(out);
+}
+
+bool resumeBoard(const Options& options, const std::string& path, std::string& error) {
+  World& s = w();
+  Options fresh = options;
+  fresh.poseLog.clear();   // Carry on with the log, don't truncate it
+  reset(fresh);
+  s.options = options;
+  s.cueAt = -1;   // Resuming: nobody gives a start cue
+  std::ifstream in(path);
+  if (!in) {
+    error = path + ": cannot open";
+    return false;
+  }
+  std::string line;
+  size_t solid = 0;
+  bool ok = true;
+  while (ok && std::getline(in, line)) {
+    std::istringstream ss(line);
+    std::string key;
+    ss >> key;
+    if (key == "clock") {
+      unsigned long long now, started;
+      ok = bool(ss >> now >> started);
+      s.now = s.bootAt = now;
+      s.started = started;
+    } else if (key == "pose") {
+      ok = bool(ss >> s.pose.x >> s.pose.y >> s.pose.heading >> s.vLeft >> s.vRight);
+    } else if (key == "motors") {
+      ok = bool(ss >> s.truth.gainLeft >> s.truth.gainRight);
+    } else if (key == "claw") {
+      ServoState &arm = s.servo[PIN_SERVO_BASE], &clamp = s.servo[PIN_SERVO_CLAMP];
+      ok = bool(ss >> s.held >> arm.pos >> clamp.pos >> s.lastClamp);
+      arm.target = arm.pos;   // No pulses while the board restarts: they stay put
+      clamp.target = clamp.pos;
+    } else if (key == "solid" && solid < s.scene.solids.size()) {
+      Solid& so = s.scene.solids[solid++];
+      int held = 0;
+      ok = bool(ss >> so.a.x >> so.a.y >> held);
+      so.held = held;
+    } else if (key == "stats") {
+      Stats& st = s.stats;
+      ok = bool(ss >> st.collisions >> st.pushes >> st.grabs >> st.drops >> st.travelCm >> st.resets >> st.peakA >> st.sags);
+    } else if (key == "cwsf") {
+      unsigned cwsf;
+      ok = bool(ss >> cwsf);
+      s.resetFlags = {R_SYSTEM_RSTSR0_LVD0RF_Msk, 0, uint8_t(cwsf)};
+    } else if (key == "eeprom") {
+      std::string hex;
+      ok = (ss >> hex) && hex.size() == 2 * s.eeprom.size();
+      for (size_t i = 0; ok && i < s.eeprom.size(); i++) s.eeprom[i] = uint8_t(std::stoul(hex.substr(2 * i, 2), nullptr, 16));
+    } else {
+      ok = false;
+    }
+  }
+  if (!ok) {
+    error = path + ": can't read \"" + line + "\"";
+    return false;
+  }
+  s.stats.resets++;
+  s.nextPhysics = s.now + PHYSICS_STEP_US;
+  s.nextPoseLog = s.now;
+  s.deadline = options.timeLimitS > 0 ? s.started + uint64_t(options.timeLimitS * 1e6) : 0;
+  if (!options.poseLog.empty()) s.poseLog = std::fopen(options.poseLog.c_str(), "a");
+  return true;
+}
+
+void placeRobot(const Pose& pose) {
+  w().pose = pose;
+  w().vLeft = w().vRight = 0;
+}
+
+uint64_t nowUs() { return w().now - w().started; }
+
+void run(uint64_t us) { advance(us); }
+
+void stopAfter(uint64_t us) {
+  World& s = w();
+  uint64_t at = s.now + us;
+  if (!s.deadline || at < s.deadline) s.deadline = at;
+}
+
+Pose pose() { return w().pose; }
+double wheelSpeed(bool right) { return right ? w().vRight : w().vLeft; }
+
+Paint floorAt(Vec p) {
+  const Scene& sc = w().scene;
+  for (auto it = sc.paint.rbegin(); it != sc.paint.rend(); ++it)
+    if (insidePaint(*it, p)) return it->color;
+  return sc.floor;
+}
+
+Paint colorUnderSensor() {
+  const World& s = w();
+  if (s.cueAt >= 0 && s.now < uint64_t(s.cueAt) + uint64_t(CUE_MS * 1000)) return WHITE;   // The card
+  return floorAt(ahead(s.pose, s.truth.colorFwdCm));
+}
+double rangeAhead() { return sonarRange(w().pose); }
+const Stats& stats() { return w().stats; }
+
+const char* paintName(Paint p) {
+  static const char* names[] = {"WHITE", "BLACK", "RED", "GREEN", "BLUE"};
+  return names[p];
+}
+
+void onSerialLine(std::function<void(const std::string&)> listener) { w().listeners.push_back(std::move(listener)); }
+void serialInput(const std::string& bytes) { w().input += bytes; }
+
+}  // namespace sim
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                          ARDUINO API (sketch side)                         ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+using sim::w;
+
+SimSerial Serial;
+static DWT_Type dwtRegisters;
+static CoreDebug_Type coreDebugRegisters;
+DWT_Type* DWT = &dwtRegisters;
+CoreDebug_Type* CoreDebug = &coreDebugRegisters;
+uint32_t SystemCoreClock = sim::CPU_HZ;
+R_SYSTEM_Type* R_SYSTEM = &w().resetFlags;
+EEPROMClass EEPROM;
+
+void pinMode(int pin, int mode) {
+  if (pin >= 0 && pin < sim::PINS) w().mode[pin] = uint8_t(mode);
+}
+
+void digitalWrite(int pin, int level) {
+  sim::advance(sim::COST_PIN_US);
+  if (pin < 0 || pin >= sim::PINS) return;
+  sim::World& s = w();
+  bool falling = s.level[pin] && !level;
+  s.level[pin] = level ? HIGH : LOW;
+  if (pin == sim::PIN_ENA || pin == sim::PIN_ENB) s.pwm[pin] = level ? 255 : 0;
+  if (pin == sim::PIN_TRIG && falling) sim::sonarTrigger();
+}
+
+int digitalRead(int pin) {
+  sim::advance(sim::COST_PIN_US);
+  return pin >= 0 && pin < sim::PINS ? sim::pinLevel(pin) : LOW;
+}
+
+void analogWrite(int pin, int value) {
+  sim::advance(sim::COST_ANALOG_WRITE_US);
+  if (pin < 0 || pin >= sim::PINS) return;
+  w().pwm[pin] = std::clamp(value, 0, 255);
+  w().level[pin] = value > 0;
+}
+
+int analogRead(int pin) {
+  sim::advance(sim::COST_ANALOG_READ_US);
+  return pin == sim::PIN_IR_LEFT || pin == sim::PIN_IR_RIGHT ? (sim::pinLevel(pin) ? 900 : 100) : 512;
+}
+
+void delay(unsigned long ms) {
+  sim::advance(uint64_t(ms) * 1000);
+  sim::checkDeadline();
+}
+
+void delayMicroseconds(unsigned int us) {
+  sim::advance(us);
+  sim::checkDeadline();
+}
+
+unsigned long millis() {
+  sim::advance(sim::COST_CLOCK_US);
+  return uint32_t((w().now - w().bootAt) / 1000);   // 32-bit, like the board
+}
+
+unsigned long micros() {
+  sim::advance(sim::COST_CLOCK_US);
+  return uint32_t(w().now - w().bootAt);
+}
+
+unsigned long pulseIn(int pin, int level, unsigned long timeoutUs) {
+  sim::World& s = w();
+  sim::checkDeadline();
+  if (pin == sim::PIN_COLOR_OUT) {
+    // Square wave: wait for the next edge into `level`, then time one half-period
+    double halfUs = sim::COLOR_PULSE_US[sim::colorUnderSensor()][sim::colorFilter()];
+    halfUs *= 1 + sim::gauss(sim::COLOR_NOISE * s.options.noise);
+    double wait = sim::uniform(0, 2 * halfUs);
+    sim::advance(uint64_t(wait));
+    if (wait + halfUs > timeoutUs) {
+      sim::advance(timeoutUs - std::min<uint64_t>(timeoutUs, uint64_t(wait)));
+      return 0;
+    }
+    sim::advance(uint64_t(halfUs));
+    return (unsigned long)halfUs;
+  }
+  uint64_t limit = s.now + timeoutUs;
+  while (sim::pinLevel(pin) == level) {   // A pulse already under way doesn't count
+    if (s.now >= limit) return 0;
+    sim::advance(sim::PULSEIN_POLL_US);
+  }
+  while (sim::pinLevel(pin) != level) {
+    if (s.now >= limit) return 0;
+    sim::advance(sim::PULSEIN_POLL_US);
+  }
+  uint64_t start = s.now;
+  while (sim::pinLevel(pin) == level) {
+    if (s.now >= limit) return 0;
+    sim::advance(sim::PULSEIN_POLL_US);
+  }
+  return (unsigned long)(s.now - start);
+}
+
+void noInterrupts() { w().irqEnabled = false; }
+
+void interrupts() {
+  w().irqEnabled = true;
+  sim::serviceInterrupts();
+}
+
+void attachInterrupt(int interrupt, void (*isr)(), int) {
+  if (interrupt == sim::PIN_ECHO) w().echoIsr = isr;
+}
+
+void detachInterrupt(int interrupt) {
+  if (interrupt == sim::PIN_ECHO) w().echoIsr = nullptr;
+}
+
+long random(long howBig) { return howBig > 0 ? long(w().rng() % uint32_t(howBig)) : 0; }
+long random(long howSmall, long howBig) { return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall); }
+void randomSeed(unsigned long seed) { w().rng.seed(uint32_t(seed)); }
+
+int SimSerial::available() { return int(w().input.size() - w().inputPos); }
+int SimSerial::read() { return available() ? (unsigned char)w().input[w().inputPos++] : -1; }
+int SimSerial::peek() { return available() ? (unsigned char)w().input[w().inputPos] : -1; }
+size_t SimSerial::write(uint8_t c) { return sim::serialWrite((const char*)&c, 1); }
+size_t SimSerial::write(const uint8_t* p, size_t n) { return sim::serialWrite((const char*)p, n); }
+size_t SimSerial::print(const __FlashStringHelper* s) { return print(reinterpret_cast<const char*>(s)); }
+size_t SimSerial::print(const char* s) { return sim::serialWrite(s, std::strlen(s)); }
+size_t SimSerial::print(char c) { return sim::serialWrite(&c, 1); }
+
+size_t SimSerial::print(long v, int base) {
+  char buf[24];
+  if (base == HEX) std::snprintf(buf, sizeof buf, "%lX", (unsigned long)v);
+  else std::snprintf(buf, sizeof buf, "%ld", v);
+  return print(buf);
+}
+
+size_t SimSerial::print(unsigned long v, int base) {
+  char buf[24];
+  std::snprintf(buf, sizeof buf, base == HEX ? "%lX" : "%lu", v);
+  return print(buf);
+}
+
+size_t SimSerial::print(double v, int digits) {
+  char buf[48];
+  std::snprintf(buf, sizeof buf, "%.*f", digits, v);
+  return print(buf);
+}
+
+uint8_t Servo::attach(int pin) {
+  pin_ = pin;
+  return 1;
+}
+
+void Servo::write(int angle) {
+  angle_ = std::clamp(angle, 0, 180);
+  if (pin_ >= 0 && pin_ < sim::PINS) w().servo[pin_].target = angle_;
+}
+
+uint8_t EEPROMClass::read(int idx) {
+  const std::vector<uint8_t>& e = w().eeprom;
+  return idx >= 0 && size_t(idx) < e.size() ? e[idx] : 0xFF;
+}
+
+void EEPROMClass::write(int idx, uint8_t value) {
+  std::vector<uint8_t>& e = w().eeprom;
+  sim::advance(sim::COST_EEPROM_WRITE_US);
+  if (idx >= 0 && size_t(idx) < e.size()) e[idx] = value;
+}
+
+bool FspTimer::begin(timer_mode_t, uint8_t, uint8_t, float freqHz, float, GPTimerCbk_f callback, void*) {
+  freqHz_ = freqHz;
+  callback_ = callback;
+  return freqHz > 0 && callback;
+}
+
+bool FspTimer::start() {
+  sim::World& s = w();
+  s.timerCallback = callback_;
+  s.timerPeriod = uint64_t(1e6 / freqHz_ + 0.5);
+  s.timerNext = s.now + s.timerPeriod;
+  return true;
+}
+
+bool FspTimer::stop() {
+  w().timerCallback = nullptr;
+  return true;
+}
@@ -0,0 +1,161 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║                 SIM: the robot and its course, on the PC                  ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * The mission sketches compile unchanged against the Arduino.h, Servo.h,
+ * FspTimer.h and EEPROM.h in this folder. Those headers talk to a simulated robot:
+ *
+ *   - a virtual clock: delay(), pulseIn() and every pin access advance it,
+ *     so a 60 s mission runs in well under a second
+ *   - the timer interrupt and the echo pin interrupt fire at the right
+ *     virtual times (and wait while noInterrupts() is in effect)
+ *   - L298N pins drive two motors with a deadband and a first-order lag;
+ *     the robot moves by differential-drive kinematics
+ *   - the motors, servos and board draw current from a battery with an
+ *     internal resistance: a big enough spike sags it (see Stats)
+ *   - the TCS3200 returns the pulse widths of the floor color under it, the
+ *     HC-SR04 echoes off the nearest solid in its beam, the IR sensors see
+ *     black tape, and the claw can pick up and drop boxes
+ *
+ * The course is a scene file (see scenes/). Units are cm and degrees; x to
+ * the right, y up, heading 0 = +x, counterclockwise positive.
+ *
+ * This header is for the programs that drive a simulation (sim_main.cpp and
+ * the benches); the sketch only sees the Arduino API.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+enum Paint : uint8_t { WHITE, BLACK, RED, GREEN, BLUE };
+
+struct Vec {
+  double x = 0, y = 0;
+};
+
+struct Pose {
+  double x = 0, y = 0;
+  double heading = 0;   // Degrees
+};
+
+/** Painted floor, drawn in file order (later ops cover earlier ones). */
+struct PaintOp {
+  enum Kind : uint8_t { RECT, LINE, DISC } kind;
+  Vec a, b;             // RECT: corners; LINE: ends; DISC: a = center
+  double size = 0;      // LINE: width; DISC: radius
+  Paint color = WHITE;
+};
+
+/** Things the ultrasonic sensor sees and the robot can hit. */
+struct Solid {
+  enum Kind : uint8_t { BOX, BLOCK, WALL, BALL } kind;
+  Vec a, b;             // BOX/BLOCK: center and (w, h); WALL: ends; BALL: center, b.x = radius
+  bool held = false;    // BOX in the claw: out of the world until dropped
+  Vec start;            // Where it was placed (reset() puts it back)
+};
+
+struct Scene {
+  Paint floor = WHITE;
+  std::vector<PaintOp> paint;
+  std::vector<Solid> solids;
+  Pose start;
+};
+
+/** The true robot, what the firmware only estimates. */
+struct Physics {
+  double trackCm = 13.0;           // Wheel spacing (TIME_TURN_90 at SPEED_TURN = 90°)
+  double radiusCm = 9.0;           // Body, for collisions
+  double gainLeft = 0.29;          // cm/s per PWM step above the deadband
+  double gainRight = 0.322;        // The right motor is faster (SPEED_COMPENSATION 0.9)
+  double deadbandLeft = 50;
+  double deadbandRight = 45;
+  double tauMs = 80;               // Wheel speed lag
+  double colorFwdCm = 4.0;         // Color sensor ahead of the wheel axle
+  double irFwdCm = 6.0, irSideCm = 1.5;
+  double sonarFwdCm = 8.0;
+  double clawReachCm = 16.0;       // Claw (arm down) ahead of the axle
+  double grabToleranceCm = 4.0;    // Box center to claw point, along the heading
+  double grabWidthCm = 5.0;        // ... and sideways (open jaws minus box, per side)
+};
+
+struct Options {
+  uint32_t seed = 1;
+  double noise = 1.0;              // Scales sensor noise and per-run motor spread (0 = exact)
+  double timeLimitS = 120;
+  bool echoSerial = true;          // Sketch output to stdout
+  std::string poseLog;             // CSV of t,x,y,heading,state every 20 ms
+  double startCueS = 0.5;          // The start cue, this long after reset(); < 0 = none (see START CUE)
+  uint32_t robotSeed = 0;          // Motor spread from this seed instead of `seed` (0 = seed): the same robot
+  std::string eepromFile;          // EEPROM from this file at reset(), if it exists (see saveEeprom())
+  bool sagResets = false;          // A supply sag resets the board, like brownoutAfter() (see Stats)
+};
+
+struct Stats {
+  uint32_t collisions = 0;         // Times the body hit a block or wall
+  uint32_t pushes = 0;             // Times it shoved a box or ball
+  uint32_t grabs = 0, drops = 0;
+  double travelCm = 0;             // Path length of the axle center
+  uint32_t resets = 0;             // Brownouts survived (see resumeBoard())
+  double peakA = 0;                // Most the motors, servos and board drew at once
+  uint32_t sags = 0;               // Times that sagged the battery below what the board needs
+};
+
+/**
+ * START CUE: for CUE_MS from Options.startCueS on, every cue a sketch's
+ * START_TRIGGER can wait for happens at once: a hand in front of the
+ * ultrasonic, the start button (pin 0) pressed, and a white card under
+ * the color sensor, pulled away when it ends.
+ */
+constexpr double CUE_MS = 500;
+
+/** Thrown out of delay() when the time limit is reached. */
+struct Stop {};
+
+/** Thrown out of delay() at the time set by brownoutAfter(): the board resets. */
+struct Brownout {};
+
+bool loadScene(const std::string& path, std::string& error);
+Scene& scene();                    // Benches may build or edit one in code
+Physics& physics();
+
+/** Apply options and put robot and objects back at their start (the clock keeps running). */
+void reset(const Options& options);
+void placeRobot(const Pose& pose);
+
+uint64_t nowUs();
+void run(uint64_t us);             // Let time pass outside the sketch (delay() without Stop)
+void stopAfter(uint64_t us);       // Bring the time limit forward (e.g. once the mission is complete)
+
+/**
+ * BROWNOUT: the board resets, the robot and the course carry on. The
+ * sketch's globals can only start clean in a new process, so after a
+ * Brownout the driver saves what outlives the reset (pose, wheel speeds,
+ * claw, objects, clock, EEPROM, CWSF) with saveBoard(), execs itself and
+ * calls resumeBoard() instead of reset(): the sketch boots again warm, with
+ * RSTSR0.LVD0RF set, millis() from 0 and the motors unpowered.
+ */
+void brownoutAfter(uint64_t us);   // 0 = never
+bool saveBoard(const std::string& path);
+bool saveEeprom(const std::string& path);   // 8192 raw bytes: the next run's eepromFile
+bool resumeBoard(const Options& options, const std::string& path, std::string& error);
+
+Pose pose();
+double wheelSpeed(bool right);     // cm/s, true
+Paint floorAt(Vec p);
+Paint colorUnderSensor();
+double rangeAhead();               // True distance from the sonar to the nearest solid (999 = none)
+const Stats& stats();
+const char* paintName(Paint p);
+
+/** Every complete line the sketch prints (after echoing it). */
+void onSerialLine(std::function<void(const std::string&)> listener);
+void serialInput(const std::string& bytes);
+
+}  // namespace sim
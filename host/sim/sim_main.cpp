@@ -0,0 +1,344 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║                  SIM MAIN: run a mission sketch on a scene                ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * Linked with one sketch (see build.sh), this runs its setup() and loop()
+ * against a scene until the sketch prints its COMPLETE state or the time
+ * limit hits. The sketch's Serial output goes to stdout exactly as the
+ * robot would send it, so it pipes into the other host tools:
+ *
+ *   build/sim_start scenes/start.scene | ./run_analyzer -
+ *   build/sim_start scenes/start.scene | ./serial_capture - sim.ring
+ *
+ * A summary goes to stderr:
+ *
+ *   SIM: seed=1 result=COMPLETE time_s=38.42 travel_cm=412.0 collisions=0 pushes=0 grabs=1 drops=1 pose=...
+ *
+ * --runs N repeats the mission with seeds seed..seed+N-1 (each in a fresh
+ * process, so the sketch's globals start clean) and adds a distribution of
+ * completion times. A sketch with a mission clock prints BUDGET: lines;
+ * then each SIM: line has mission_s=<used>/<budget> (from the last one)
+ * and the summary counts the completed runs that stayed in_budget.
+ *
+ * --practice N drives N missions in a row on one robot (its motor spread
+ * fixed), the EEPROM carried from each to the next, as between practice
+ * runs: what a sketch learned (speed_profile.h) stays learned. With --runs
+ * M, M robots do that, and a PRACTICE: line per run of the series shows
+ * how the learning converges, over the robots:
+ *
+ *   PRACTICE: run=4 complete=14/20 losses=0.35 time_s mean=16.20 p50=15.90 p90=17.80
+ *
+ * A sketch that learns prints PROFILE: lines; then each SIM: line has
+ * losses=<n> (from the last one). --eeprom FILE does the same for a single
+ * run: the EEPROM is loaded from FILE, if it exists, and saved back.
+ *
+ * --brownout S resets the board S simulated seconds in (like a servo spike
+ * sagging the battery): the sketch starts over in a new process, warm, with
+ * the robot, the course and the EEPROM as they were (see sim.h). The SIM:
+ * line then counts resets=1.
+ *
+ * The SIM: line also has peak_a=, the most current the motors, servos and
+ * board drew at once, and sags=, how often that pulled the battery below
+ * what the board needs. --sag-resets makes every sag a brownout, as above.
+ *
+ * USAGE:
+ *   sim_<sketch> <scene> [--time S] [--seed N] [--noise X] [--runs N]
+ *                        [--quiet] [--poses FILE] [--input FILE] [--brownout S] [--start S]
+ *                        [--eeprom FILE] [--robot N] [--practice N] [--sag-resets]
+ */
+
+#include "sim.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+void setup();
+void loop();
+
+static std::string scenePath;
+static std::string selfPath;
+
+constexpr uint64_t COMPLETE_GRACE_US = 1500000;   // Let the final reports print
+
+struct RunResult {
+  bool complete = false;
+  double timeS = 0;
+  double budgetS = 0;    // From the sketch's last BUDGET: line (0 = none)
+  double missionS = 0;   // ...its clock: start cue to that line
+  int losses = -1;       // From the last PROFILE: line (-1 = none)
+};
+
+/**
+ * The board just browned out: save what outlives it and exec this program
+ * again to boot the sketch afresh. Only returns if that failed.
+ */
+static void rebootAfterBrownout(const sim::Options& options) {
+  char path[] = "/tmp/sim_board_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0 || !sim::saveBoard(path)) {
+    std::perror("sim: brownout");
+    return;
+  }
+  close(fd);
+  std::vector<std::string> args = {selfPath, scenePath, "--time", std::to_string(options.timeLimitS),
+                                   "--seed", std::to_string(options.seed), "--robot", std::to_string(options.robotSeed),
+                                   "--noise", std::to_string(options.noise), "--start", "-1", "--resume", path};
+  if (!options.echoSerial) args.push_back("--quiet");
+  if (options.sagResets) args.push_back("--sag-resets");
+  if (!options.poseLog.empty()) args.insert(args.end(), {"--poses", options.poseLog});
+  if (!options.eepromFile.empty()) args.insert(args.end(), {"--eeprom", options.eepromFile});
+  std::vector<char*> argv;
+  for (std::string& a : args) argv.push_back(&a[0]);
+  argv.push_back(nullptr);
+  std::fflush(nullptr);
+  execv(selfPath.c_str(), argv.data());
+  std::perror("sim: exec");
+}
+
+/** One mission in this process (or its rest, after a brownout); prints its SIM: line to `out`. */
+static RunResult runMission(const sim::Options& options, FILE* out, double brownoutS, const std::string& resume) {
+  RunResult result;
+  sim::onSerialLine([&](const std::string& line) {
+    if (result.complete || line.rfind("STATE: ", 0) != 0 || line.find(" COMPLETE") == std::string::npos) return;
+    result.complete = true;
+    result.timeS = sim::nowUs() / 1e6;
+    sim::stopAfter(COMPLETE_GRACE_US);
+  });
+  sim::onSerialLine([&](const std::string& line) {
+    const char* b = std::strstr(line.c_str(), "BUDGET: budget_ms=");
+    const char* e = std::strstr(line.c_str(), "elapsed_ms=");
+    if (!b || !e) return;
+    result.budgetS = std::atof(b + 18) / 1000;
+    result.missionS = std::atof(e + 11) / 1000;
+  });
+  sim::onSerialLine([&](const std::string& line) {
+    const char* l = std::strstr(line.c_str(), " losses=");
+    if (line.rfind("PROFILE: ", 0) == 0 && l) result.losses = std::atoi(l + 8);
+  });
+  if (resume.empty()) {
+    sim::reset(options);
+  } else {
+    std::string error;
+    bool ok = sim::resumeBoard(options, resume, error);
+    unlink(resume.c_str());
+    if (!ok) {
+      std::fprintf(stderr, "sim: %s\n", error.c_str());
+      std::exit(2);
+    }
+  }
+  sim::brownoutAfter(uint64_t(brownoutS * 1e6));
+  try {
+    setup();
+    for (;;) loop();
+  } catch (const sim::Stop&) {
+  } catch (const sim::Brownout&) {
+    rebootAfterBrownout(options);
+  }
+  if (!result.complete) result.timeS = sim::nowUs() / 1e6;
+  if (!options.eepromFile.empty() && !sim::saveEeprom(options.eepromFile)) std::perror("sim: eeprom");
+
+  const sim::Stats& st = sim::stats();
+  sim::Pose p = sim::pose();
+  std::fprintf(out, "SIM: seed=%u result=%s time_s=%.2f travel_cm=%.1f collisions=%u pushes=%u grabs=%u drops=%u "
+               "resets=%u peak_a=%.2f sags=%u pose=%.1f,%.1f,%.0f", options.seed, result.complete ? "COMPLETE" : "TIMEOUT",
+               result.timeS, st.travelCm, st.collisions, st.pushes, st.grabs, st.drops, st.resets, st.peakA, st.sags,
+               p.x, p.y, p.heading);
+  int n = 0;
+  for (const sim::Solid& s : sim::scene().solids) {
+    if (s.kind != sim::Solid::BOX) continue;
+    std::fprintf(out, " box%d=%s@%.1f,%.1f", ++n, s.held ? "HELD" : sim::paintName(sim::floorAt(s.a)), s.a.x, s.a.y);
+  }
+  if (result.budgetS > 0) std::fprintf(out, " mission_s=%.2f/%.2f", result.missionS, result.budgetS);
+  if (result.losses >= 0) std::fprintf(out, " losses=%d", result.losses);
+  std::fprintf(out, "\n");
+  std::fflush(out);
+  return result;
+}
+
+static double percentile(std::vector<double> v, double q) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, size_t(q * (v.size() - 1) + 0.5))];
+}
+
+/** One mission in a child process; returns its SIM: line(s), also echoed to stderr. */
+static std::vector<std::string> runChild(const sim::Options& options, double brownoutS) {
+  std::vector<std::string> lines;
+  int fds[2];
+  if (pipe(fds) != 0) { std::perror("pipe"); return lines; }
+  std::fflush(nullptr);
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    dup2(fds[1], 2);   // The SIM: line goes to stderr, also after a brownout's exec
+    close(fds[1]);
+    runMission(options, stderr, brownoutS, "");
+    std::fflush(stderr);
+    _exit(0);
+  }
+  close(fds[1]);
+  FILE* in = fdopen(fds[0], "r");
+  char line[1024];
+  while (std::fgets(line, sizeof line, in)) {
+    std::fputs(line, stderr);
+    lines.push_back(line);
+  }
+  std::fclose(in);
+  waitpid(pid, nullptr, 0);
+  return lines;
+}
+
+/** The completion time of a SIM: line, or < 0 if it didn't complete. */
+static double completeTime(const std::string& line) {
+  const char* t = std::strstr(line.c_str(), "time_s=");
+  return line.find("result=COMPLETE") != std::string::npos && t ? std::atof(t + 7) : -1;
+}
+
+/** --runs: one child per seed, SIM: lines collected through a pipe. */
+static int runMany(const sim::Options& base, int runs, double brownoutS) {
+  std::vector<double> times;
+  int complete = 0, inBudget = 0;
+  bool budgeted = false;
+  for (int i = 0; i < runs; i++) {
+    sim::Options options = base;
+    options.seed = base.seed + i;
+    for (const std::string& line : runChild(options, brownoutS)) {
+      const char* m = std::strstr(line.c_str(), "mission_s=");
+      double t = completeTime(line);
+      if (t >= 0) {
+        complete++;
+        times.push_back(t);
+        const char* slash = m ? std::strchr(m, '/') : nullptr;
+        if (slash && std::atof(m + 10) <= std::atof(slash + 1)) inBudget++;
+      }
+      if (m) budgeted = true;
+    }
+  }
+  double mean = 0, sd = 0;
+  for (double t : times) mean += t;
+  if (!times.empty()) mean /= times.size();
+  for (double t : times) sd += (t - mean) * (t - mean);
+  if (times.size() > 1) sd = std::sqrt(sd / (times.size() - 1));
+  std::fprintf(stderr, "SIM: runs=%d complete=%d", runs, complete);
+  if (budgeted) std::fprintf(stderr, " in_budget=%d", inBudget);
+  std::fprintf(stderr, " time_s mean=%.2f sd=%.2f min=%.2f p50=%.2f p90=%.2f max=%.2f\n",
+               mean, sd, percentile(times, 0), percentile(times, 0.5), percentile(times, 0.9), percentile(times, 1));
+  return complete == runs ? 0 : 1;
+}
+
+/**
+ * --practice: `robots` series of `practice` missions. Within a series the
+ * robot (motor spread) stays the same, the sensor noise changes and the
+ * EEPROM goes from each run to the next through a temporary file.
+ */
+static int runPractice(const sim::Options& base, int robots, int practice) {
+  std::vector<std::vector<double>> times(practice);
+  std::vector<int> complete(practice, 0);
+  std::vector<double> losses(practice, 0);
+  for (int r = 0; r < robots; r++) {
+    char path[] = "/tmp/sim_eeprom_XXXXXX";
+    int fd = mkstemp(path);   // Empty: the first run finds the EEPROM erased
+    if (fd < 0) { std::perror("sim: eeprom"); return 1; }
+    close(fd);
+    for (int i = 0; i < practice; i++) {
+      sim::Options options = base;
+      options.robotSeed = base.seed + r;
+      options.seed = base.seed + r * practice + i;
+      options.eepromFile = path;
+      for (const std::string& line : runChild(options, 0)) {
+        const char* l = std::strstr(line.c_str(), " losses=");
+        if (l) losses[i] += std::atoi(l + 8);
+        double t = completeTime(line);
+        if (t < 0) continue;
+        complete[i]++;
+        times[i].push_back(t);
+      }
+    }
+    unlink(path);
+  }
+  for (int i = 0; i < practice; i++) {
+    double mean = 0;
+    for (double t : times[i]) mean += t / times[i].size();
+    std::fprintf(stderr, "PRACTICE: run=%d complete=%d/%d losses=%.2f time_s mean=%.2f p50=%.2f p90=%.2f\n", i + 1,
+                 complete[i], robots, losses[i] / robots, mean, percentile(times[i], 0.5), percentile(times[i], 0.9));
+  }
+  return 0;
+}
+
+static void usage() {
+  std::fprintf(stderr,
+    "usage: sim_<sketch> <scene> [options]\n"
+    "  --time S      time limit in simulated seconds (default 120)\n"
+    "  --seed N      noise seed (default 1)\n"
+    "  --robot N     motor spread from seed N instead (a --practice robot: N = seed + robot)\n"
+    "  --noise X     sensor noise and motor spread scale, 0 = exact (default 1)\n"
+    "  --runs N      N missions with seeds seed.., summary only\n"
+    "  --quiet       don't print the sketch's serial output\n"
+    "  --poses FILE  CSV of t,x,y,heading,state every 20 ms\n"
+    "  --input FILE  bytes the sketch can read from Serial\n"
+    "  --brownout S  reset the board S seconds in; the sketch boots again warm\n"
+    "  --start S     start cue S seconds in, < 0 = none (default 0.5)\n"
+    "  --eeprom FILE EEPROM from FILE (if it exists), saved back at the end\n"
+    "  --practice N  N missions in a row on one robot, EEPROM carried over (x --runs robots)\n"
+    "  --sag-resets  a current spike that sags the battery resets the board\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) { usage(); return 2; }
+  sim::Options options;
+  scenePath = argv[1];
+  selfPath = argv[0];
+  int runs = 1, practice = 0;
+  double brownoutS = 0;
+  std::string resume;
+  for (int i = 2; i < argc; i++) {
+    std::string a = argv[i];
+    bool more = i + 1 < argc;
+    if (a == "--time" && more) options.timeLimitS = std::atof(argv[++i]);
+    else if (a == "--seed" && more) options.seed = uint32_t(std::atol(argv[++i]));
+    else if (a == "--robot" && more) options.robotSeed = uint32_t(std::atol(argv[++i]));
+    else if (a == "--noise" && more) options.noise = std::atof(argv[++i]);
+    else if (a == "--runs" && more) runs = std::max(1, std::atoi(argv[++i]));
+    else if (a == "--quiet") options.echoSerial = false;
+    else if (a == "--poses" && more) options.poseLog = argv[++i];
+    else if (a == "--brownout" && more) brownoutS = std::atof(argv[++i]);
+    else if (a == "--start" && more) options.startCueS = std::atof(argv[++i]);
+    else if (a == "--eeprom" && more) options.eepromFile = argv[++i];
+    else if (a == "--sag-resets") options.sagResets = true;
+    else if (a == "--practice" && more) practice = std::max(1, std::atoi(argv[++i]));
+    else if (a == "--resume" && more) resume = argv[++i];   // Internal: the boot after a brownout
+    else if (a == "--input" && more) {
+      std::ifstream in(argv[++i], std::ios::binary);
+      if (!in) { std::fprintf(stderr, "sim: can't read %s\n", argv[i]); return 2; }
+      std::stringstream ss;
+      ss << in.rdbuf();
+      sim::serialInput(ss.str());
+    } else { usage(); return 2; }
+  }
+
+  std::string error;
+  if (!sim::loadScene(scenePath, error)) {
+    std::fprintf(stderr, "sim: %s\n", error.c_str());
+    return 2;
+  }
+  if (practice > 0) {
+    options.echoSerial = false;
+    return runPractice(options, runs, practice);
+  }
+  if (runs > 1) {
+    options.echoSerial = false;
+    return runMany(options, runs, brownoutS);
+  }
+  return runMission(options, stderr, brownoutS, resume).complete ? 0 : 1;
+}
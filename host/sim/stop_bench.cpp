@@ -0,0 +1,309 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║              STOP BENCH: where the robot really stops                     ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * Drives the start sketch's own sensor and motor code in the simulator and
+ * measures where it comes to rest, over a range of approach speeds:
+ *
+ *   range  drive at a wall, stop when the reading says DIST_BOX_PICKUP.
+ *          Error = true range at rest - DIST_BOX_PICKUP.
+ *   blue   drive onto a blue zone, then do what STATE_APPROACH_BLUE does.
+ *          Error = color sensor's distance past the edge - BLUE_ENTRY_CM.
+ *
+ * Each is done twice: "raw" acts on the reading as it comes (the old code:
+ * dist < DIST_BOX_PICKUP, then a blind 500ms into blue), "comp" through
+ * rangeAtStop() and stopPast(). The loop reads distance and color once per
+ * tick like processState(), so the color read's ~35ms is in the latency.
+ *
+ *   STOP: range pwm=150 speed_cm_s=29.0 raw_err=-6.12/0.84 comp_err=0.21/0.40 hits=20/0
+ *
+ * err = mean/sd in cm over --runs seeds; hits = runs where the body touched
+ * the wall (raw/comp).
+ *
+ *   approach  come in at SPEED_NORMAL, hand over to the approach `from_cm`
+ *             from a box like FOLLOW_BLACK -> APPROACH_BOX (the sketches
+ *             hand over at DIST_BOX_PICKUP + 10), and stop at
+ *             DIST_BOX_PICKUP:
+ *               creep  SPEED_SLOW on the raw reading (the original code)
+ *               comp   SPEED_SLOW on rangeAtStop()
+ *               servo  approachSpeed() on rangeAtStop() (the sketch now)
+ *
+ *   STOP: approach from_cm=30 creep=1.79s,-1.95/0.88 comp=1.94s,0.04/0.20 servo=1.18s,0.09/0.11 pushes=0/0/0 missed=0/0/0
+ *
+ * time = mean from the handover to standing still (under 1 cm/s); then err
+ * mean/sd. pushes = runs that shoved the box, missed = runs that drifted
+ * past it on the way in (no line to follow here), left out of the rest
+ * (creep/comp/servo). Then the servo at other APPROACH_GAINs, per from_cm:
+ *
+ *   STOP: gain=20 15cm=0.63s,-0.02/0.15 20cm=0.80s,-0.01/0.24 ...
+ *
+ * BUILD: see build.sh (it includes ../../standalone/start_section)
+ * USAGE: stop_bench [--runs N] [--noise X]
+ */
+
+#include "Arduino.h"
+#include "start_section.ino"
+
+#include "sim.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+constexpr double WALL_X = 120;      // Face of the wall / edge of the blue zone
+constexpr uint64_t SETTLE_US = 600000;
+constexpr uint64_t GIVE_UP_US = 15000000;
+constexpr uint64_t STILL_STEP_US = 5000;
+constexpr double STILL_CM_S = 1.0;         // Slower than this = there (under 1 mm left to roll)
+constexpr double RUN_UP_CM = 20;           // Following the line at SPEED_NORMAL before the handover
+
+struct Summary {
+  double mean = 0, sd = 0;
+  int hits = 0;
+};
+
+static Summary summarize(const std::vector<double>& v, int hits) {
+  Summary s;
+  s.hits = hits;
+  for (double x : v) s.mean += x;
+  if (!v.empty()) s.mean /= v.size();
+  for (double x : v) s.sd += (x - s.mean) * (x - s.mean);
+  if (v.size() > 1) s.sd = std::sqrt(s.sd / (v.size() - 1));
+  return s;
+}
+
+enum Test { RANGE, BLUE, APPROACH };
+
+/** Empty floor, robot at the origin facing +x; then the obstacle of one test. */
+static void buildScene(Test test) {
+  sim::Scene& sc = sim::scene();
+  sc = sim::Scene();
+  if (test == APPROACH) {
+    sim::Solid s;
+    s.kind = sim::Solid::BOX;
+    s.a = {WALL_X + 3, 0};
+    s.b = {6, 6};
+    s.start = s.a;
+    sc.solids.push_back(s);
+  } else if (test == RANGE) {
+    sim::Solid s;
+    s.kind = sim::Solid::BLOCK;
+    s.a = {WALL_X + 10, 0};
+    s.b = {20, 80};
+    s.start = s.a;
+    sc.solids.push_back(s);
+  } else {
+    sim::PaintOp p;
+    p.kind = sim::PaintOp::RECT;
+    p.a = {WALL_X, -40};
+    p.b = {WALL_X + 80, 40};
+    p.color = sim::BLUE;
+    sc.paint.push_back(p);
+  }
+}
+
+/** Put everything back and let the motors and the echo settle. */
+static void startRun(sim::Options& options, uint32_t seed) {
+  stopMotors();
+  sim::run(SETTLE_US);
+  options.seed = seed;
+  sim::reset(options);
+  readDistance();   // A fresh ping from the new position
+}
+
+/** One approach to the wall; returns the error and whether the body touched. */
+static double rangeRun(uint8_t pwm, bool comp, bool& hit) {
+  uint64_t start = sim::nowUs();
+  moveForward(pwm);
+  while (sim::nowUs() - start < GIVE_UP_US) {
+    float dist = readDistance();
+    readColor();
+    float gap = comp ? rangeAtStop(dist) : dist;
+    if (gap > 0 && gap < DIST_BOX_PICKUP) break;
+  }
+  stopMotors();
+  sim::run(SETTLE_US);
+  hit = sim::stats().collisions > 0;
+  return sim::rangeAhead() - DIST_BOX_PICKUP;
+}
+
+/** Let the robot roll to a standstill; returns how long that took (s). */
+static double waitStill() {
+  uint64_t start = sim::nowUs();
+  while (std::fabs(sim::wheelSpeed(false)) + std::fabs(sim::wheelSpeed(true)) > 2 * STILL_CM_S) sim::run(STILL_STEP_US);
+  return (sim::nowUs() - start) / 1e6;
+}
+
+enum Approach { CREEP, COMP, SERVO };
+
+/** approachSpeed() at another gain (`gain` 0 = the sketch's own). */
+static uint8_t servoSpeed(float ahead, double gain) {
+  if (gain <= 0) return approachSpeed(ahead, DIST_BOX_PICKUP);
+  double pwm = DRIVE_DEADBAND + gain * (ahead - DIST_BOX_PICKUP) / DRIVE_CM_PER_PWM;
+  return (uint8_t)constrain(pwm, APPROACH_MIN_PWM, SPEED_NORMAL);
+}
+
+/**
+ * One box approach handed over `fromCm` out, after a run-up at SPEED_NORMAL;
+ * sets the error, the time from the handover and the pushes. With no line
+ * to follow the robot can drift past the box: false then.
+ */
+static bool approachRun(Approach how, double fromCm, double gain, double& error, double& seconds, bool& pushed) {
+  sim::Pose p = sim::scene().start;
+  p.x = WALL_X - sim::physics().sonarFwdCm - fromCm - RUN_UP_CM;
+  sim::placeRobot(p);
+  readDistance();
+
+  uint64_t start = sim::nowUs();
+  uint64_t switched = 0;
+  moveForward(SPEED_NORMAL);
+  while (sim::nowUs() - start < GIVE_UP_US) {
+    float dist = readDistance();
+    readColor();
+    float ahead = how == CREEP ? dist : rangeAtStop(dist);
+    if (!switched) {
+      if (ahead > 0 && ahead < fromCm) switched = sim::nowUs();
+      else continue;
+    }
+    if (ahead > 0 && ahead < DIST_BOX_PICKUP) break;
+    moveForward(how == SERVO ? servoSpeed(ahead, gain) : SPEED_SLOW);
+  }
+  bool stopped = sim::nowUs() - start < GIVE_UP_US;
+  stopMotors();
+  waitStill();
+  seconds = (sim::nowUs() - (switched ? switched : start)) / 1e6;
+  pushed = sim::stats().pushes > 0;
+  error = sim::rangeAhead() - DIST_BOX_PICKUP;
+  return stopped && error < fromCm;   // Else beside the box, or past it
+}
+
+/**
+ * `runs` approaches one way: error mean/sd and pushes as hits, over the
+ * runs that stopped at the box; their mean time in `seconds`, the others
+ * in `missed`.
+ */
+static Summary approachRuns(sim::Options& options, int runs, Approach how, double fromCm, double gain, double& seconds,
+                            int& missed) {
+  std::vector<double> errors;
+  int pushes = 0;
+  seconds = 0;
+  missed = 0;
+  for (int r = 0; r < runs; r++) {
+    startRun(options, 1 + r);
+    double error = 0, s = 0;
+    bool pushed = false;
+    if (!approachRun(how, fromCm, gain, error, s, pushed)) {
+      missed++;
+      continue;
+    }
+    errors.push_back(error);
+    seconds += s;
+    pushes += pushed;
+  }
+  if (!errors.empty()) seconds /= errors.size();
+  return summarize(errors, pushes);
+}
+
+/** Drive onto the blue zone, then enter it the raw or the compensated way. */
+static double blueRun(uint8_t pwm, bool comp) {
+  uint64_t start = sim::nowUs();
+  moveForward(pwm);
+  while (sim::nowUs() - start < GIVE_UP_US) {
+    readDistance();
+    if (readColor() == COLOR_BLUE) break;
+  }
+  if (comp) {
+    stopPast(colorAtUs, BLUE_ENTRY_CM);
+  } else {
+    moveForward(SPEED_SLOW);
+    delay(500);
+    stopMotors();
+  }
+  sim::run(SETTLE_US);
+  sim::Pose p = sim::pose();
+  double sensorX = p.x + sim::physics().colorFwdCm * std::cos(p.heading * M_PI / 180);
+  return sensorX - WALL_X - BLUE_ENTRY_CM;
+}
+
+int main(int argc, char** argv) {
+  int runs = 20;
+  sim::Options options;
+  options.echoSerial = false;
+  options.timeLimitS = 0;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--runs" && i + 1 < argc) runs = std::max(1, std::atoi(argv[++i]));
+    else if (a == "--noise" && i + 1 < argc) options.noise = std::atof(argv[++i]);
+    else {
+      std::fprintf(stderr, "usage: stop_bench [--runs N] [--noise X]\n");
+      return 2;
+    }
+  }
+
+  buildScene(RANGE);
+  sim::reset(options);
+  setup();   // Waits for the start cue
+  options.startCueS = -1;
+
+  std::printf("# DIST_BOX_PICKUP=%d BLUE_ENTRY_CM=%d DRIVE_TAU_MS=%d runs=%d noise=%.2f\n",
+              DIST_BOX_PICKUP, BLUE_ENTRY_CM, DRIVE_TAU_MS, runs, options.noise);
+  for (const char* test : {"range", "blue"}) {
+    bool wall = test[0] == 'r';
+    buildScene(wall ? RANGE : BLUE);
+    for (int pwm = 80; pwm <= 240; pwm += 20) {
+      Summary result[2];
+      for (int comp = 0; comp < 2; comp++) {
+        std::vector<double> errors;
+        int hits = 0;
+        for (int r = 0; r < runs; r++) {
+          startRun(options, 1 + r);
+          bool hit = false;
+          errors.push_back(wall ? rangeRun(pwm, comp, hit) : blueRun(pwm, comp));
+          hits += hit;
+        }
+        result[comp] = summarize(errors, hits);
+      }
+      std::printf("STOP: %s pwm=%d speed_cm_s=%.1f raw_err=%.2f/%.2f comp_err=%.2f/%.2f", test, pwm,
+                  wheelModelSpeed(pwm), result[0].mean, result[0].sd, result[1].mean, result[1].sd);
+      if (wall) std::printf(" hits=%d/%d", result[0].hits, result[1].hits);
+      std::printf("\n");
+      std::fflush(stdout);
+    }
+  }
+
+  // The sketches hand over at DIST_BOX_PICKUP + 10 (the NEAR step); further
+  // out, the creep's time grows with the distance and the servo's barely
+  buildScene(APPROACH);
+  const double handovers[] = {DIST_BOX_PICKUP + 10.0, 20.0, 30.0, 45.0, 60.0};
+  for (double fromCm : handovers) {
+    std::printf("STOP: approach from_cm=%.0f", fromCm);
+    int pushes[3] = {}, missed[3] = {};
+    for (Approach how : {CREEP, COMP, SERVO}) {
+      double seconds = 0;
+      Summary e = approachRuns(options, runs, how, fromCm, 0, seconds, missed[how]);
+      static const char* names[] = {"creep", "comp", "servo"};
+      std::printf(" %s=%.2fs,%.2f/%.2f", names[how], seconds, e.mean, e.sd);
+      pushes[how] = e.hits;
+    }
+    std::printf(" pushes=%d/%d/%d missed=%d/%d/%d\n", pushes[0], pushes[1], pushes[2], missed[0], missed[1],
+                missed[2]);
+    std::fflush(stdout);
+  }
+
+  // APPROACH_GAIN: the servo at other gains
+  for (double gain : {5.0, 10.0, 20.0, 40.0}) {
+    std::printf("STOP: gain=%.0f", gain);
+    for (double fromCm : handovers) {
+      double seconds = 0;
+      int missed = 0;
+      Summary e = approachRuns(options, runs, SERVO, fromCm, gain, seconds, missed);
+      std::printf(" %.0fcm=%.2fs,%.2f/%.2f", fromCm, seconds, e.mean, e.sd);
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+  }
+  return 0;
+}
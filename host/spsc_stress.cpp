@@ -0,0 +1,130 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║              SPSC STRESS: hammer the sketches' event queue                ║
+ * ║                                                                           ║
+ * ║  One thread pushes, one pops, as fast as they can, on separate cores.     ║
+ * ║  Much harsher than an ISR and loop() on one core: any missing ordering    ║
+ * ║  shows up here as a torn, duplicated, lost or reordered item.             ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * Tests the header the sketches compile (standalone/<sketch>/spsc_queue.h)
+ * in two modes, each at a tiny and a large capacity:
+ *
+ *   blocking   producer retries when full: every item must arrive, in order
+ *   dropping   producer gives up when full, like an ISR: items that arrive
+ *              must be in order, and arrived + overflows must equal pushed
+ *              (the sentinel's retries taken off the overflows)
+ *
+ * Items are three words (seq, ~seq, seq * K) so a torn copy is caught too,
+ * and every seq is checked off, so one that arrives twice is an error.
+ *
+ * BUILD:  g++ -std=c++17 -O2 -Wall -pthread -o spsc_stress spsc_stress.cpp
+ *         (add -fsanitize=thread to have ThreadSanitizer check the ordering)
+ *
+ * USAGE:
+ *   spsc_stress              # 20M items per test
+ *   spsc_stress -n 200000000
+ */
+
+#include "../standalone/start_section/spsc_queue.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+constexpr uint32_t MIX = 0x9E3779B1u;   // Any odd constant: seq * MIX checks the copy
+
+struct Item {
+  uint32_t seq, inverted, mixed;
+};
+
+struct Result {
+  uint64_t received = 0, overflows = 0, sentinelRetries = 0, duplicates = 0, errors = 0;
+  uint32_t peak = 0;
+  double seconds = 0;
+};
+
+/**
+ * run() - Push `count` items from one thread and pop them in another.
+ * The consumer stops at the sentinel (seq == count), which the producer
+ * always delivers, even in dropping mode.
+ */
+template <uint32_t N>
+static Result run(uint32_t count, bool dropping) {
+  auto queue = std::make_unique<SpscQueue<Item, N>>();   // Fresh per run: the counters start at 0
+  SpscQueue<Item, N>& q = *queue;
+  Result r;
+  std::vector<bool> seen(count + 1);
+  auto start = std::chrono::steady_clock::now();
+
+  uint64_t sentinelRetries = 0;   // The producer's; read after join()
+  std::thread producer([&] {
+    for (uint32_t i = 0; i <= count; i++) {
+      Item it = {i, ~i, i * MIX};
+      bool last = i == count;
+      while (!q.push(it) && (!dropping || last)) {   // Retry: always when blocking, the sentinel when dropping
+        if (last) sentinelRetries++;
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 0;   // Lowest seq still allowed
+  for (;;) {
+    Item it;
+    if (!q.pop(it)) { std::this_thread::yield(); continue; }   // Yield: also runs on one core
+    if (it.inverted != ~it.seq || it.mixed != it.seq * MIX) {
+      if (r.errors++ < 5) std::fprintf(stderr, "  torn item: %08x %08x %08x\n", it.seq, it.inverted, it.mixed);
+      continue;
+    }
+    if (it.seq <= count && seen[it.seq] && r.duplicates++ < 5) std::fprintf(stderr, "  #%u arrived twice\n", it.seq);
+    if (it.seq <= count) seen[it.seq] = true;
+    bool ok = dropping ? it.seq >= expected : it.seq == expected;
+    if (!ok && r.errors++ < 5) std::fprintf(stderr, "  got #%u, expected #%u\n", it.seq, expected);
+    expected = it.seq + 1;
+    if (it.seq == count) break;
+    r.received++;
+  }
+  producer.join();
+
+  r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  r.peak = q.peak();
+  r.overflows = q.overflows();   // With every failed push: the sentinel's retries too
+  r.sentinelRetries = sentinelRetries;
+  if (!dropping && r.overflows == 0 && r.received != count) r.errors++;
+  return r;
+}
+
+template <uint32_t N>
+static bool test(const char* mode, uint32_t count) {
+  bool dropping = std::strcmp(mode, "dropping") == 0;
+  Result r = run<N>(count, dropping);
+  uint64_t lost = count - r.received;
+  // Blocking: nothing lost. Dropping: every missing item, and nothing else, was an overflow.
+  bool ok = r.errors == 0 && r.duplicates == 0 &&
+            (dropping ? lost == r.overflows - r.sentinelRetries : lost == 0);
+  std::printf("  %-9s capacity %-5u %10llu items %6.1f M/s  peak %5u  dropped %10llu  %s\n",
+              mode, N, (unsigned long long)r.received, r.received / r.seconds / 1e6, r.peak,
+              (unsigned long long)lost, ok ? "OK" : "FAIL");
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  uint32_t count = 20000000;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) count = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+    else { std::fprintf(stderr, "usage: spsc_stress [-n ITEMS]\n"); return 2; }
+  }
+  std::printf("SPSC stress: %u items per test, %u hardware threads\n", count, std::thread::hardware_concurrency());
+  bool ok = true;
+  ok &= test<16>("blocking", count);     // The sketches' size: full most of the time
+  ok &= test<1024>("blocking", count);
+  ok &= test<16>("dropping", count);
+  ok &= test<1024>("dropping", count);
+  std::printf(ok ? "PASS\n" : "FAIL\n");
+  return ok ? 0 : 1;
+}
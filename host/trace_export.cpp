@@ -0,0 +1,308 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║           TRACE EXPORT: a run's TRACE: lines -> Chrome trace JSON         ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * The mission sketches send their spans - states, maneuvers, servo waits,
+ * sensor readings (see trace.h, TRACE_MASK) - as compact "TRACE: ev=" lines.
+ * This decodes them from any log of the robot's Serial output (plain,
+ * telemetry.py's "<ms>\t" lines, the Arduino IDE's timestamps) and writes
+ * the Chrome trace event format, which chrome://tracing and
+ * https://ui.perfetto.dev both open:
+ *
+ *   one process per run ("TRACE: mask=" starts one: a boot or sim run)
+ *   one thread per kind: state, maneuver, servo, wait, and each sensor
+ *   B/E events at the robot's micros(); an end's value as args.value
+ *
+ * Spans still open when the log ends are closed at its last event; ends
+ * without a begin (a log joined mid-span) are left out.
+ *
+ * BUILD:  g++ -std=c++17 -O2 -Wall -o trace_export trace_export.cpp
+ *
+ * USAGE:
+ *   trace_export run.log > run.json
+ *   sim_start start.scene | trace_export -o run.json
+ *   trace_export --summary run.log       # count, total and longest per span
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+constexpr int IDS = 64;   // The tag byte's 6 bits
+
+struct Name {
+  std::string cat = "unknown", name;
+};
+
+struct Event {
+  uint64_t us;
+  uint8_t id, phase;   // trace.h's TracePhase: 0 begin, 1 end, 2 end + value, 3 instant
+  int32_t arg;
+};
+
+struct Run {
+  int mask = 0;
+  Name names[IDS];
+  std::vector<Event> events;
+};
+
+static bool startsWith(const std::string& s, const char* p) { return s.compare(0, std::char_traits<char>::length(p), p) == 0; }
+
+static std::string field(const std::string& s, const std::string& key) {
+  size_t at = s.find(key + "=");
+  if (at == std::string::npos) return "";
+  at += key.size() + 1;
+  return s.substr(at, s.find(' ', at) - at);
+}
+
+static bool base64(const std::string& text, std::vector<uint8_t>& out) {
+  uint32_t word = 0;
+  int bits = 0;
+  for (char c : text) {
+    int v;
+    if (c >= 'A' && c <= 'Z') v = c - 'A';
+    else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+    else if (c >= '0' && c <= '9') v = c - '0' + 52;
+    else if (c == '+') v = 62;
+    else if (c == '/') v = 63;
+    else if (c == '=' || c == '\r') break;
+    else return false;
+    word = word << 6 | v;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out.push_back(uint8_t(word >> bits));
+    }
+  }
+  return true;
+}
+
+static bool varint(const std::vector<uint8_t>& b, size_t& at, uint32_t& v) {
+  v = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (at >= b.size()) return false;
+    uint8_t byte = b[at++];
+    v |= uint32_t(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+static int32_t unzigzag(uint32_t v) { return int32_t(v >> 1) ^ -int32_t(v & 1); }
+
+/** One "ev=" line into `run`. micros() wraps every 71 minutes: `base` carries it on. */
+static bool decode(const std::string& text, Run& run, uint64_t& base, uint32_t& lastFirst) {
+  std::vector<uint8_t> b;
+  if (!base64(text, b)) return false;
+  size_t at = 0;
+  uint32_t first;
+  if (!varint(b, at, first)) return false;
+  if (!run.events.empty() && first < lastFirst && lastFirst - first > 0x80000000u) base += 1ull << 32;
+  lastFirst = first;
+  int64_t us = int64_t(base + first);
+  while (at < b.size()) {
+    uint8_t tag = b[at++];
+    uint32_t delta, arg = 0;
+    if (!varint(b, at, delta)) return false;
+    uint8_t phase = tag >> 6;
+    if (phase >= 2 && !varint(b, at, arg)) return false;
+    us += unzigzag(delta);
+    run.events.push_back({uint64_t(std::max<int64_t>(us, 0)), uint8_t(tag & 63), phase, unzigzag(arg)});
+  }
+  return true;
+}
+
+static void readLog(std::istream& in, std::vector<Run>& runs, unsigned& bad) {
+  std::string line;
+  uint64_t base = 0;
+  uint32_t lastFirst = 0;
+  while (std::getline(in, line)) {
+    size_t at = line.find("TRACE: ");
+    if (at == std::string::npos) continue;
+    std::string s = line.substr(at + 7);
+    while (!s.empty() && (s.back() == '\r' || s.back() == ' ')) s.pop_back();
+    if (startsWith(s, "mask=")) {
+      runs.emplace_back();
+      runs.back().mask = std::atoi(s.c_str() + 5);
+      base = lastFirst = 0;
+      continue;
+    }
+    if (runs.empty()) runs.emplace_back();   // Joined after the boot: no legend
+    Run& run = runs.back();
+    if (startsWith(s, "id=")) {
+      int id = std::atoi(field(s, "id").c_str());
+      if (id < 0 || id >= IDS) continue;
+      run.names[id].cat = field(s, "cat");
+      size_t name = s.find("name=");
+      run.names[id].name = name == std::string::npos ? "" : s.substr(name + 5);
+    } else if (startsWith(s, "ev=")) {
+      if (!decode(s.substr(3), run, base, lastFirst)) bad++;
+    }
+  }
+}
+
+static std::string spanName(const Run& run, uint8_t id) {
+  const Name& n = run.names[id];
+  return n.name.empty() ? "id" + std::to_string(id) : n.name;
+}
+
+/** Thread per kind; sensors get one each (an echo overlaps a color reading). */
+static int track(const Run& run, uint8_t id) {
+  const std::string& cat = run.names[id].cat;
+  if (cat == "state") return 1;
+  if (cat == "maneuver") return 2;
+  if (cat == "servo") return 3;
+  if (cat == "wait") return 4;
+  if (cat == "sensor") return 10 + id;
+  return 100 + id;
+}
+
+static std::string quoted(const std::string& s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    if (uint8_t(c) >= 0x20) out += c;
+  }
+  return out + "\"";
+}
+
+static void writeJson(std::ostream& out, std::vector<Run>& runs) {
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool firstOut = true;
+  auto emit = [&](const std::string& e) {
+    out << (firstOut ? "" : ",\n") << e;
+    firstOut = false;
+  };
+  for (size_t r = 0; r < runs.size(); r++) {
+    Run& run = runs[r];
+    if (run.events.empty()) continue;
+    std::stable_sort(run.events.begin(), run.events.end(), [](const Event& a, const Event& b) { return a.us < b.us; });
+    std::string pid = std::to_string(r + 1);
+    emit("{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" + pid + ",\"args\":{\"name\":\"run " + pid +
+         " (mask " + std::to_string(run.mask) + ")\"}}");
+    std::map<int, std::string> threads;
+    for (const Event& e : run.events) {
+      const std::string& cat = run.names[e.id].cat;
+      threads[track(run, e.id)] = cat == "sensor" ? spanName(run, e.id) : cat;
+    }
+    for (auto& t : threads) {
+      emit("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + pid + ",\"tid\":" + std::to_string(t.first) +
+           ",\"args\":{\"name\":" + quoted(t.second) + "}}");
+      emit("{\"ph\":\"M\",\"name\":\"thread_sort_index\",\"pid\":" + pid + ",\"tid\":" + std::to_string(t.first) +
+           ",\"args\":{\"sort_index\":" + std::to_string(t.first) + "}}");
+    }
+
+    int open[IDS] = {};
+    uint64_t lastUs = run.events.back().us;
+    for (const Event& e : run.events) {
+      std::string common = "\"name\":" + quoted(spanName(run, e.id)) + ",\"cat\":" + quoted(run.names[e.id].cat) +
+                           ",\"pid\":" + pid + ",\"tid\":" + std::to_string(track(run, e.id)) +
+                           ",\"ts\":" + std::to_string(e.us);
+      std::string value = ",\"args\":{\"value\":" + std::to_string(e.arg) + "}";
+      if (e.phase == 0) {
+        open[e.id]++;
+        emit("{\"ph\":\"B\"," + common + "}");
+      } else if (e.phase == 3) {
+        emit("{\"ph\":\"i\",\"s\":\"t\"," + common + value + "}");
+      } else if (open[e.id] > 0) {
+        open[e.id]--;
+        emit("{\"ph\":\"E\"," + common + (e.phase == 2 ? value : "") + "}");
+      }
+    }
+    for (int id = 0; id < IDS; id++) {
+      for (; open[id] > 0; open[id]--) {
+        emit("{\"ph\":\"E\",\"name\":" + quoted(spanName(run, id)) + ",\"pid\":" + pid +
+             ",\"tid\":" + std::to_string(track(run, id)) + ",\"ts\":" + std::to_string(lastUs) + "}");
+      }
+    }
+  }
+  out << "\n]}\n";
+}
+
+/** Per run and span: how many, how long in all, the longest (ms). */
+static void writeSummary(std::vector<Run>& runs) {
+  for (size_t r = 0; r < runs.size(); r++) {
+    Run& run = runs[r];
+    std::stable_sort(run.events.begin(), run.events.end(), [](const Event& a, const Event& b) { return a.us < b.us; });
+    struct Total { unsigned count = 0; double ms = 0, maxMs = 0; };
+    std::map<int, Total> totals;
+    std::vector<uint64_t> began[IDS];
+    for (const Event& e : run.events) {
+      if (e.phase == 0) began[e.id].push_back(e.us);
+      else if ((e.phase == 1 || e.phase == 2) && !began[e.id].empty()) {
+        double ms = (e.us - began[e.id].back()) / 1000.0;
+        began[e.id].pop_back();
+        Total& t = totals[e.id];
+        t.count++;
+        t.ms += ms;
+        t.maxMs = std::max(t.maxMs, ms);
+      }
+    }
+    std::printf("run %zu: %zu events\n", r + 1, run.events.size());
+    for (auto& t : totals) {
+      std::printf("  %-9s %-20s count=%-5u total_ms=%-9.1f max_ms=%.1f\n", run.names[t.first].cat.c_str(),
+                  spanName(run, uint8_t(t.first)).c_str(), t.second.count, t.second.ms, t.second.maxMs);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  std::string outPath;
+  bool summary = false;
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-o" && i + 1 < argc) outPath = argv[++i];
+    else if (a == "--summary") summary = true;
+    else if (!a.empty() && a[0] == '-' && a != "-") {
+      std::fprintf(stderr, "usage: trace_export [-o out.json] [--summary] [log ...]   (no log: stdin)\n");
+      return 2;
+    } else inputs.push_back(a);
+  }
+
+  std::vector<Run> runs;
+  unsigned bad = 0;
+  if (inputs.empty()) inputs.push_back("-");
+  for (const std::string& path : inputs) {
+    if (path == "-") {
+      readLog(std::cin, runs, bad);
+      continue;
+    }
+    std::ifstream in(path);
+    if (!in) {
+      std::fprintf(stderr, "trace_export: can't read %s\n", path.c_str());
+      return 1;
+    }
+    readLog(in, runs, bad);
+  }
+  size_t events = 0;
+  for (const Run& run : runs) events += run.events.size();
+  if (bad) std::fprintf(stderr, "trace_export: %u damaged TRACE: ev= lines skipped\n", bad);
+  if (!events) {
+    std::fprintf(stderr, "trace_export: no TRACE: events in the input (TRACE_MASK 0?)\n");
+    return 1;
+  }
+
+  if (summary) {
+    writeSummary(runs);
+    return 0;
+  }
+  if (outPath.empty()) {
+    writeJson(std::cout, runs);
+  } else {
+    std::ofstream out(outPath);
+    writeJson(out, runs);
+    if (!out) {
+      std::fprintf(stderr, "trace_export: can't write %s\n", outPath.c_str());
+      return 1;
+    }
+  }
+  std::fprintf(stderr, "trace_export: %zu runs, %zu events\n", runs.size(), events);
+  return 0;
+}
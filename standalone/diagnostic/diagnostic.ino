@@ -44,17 +44,61 @@
 Servo baseServo, clampServo;
 int blinkCount = 0;
 
+// ============================================================================
+// STACK PAINTING - worst-case stack depth, measured on the real board
+// ============================================================================
+// setup() fills the unused stack with a known byte. The stack only ever
+// overwrites it, so the first changed byte from the bottom marks the deepest
+// the stack has been since boot. Run the tests, then 'm' for the result.
+
+#define STACK_PAINT       0xA5
+#define STACK_PAINT_GAP   64     // Bytes below the current SP left alone
+
+#if defined(ARDUINO_ARCH_AVR)
+// Stack grows down from RAMEND toward the heap: the gap between them
+extern char __heap_start;
+extern char* __brkval;
+uint8_t* stackBottom() { return (uint8_t*)(__brkval ? __brkval : &__heap_start); }
+uint8_t* stackTop()    { return (uint8_t*)RAMEND + 1; }
+#else
+// UNO R4 (Renesas FSP linker script): the main stack is its own section
+extern uint8_t __StackLimit;
+extern uint8_t __StackTop;
+uint8_t* stackBottom() { return &__StackLimit; }
+uint8_t* stackTop()    { return &__StackTop; }
+#endif
+
+/**
+ * paintStack() - Call first thing in setup(). Not inlined, so `here` is
+ * in its own frame, just below everything that's live.
+ */
+__attribute__((noinline)) void paintStack() {
+  uint8_t here;
+  uint8_t* p = stackBottom();
+  while (p < &here - STACK_PAINT_GAP) *p++ = STACK_PAINT;
+}
+
+/** Deepest stack use since boot, in bytes. */
+unsigned int stackHighWater() {
+  const uint8_t* p = stackBottom();
+  while (p < stackTop() && *p == STACK_PAINT) p++;
+  return stackTop() - p;
+}
+
+#define SERIAL_WAIT_MS    2000   // Longest setup() waits for a Serial Monitor
+
 void setup() {
+  paintStack();
+
   // Start Serial FIRST
   Serial.begin(9600);
   
-  // Wait for Serial to be ready (important for some boards)
-  while (!Serial) {
+  // Wait for the Serial Monitor (the R4's Serial is its USB port), but not
+  // forever: with nothing connected, the tests below still run
+  while (!Serial && millis() < SERIAL_WAIT_MS) {
     ; // wait
   }
   
-  delay(1000);
-  
   Serial.println();
   Serial.println(F("===================================="));
   Serial.println(F("   DIAGNOSTIC TOOL STARTING"));
@@ -124,6 +168,7 @@ void printMenu() {
   Serial.println(F("║  7 - Test IR sensors                   ║"));
   Serial.println(F("║  8 - CONTINUOUS sensor reading         ║"));
   Serial.println(F("║  9 - Stop everything                   ║"));
+  Serial.println(F("║  m - Memory: stack high-water mark     ║"));
   Serial.println(F("║  ? - Show this menu                    ║"));
   Serial.println(F("╚════════════════════════════════════════╝"));
   Serial.println();
@@ -185,6 +230,10 @@ void loop() {
       case '9':
         stopEverything();
         break;
+      case 'm':
+      case 'M':
+        testMemory();
+        break;
       case '?':
       case 'h':
       case 'H':
@@ -496,6 +545,38 @@ void continuousSensorReading() {
   Serial.println(F("\nStopped."));
 }
 
+void testMemory() {
+  Serial.println(F("\n=== MEMORY / STACK ==="));
+  Serial.println(F("Worst case since boot: run tests 1-8 first, then m again."));
+
+  uint8_t here;
+  unsigned int size = stackTop() - stackBottom();
+  unsigned int used = stackHighWater();
+  unsigned int now = stackTop() - &here;
+
+  Serial.print(F("Stack region: "));
+  Serial.print(size);
+  Serial.println(F(" bytes"));
+  Serial.print(F("Used now:     ~"));
+  Serial.print(now);
+  Serial.println(F(" bytes"));
+  Serial.print(F("High-water:   "));
+  Serial.print(used);
+  Serial.print(F(" bytes ("));
+  Serial.print(100UL * used / size);
+  Serial.println(F("%)"));
+  Serial.print(F("Never touched: "));
+  Serial.print(size - used);
+  Serial.println(F(" bytes"));
+  if (size - used < 256) Serial.println(F("WARNING: less than 256 bytes of stack to spare!"));
+
+  // One line for host/mem_budget --stack-log
+  Serial.print(F("STACK: used="));
+  Serial.print(used);
+  Serial.print(F(" size="));
+  Serial.println(size);
+}
+
 void stopEverything() {
   Serial.println(F("\n=== STOPPING EVERYTHING ==="));
   
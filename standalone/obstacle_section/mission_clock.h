@@ -0,0 +1,193 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║          MISSION CLOCK: the section's time budget, spent on purpose       ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * Every state has its own timeout, but nothing knew how the run as a whole
+ * was doing. The sketch hands begin() a PLAN - each state of a normal run,
+ * in course order, with how long it takes and how far it drives:
+ *
+ *   const Leg PLAN[] = {
+ *     // state                 ms     cm (0 = progress by time)
+ *     { STATE_FOLLOW_BLACK,      1250,  33 },
+ *     { STATE_PICKUP,            1200,   0 },
+ *     ...
+ *     { STATE_COMPLETE,             0,   0 },   // The finish line: 100%
+ *   };
+ *
+ * PROGRESS: the plan time of the legs behind us, plus the part of the
+ * current leg done - by odometer if it drives a known distance, else by
+ * time in it (capped at the leg's plan). Going back to an earlier state
+ * (another obstacle) never takes progress back.
+ *
+ * PACE = plan time still ahead / budget time still left (budget minus a
+ * reserve). 1.0 is on schedule; above, the run is behind.
+ *
+ *   cruise(nominal, max)     a driving speed scaled by the pace, within
+ *                            MISSION_PACE_MIN..MAX and capped at `max`
+ *   searchMs(nominal, least) how long an OPTIONAL search may take: all of
+ *                            it while the plan fits the budget, less by the
+ *                            overrun when it doesn't, 0 (skip) under `least`
+ *
+ * Precision moves (approach, pickup, timed turns) keep their own speeds:
+ * only cruising and the give-up time of searches change.
+ *
+ * report() prints:
+ *   BUDGET: budget_ms=<b> elapsed_ms=<t> progress=<%> spare_ms=<ms> pace=<x> speed_pct=<min>/<max> shortened=<n> skipped=<n>
+ *
+ * Arduino only compiles files inside the sketch folder, so every mission
+ * sketch carries an identical copy of this header.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#define MISSION_PACE_MIN  1.0    // Ahead of schedule: nominal speed (0.9 was tried: slower overall)
+#define MISSION_PACE_MAX  1.25   // Behind: up to 125%, if the sketch's cap allows
+
+struct Leg {
+  uint8_t state;       // The sketch's State
+  uint16_t ms;         // Time in it on a normal run
+  uint16_t cm;         // Distance driven in it; 0 = measure progress by time
+};
+
+class MissionClock {
+public:
+  /**
+   * Start the clock. `firstState` is where the run begins: after a
+   * brownout that is the resumed state, and the clock assumes the run
+   * was on schedule up to there.
+   */
+  void begin(uint32_t budgetMs, uint32_t reserveMs, const Leg* plan, uint8_t count,
+             uint8_t firstState, uint32_t nowMs) {
+    budgetMs_ = budgetMs;
+    reserveMs_ = reserveMs;
+    plan_ = plan;
+    count_ = count;
+    planMs_ = 0;
+    for (uint8_t i = 0; i < count_; i++) planMs_ += plan_[i].ms;
+    leg_ = legOf(firstState, 0);
+    doneMs_ = leg_ < count_ ? before(leg_) : 0;
+    startMs_ = nowMs - doneMs_;
+    enteredMs_ = now_ = nowMs;
+  }
+
+  /** Call from transitionTo(): the run is at the start of this state. */
+  void enter(uint8_t state, uint32_t nowMs, float cm) {
+    uint8_t leg = legOf(state, leg_);
+    if (leg < count_ && (leg_ >= count_ || leg >= leg_)) {
+      leg_ = leg;
+      uint32_t at = before(leg_);
+      if (at > doneMs_) doneMs_ = at;
+    }
+    enteredMs_ = now_ = nowMs;
+    enteredCm_ = cm;
+  }
+
+  /** Call every loop() tick with the odometer (0 without one). */
+  void update(uint32_t nowMs, float cm) {
+    now_ = nowMs;
+    if (leg_ >= count_) return;
+    const Leg& l = plan_[leg_];
+    float part = l.cm ? (cm - enteredCm_) / l.cm : l.ms ? (float)(nowMs - enteredMs_) / l.ms : 1;
+    if (part > 1) part = 1;
+    if (part < 0) part = 0;
+    uint32_t done = before(leg_) + (uint32_t)(part * l.ms);
+    if (done > doneMs_) doneMs_ = done;
+  }
+
+  uint32_t elapsedMs() const { return now_ - startMs_; }
+  uint32_t inStateMs() const { return now_ - enteredMs_; }
+
+  /** Budget left over if the rest goes to plan; negative = over budget. */
+  int32_t spareMs() const {
+    return (int32_t)budgetMs_ - (int32_t)reserveMs_ - (int32_t)elapsedMs() - (int32_t)(planMs_ - doneMs_);
+  }
+
+  float pace() const {
+    int32_t left = (int32_t)budgetMs_ - (int32_t)reserveMs_ - (int32_t)elapsedMs();
+    uint32_t ahead = planMs_ - doneMs_;
+    if (left <= 0) return ahead ? MISSION_PACE_MAX : 1.0f;
+    return (float)ahead / left;
+  }
+
+  /** A cruising speed for the time left; above `maxPwm` only if `nominal` is. */
+  uint8_t cruise(uint8_t nominal, uint8_t maxPwm) {
+    float scale = constrain(pace(), MISSION_PACE_MIN, MISSION_PACE_MAX);
+    uint16_t pwm = (uint16_t)(nominal * scale + 0.5f);
+    if (pwm > maxPwm) pwm = maxPwm > nominal ? maxPwm : nominal;
+    uint8_t pct = (uint8_t)(pwm * 100UL / nominal);
+    if (pct < minPct_) minPct_ = pct;
+    if (pct > maxPct_) maxPct_ = pct;
+    return pwm;
+  }
+
+  /**
+   * How long an optional search may run. Counts (once per state) the
+   * searches it cut short or skipped.
+   */
+  uint32_t searchMs(uint32_t nominal, uint32_t leastMs) {
+    int32_t spare = spareMs();
+    if (spare >= 0) return nominal;
+    int32_t allowed = (int32_t)nominal + spare;
+    bool skip = allowed < (int32_t)leastMs;
+    if (cutAt_ != enteredMs_) {
+      cutAt_ = enteredMs_;
+      if (skip) skipped_++;
+      else shortened_++;
+    }
+    return skip ? 0 : allowed;
+  }
+
+  /** The optional search of this state has had its time. */
+  bool searchOver(uint32_t nominal, uint32_t leastMs) { return inStateMs() >= searchMs(nominal, leastMs); }
+
+  void report() const {
+    Serial.print(F("BUDGET: budget_ms="));
+    Serial.print(budgetMs_);
+    Serial.print(F(" elapsed_ms="));
+    Serial.print(elapsedMs());
+    Serial.print(F(" progress="));
+    Serial.print(planMs_ ? doneMs_ * 100UL / planMs_ : 0);
+    Serial.print(F("% spare_ms="));
+    Serial.print(spareMs());
+    Serial.print(F(" pace="));
+    Serial.print(pace(), 2);
+    Serial.print(F(" speed_pct="));
+    Serial.print(maxPct_ ? minPct_ : 100);
+    Serial.print('/');
+    Serial.print(maxPct_ ? maxPct_ : 100);
+    Serial.print(F(" shortened="));
+    Serial.print(shortened_);
+    Serial.print(F(" skipped="));
+    Serial.println(skipped_);
+  }
+
+private:
+  /** Plan time before leg i. */
+  uint32_t before(uint8_t i) const {
+    uint32_t ms = 0;
+    for (uint8_t k = 0; k < i && k < count_; k++) ms += plan_[k].ms;
+    return ms;
+  }
+
+  /** The leg of `state`, looking from leg `from` on first; count_ = not in the plan. */
+  uint8_t legOf(uint8_t state, uint8_t from) const {
+    for (uint8_t i = from; i < count_; i++) if (plan_[i].state == state) return i;
+    for (uint8_t i = 0; i < from && i < count_; i++) if (plan_[i].state == state) return i;
+    return count_;
+  }
+
+  const Leg* plan_ = nullptr;
+  uint8_t count_ = 0;
+  uint8_t leg_ = 0;
+  uint32_t budgetMs_ = 0, reserveMs_ = 0, planMs_ = 0;
+  uint32_t startMs_ = 0, now_ = 0;
+  uint32_t doneMs_ = 0;           // Plan time covered so far
+  uint32_t enteredMs_ = 0;
+  float enteredCm_ = 0;
+  uint32_t cutAt_ = 0xFFFFFFFF;   // enteredMs_ of the last state whose search was cut
+  uint8_t minPct_ = 255, maxPct_ = 0;
+  uint16_t shortened_ = 0, skipped_ = 0;
+};
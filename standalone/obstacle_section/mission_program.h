@@ -0,0 +1,402 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║        MISSION PROGRAM: the route as bytecode, reloadable over Serial     ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * The route used to be the state machine itself: taking the other branch,
+ * adding a turn or a second box meant editing the sketch and reflashing
+ * it. Now the states are STEPS that a small program strings together. The
+ * program is a few dozen bytes in EEPROM, sent over Serial by the host
+ * assembler (host/mission_asm.cpp). Without one the sketch runs its
+ * built-in program, which is the course as it was.
+ *
+ * Each sketch has states for some of the ops only, and passes begin() the
+ * set it runs (PROGRAM_OP bits); check() turns a program with any other
+ * away. The start sketch:
+ *
+ *   op        operands         the step
+ *   FOLLOW    line colors      follow `line` until one of `colors` (bit 1 << Color)
+ *                              is under the sensor
+ *   NEAR      line cm          follow `line` until something is within `cm`
+ *   FOR       line ms_lo ms_hi follow `line` for `ms`
+ *   APPROACH  cm               drive at what's ahead, stop `cm` from it
+ *   PAST      cm               drive on, stop `cm` past where the last FOLLOW's
+ *                              color went by
+ *   GRIP                       pick the box up
+ *   RELEASE                    put it down
+ *   BRANCH    color            find the `color` branch at the junction, face down it
+ *   TURN      deg_lo deg_hi    pivot by `deg` (signed, + = left)
+ *
+ * The target sketch:
+ *
+ *   CLIMB     ms_lo ms_hi      up the ramp until a color, `ms` at most
+ *   CENTER                     ring by ring inward to the black center
+ *   SEEK      cm               creep until something is within `cm` (the ball)
+ *   SHOOT                      ram it
+ *   TURN      deg_lo deg_hi    turn by `deg` (signed, + = left)
+ *   DRIVE     ms_lo ms_hi      straight ahead for `ms`, at the nominal speed
+ *
+ * The obstacle sketch:
+ *
+ *   FIND      color            look for the `color` line (red, blue or black)
+ *   BOX       line             follow `line` until the box, around what's not it
+ *   APPROACH  cm               as above; GRIP and RELEASE too
+ *   AVOID     line n           follow `line` around `n` obstacles
+ *   FOR       line ms_lo ms_hi as above (the IR follower: black)
+ *
+ * And all of them:
+ *
+ *   REPEAT    n                the steps up to its END, n times
+ *   END
+ *   HALT                       the mission is over (so is running off the end)
+ *
+ * next() does the control flow (REPEAT/END, at most PROGRAM_DEPTH deep)
+ * and hands back the next step; the sketch turns it into a state and that
+ * state's subscriptions. A decode is a handful of byte reads: next() times
+ * itself in CPU cycles for report().
+ *
+ * IN EEPROM, one slot per section: section 1's at PROGRAM_BASE (after the
+ * checkpoint ring, before the speed profile), 2's and 3's after the speed
+ * profile from PROGRAM_MORE on. Each is 'M', length, CRC-8 of the code,
+ * then the code. begin() checks all of it, and the code itself (see
+ * check()); anything wrong and the built-in program runs.
+ *
+ * LOADING: while the robot waits for its start cue, the sketch feeds
+ * Serial to service(). A line
+ *
+ *   PROG <code, hex> <CRC-8, hex>      ("PROG clear": back to built-in)
+ *
+ * is checked, written to EEPROM and run from then on. The answer:
+ *
+ *   PROG: loaded bytes=<n> crc=<c>   or   PROG: rejected <why>
+ *
+ * RESUMING after a brownout: resumePc() and loops() go in the checkpoint,
+ * resumeAt() picks up there. BRANCH and PAST act on a moment that's gone
+ * (when the color went by), so they resume at the step before: the robot
+ * is still standing on the color. A TURN runs whole again (the heading
+ * model starts over). Only the innermost REPEAT's count is kept; outer
+ * ones start over. The obstacle sketch's count holds its obstacles, so
+ * there no REPEAT count is kept.
+ *
+ * report() prints:
+ *   PROG: source=builtin|eeprom bytes=<n> steps=<run> decode_us=<max>/<mean>
+ *
+ * Arduino only compiles files inside the sketch folder, so every mission
+ * sketch carries an identical copy of this header.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <FspTimer.h>   // UNO R4 core; with it DWT (the cycle counter) and SystemCoreClock
+
+#define PROGRAM_BASE   384   // Section 1's first EEPROM byte (the checkpoint ring ends here)
+#define PROGRAM_BYTES  128   // ...up to the speed profile; every slot's size
+#define PROGRAM_MORE   640   // Section 2's slot, then 3's: after the speed profile
+#define PROGRAM_CODE   (PROGRAM_BYTES - 3)
+#define PROGRAM_DEPTH  4     // Nested REPEATs
+#define PROGRAM_LINE   (2 * PROGRAM_CODE + 16)   // Longest Serial line service() takes
+
+enum ProgramOp : uint8_t {
+  OP_HALT,
+  OP_FOLLOW,     // line, colors
+  OP_NEAR,       // line, cm
+  OP_FOR,        // line, ms (2)
+  OP_APPROACH,   // cm
+  OP_PAST,       // cm
+  OP_GRIP,
+  OP_RELEASE,
+  OP_BRANCH,     // color
+  OP_TURN,       // deg (2)
+  OP_REPEAT,     // n
+  OP_END,
+  OP_FIND,       // color
+  OP_BOX,        // line
+  OP_AVOID,      // line, n
+  OP_CLIMB,      // ms (2)
+  OP_CENTER,
+  OP_SEEK,       // cm
+  OP_SHOOT,
+  OP_DRIVE,      // ms (2)
+  OP_COUNT
+};
+
+// Operand bytes of each op
+const uint8_t OP_ARGS[OP_COUNT] = { 0, 2, 2, 3, 1, 1, 0, 0, 1, 2, 1, 0, 1, 1, 2, 2, 0, 1, 0, 2 };
+
+// begin()'s op sets: a bit per op
+#define PROGRAM_OP(op)  (1UL << (op))
+#define PROGRAM_FLOW    (PROGRAM_OP(OP_HALT) | PROGRAM_OP(OP_REPEAT) | PROGRAM_OP(OP_END))
+
+struct ProgramStep {
+  ProgramOp op;
+  uint8_t line;    // FOLLOW/NEAR/FOR/BOX/AVOID: the Color to follow
+  uint8_t arg;     // FOLLOW: colors; NEAR/APPROACH/PAST/SEEK: cm; BRANCH/FIND: color; AVOID: n
+  int16_t value;   // FOR/CLIMB/DRIVE: ms; TURN: degrees
+};
+
+class MissionProgram {
+public:
+  /**
+   * Run `section`'s EEPROM program if there is a good one, else `builtin`.
+   * `ops`: the PROGRAM_OP bits of the steps this sketch runs.
+   */
+  void begin(uint8_t section, const uint8_t* builtin, uint8_t length, uint32_t ops) {
+    base_ = section <= 1 ? PROGRAM_BASE : PROGRAM_MORE + (section - 2) * PROGRAM_BYTES;
+    ops_ = ops | PROGRAM_FLOW;
+    builtin_ = builtin;
+    builtinLength_ = length;
+    uint8_t head[3];
+    for (uint8_t i = 0; i < 3; i++) head[i] = EEPROM.read(base_ + i);
+    fromEeprom_ = false;
+    if (head[0] == 'M' && head[1] <= PROGRAM_CODE) {
+      for (uint8_t i = 0; i < head[1]; i++) code_[i] = EEPROM.read(base_ + 3 + i);
+      fromEeprom_ = crc8(code_, head[1]) == head[2] && !check(code_, head[1], ops_);
+    }
+    if (fromEeprom_) length_ = head[1];
+    else use(builtin_, builtinLength_);
+    restart();
+  }
+
+  /** From the first step again. */
+  void restart() {
+    pc_ = resumePc_ = 0;
+    depth_ = 0;
+  }
+
+  /** Carry on from a checkpoint: the step at `pc`, `left` turns to go in its innermost REPEAT. */
+  void resumeAt(uint8_t pc, uint8_t left) {
+    restart();
+    if (pc >= length_) pc = length_;
+    while (pc_ < pc) {   // Rebuild the REPEATs open at `pc`
+      uint8_t op = code_[pc_];
+      if (op == OP_REPEAT && depth_ < PROGRAM_DEPTH) loop_[depth_++] = Loop{(uint8_t)(pc_ + 2), code_[pc_ + 1]};
+      else if (op == OP_END && depth_) depth_--;
+      pc_ += 1 + OP_ARGS[op];
+    }
+    if (depth_ && left) loop_[depth_ - 1].left = left;
+  }
+
+  /** The next step (OP_HALT at the end). */
+  ProgramStep next() {
+    uint32_t start = DWT->CYCCNT;
+    ProgramStep s = {OP_HALT, 0, 0, 0};
+    uint8_t at = flow(code_, length_, pc_, loop_, depth_);
+    if (at < length_) {
+      const uint8_t* p = code_ + at;
+      pc_ = at + 1 + OP_ARGS[p[0]];
+      s.op = (ProgramOp)p[0];
+      switch (s.op) {
+        case OP_FOLLOW: case OP_NEAR: case OP_AVOID: s.line = p[1]; s.arg = p[2]; break;
+        case OP_FOR:    s.line = p[1]; s.value = p[2] | p[3] << 8; break;
+        case OP_BOX:    s.line = p[1]; break;
+        case OP_TURN: case OP_CLIMB: case OP_DRIVE: s.value = (int16_t)(p[1] | p[2] << 8); break;
+        default:        if (OP_ARGS[s.op]) s.arg = p[1]; break;
+      }
+      if (s.op != OP_BRANCH && s.op != OP_PAST) resumePc_ = at;
+      steps_++;
+    } else {
+      pc_ = length_;
+    }
+    uint32_t cycles = DWT->CYCCNT - start;
+    decodeCycles_ += cycles;
+    if (cycles > decodeMax_) decodeMax_ = cycles;
+    return s;
+  }
+
+  /** The op next() will return, without moving on. */
+  ProgramOp peek() const {
+    Loop loops[PROGRAM_DEPTH];
+    memcpy(loops, loop_, sizeof(loops));
+    uint8_t depth = depth_;
+    uint8_t at = flow(code_, length_, pc_, loops, depth);
+    return at < length_ ? (ProgramOp)code_[at] : OP_HALT;
+  }
+
+  /** For the checkpoint: where to resume, and the innermost REPEAT's turns to go. */
+  uint8_t resumePc() const { return resumePc_; }
+  uint8_t loops() const { return depth_ ? loop_[depth_ - 1].left : 0; }
+
+  /** A program loaded over Serial runs, not the built-in route the sketch measured its per-state tables on. */
+  bool loaded() const { return fromEeprom_; }
+
+  /**
+   * Feed it what Serial has (call it while waiting to start). Returns true
+   * once a new program is in and running from its first step.
+   */
+  bool service() {
+    bool loaded = false;
+    while (Serial.available() > 0) {
+      char c = Serial.read();
+      if (c != '\n' && c != '\r') {
+        if (lineLength_ < PROGRAM_LINE) line_[lineLength_] = c;
+        if (lineLength_ <= PROGRAM_LINE) lineLength_++;   // One past: too long
+        continue;
+      }
+      if (lineLength_ > 0 && lineLength_ <= PROGRAM_LINE) loaded |= command(line_, lineLength_);
+      lineLength_ = 0;
+    }
+    return loaded;
+  }
+
+  /**
+   * What's wrong with `code`: an unknown op, one not in `ops` (another
+   * sketch's), operands past the end, unbalanced REPEAT/END or nesting too
+   * deep. nullptr = nothing.
+   */
+  static const __FlashStringHelper* check(const uint8_t* code, uint8_t length, uint32_t ops) {
+    uint8_t depth = 0;
+    for (uint8_t pc = 0; pc < length; pc += 1 + OP_ARGS[code[pc]]) {
+      if (code[pc] >= OP_COUNT) return F("bad_op");
+      if (!(ops & PROGRAM_OP(code[pc]))) return F("wrong_sketch");
+      if (pc + 1 + OP_ARGS[code[pc]] > length) return F("truncated");
+      if (code[pc] == OP_REPEAT && ++depth > PROGRAM_DEPTH) return F("too_deep");
+      if (code[pc] == OP_END && !depth--) return F("unbalanced");
+    }
+    return depth ? F("unbalanced") : nullptr;
+  }
+
+  static uint8_t crc8(const uint8_t* p, uint8_t n) {
+    uint8_t crc = 0xFF;
+    while (n--) {
+      crc ^= *p++;
+      for (uint8_t i = 0; i < 8; i++) crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+    }
+    return crc;
+  }
+
+  void report() const {
+    float cyclesPerUs = SystemCoreClock / 1000000.0f;
+    Serial.print(F("PROG: source="));
+    Serial.print(fromEeprom_ ? F("eeprom") : F("builtin"));
+    Serial.print(F(" bytes="));
+    Serial.print(length_);
+    Serial.print(F(" steps="));
+    Serial.print(steps_);
+    Serial.print(F(" decode_us="));
+    Serial.print(decodeMax_ / cyclesPerUs, 1);
+    Serial.print('/');
+    Serial.println(steps_ ? decodeCycles_ / cyclesPerUs / steps_ : 0.0f, 2);
+  }
+
+private:
+  struct Loop {
+    uint8_t body;    // First byte after the REPEAT
+    uint8_t left;    // Turns to go, this one included
+  };
+
+  void use(const uint8_t* code, uint8_t length) {
+    length_ = length < PROGRAM_CODE ? length : PROGRAM_CODE;
+    memcpy(code_, code, length_);
+  }
+
+  /**
+   * Run REPEAT/END from `pc` on: the pc of the next step (`length` at the
+   * end), with `loops`/`depth` updated.
+   */
+  static uint8_t flow(const uint8_t* code, uint8_t length, uint8_t pc, Loop* loops, uint8_t& depth) {
+    while (pc < length) {
+      uint8_t op = code[pc];
+      if (op == OP_REPEAT) {
+        pc += 2;
+        if (!code[pc - 1]) pc = skipLoop(code, length, pc);
+        else if (depth < PROGRAM_DEPTH) loops[depth++] = Loop{pc, code[pc - 1]};
+      } else if (op == OP_END) {
+        pc++;
+        if (depth && --loops[depth - 1].left) pc = loops[depth - 1].body;
+        else if (depth) depth--;
+      } else {
+        break;
+      }
+    }
+    return pc;
+  }
+
+  /** The pc after the END matching the REPEAT whose body starts at `pc`. */
+  static uint8_t skipLoop(const uint8_t* code, uint8_t length, uint8_t pc) {
+    for (uint8_t depth = 1; pc < length; ) {
+      uint8_t op = code[pc];
+      pc += 1 + OP_ARGS[op];
+      if (op == OP_REPEAT) depth++;
+      else if (op == OP_END && !--depth) break;
+    }
+    return pc;
+  }
+
+  /** One Serial line. Returns true if it loaded a program. */
+  bool command(const char* s, uint16_t n) {
+    if (n < 5 || strncmp(s, "PROG ", 5) != 0) return false;   // Not for us
+    s += 5;
+    n -= 5;
+    if (n == 5 && strncmp(s, "clear", 5) == 0) {
+      EEPROM.update(base_, 0);
+      use(builtin_, builtinLength_);
+      fromEeprom_ = false;
+      restart();
+      Serial.println(F("PROG: cleared"));
+      return true;
+    }
+    uint8_t code[PROGRAM_CODE];
+    uint8_t length = 0;
+    uint16_t i = 0;
+    while (i + 1 < n && s[i] != ' ') {
+      int hi = hexDigit(s[i]), lo = hexDigit(s[i + 1]);
+      if (hi < 0 || lo < 0) return reject(F("bad_hex"));
+      if (length >= PROGRAM_CODE) return reject(F("too_long"));
+      code[length++] = hi << 4 | lo;
+      i += 2;
+    }
+    if (i + 3 != n || s[i] != ' ' || hexDigit(s[i + 1]) < 0 || hexDigit(s[i + 2]) < 0) return reject(F("format"));
+    uint8_t crc = hexDigit(s[i + 1]) << 4 | hexDigit(s[i + 2]);
+    if (crc8(code, length) != crc) return reject(F("crc"));
+    const __FlashStringHelper* wrong = check(code, length, ops_);
+    if (wrong) return reject(wrong);
+
+    // The magic byte last: a reset halfway leaves no program, not half of one
+    EEPROM.update(base_, 0);
+    for (uint8_t k = 0; k < length; k++) EEPROM.update(base_ + 3 + k, code[k]);
+    EEPROM.update(base_ + 1, length);
+    EEPROM.update(base_ + 2, crc);
+    EEPROM.update(base_, 'M');
+    use(code, length);
+    fromEeprom_ = true;
+    restart();
+    Serial.print(F("PROG: loaded bytes="));
+    Serial.print(length);
+    Serial.print(F(" crc="));
+    Serial.println(crc, HEX);
+    return true;
+  }
+
+  static bool reject(const __FlashStringHelper* why) {
+    Serial.print(F("PROG: rejected "));
+    Serial.println(why);
+    return false;
+  }
+
+  static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  uint8_t code_[PROGRAM_CODE];
+  uint8_t length_ = 0;
+  int base_ = PROGRAM_BASE;   // This section's slot
+  uint32_t ops_ = 0;          // The steps this sketch runs (PROGRAM_OP bits)
+  const uint8_t* builtin_ = nullptr;
+  uint8_t builtinLength_ = 0;
+  bool fromEeprom_ = false;
+  uint8_t pc_ = 0;          // Next byte to decode
+  uint8_t resumePc_ = 0;    // The step running now, or the one before it (see RESUMING)
+  Loop loop_[PROGRAM_DEPTH];
+  uint8_t depth_ = 0;
+
+  char line_[PROGRAM_LINE];
+  uint16_t lineLength_ = 0;
+
+  uint16_t steps_ = 0;
+  uint32_t decodeCycles_ = 0, decodeMax_ = 0;
+};
@@ -32,9 +32,20 @@
  *   [FIND RED] → [FOLLOW RED] → [APPROACH BOX] → [PICKUP]
  *                                                    ↓
  *   [COMPLETE] ← [RETURN HOME] ← [DROP] ← [AVOID x2] ← [TO OBSTACLES]
+ *
+ * This is the built-in mission program (see MISSION PROGRAM below): each
+ * step runs as one of these states.
  */
 
 #include <Servo.h>
+#include <FspTimer.h>
+#include "spsc_queue.h"
+#include "event_bus.h"
+#include "checkpoint.h"
+#include "mission_clock.h"
+#include "power_arbiter.h"
+#include "trace.h"
+#include "mission_program.h"
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                           PIN DEFINITIONS                                  ║
@@ -71,6 +82,9 @@
 #define PIN_IR_LEFT       A2
 #define PIN_IR_RIGHT      A3
 
+// --- START BUTTON (optional, to GND; see START_TRIGGER). D0: free, Serial is USB ---
+#define PIN_START         0
+
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                              CONSTANTS                                     ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
@@ -82,7 +96,6 @@
 
 // Distance thresholds (cm)
 #define DIST_OBSTACLE     15   // Detect obstacle ahead
-#define DIST_WALL_HUG     10   // Distance to maintain when hugging wall
 #define DIST_BOX_PICKUP   5    // Distance to grab box
 
 // Color sensor thresholds
@@ -100,6 +113,93 @@
 #define TIME_TURN_90      500
 #define TIME_SERVO_MOVE   300
 
+// Telemetry: print a "T:" line every N loop ticks (0 = off)
+#define TELEMETRY_EVERY   5
+// Spans sent as "TRACE:" lines (see trace.h): states 1, sensors 2,
+// maneuvers 4, servos 8, the loop's idle wait 16
+#define TRACE_MASK        13    // States, maneuvers, servos; 0 = off
+#define STR_(x) #x      // Stringify a #define for the boot banner
+#define STR(x)  STR_(x)
+
+// Control interrupt: a hardware timer updates the motors at a fixed rate
+#define CONTROL_HZ        1000  // 0 = off: motor functions write the pins directly
+#define CONTROL_SLEW      0     // Max PWM change per tick (0 = jump to the target)
+#define CONTROL_REPORT_MS 5000  // Print a "CTRL:" timing line this often (0 = never)
+
+// Checkpoint: every state change goes to EEPROM and a brownout or watchdog
+// reset resumes from it (see checkpoint.h); power-on and the reset button start fresh
+#define CHECKPOINT_RESUME 1     // 0 = never resume
+#define CHECKPOINT_BUDGET_US 20000 // EEPROM writing per loop() tick, at most
+
+// Boot & start: check the parts are ready instead of a fixed delay(1000),
+// then wait for a start cue (see waitForStart())
+#define START_NOW         0     // Go as soon as everything is ready
+#define START_BUTTON      1     // PIN_START pressed
+#define START_WAVE        2     // A hand in front of the ultrasonic, then away
+#define START_LINE        3     // The color sensor sees the line after white (pull a card)
+#define START_TRIGGER     START_WAVE
+#define START_WAVE_CM     10    // Closer than this is a hand
+#define START_HOLD_MS     300   // A cue must last this long
+#define BOOT_SERVO_MS     450   // Worst servo move at power-on (180° at 0.15 s / 60°)
+#define BOOT_TIMEOUT_MS   1000  // Give up waiting for a part after this
+
+// Mission budget: behind the PLAN, line following goes faster and the
+// searches give up sooner (see mission_clock.h)
+#define MISSION_ADAPT     1     // 0 = fixed speeds and search times
+#define MISSION_BUDGET_MS 32000 // This section's share of the competition time
+#define MISSION_RESERVE_MS 2000 // ...minus this, kept back
+#define SPEED_CRUISE_MAX  185   // Fastest line following may go
+#define RED_SEARCH_MS     3000  // FIND_RED: then assume we're on it
+#define BLUE_SEARCH_MS    5000  // FIND_BLUE: then start turning to look
+#define BLACK_SEARCH_MS   5000  // FIND_BLACK: then head home anyway
+#define SEARCH_LEAST_MS   1000  // However late, search at least this long
+#define SEARCH_MOVE_MS    200   // FIND_BLUE's pivots, FIND_BLACK's blind rolls
+
+// Ultrasonic echo (timed by interrupt, see readDistance())
+#define ECHO_TIMEOUT_US   25000  // No echo by then = nothing in range
+#define ECHO_FRESH_MS     150    // Older results make readDistance() wait for a new ping
+
+// Stopping: act on where the robot will be, not where a reading was taken
+// (see MOTION MODEL; the color read takes ~35ms, the wheels coast on)
+#define DRIVE_CM_PER_PWM  0.29  // Wheel cm/s per PWM step above the deadband
+#define DRIVE_DEADBAND    50    // PWM below this doesn't turn the wheels
+#define DRIVE_TAU_MS      80    // Wheel speed lag (time to ~63% of a change)
+#define DRIVE_TRACK_CM    13    // Wheel spacing, for the model's heading
+#define STOP_COMPENSATION 1     // 0 = act on the raw readings
+#define BLUE_ENTRY_CM     8     // Stop this far past the blue edge to drop
+#define RANGE_BLEND       0.5   // Weight of a new echo in the tracked range (1 = no filter)
+#define RANGE_GATE_CM     10    // Echo this far off the track = new object, jump to it
+
+// Box approach: speed proportional to the range still to go
+#define APPROACH_GAIN     10.0  // cm/s per cm to go
+#define APPROACH_MIN_PWM  80    // Floor above DRIVE_DEADBAND so it doesn't stall short
+
+// Box or obstacle? Before pickup, stop at CLASSIFY_RANGE_CM and sweep the
+// ultrasonic across the object (see OBJECT CLASSIFIER)
+#define CLASSIFY_RANGE_CM 20    // Stop this far out to look
+#define SWEEP_DEG         60    // Total sweep, centered on the heading
+#define SPEED_SWEEP       90    // Pivot PWM while sweeping (~100°/s)
+#define SWEEP_PING_MS     10    // At most one ping per 10ms (no stray echoes)
+#define SONAR_BEAM_DEG    24    // The beam's width: added to every object's angle
+#define SONAR_FWD_CM      8     // Ultrasonic ahead of the wheel axle (the pivot)
+#define BOX_WIDTH_CM      6
+#define OBSTACLE_WIDTH_CM 14
+#define BOX_WITHIN_CM     150   // The box is this close to the start of the red line
+
+// Arc turns: a maneuver's corners are driven as arcs at speed, each
+// flowing into the next move, instead of stop-pivot-stop (see ARC TURNS)
+#define ARC_TURNS         1     // 0 = stop, pivot, stop at every corner
+#define ARC_RADIUS_CM     10    // Corner radius, axle center (> DRIVE_TRACK_CM / 2: both wheels forward)
+#define AVOID_SIDE_CM     28    // Pass this far off the line: half the obstacle + body + ARC_RADIUS_CM
+#define AVOID_CLEAR_CM    12    // Turn back this far past the obstacle's far side (body radius + margin)
+
+// Power budget: motors and servos share one battery. The control interrupt
+// keeps what they draw under this (see power_arbiter.h): the motors ramp
+// as fast as it allows, a servo waits or slews slower meanwhile.
+#define POWER_BUDGET_MA   1500  // The battery sags below the board's brownout at ~1.6 A
+#define SERVO_ARM         0     // Arbiter's servo numbers
+#define SERVO_CLAMP       1
+
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                              DATA TYPES                                    ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
@@ -135,30 +235,145 @@ Servo baseServo, clampServo;
 State currentState = STATE_FIND_RED;
 bool holding = false;          // Is robot holding a box?
 uint32_t stateStartTime = 0;
-uint8_t obstacleCount = 0;     // Number of obstacles avoided
+uint8_t obstacleCount = 0;     // Obstacles avoided in this AVOID step
+float redStartCm = 0;          // odometerCm() when the red line was found
+Color lastColor = COLOR_NONE;  // Latest readings (for telemetry)
+float lastDistance = 999.0;
+EventBus<8> bus;               // Sensor edges -> state handlers (see event_bus.h)
+CheckpointStore checkpoint;    // Mission state in EEPROM (see checkpoint.h)
+MissionClock mission;          // Time used vs. the plan (see mission_clock.h)
+PowerArbiter power;            // Moves the servos, caps the motors (see power_arbiter.h)
+Tracer trace;                  // Spans of the run, sent as TRACE: lines (see trace.h)
+MissionProgram program;        // The route, step by step (see mission_program.h)
+ProgramStep programStep;       // The step running now
+bool adapting = false;         // MISSION_ADAPT on the built-in route (set in setup())
+uint32_t searchMoveAt = 0;     // millis() when the running search move began
+bool searchMoving = false;     // A search move is running (see searchMove())
+bool searchMoveStops = false;  // ...and stops the motors when it ends
+
+// Trace ids (named in setup()): a state's span is TRACE_STATE + its State
+enum TraceId : uint8_t {
+  TRACE_STATE = 0,
+  TRACE_COLOR = 16, TRACE_ECHO,
+  TRACE_STOP_PAST = 24, TRACE_PICKUP, TRACE_DROP, TRACE_SWEEP, TRACE_CLASSIFY,
+  TRACE_ARC, TRACE_DRIVE, TRACE_CORNER, TRACE_AVOID,
+  TRACE_SERVO_WAIT = 40,
+  TRACE_IDLE = 48
+};
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                          SENSOR FUNCTIONS                                  ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
 
-/**
- * Read distance from ultrasonic sensor (in cm)
- */
-float readDistance() {
+// Sensor events: interrupts push, loop() pops (no locking, see spsc_queue.h)
+enum EventKind : uint8_t { EV_ECHO_RISE, EV_ECHO_FALL };
+struct SensorEvent {
+  uint32_t us;       // micros() at the edge
+  EventKind kind;
+};
+SpscQueue<SensorEvent, 16> sensorEvents;
+
+bool echoByInterrupt = false;   // false: the echo pin has no interrupt, use pulseIn()
+bool pingInFlight = false, echoStarted = false;
+uint32_t pingSentUs = 0, echoRiseUs = 0;
+uint32_t resultPingUs = 0;      // When the ping behind echoDistance was sent
+float echoDistance = 999.0;
+uint32_t distanceAtUs = 0;      // When the sound reached what echoDistance measured
+uint32_t colorAtUs = 0;         // Middle of the latest readColor()
+
+/** Interrupt on both echo edges: just timestamp and queue. */
+void echoEdge() {
+  SensorEvent e = {(uint32_t)micros(), digitalRead(PIN_ULTRA_ECHO) == HIGH ? EV_ECHO_RISE : EV_ECHO_FALL};
+  sensorEvents.push(e);   // Full: dropped and counted
+}
+
+void sendPing() {
   digitalWrite(PIN_ULTRA_TRIG, LOW);
   delayMicroseconds(2);
   digitalWrite(PIN_ULTRA_TRIG, HIGH);
   delayMicroseconds(10);
   digitalWrite(PIN_ULTRA_TRIG, LOW);
-  
-  unsigned long duration = pulseIn(PIN_ULTRA_ECHO, HIGH, 25000);
-  return duration == 0 ? 999.0 : (duration * 0.034) / 2.0;
+  pingSentUs = micros();
+  pingInFlight = true;
+  echoStarted = false;
+}
+
+/** Turn queued echo edges into a distance; give up on a ping after ECHO_TIMEOUT_US. */
+void serviceEcho() {
+  SensorEvent e;
+  while (sensorEvents.pop(e)) {
+    if (e.kind == EV_ECHO_RISE) {
+      echoRiseUs = e.us;
+      echoStarted = true;
+    } else if (pingInFlight && echoStarted) {
+      echoDistance = ((e.us - echoRiseUs) * 0.034) / 2.0;
+      distanceAtUs = echoRiseUs + (e.us - echoRiseUs) / 2;
+      resultPingUs = pingSentUs;
+      pingInFlight = false;
+      trace.complete(TRACE_ECHO, pingSentUs, e.us, echoDistance);
+    }
+  }
+  if (pingInFlight && micros() - pingSentUs > ECHO_TIMEOUT_US) {
+    echoDistance = 999.0;
+    distanceAtUs = pingSentUs;
+    resultPingUs = pingSentUs;
+    pingInFlight = false;
+    trace.complete(TRACE_ECHO, pingSentUs, pingSentUs + ECHO_TIMEOUT_US, 999);
+  }
+}
+
+/** Attach the echo interrupt, then check a ping really produces an edge. */
+void startEcho() {
+  attachInterrupt(digitalPinToInterrupt(PIN_ULTRA_ECHO), echoEdge, CHANGE);
+  sendPing();
+  delay(5);
+  echoByInterrupt = !sensorEvents.empty();
+  if (!echoByInterrupt) {
+    detachInterrupt(digitalPinToInterrupt(PIN_ULTRA_ECHO));
+    Serial.println(F("ECHO: no interrupt on the echo pin, using pulseIn()"));
+  }
+}
+
+/**
+ * Read distance from ultrasonic sensor (in cm). Returns the previous
+ * ping's result and sends the next one; only waits when that result is
+ * older than ECHO_FRESH_MS (first call, after a long maneuver).
+ * distanceAtUs = when that distance was true.
+ */
+float readDistance() {
+  if (!echoByInterrupt) {
+    sendPing();
+    unsigned long duration = pulseIn(PIN_ULTRA_ECHO, HIGH, ECHO_TIMEOUT_US);
+    distanceAtUs = micros() - duration / 2;
+    float cm = duration == 0 ? 999.0 : (duration * 0.034) / 2.0;
+    trace.complete(TRACE_ECHO, pingSentUs, micros(), cm);
+    return cm;
+  }
+  serviceEcho();
+  bool stale = micros() - resultPingUs > ECHO_FRESH_MS * 1000UL;
+  if (!pingInFlight && digitalRead(PIN_ULTRA_ECHO) == LOW) sendPing();
+  while (stale && pingInFlight) serviceEcho();
+  return echoDistance;
+}
+
+/** QUEUE: sensor peak=<most waiting>/<capacity> overflows=<dropped events> */
+void reportSensorQueue() {
+  Serial.print(F("QUEUE: sensor peak="));
+  Serial.print(sensorEvents.peak());
+  Serial.print('/');
+  Serial.print(sensorEvents.capacity());
+  Serial.print(F(" overflows="));
+  Serial.println(sensorEvents.overflows());
 }
 
 /**
- * Read color from TCS3200 sensor
+ * Read color from TCS3200 sensor. The three reads take ~35ms on the move;
+ * colorAtUs = their middle.
  */
 Color readColor() {
+  TraceSpan span(trace, TRACE_COLOR);
+  uint32_t startUs = micros();
+  
   // Read RED
   digitalWrite(PIN_COLOR_S2, LOW);
   digitalWrite(PIN_COLOR_S3, LOW);
@@ -176,6 +391,7 @@ Color readColor() {
   digitalWrite(PIN_COLOR_S3, HIGH);
   delay(10);
   uint16_t b = pulseIn(PIN_COLOR_OUT, LOW, 40000);
+  colorAtUs = startUs + (micros() - startUs) / 2;
   
   // Handle timeouts
   if (r == 0) r = 999;
@@ -204,191 +420,731 @@ void readIR(bool& left, bool& right) {
   right = (digitalRead(PIN_IR_RIGHT) == LOW);
 }
 
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                         CONTROL INTERRUPT                                  ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+FspTimer controlTimer;
+volatile bool controlRunning = false;
+volatile int16_t targetLeft = 0, targetRight = 0;   // Signed PWM: < 0 = backward
+int16_t outLeft = 0, outRight = 0;                  // What the pins are at (ISR only, once it runs)
+volatile uint8_t lineSpeed = 0;                     // > 0: the ISR follows the black line (IR)
+
+struct ControlStats {            // CPU cycles; written by the ISR, read by reportControl()
+  uint32_t ticks, late;
+  uint32_t periodMin, periodMax, periodSum;
+  uint32_t execMax, execSum;
+};
+const ControlStats CONTROL_STATS_EMPTY = {0, 0, UINT32_MAX, 0, 0, 0, 0};
+ControlStats ctrlStats = CONTROL_STATS_EMPTY;
+uint32_t ctrlLastStart = 0;
+uint32_t ctrlNominal = 0;        // Cycles per tick
+
+/** Writes the pins. Only controlTick() calls this once the timer runs. */
+void applyMotors(int16_t left, int16_t right) {
+  digitalWrite(PIN_MOTOR_IN1, left >= 0 ? HIGH : LOW);   // LEFT direction
+  digitalWrite(PIN_MOTOR_IN2, left >= 0 ? LOW : HIGH);
+  digitalWrite(PIN_MOTOR_IN3, right >= 0 ? HIGH : LOW);  // RIGHT direction
+  digitalWrite(PIN_MOTOR_IN4, right >= 0 ? LOW : HIGH);
+  analogWrite(PIN_MOTOR_ENA, abs(left));
+  analogWrite(PIN_MOTOR_ENB, abs(right));
+}
+
+int16_t slewToward(int16_t from, int16_t to) {
+  if (CONTROL_SLEW == 0) return to;
+  if (to > from + CONTROL_SLEW) return from + CONTROL_SLEW;
+  if (to < from - CONTROL_SLEW) return from - CONTROL_SLEW;
+  return to;
+}
+
+/**
+ * MOTION MODEL: no encoders, so the odometer integrates what the motors
+ * were told. Each wheel follows its PWM (less the deadband, right wheel
+ * divided by SPEED_COMPENSATION) with a DRIVE_TAU_MS lag; the odometer
+ * adds up their average and the heading their difference. A short
+ * history lets travelledSince() answer "how far since micros() was X"
+ * for the sensors' timestamps.
+ */
+#define ODO_HISTORY       64   // Samples kept...
+#define ODO_EVERY_TICKS   4    // ...one every 4 control ticks (256ms at 1 kHz)
+#define ODO_SPARE         2    // Oldest samples travelledSince() skips (the ISR may be writing them)
+
+struct OdoSample {
+  uint32_t us;
+  float cm;
+};
+OdoSample odoHistory[ODO_HISTORY];
+uint8_t odoNewest = 0, odoTicks = 0;
+volatile float odometer = 0;     // cm forward (model)
+volatile float modelSpeed = 0;   // cm/s now (model)
+volatile float wheelLeft = 0, wheelRight = 0;   // cm/s per wheel (model)
+volatile float modelHeading = 0; // Degrees turned, counterclockwise (model)
+uint32_t modelUpdatedUs = 0;     // Without the timer: when loop() last stepped it
+
+float wheelModelSpeed(float pwm) {
+  float over = (pwm < 0 ? -pwm : pwm) - DRIVE_DEADBAND;
+  if (over <= 0) return 0;
+  return (pwm < 0 ? -over : over) * DRIVE_CM_PER_PWM;
+}
+
+void stepModel(int16_t left, int16_t right, float dt, uint32_t nowUs) {
+  float lag = dt / (DRIVE_TAU_MS / 1000.0f + dt);
+  wheelLeft += (wheelModelSpeed(left) - wheelLeft) * lag;
+  wheelRight += (wheelModelSpeed(right / SPEED_COMPENSATION) - wheelRight) * lag;
+  modelSpeed = (wheelLeft + wheelRight) / 2;
+  odometer += modelSpeed * dt;
+  modelHeading += (wheelRight - wheelLeft) / DRIVE_TRACK_CM * dt * 57.2958f;   // rad -> deg
+  if (++odoTicks < ODO_EVERY_TICKS && controlRunning) return;
+  odoTicks = 0;
+  odoNewest = (odoNewest + 1) % ODO_HISTORY;
+  odoHistory[odoNewest].us = nowUs;
+  odoHistory[odoNewest].cm = odometer;
+}
+
+/**
+ * Line following at the control rate: same rules as followBlackLine(),
+ * on IR readings taken this tick.
+ */
+void lineTargets(uint8_t speed, int16_t& left, int16_t& right) {
+  bool onLeft, onRight;
+  readIR(onLeft, onRight);
+  if (onLeft == onRight) speed = onLeft ? speed : SPEED_SLOW;   // Both on: straight; both off: creep
+  left = onLeft && !onRight ? speed / 2 : speed;
+  right = (uint8_t)((!onLeft && onRight ? speed / 2 : speed) * SPEED_COMPENSATION);
+}
+
+/**
+ * Timer interrupt: move the outputs toward the targets (within the power
+ * budget), step the servos and time itself.
+ * Must stay short; it runs CONTROL_HZ times a second whatever loop() does.
+ */
+void controlTick(timer_callback_args_t*) {
+  uint32_t start = DWT->CYCCNT;
+  ControlStats& s = ctrlStats;
+  if (s.ticks++ > 0) {   // The first tick of a window has no period yet
+    uint32_t period = start - ctrlLastStart;
+    if (period < s.periodMin) s.periodMin = period;
+    if (period > s.periodMax) s.periodMax = period;
+    if (period > ctrlNominal + ctrlNominal / 2) s.late++;
+    s.periodSum += period;
+  }
+  ctrlLastStart = start;
+
+  int16_t wantLeft = targetLeft, wantRight = targetRight;
+  if (lineSpeed) lineTargets(lineSpeed, wantLeft, wantRight);   // Latest IR, every tick
+  int16_t left = slewToward(outLeft, wantLeft);
+  int16_t right = slewToward(outRight, wantRight);
+  power.tick(left, right);   // Under POWER_BUDGET_MA; steps the servos
+  if (left != outLeft || right != outRight) {
+    applyMotors(left, right);
+    outLeft = left;
+    outRight = right;
+  }
+  stepModel(outLeft, outRight, 1.0f / CONTROL_HZ, micros());
+
+  uint32_t exec = DWT->CYCCNT - start;
+  s.execSum += exec;
+  if (exec > s.execMax) s.execMax = exec;
+}
+
+/** Model odometer now (without the timer, loop() steps the model here). */
+float odometerCm() {
+  if (!controlRunning) {
+    uint32_t now = micros();
+    stepModel(outLeft, outRight, (now - modelUpdatedUs) / 1000000.0f, now);
+    modelUpdatedUs = now;
+  }
+  return odometer;   // One 32-bit read: the ISR can't tear it
+}
+
+/** cm driven since micros() was `us` (interpolated from the history). */
+float travelledSince(uint32_t us) {
+  float now = odometerCm();
+  OdoSample newer = {(uint32_t)micros(), now};
+  OdoSample s = newer;
+  noInterrupts();   // The ISR writes the history: only the copies are guarded
+  uint8_t i = odoNewest;
+  interrupts();
+  // Newest to oldest. The ISR only overwrites the slots after odoNewest,
+  // the oldest, so the last ODO_SPARE are left alone
+  for (uint8_t n = 0; n < ODO_HISTORY - ODO_SPARE; n++) {
+    newer = s;
+    noInterrupts();
+    s = odoHistory[i];
+    interrupts();
+    if ((int32_t)(s.us - us) <= 0) break;
+    i = (i + ODO_HISTORY - 1) % ODO_HISTORY;
+  }
+  if ((int32_t)(s.us - us) > 0) return now - s.cm;   // Older than the history: the oldest we have
+  // us is between s and the newer sample: interpolate
+  uint32_t span = newer.us - s.us;
+  float then = span ? s.cm + (newer.cm - s.cm) * (us - s.us) / span : s.cm;
+  return now - then;
+}
+
+/** How far we'd still roll after stopping now (speed x lag). */
+float coastCm() {
+  float v = modelSpeed;
+  return v > 0 ? v * DRIVE_TAU_MS / 1000.0f : 0;
+}
+
+/**
+ * Range to what's ahead as of now: the odometer moves it between echoes,
+ * each new echo (moved to now too) is blended in by RANGE_BLEND, and one
+ * more than RANGE_GATE_CM off restarts it. Pass every readDistance().
+ */
+float trackedRange = 999.0, trackedOdo = 0;
+uint32_t trackedAtUs = 0;        // distanceAtUs of the last echo blended in
+
+float trackRange(float dist) {
+  float odo = odometerCm();
+  if (trackedRange < 999.0) trackedRange -= odo - trackedOdo;
+  trackedOdo = odo;
+  if (distanceAtUs == trackedAtUs) return trackedRange;   // No new echo
+  trackedAtUs = distanceAtUs;
+  float now = dist >= 999.0 ? 999.0 : dist - travelledSince(distanceAtUs);
+  if (now >= 999.0 || trackedRange >= 999.0 || fabs(now - trackedRange) > RANGE_GATE_CM) trackedRange = now;
+  else trackedRange += RANGE_BLEND * (now - trackedRange);
+  return trackedRange;
+}
+
+/** The range readDistance() would give once stopped, if we stopped now. */
+float rangeAtStop(float dist) {
+  if (!STOP_COMPENSATION) return dist;
+  float range = trackRange(dist);
+  if (range >= 999.0) return range;
+  float ahead = range - coastCm();
+  return ahead > 0.1 ? ahead : 0.1;   // Already past: still "below" (0 = no reading)
+}
+
+uint32_t firstMotionMs = 0;      // millis() of the first drive command (see reportBoot())
+
+/** What the motor functions call: targets for the next tick. */
+void setDrive(int16_t left, int16_t right) {
+  if (!firstMotionMs && (left || right)) firstMotionMs = millis();
+  lineSpeed = 0;    // Any other motion command ends line following
+  if (!controlRunning) {
+    odometerCm();   // Catch the model up at the old outputs first
+    applyMotors(left, right);
+    outLeft = left;
+    outRight = right;
+    return;
+  }
+  noInterrupts();   // Both sides change on the same tick
+  targetLeft = left;
+  targetRight = right;
+  interrupts();
+}
+
+/** Start the timer (call after the motors are stopped and PWM is set up). */
+void startControl() {
+  if (CONTROL_HZ == 0) return;
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;   // CPU cycle counter for the timing stats
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  ctrlNominal = SystemCoreClock / CONTROL_HZ;
+
+  uint8_t type;
+  int8_t channel = FspTimer::get_available_timer(type);
+  if (channel < 0 || !controlTimer.begin(TIMER_MODE_PERIODIC, type, channel, CONTROL_HZ, 0.0f, controlTick) ||
+      !controlTimer.setup_overflow_irq() || !controlTimer.open() || !controlTimer.start()) {
+    Serial.println(F("CTRL: no free timer, motors updated from loop()"));
+    return;
+  }
+  controlRunning = true;
+}
+
+/**
+ * CTRL: hz=1000 ticks=5000 period_us=min/avg/max jitter_us=.. exec_us=avg/max late=..
+ * Stats since the previous report. late = ticks more than 1.5 periods apart.
+ */
+void reportControl() {
+  if (!controlRunning) return;
+  noInterrupts();
+  ControlStats s = ctrlStats;
+  ctrlStats = CONTROL_STATS_EMPTY;
+  interrupts();
+  if (s.ticks < 2) return;
+
+  float cyclesPerUs = SystemCoreClock / 1000000.0f;
+  float nominal = 1000000.0f / CONTROL_HZ;
+  float lo = s.periodMin / cyclesPerUs, hi = s.periodMax / cyclesPerUs;
+  Serial.print(F("CTRL: hz="));
+  Serial.print(CONTROL_HZ);
+  Serial.print(F(" ticks="));
+  Serial.print(s.ticks);
+  Serial.print(F(" period_us="));
+  Serial.print(lo, 1);
+  Serial.print('/');
+  Serial.print(s.periodSum / cyclesPerUs / (s.ticks - 1), 1);
+  Serial.print('/');
+  Serial.print(hi, 1);
+  Serial.print(F(" jitter_us="));
+  Serial.print(hi - nominal > nominal - lo ? hi - nominal : nominal - lo, 1);
+  Serial.print(F(" exec_us="));
+  Serial.print(s.execSum / cyclesPerUs / s.ticks, 1);
+  Serial.print('/');
+  Serial.print(s.execMax / cyclesPerUs, 1);
+  Serial.print(F(" late="));
+  Serial.println(s.late);
+}
+
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                          MOTOR FUNCTIONS                                   ║
 // ║              Motor A = LEFT wheel, Motor B = RIGHT wheel                  ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
 
 void stopMotors() {
-  analogWrite(PIN_MOTOR_ENA, 0);
-  analogWrite(PIN_MOTOR_ENB, 0);
+  setDrive(0, 0);
 }
 
 void moveForward(uint8_t speed) {
-  digitalWrite(PIN_MOTOR_IN1, HIGH);  // LEFT forward
-  digitalWrite(PIN_MOTOR_IN2, LOW);
-  digitalWrite(PIN_MOTOR_IN3, HIGH);  // RIGHT forward
-  digitalWrite(PIN_MOTOR_IN4, LOW);
-  analogWrite(PIN_MOTOR_ENA, speed);
-  analogWrite(PIN_MOTOR_ENB, (uint8_t)(speed * SPEED_COMPENSATION));
+  setDrive(speed, (uint8_t)(speed * SPEED_COMPENSATION));
 }
 
 void turnLeft(uint8_t speed) {
-  digitalWrite(PIN_MOTOR_IN1, LOW);   // LEFT backward
-  digitalWrite(PIN_MOTOR_IN2, HIGH);
-  digitalWrite(PIN_MOTOR_IN3, HIGH);  // RIGHT forward
-  digitalWrite(PIN_MOTOR_IN4, LOW);
-  analogWrite(PIN_MOTOR_ENA, speed);
-  analogWrite(PIN_MOTOR_ENB, (uint8_t)(speed * SPEED_COMPENSATION));
+  setDrive(-speed, (uint8_t)(speed * SPEED_COMPENSATION));   // LEFT backward, RIGHT forward
 }
 
 void turnRight(uint8_t speed) {
-  digitalWrite(PIN_MOTOR_IN1, HIGH);  // LEFT forward
-  digitalWrite(PIN_MOTOR_IN2, LOW);
-  digitalWrite(PIN_MOTOR_IN3, LOW);   // RIGHT backward
-  digitalWrite(PIN_MOTOR_IN4, HIGH);
-  analogWrite(PIN_MOTOR_ENA, speed);
-  analogWrite(PIN_MOTOR_ENB, (uint8_t)(speed * SPEED_COMPENSATION));
+  setDrive(speed, -(uint8_t)(speed * SPEED_COMPENSATION));   // LEFT forward, RIGHT backward
 }
 
 void curveLeft(uint8_t speed) {
-  digitalWrite(PIN_MOTOR_IN1, HIGH);
-  digitalWrite(PIN_MOTOR_IN2, LOW);
-  digitalWrite(PIN_MOTOR_IN3, HIGH);
-  digitalWrite(PIN_MOTOR_IN4, LOW);
-  analogWrite(PIN_MOTOR_ENA, speed / 2);                             // LEFT half
-  analogWrite(PIN_MOTOR_ENB, (uint8_t)(speed * SPEED_COMPENSATION)); // RIGHT full
+  setDrive(speed / 2, (uint8_t)(speed * SPEED_COMPENSATION));     // LEFT half
 }
 
 void curveRight(uint8_t speed) {
-  digitalWrite(PIN_MOTOR_IN1, HIGH);
-  digitalWrite(PIN_MOTOR_IN2, LOW);
-  digitalWrite(PIN_MOTOR_IN3, HIGH);
-  digitalWrite(PIN_MOTOR_IN4, LOW);
-  analogWrite(PIN_MOTOR_ENA, speed);                                         // LEFT full
-  analogWrite(PIN_MOTOR_ENB, (uint8_t)((speed / 2) * SPEED_COMPENSATION));   // RIGHT half
+  setDrive(speed, (uint8_t)((speed / 2) * SPEED_COMPENSATION));   // RIGHT half
+}
+
+/** PWM to close in on something `ahead` cm off (rangeAtStop()) and stop `target` short. */
+uint8_t approachSpeed(float ahead, float target) {
+  float pwm = DRIVE_DEADBAND + APPROACH_GAIN * (ahead - target) / DRIVE_CM_PER_PWM;
+  return (uint8_t)constrain(pwm, APPROACH_MIN_PWM, SPEED_NORMAL);
+}
+
+/** Creep on and come to rest `cm` past where we were at micros() == atUs (2s max). */
+void stopPast(uint32_t atUs, float cm) {
+  TraceSpan span(trace, TRACE_STOP_PAST);
+  uint32_t start = millis();
+  float from = odometerCm() - travelledSince(atUs);   // atUs drops out of the history soon
+  moveForward(SPEED_SLOW);
+  while (odometerCm() - from + coastCm() < cm && millis() - start < 2000) {
+    delay(1);
+  }
+  stopMotors();
 }
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                          SERVO FUNCTIONS                                   ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
 
+/**
+ * Wait for the servos to get there: as long as the arbiter needs, `ms` at
+ * least without the control timer, 3 x `ms` at most.
+ */
+void awaitServos(uint32_t ms) {
+  TraceSpan span(trace, TRACE_SERVO_WAIT);
+  uint32_t start = millis();
+  while (power.servosMoving() && millis() - start < 3 * ms) delay(5);
+  if (!controlRunning && millis() - start < ms) delay(ms - (millis() - start));
+}
+
 /**
  * Pick up a box: lower arm, close claw, raise arm
  */
 void pickup() {
-  baseServo.write(SERVO_ARM_DOWN);
-  delay(TIME_SERVO_MOVE + 200);
-  clampServo.write(SERVO_CLAMP_CLOSED);
-  delay(TIME_SERVO_MOVE);
-  baseServo.write(SERVO_ARM_CARRY);
-  delay(TIME_SERVO_MOVE);
+  TraceSpan span(trace, TRACE_PICKUP);
+  power.moveServo(SERVO_ARM, SERVO_ARM_DOWN);
+  awaitServos(TIME_SERVO_MOVE + 200);
+  power.moveServo(SERVO_CLAMP, SERVO_CLAMP_CLOSED);
+  awaitServos(TIME_SERVO_MOVE);
+  power.moveServo(SERVO_ARM, SERVO_ARM_CARRY);
+  awaitServos(TIME_SERVO_MOVE);
   holding = true;
+  bus.publish(EVT_SERVO_ARRIVED, SERVO_ARM_CARRY);
 }
 
 /**
  * Drop a box: lower arm, open claw, raise arm
  */
 void drop() {
-  baseServo.write(SERVO_ARM_DOWN);
-  delay(TIME_SERVO_MOVE + 200);
-  clampServo.write(SERVO_CLAMP_OPEN);
-  delay(TIME_SERVO_MOVE);
-  baseServo.write(SERVO_ARM_CARRY);
-  delay(TIME_SERVO_MOVE);
+  TraceSpan span(trace, TRACE_DROP);
+  power.moveServo(SERVO_ARM, SERVO_ARM_DOWN);
+  awaitServos(TIME_SERVO_MOVE + 200);
+  power.moveServo(SERVO_CLAMP, SERVO_CLAMP_OPEN);
+  awaitServos(TIME_SERVO_MOVE);
+  power.moveServo(SERVO_ARM, SERVO_ARM_CARRY);
+  awaitServos(TIME_SERVO_MOVE);
   holding = false;
+  bus.publish(EVT_SERVO_ARRIVED, SERVO_ARM_CARRY);
 }
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
-// ║                        OBSTACLE AVOIDANCE                                  ║
+// ║                         OBJECT CLASSIFIER                                  ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
 
-/**
- * Avoid an obstacle by going around it to the right.
+/*
+ * Something is ahead: is it the box, or an obstacle to drive around?
+ * Grabbing at an obstacle costs seconds, so before pickup we stop and
+ * look, and weigh three things in log-odds (> 0 = box):
  * 
- * MANEUVER:
- *   1. Turn right 90°
- *   2. Move forward (alongside obstacle)
- *   3. Turn left 90°
- *   4. Move forward while hugging wall
- *   5. Turn left 90° (past obstacle)
- *   6. Move forward (clear of obstacle)
- *   7. Turn right 90° (resume original direction)
+ *   width   Sweep the ultrasonic across it: the angle it fills, less the
+ *           beam's own width, at its range, gives its width. Near
+ *           BOX_WIDTH_CM votes box, near OBSTACLE_WIDTH_CM obstacle.
+ *   edges   A box or block has a clean jump to the background on both
+ *           sides. No edge inside the sweep = wider than we can see.
+ *   course  Where we are: before pickup and near the start of the red
+ *           line, a box is likely; once holding one, everything is an
+ *           obstacle.
+ * 
+ * There is no color evidence: the color sensor looks down at the floor
+ * behind the ultrasonic and never sees the object.
  */
-void avoidObstacle() {
-  Serial.println(F(">>> AVOIDING OBSTACLE <<<"));
+enum ObjectClass : uint8_t { OBJ_BOX, OBJ_OBSTACLE };
+
+struct ObjectView {
+  ObjectClass kind;
+  float confidence;   // 0.5-1: how sure, for the class given
+  float widthCm;
+  float rangeCm;
+  uint8_t edges;      // Clean edges seen (0-2)
+};
+
+#define SWEEP_SAMPLES 96
+
+// Turning rate now, deg/s counterclockwise (model)
+float turnRate() {
+  return (wheelRight - wheelLeft) / DRIVE_TRACK_CM * 57.2958f;
+}
+
+/**
+ * Pivot until the model heading will come to rest at `toDeg` (the turn
+ * coasts on by turnRate() * tau, like coastCm()). With `angles`, ping on
+ * the way, coast included, and record each reading at the heading it was
+ * taken.
+ */
+uint8_t sweepTo(float toDeg, float* angles, float* ranges) {
+  TraceSpan span(trace, TRACE_SWEEP);
+  bool left = toDeg > modelHeading;
+  if (left) turnLeft(SPEED_SWEEP);
+  else turnRight(SPEED_SWEEP);
+  uint8_t n = 0;
+  bool turning = true;
+  uint32_t lastPing = 0, start = millis();
+  for (;;) {
+    odometerCm();   // Steps the model when the control timer isn't running
+    float rest = modelHeading + turnRate() * DRIVE_TAU_MS / 1000.0f;
+    if (turning && ((left ? rest >= toDeg : rest <= toDeg) || millis() - start > 2000)) {
+      stopMotors();
+      turning = false;
+    }
+    if (!turning && (!angles || fabs(turnRate()) < 5)) break;
+    if (!angles || millis() - lastPing < SWEEP_PING_MS) continue;
+    lastPing = millis();
+    uint32_t before = distanceAtUs;
+    float d = readDistance();
+    if (distanceAtUs == before || n >= SWEEP_SAMPLES) continue;
+    angles[n] = modelHeading - turnRate() * (micros() - distanceAtUs) / 1000000.0f;
+    ranges[n++] = d;
+  }
+  return n;
+}
+
+// ln(p / (1 - p)) -> p
+float fromLogOdds(float l) {
+  return 1.0 / (1.0 + exp(-l));
+}
+
+/** Stop, sweep, and say what's ahead (prints a CLASS: line). */
+ObjectView classifyObject() {
+  TraceSpan span(trace, TRACE_CLASSIFY);
+  float angles[SWEEP_SAMPLES], ranges[SWEEP_SAMPLES];
   stopMotors();
-  delay(100);
+  delay(150);   // Stand still before turning
+  float center = modelHeading;
+  sweepTo(center + SWEEP_DEG / 2, nullptr, nullptr);
+  uint8_t n = sweepTo(center - SWEEP_DEG / 2, angles, ranges);
+  sweepTo(center, nullptr, nullptr);
+  delay(DRIVE_TAU_MS * 3);   // Come to rest facing it
   
-  // Step 1: Turn right 90°
-  turnRight(SPEED_TURN);
-  delay(TIME_TURN_90);
-  stopMotors();
-  delay(100);
+  // The object = the nearest reading and its neighbors within 5cm of it
+  uint8_t nearest = 0;
+  for (uint8_t i = 1; i < n; i++) if (ranges[i] < ranges[nearest]) nearest = i;
+  float r0 = n ? ranges[nearest] : 999.0;
+  uint8_t first = nearest, last = nearest;
+  while (first > 0 && ranges[first - 1] < r0 + 5) first--;
+  while (last + 1 < n && ranges[last + 1] < r0 + 5) last++;
   
-  // Step 2: Move forward alongside obstacle
-  moveForward(SPEED_NORMAL);
-  delay(800);
+  ObjectView v;
+  v.rangeCm = r0;
+  v.edges = (first > 0 && ranges[first - 1] > r0 + 10) + (last + 1 < n && ranges[last + 1] > r0 + 10);
+  // We pivot on the axle, SONAR_FWD_CM behind the ultrasonic: the beam's
+  // edge touches the object first, so take its half-width off each side.
+  // A clean edge lies between its last reading on and first reading off.
+  float left = first > 0 && ranges[first - 1] > r0 + 10 ? (angles[first - 1] + angles[first]) / 2 : angles[first];
+  float right = last + 1 < n && ranges[last + 1] > r0 + 10 ? (angles[last] + angles[last + 1]) / 2 : angles[last];
+  float half = n ? (left - right) / 2 / 57.2958f : 0;   // Sweeping right: angles fall
+  v.widthCm = 2 * ((r0 + SONAR_FWD_CM) * tan(half) - r0 * tan(SONAR_BEAM_DEG / 2 / 57.2958f));
+  if (v.widthCm < 0) v.widthCm = 0;
   
-  // Step 3: Turn left 90°
-  turnLeft(SPEED_TURN);
-  delay(TIME_TURN_90);
-  stopMotors();
-  delay(100);
+  // Width: Gaussian around each nominal (sd 2cm), as a log-likelihood ratio
+  float dBox = v.widthCm - BOX_WIDTH_CM, dObs = v.widthCm - OBSTACLE_WIDTH_CM;
+  float width = constrain((dObs * dObs - dBox * dBox) / (2 * 2 * 2), -4, 4);
+  float edges = -2.0 * (2 - v.edges);
+  float course = holding ? -3.0 : (odometerCm() - redStartCm < BOX_WITHIN_CM ? 1.0 : -0.5);
+  float p = fromLogOdds(width + edges + course);
+  if (n == 0 || r0 >= 999.0) p = fromLogOdds(course);   // Saw nothing: only the course
+  v.kind = p >= 0.5 ? OBJ_BOX : OBJ_OBSTACLE;
+  v.confidence = p >= 0.5 ? p : 1 - p;
   
-  // Step 4: Wall hug - move forward while maintaining distance
-  for (int i = 0; i < 20; i++) {
-    float d = readDistance();
-    if (d < DIST_WALL_HUG - 3) {
-      curveRight(SPEED_NORMAL);  // Too close, veer away
-    } else if (d < DIST_WALL_HUG + 5) {
-      moveForward(SPEED_NORMAL); // Good distance
-    } else {
-      break;  // Clear of obstacle
+  Serial.print(F("CLASS: "));
+  Serial.print(v.kind == OBJ_BOX ? F("BOX") : F("OBSTACLE"));
+  Serial.print(F(" conf="));
+  Serial.print(v.confidence, 2);
+  Serial.print(F(" width_cm="));
+  Serial.print(v.widthCm, 1);
+  Serial.print(F(" range_cm="));
+  Serial.print(r0, 1);
+  Serial.print(F(" edges="));
+  Serial.print(v.edges);
+  Serial.print(F(" samples="));
+  Serial.println(n);
+  return v;
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                             ARC TURNS                                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/**
+ * A pivot stops, turns in place and stops again: three times the wheels
+ * spin up and coast down. An arc keeps the axle moving at `speed` along a
+ * circle of radius R, the wheels at the differential-drive speeds
+ *
+ *   v_outer = v (R + T/2) / R      v_inner = v (R - T/2) / R
+ *
+ * (T = DRIVE_TRACK_CM), turned back into PWM by the motion model. Like
+ * sweepTo() it ends on the model heading, cut turnRate() x tau early: the
+ * wheels take that long to even out whether the next command is a stop
+ * or a straight, so the next move can start without stopping first.
+ */
+
+// Wheel speed (cm/s) -> PWM: wheelModelSpeed() backwards
+int16_t wheelPwm(float cmPerS) {
+  if (fabs(cmPerS) < 0.01) return 0;
+  float pwm = DRIVE_DEADBAND + fabs(cmPerS) / DRIVE_CM_PER_PWM;
+  if (pwm > 255) pwm = 255;
+  return cmPerS < 0 ? -(int16_t)pwm : (int16_t)pwm;
+}
+
+/**
+ * Turn until the model heading will come to rest at `heading`, on an arc
+ * of `radiusCm` (0 = pivot) with the axle at `speed`. Returns still turning:
+ * the caller stops or drives on.
+ */
+void arcTo(float heading, float radiusCm, uint8_t speed) {
+  TraceSpan span(trace, TRACE_ARC);
+  bool left = heading > modelHeading;
+  if (radiusCm <= 0) {
+    if (left) turnLeft(speed);
+    else turnRight(speed);
+  } else {
+    float v = wheelModelSpeed(speed);
+    float outer = v * (radiusCm + DRIVE_TRACK_CM / 2.0f) / radiusCm;
+    float most = wheelModelSpeed(255);
+    if (outer > most) {      // Too tight for this speed: slow the axle down
+      v *= most / outer;
+      outer = most;
     }
-    delay(50);
+    int16_t o = wheelPwm(outer), i = wheelPwm(v * (radiusCm - DRIVE_TRACK_CM / 2.0f) / radiusCm);
+    if (left) setDrive(i, (int16_t)(o * SPEED_COMPENSATION));
+    else setDrive(o, (int16_t)(i * SPEED_COMPENSATION));
+  }
+  uint32_t start = millis();
+  while (millis() - start < 3000) {
+    odometerCm();   // Steps the model when the control timer isn't running
+    float rest = modelHeading + turnRate() * DRIVE_TAU_MS / 1000.0f;
+    if (left ? rest >= heading : rest <= heading) break;
+  }
+}
+
+/** Straight on for `cm` by the odometer; with `stop`, come to rest there (3s max). */
+void driveCm(float cm, uint8_t speed, bool stop) {
+  TraceSpan span(trace, TRACE_DRIVE);
+  float from = odometerCm();
+  uint32_t start = millis();
+  moveForward(speed);
+  while (odometerCm() - from + (stop ? coastCm() : 0) < cm && millis() - start < 3000) {
+    delay(1);
+  }
+  if (stop) stopMotors();
+}
+
+/** A maneuver's corner: an arc rolling straight on, or stop-pivot-stop. */
+void corner(float heading, bool arcs) {
+  TraceSpan span(trace, TRACE_CORNER);
+  arcTo(heading, arcs ? ARC_RADIUS_CM : 0, arcs ? SPEED_NORMAL : SPEED_TURN);
+  if (arcs) {
+    moveForward(SPEED_NORMAL);
+    return;
   }
-  stopMotors();
-  
-  // Step 5: Turn left 90°
-  turnLeft(SPEED_TURN);
-  delay(TIME_TURN_90);
   stopMotors();
   delay(100);
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                        OBSTACLE AVOIDANCE                                  ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/**
+ * Avoid an obstacle by going around it to the right.
+ * 
+ * MANEUVER: a rectangle around it, by odometer and model heading
+ *   1. Turn right 90°, out AVOID_SIDE_CM from the line
+ *   2. Turn left 90°, along the obstacle until AVOID_CLEAR_CM past its
+ *      far side (the range now + OBSTACLE_WIDTH_CM)
+ *   3. Turn left 90°, back AVOID_SIDE_CM to the line
+ *   4. Turn right 90° (resume original direction)
+ * 
+ * With `arcs` the corners are arcs of ARC_RADIUS_CM at SPEED_NORMAL and
+ * every move flows into the next: the robot never stops. Without, it
+ * stops, pivots and stops at each corner, like it always did.
+ * 
+ * The old timed version hugged the wall with the forward ultrasonic,
+ * which looks past an obstacle beside the robot: it gave up at once and
+ * the robot came back onto the line short of the obstacle.
+ * 
+ * Prints "AVOID: ms=2710 turns=arc range_cm=15.2 pass_cm=49.2".
+ */
+void avoidObstacle(bool arcs = ARC_TURNS) {
+  TraceSpan span(trace, TRACE_AVOID);
+  Serial.println(F(">>> AVOIDING OBSTACLE <<<"));
+  uint32_t start = millis();
+  if (!arcs) {
+    stopMotors();
+    delay(100);
+  }
+  float range = lastDistance - travelledSince(distanceAtUs);   // Sonar to its near face, now
+  if (range <= 0 || range > 2 * CLASSIFY_RANGE_CM) range = DIST_OBSTACLE;
+  float pass = SONAR_FWD_CM + range + OBSTACLE_WIDTH_CM + AVOID_CLEAR_CM;   // Axle to the way back
+  float r = arcs ? ARC_RADIUS_CM : 0;   // An arc's corner starts and ends r off the corner point
+  float heading = modelHeading;
   
-  // Step 6: Clear the obstacle
-  moveForward(SPEED_NORMAL);
-  delay(800);
+  corner(heading - 90, arcs);                          // Step 1
+  driveCm(AVOID_SIDE_CM - 2 * r, SPEED_NORMAL, !arcs);
+  corner(heading, arcs);                               // Step 2
+  driveCm(pass - 3 * r, SPEED_NORMAL, !arcs);          // The first corner point is r ahead
+  corner(heading + 90, arcs);                          // Step 3
+  driveCm(AVOID_SIDE_CM - 2 * r, SPEED_NORMAL, !arcs);
+  corner(heading, arcs);                               // Step 4: rolling on along the line
   
-  // Step 7: Turn right to resume direction
-  turnRight(SPEED_TURN);
-  delay(TIME_TURN_90);
-  stopMotors();
+  Serial.print(F("AVOID: ms="));
+  Serial.print(millis() - start);
+  Serial.print(F(" turns="));
+  Serial.print(arcs ? F("arc") : F("pivot"));
+  Serial.print(F(" range_cm="));
+  Serial.print(range, 1);
+  Serial.print(F(" pass_cm="));
+  Serial.println(pass, 1);
   
-  obstacleCount++;
+  if (programStep.op == OP_AVOID) obstacleCount++;   // Not the ones a BOX step drives around
   Serial.print(F("Obstacles avoided: "));
   Serial.println(obstacleCount);
 }
 
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                          MISSION BUDGET                                    ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+// A normal run: ms per state and cm where it drives a known stretch.
+// Up to the drop measured in the simulator (host/sim, arc turns); the
+// rest from the code's own timings. It is the built-in route's: a loaded
+// program runs without it (fixed speeds and search times).
+const Leg PLAN[] = {
+  { STATE_FIND_RED,      550,  0 },
+  { STATE_FOLLOW_RED,   3250, 40 },
+  { STATE_APPROACH_BOX,  600,  0 },
+  { STATE_PICKUP,        650,  0 },
+  { STATE_TO_OBSTACLES, 2400, 65 },
+  { STATE_AVOID_OBS,    3400,  0 },
+  { STATE_TO_OBSTACLES,  650,  0 },
+  { STATE_AVOID_OBS,    3400,  0 },
+  { STATE_FIND_BLUE,    1600,  0 },
+  { STATE_DROP,          700,  0 },
+  { STATE_FIND_BLACK,   2000,  0 },
+  { STATE_RETURN_HOME,  5000,  0 },
+  { STATE_COMPLETE,        0,  0 },
+};
+
+/** Faster or slower for the time left (SPEED_CRUISE_MAX at most), or `nominal`. */
+uint8_t cruiseSpeed(uint8_t nominal) {
+  return adapting ? mission.cruise(nominal, SPEED_CRUISE_MAX) : nominal;
+}
+
+/** This state's optional search has had its time (less when late). */
+bool searchOver(uint32_t nominal, uint32_t least) {
+  return adapting ? mission.searchOver(nominal, least) : millis() - stateStartTime >= nominal;
+}
+
+/**
+ * Let the motion just set run for SEARCH_MOVE_MS without blocking: the
+ * state checks searchMove() each tick, so events and sensors keep being
+ * served. With `stop`, the motors stop when it ends and rest for a tick.
+ */
+void startSearchMove(bool stop) {
+  searchMoveAt = millis();
+  searchMoving = true;
+  searchMoveStops = stop;
+}
+
+/** A search move is still running (or resting its last tick). */
+bool searchMove() {
+  if (!searchMoving) return false;
+  if (millis() - searchMoveAt < SEARCH_MOVE_MS) return true;
+  searchMoving = false;
+  if (!searchMoveStops) return false;
+  stopMotors();
+  return true;
+}
+
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                         LINE FOLLOWING                                     ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
 
 /**
- * Follow black line using IR sensors
+ * Follow black line using IR sensors. With the control interrupt running
+ * the steering happens there, every tick (see lineTargets()), and so does
+ * the creep when both sensors are off the line: no step here waits for
+ * EVT_LINE_LOST.
  */
 void followBlackLine() {
   bool left, right;
   readIR(left, right);
+  uint8_t speed = cruiseSpeed(SPEED_NORMAL);
+  if (controlRunning) {
+    if (!firstMotionMs) firstMotionMs = millis();
+    lineSpeed = speed;
+    return;
+  }
   
   if (left && right) {
-    moveForward(SPEED_NORMAL);
+    moveForward(speed);
   } else if (left && !right) {
-    curveLeft(SPEED_NORMAL);
+    curveLeft(speed);
   } else if (!left && right) {
-    curveRight(SPEED_NORMAL);
+    curveRight(speed);
   } else {
     moveForward(SPEED_SLOW);
   }
 }
 
 /**
- * Follow red line using color sensor
+ * Follow red line using color sensor (this tick's reading)
  */
-void followRedLine() {
-  Color c = readColor();
+void followRedLine(Color c) {
   if (c == COLOR_RED) {
-    moveForward(SPEED_NORMAL);
+    moveForward(cruiseSpeed(SPEED_NORMAL));
   } else {
     moveForward(SPEED_SLOW);
   }
@@ -398,16 +1154,198 @@ void followRedLine() {
 // ║                           STATE MACHINE                                    ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
 
+/**
+ * State names for the Serial log (Coach App / host tools read these).
+ * Keep in sync with the State enum.
+ */
+const __FlashStringHelper* stateName(State s) {
+  switch (s) {
+    case STATE_FIND_RED:     return F("FIND_RED");
+    case STATE_FOLLOW_RED:   return F("FOLLOW_RED");
+    case STATE_APPROACH_BOX: return F("APPROACH_BOX");
+    case STATE_PICKUP:       return F("PICKUP");
+    case STATE_TO_OBSTACLES: return F("TO_OBSTACLES");
+    case STATE_AVOID_OBS:    return F("AVOID_OBS");
+    case STATE_FIND_BLUE:    return F("FIND_BLUE");
+    case STATE_DROP:         return F("DROP");
+    case STATE_FIND_BLACK:   return F("FIND_BLACK");
+    case STATE_RETURN_HOME:  return F("RETURN_HOME");
+    case STATE_COMPLETE:     return F("COMPLETE");
+  }
+  return F("?");
+}
+
 void transitionTo(State newState) {
   currentState = newState;
   stateStartTime = millis();
+  searchMoving = false;   // A search move ends with its state
+  bus.enter(newState, stateStartTime);
+  checkpoint.save(newState, holding, obstacleCount, (int16_t)(odometerCm() - redStartCm), program.resumePc());
+  mission.enter(newState, stateStartTime, odometerCm());
+  trace.switchTo(TRACE_STATE + newState);
   Serial.print(F("STATE: "));
-  Serial.println(newState);
+  Serial.print(newState);
+  Serial.print(' ');
+  Serial.print(stateName(newState));
+  Serial.print(F(" ms="));   // Robot time: a log without host stamps still times each state
+  Serial.println(stateStartTime);
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                        MISSION PROGRAM                                     ║
+// ║  The route as steps (see mission_program.h), and the events ending each.  ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/*
+ * Each step runs as one of the states, with the subscriptions that end it
+ * (subscribeStep() builds them, see event_bus.h):
+ *
+ *   step       state           ends on
+ *   FIND red   FIND_RED        red, or RED_SEARCH_MS (less when late): onRedFound
+ *   FIND blue  FIND_BLUE       blue: onBlueFound (stops past the edge)
+ *   FIND black FIND_BLACK      black, or BLACK_SEARCH_MS (less when late)
+ *   BOX        FOLLOW_RED      something in range that is the box: onObjectAhead
+ *   APPROACH   APPROACH_BOX    within cm: onBoxInReach
+ *   GRIP       PICKUP          the servos arrived
+ *   AVOID      TO_OBSTACLES    its n-th obstacle driven around (AVOID_OBS)
+ *   RELEASE    DROP            the servos arrived
+ *   FOR        RETURN_HOME     its time: onHome
+ *   HALT       COMPLETE
+ *
+ * AVOID_OBS drives around what a BOX or AVOID step met, then goes back to
+ * that step's state. After a brownout a half-done avoidance can't be
+ * finished blind: the step starts again from the line (the obstacle, if
+ * still ahead, is met and counted again).
+ */
+
+// The course as it is; a program loaded over Serial replaces it
+const uint8_t BUILTIN_PROGRAM[] = {
+  OP_FIND,     COLOR_RED,                           // find red
+  OP_BOX,      COLOR_RED,                           // follow red until box
+  OP_APPROACH, DIST_BOX_PICKUP,                     // approach 5cm
+  OP_GRIP,                                          // grip
+  OP_AVOID,    COLOR_RED, 2,                        // follow red avoiding 2
+  OP_FIND,     COLOR_BLUE,                          // find blue
+  OP_RELEASE,                                       // release
+  OP_FIND,     COLOR_BLACK,                         // find black
+  OP_FOR,      COLOR_BLACK, 5000 & 0xFF, 5000 >> 8, // follow black for 5000ms
+  OP_HALT,                                          // halt
+};
+
+// The steps this sketch has states for (a program with others is rejected)
+const uint32_t STEP_OPS = PROGRAM_OP(OP_FIND) | PROGRAM_OP(OP_BOX) | PROGRAM_OP(OP_APPROACH) |
+                          PROGRAM_OP(OP_GRIP) | PROGRAM_OP(OP_AVOID) | PROGRAM_OP(OP_RELEASE) |
+                          PROGRAM_OP(OP_FOR);
+
+Subscription stepSubscriptions[2];   // The running step's (a FIND: its color and its time)
+
+/** The state that runs step `s`. The followers know red (color sensor) and black (IR). */
+State stepState(const ProgramStep& s) {
+  switch (s.op) {
+    case OP_FIND:
+      if (s.arg == COLOR_RED) return STATE_FIND_RED;
+      return s.arg == COLOR_BLUE ? STATE_FIND_BLUE : STATE_FIND_BLACK;
+    case OP_BOX:      return STATE_FOLLOW_RED;
+    case OP_APPROACH: return STATE_APPROACH_BOX;
+    case OP_GRIP:     return STATE_PICKUP;
+    case OP_AVOID:    return STATE_TO_OBSTACLES;
+    case OP_RELEASE:  return STATE_DROP;
+    case OP_FOR:      return STATE_RETURN_HOME;
+    default:          return STATE_COMPLETE;
+  }
 }
 
+void nextStep();   // The handlers end their step with it; it subscribes them (below)
+
+// The step is over (black found, the servos of a GRIP/RELEASE)
+void onStepDone(const BusEvent&)   { nextStep(); }
+void onBoxInReach(const BusEvent&) { stopMotors(); nextStep(); }
+void onHome(const BusEvent&)       { stopMotors(); nextStep(); }
+
+void onRedFound(const BusEvent&) {
+  redStartCm = odometerCm();
+  nextStep();
+}
+
+// Stop and look: only the box is worth approaching
+void onObjectAhead(const BusEvent&) {
+  ObjectView v = classifyObject();
+  if (v.kind == OBJ_BOX && !holding) nextStep();
+  else transitionTo(STATE_AVOID_OBS);
+}
+
+void onObstacleAhead(const BusEvent&) { transitionTo(STATE_AVOID_OBS); }
+
+void onBlueFound(const BusEvent&) {
+  if (STOP_COMPENSATION) {
+    stopPast(colorAtUs, BLUE_ENTRY_CM);   // Measured from where blue was seen
+  } else {
+    moveForward(SPEED_SLOW);             // Blind half second
+    delay(500);
+    stopMotors();
+  }
+  nextStep();
+}
+
+/** subscribeStep() - Take the program's next step and subscribe what ends it. Returns its state. */
+State subscribeStep() {
+  programStep = program.next();
+  const ProgramStep& s = programStep;
+  State state = stepState(s);
+  uint8_t n = 0;
+  switch (s.op) {
+    case OP_FIND:
+      if (s.arg == COLOR_RED) {
+        stepSubscriptions[n++] = {state, EVT_COLOR_CHANGED, COLOR_RED, onRedFound};
+        stepSubscriptions[n++] = {state, EVT_TIMEOUT, RED_SEARCH_MS, onRedFound};
+      } else if (s.arg == COLOR_BLUE) {
+        stepSubscriptions[n++] = {state, EVT_COLOR_CHANGED, COLOR_BLUE, onBlueFound};   // Searches on
+      } else {
+        stepSubscriptions[n++] = {state, EVT_COLOR_CHANGED, COLOR_BLACK, onStepDone};
+        stepSubscriptions[n++] = {state, EVT_TIMEOUT, BLACK_SEARCH_MS, onStepDone};
+      }
+      break;
+    case OP_BOX:      stepSubscriptions[n++] = {state, EVT_RANGE_BELOW, CLASSIFY_RANGE_CM, onObjectAhead}; break;
+    case OP_APPROACH: stepSubscriptions[n++] = {state, EVT_RANGE_BELOW, s.arg, onBoxInReach}; break;
+    case OP_GRIP:
+    case OP_RELEASE:  stepSubscriptions[n++] = {state, EVT_SERVO_ARRIVED, BUS_ANY, onStepDone}; break;
+    case OP_AVOID:    stepSubscriptions[n++] = {state, EVT_RANGE_BELOW, DIST_OBSTACLE, onObstacleAhead}; break;
+    case OP_FOR:      stepSubscriptions[n++] = {state, EVT_TIMEOUT, s.value, onHome}; break;
+    default:          break;   // HALT: over
+  }
+  bus.begin(stepSubscriptions, n);
+  return state;
+}
+
+/**
+ * nextStep() - On to the program's next step (an AVOID counts its
+ * obstacles from 0). After a brownout, setup() resumes the program where
+ * the checkpoint says (see mission_program.h).
+ */
+void nextStep() {
+  State state = subscribeStep();
+  if (programStep.op == OP_AVOID) obstacleCount = 0;
+  transitionTo(state);
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                          STATE ACTIONS                                     ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/**
+ * Read the sensors once, let the bus move us on if something changed,
+ * otherwise keep doing what the current state does.
+ */
 void processState() {
   Color color = readColor();
   float dist = readDistance();
+  float ahead = rangeAtStop(dist);   // Where we'd stop, not where we were
+  lastColor = color;
+  lastDistance = dist;
+  bus.sampleColor(color);
+  bus.sampleRange(ahead);
+  bus.sampleTime(millis());
+  if (bus.dispatch()) return;   // New state acts next tick
   
   switch (currentState) {
     
@@ -415,93 +1353,58 @@ void processState() {
     // FIND RED: Look for the red line (turn left from intersection)
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_FIND_RED:
-      turnLeft(SPEED_TURN);
-      delay(TIME_TURN_90);
-      stopMotors();
-      
-      if (readColor() == COLOR_RED) {
-        transitionTo(STATE_FOLLOW_RED);
-      } else {
-        moveForward(SPEED_SLOW);
-        delay(300);
-        stopMotors();
-      }
-      
-      // Timeout
-      if (millis() - stateStartTime > 3000) {
-        transitionTo(STATE_FOLLOW_RED);
+      if (searchOver(RED_SEARCH_MS, SEARCH_LEAST_MS)) {   // Sooner than the timeout when late
+        onRedFound(BusEvent());
+        break;
       }
+      // Pivot (the red line starts right here: an arc would miss it),
+      // then with ARC_TURNS roll straight on and look while moving
+      arcTo(modelHeading + 90, 0, SPEED_TURN);
+      if (ARC_TURNS) moveForward(SPEED_SLOW);
+      else stopMotors();
+
+      lastColor = readColor();
+      bus.sampleColor(lastColor);
+      if (bus.dispatch()) break;   // Red: following it
+      moveForward(SPEED_SLOW);
+      delay(300);
+      stopMotors();
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
-    // FOLLOW RED: Follow the red line, watch for box or obstacles
+    // FOLLOW RED / TO OBSTACLES: Follow the red line; box, obstacles and
+    // blue arrive as events
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_FOLLOW_RED:
-      followRedLine();
-      
-      // Not holding box? Look for box
-      if (!holding && dist < DIST_BOX_PICKUP + 10 && dist > 0) {
-        transitionTo(STATE_APPROACH_BOX);
-      }
-      
-      // Holding box? Watch for obstacles
-      if (holding && dist < DIST_OBSTACLE && dist > 0) {
-        transitionTo(STATE_TO_OBSTACLES);
-      }
-      
-      // After 2 obstacles, look for blue
-      if (holding && obstacleCount >= 2 && color == COLOR_BLUE) {
-        transitionTo(STATE_FIND_BLUE);
-      }
+    case STATE_TO_OBSTACLES:
+      followRedLine(color);
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
-    // APPROACH BOX: Move slowly toward the box
+    // APPROACH BOX: Close in, slowing down as the box gets near
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_APPROACH_BOX:
-      if (dist <= DIST_BOX_PICKUP) {
-        stopMotors();
-        transitionTo(STATE_PICKUP);
-      } else {
-        moveForward(SPEED_SLOW);
-      }
+      moveForward(approachSpeed(ahead, programStep.arg));
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
-    // PICKUP: Grab the box
+    // PICKUP: Grab the box (publishes EVT_SERVO_ARRIVED when done)
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_PICKUP:
       pickup();
-      transitionTo(STATE_TO_OBSTACLES);
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
-    // TO OBSTACLES: Continue on path until obstacle detected
-    // ─────────────────────────────────────────────────────────────────────────
-    case STATE_TO_OBSTACLES:
-      followRedLine();
-      
-      // Obstacle detected?
-      if (dist < DIST_OBSTACLE && dist > 0) {
-        transitionTo(STATE_AVOID_OBS);
-      }
-      
-      // Done with obstacles? Look for blue
-      if (obstacleCount >= 2 && color == COLOR_BLUE) {
-        transitionTo(STATE_FIND_BLUE);
-      }
-      break;
-    
-    // ─────────────────────────────────────────────────────────────────────────
-    // AVOID OBS: Execute obstacle avoidance maneuver
+    // AVOID OBS: Execute obstacle avoidance maneuver, then back to the
+    // step's line (an AVOID is over after its n-th)
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_AVOID_OBS:
       avoidObstacle();
       
-      if (obstacleCount >= 2) {
-        transitionTo(STATE_FIND_BLUE);
+      if (programStep.op == OP_AVOID && obstacleCount >= programStep.arg) {
+        nextStep();
       } else {
-        transitionTo(STATE_TO_OBSTACLES);
+        transitionTo(stepState(programStep));
       }
       break;
     
@@ -509,60 +1412,44 @@ void processState() {
     // FIND BLUE: Look for the blue drop zone
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_FIND_BLUE:
-      if (color == COLOR_BLUE) {
-        moveForward(SPEED_SLOW);
-        delay(500);
-        stopMotors();
-        transitionTo(STATE_DROP);
-      } else {
-        followRedLine();
-        // Search pattern if taking too long
-        if (millis() - stateStartTime > 5000) {
-          turnLeft(SPEED_TURN);
-          delay(200);
-          stopMotors();
-        }
+      if (searchMove()) break;   // Pivoting
+      followRedLine(color);
+      // Search pattern if taking too long (sooner when late)
+      if (searchOver(BLUE_SEARCH_MS, SEARCH_LEAST_MS)) {
+        turnLeft(SPEED_TURN);
+        startSearchMove(true);
       }
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
-    // DROP: Release the box
+    // DROP: Release the box (publishes EVT_SERVO_ARRIVED when done)
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_DROP:
       drop();
-      transitionTo(STATE_FIND_BLACK);
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
     // FIND BLACK: Look for black line to return home
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_FIND_BLACK:
-      if (color == COLOR_BLACK) {
-        transitionTo(STATE_RETURN_HOME);
-      } else if (color == COLOR_RED) {
-        followRedLine();
+      if (searchOver(BLACK_SEARCH_MS, SEARCH_LEAST_MS)) {   // Sooner than the timeout when late
+        nextStep();
+        break;
+      }
+      if (searchMove()) break;   // Rolling on blind
+      if (color == COLOR_RED) {
+        followRedLine(color);
       } else {
         moveForward(SPEED_SLOW);
-        delay(200);
-      }
-      
-      // Timeout
-      if (millis() - stateStartTime > 5000) {
-        transitionTo(STATE_RETURN_HOME);
+        startSearchMove(false);
       }
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
-    // RETURN HOME: Follow black line back to start
+    // RETURN HOME: Follow black line back to start (home after the step's time)
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_RETURN_HOME:
       followBlackLine();
-      
-      // Assume we're home after 5 seconds
-      if (millis() - stateStartTime > 5000) {
-        stopMotors();
-        transitionTo(STATE_COMPLETE);
-      }
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
@@ -570,12 +1457,119 @@ void processState() {
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_COMPLETE:
       stopMotors();
+      reportControl();
+      reportSensorQueue();
+      bus.report();
+      while (checkpoint.pending()) checkpoint.service(CHECKPOINT_BUDGET_US);
+      checkpoint.report();
+      mission.report();
+      power.log();
+      power.report();
+      program.report();
+      trace.flush();
+      trace.report();
       Serial.println(F("\n╔═══════════════════════════════════╗"));
       Serial.println(F("║     COMPETITION COMPLETE!         ║"));
       Serial.println(F("╚═══════════════════════════════════╝"));
       while (true) delay(1000);
       break;
   }
+  bus.dispatch();   // Events the action itself raised (servo arrived)
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                             TELEMETRY                                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/**
+ * T:<millis>,<state>,<color>,<distance>  (enum values; read by the Coach App)
+ */
+void sendTelemetry() {
+  Serial.print(F("T:"));
+  Serial.print(millis());
+  Serial.print(',');
+  Serial.print(currentState);
+  Serial.print(',');
+  Serial.print(lastColor);
+  Serial.print(',');
+  Serial.println(lastDistance, 1);
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                            BOOT & START                                    ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+#define READY_SERVO   1    // waitUntilReady() bits: parts that timed out
+#define READY_ECHO    2
+#define READY_COLOR   4
+#define READY_CONTROL 8
+
+uint32_t servosWrittenMs = 0, bootReadyMs = 0, startCueMs = 0;
+uint8_t bootNotReady = 0;
+
+/**
+ * Poll the parts until all are ready, at most BOOT_TIMEOUT_MS: servos had
+ * BOOT_SERVO_MS to get there, the ultrasonic answered, the color sensor
+ * pulses, the control interrupt ticks. Returns the READY_ bits that didn't.
+ */
+uint8_t waitUntilReady() {
+  uint32_t start = millis();
+  uint8_t missing;
+  bool colorSeen = false;
+  do {
+    missing = 0;
+    if (millis() - servosWrittenMs < BOOT_SERVO_MS) missing |= READY_SERVO;
+    readDistance();
+    if (echoByInterrupt && (!echoRiseUs || !resultPingUs)) missing |= READY_ECHO;
+    if (!colorSeen) colorSeen = pulseIn(PIN_COLOR_OUT, LOW, 5000) > 0;
+    if (!colorSeen) missing |= READY_COLOR;
+    if (controlRunning && ctrlStats.ticks == 0) missing |= READY_CONTROL;
+  } while (missing && millis() - start < BOOT_TIMEOUT_MS);
+  return missing;
+}
+
+/** Hold still until the START_TRIGGER cue has lasted START_HOLD_MS. */
+void waitForStart() {
+  if (START_TRIGGER == START_NOW) return;
+  Serial.println(F("START: waiting for the cue"));
+  bool seen = false, armed = false;   // armed: card seen (LINE) / hand held (WAVE)
+  uint32_t since = 0;
+  for (;;) {
+    program.service();   // A new program over Serial (host/mission_asm.cpp)?
+    if (START_TRIGGER == START_BUTTON) {
+      seen = digitalRead(PIN_START) == LOW;
+    } else if (START_TRIGGER == START_WAVE) {
+      float dist = readDistance();
+      seen = dist > 0 && dist < START_WAVE_CM;
+      if (!seen && armed) return;   // Hand gone: go
+    } else {
+      Color c = readColor();
+      if (c == COLOR_NONE) armed = true;   // White reads as no color
+      seen = armed && c != COLOR_NONE;
+    }
+    uint32_t now = millis();
+    if (!seen) since = now;
+    if (seen && now - since >= START_HOLD_MS) {
+      if (START_TRIGGER != START_WAVE) return;
+      armed = true;
+    }
+    delay(10);
+  }
+}
+
+/** Once, when the wheels first move: BOOT: ready_ms= start_ms= motion_ms= not_ready= */
+void reportBoot() {
+  static bool reported = false;
+  if (reported || !firstMotionMs) return;
+  reported = true;
+  Serial.print(F("BOOT: ready_ms="));
+  Serial.print(bootReadyMs);
+  Serial.print(F(" start_ms="));
+  Serial.print(startCueMs);
+  Serial.print(F(" motion_ms="));
+  Serial.print(firstMotionMs);
+  Serial.print(F(" not_ready="));
+  Serial.println(bootNotReady);
 }
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
@@ -583,7 +1577,24 @@ void processState() {
 // ╚═══════════════════════════════════════════════════════════════════════════╝
 
 void setup() {
+  ResetCause cause = readResetCause();   // First: this clears the flags
   Serial.begin(9600);
+  bool resume = checkpoint.begin(3, __DATE__ " " __TIME__) && CHECKPOINT_RESUME &&
+                (cause == RESET_BROWNOUT || cause == RESET_WATCHDOG);
+  if (resume) {
+    const Checkpoint& c = checkpoint.last();
+    holding = c.holding;
+    obstacleCount = c.count;
+    redStartCm = -c.value;   // The odometer restarts at 0
+  }
+  program.begin(3, BUILTIN_PROGRAM, sizeof(BUILTIN_PROGRAM), STEP_OPS);   // Loaded over Serial, else built-in
+  
+  // Servos first: they take longest, the rest of setup() runs meanwhile
+  baseServo.attach(PIN_SERVO_BASE);
+  clampServo.attach(PIN_SERVO_CLAMP);
+  power.attachServo(SERVO_ARM, baseServo, SERVO_ARM_CARRY);
+  power.attachServo(SERVO_CLAMP, clampServo, holding ? SERVO_CLAMP_CLOSED : SERVO_CLAMP_OPEN);
+  servosWrittenMs = millis();
   
   // Color sensor pins
   pinMode(PIN_COLOR_S0, OUTPUT);
@@ -597,10 +1608,12 @@ void setup() {
   // Ultrasonic pins
   pinMode(PIN_ULTRA_TRIG, OUTPUT);
   pinMode(PIN_ULTRA_ECHO, INPUT);
+  startEcho();
   
   // IR sensor pins
   pinMode(PIN_IR_LEFT, INPUT);
   pinMode(PIN_IR_RIGHT, INPUT);
+  pinMode(PIN_START, INPUT_PULLUP);
   
   // Motor pins
   pinMode(PIN_MOTOR_ENA, OUTPUT);
@@ -610,25 +1623,106 @@ void setup() {
   pinMode(PIN_MOTOR_IN3, OUTPUT);
   pinMode(PIN_MOTOR_IN4, OUTPUT);
   
-  // Servos
-  baseServo.attach(PIN_SERVO_BASE);
-  clampServo.attach(PIN_SERVO_CLAMP);
-  baseServo.write(SERVO_ARM_CARRY);
-  clampServo.write(SERVO_CLAMP_OPEN);
-  
   stopMotors();
-  delay(1000);
+  power.begin(POWER_BUDGET_MA, DRIVE_DEADBAND, DRIVE_TAU_MS, CONTROL_HZ);   // Before the timer's first tick
+  startControl();
+  power.start(controlRunning);
   
   Serial.println(F("============================="));
   Serial.println(F("  SECTION 3: OBSTACLE COURSE"));
   Serial.println(F("============================="));
   Serial.println(F("Mission: Red line -> Box -> Obstacles -> Blue -> Home"));
+  Serial.println(F("FW: " __DATE__ " " __TIME__));
+  Serial.println(F("PARAMS: SPEED_NORMAL=" STR(SPEED_NORMAL) ",SPEED_TURN=" STR(SPEED_TURN) ",SPEED_COMPENSATION=" STR(SPEED_COMPENSATION)
+                 ",TIME_TURN_90=" STR(TIME_TURN_90) ",DIST_OBSTACLE=" STR(DIST_OBSTACLE)
+                 ",DIST_BOX_PICKUP=" STR(DIST_BOX_PICKUP)
+                 ",COLOR_FREQ_MAX=" STR(COLOR_FREQ_MAX) ",COLOR_FREQ_BLACK=" STR(COLOR_FREQ_BLACK)
+                 ",COLOR_MARGIN=" STR(COLOR_MARGIN) ",CONTROL_HZ=" STR(CONTROL_HZ)
+                 ",STOP_COMPENSATION=" STR(STOP_COMPENSATION) ",DRIVE_TAU_MS=" STR(DRIVE_TAU_MS)
+                 ",APPROACH_GAIN=" STR(APPROACH_GAIN) ",APPROACH_MIN_PWM=" STR(APPROACH_MIN_PWM)
+                 ",CLASSIFY_RANGE_CM=" STR(CLASSIFY_RANGE_CM) ",SWEEP_DEG=" STR(SWEEP_DEG)
+                 ",START_TRIGGER=" STR(START_TRIGGER) ",ARC_TURNS=" STR(ARC_TURNS)
+                 ",ARC_RADIUS_CM=" STR(ARC_RADIUS_CM) ",AVOID_SIDE_CM=" STR(AVOID_SIDE_CM)
+                 ",POWER_BUDGET_MA=" STR(POWER_BUDGET_MA) ",TRACE_MASK=" STR(TRACE_MASK)));
+  
+  // The trace's legend: every span's id, kind and name
+  trace.begin(TRACE_MASK);
+  for (uint8_t s = 0; s <= STATE_COMPLETE; s++) trace.name(TRACE_STATE + s, TRACE_STATES, stateName((State)s));
+  trace.name(TRACE_COLOR, TRACE_SENSORS, F("readColor"));
+  trace.name(TRACE_ECHO, TRACE_SENSORS, F("echo"));
+  trace.name(TRACE_STOP_PAST, TRACE_MANEUVERS, F("stopPast"));
+  trace.name(TRACE_PICKUP, TRACE_MANEUVERS, F("pickup"));
+  trace.name(TRACE_DROP, TRACE_MANEUVERS, F("drop"));
+  trace.name(TRACE_SWEEP, TRACE_MANEUVERS, F("sweepTo"));
+  trace.name(TRACE_CLASSIFY, TRACE_MANEUVERS, F("classifyObject"));
+  trace.name(TRACE_ARC, TRACE_MANEUVERS, F("arcTo"));
+  trace.name(TRACE_DRIVE, TRACE_MANEUVERS, F("driveCm"));
+  trace.name(TRACE_CORNER, TRACE_MANEUVERS, F("corner"));
+  trace.name(TRACE_AVOID, TRACE_MANEUVERS, F("avoidObstacle"));
+  trace.name(TRACE_SERVO_WAIT, TRACE_SERVOS, F("awaitServos"));
+  trace.name(TRACE_IDLE, TRACE_WAITS, F("idle"));
   Serial.println();
   
-  transitionTo(STATE_FIND_RED);
+  if (!resume) {   // Resuming: we're under way, no waiting
+    bootNotReady = waitUntilReady();
+    bootReadyMs = millis();
+    waitForStart();
+  }
+  startCueMs = millis();
+  adapting = MISSION_ADAPT && !program.loaded();   // PLAN is the built-in route's
+  
+  // Begin at the program's first step, or the saved one (with its obstacles)
+  Serial.print(F("RESET: cause="));
+  Serial.print(resetCauseName(cause));
+  if (resume) {
+    const Checkpoint& saved = checkpoint.last();
+    program.resumeAt(saved.step, 0);
+    Serial.print(F(" resume="));
+    Serial.print(stateName((State)saved.state));
+    Serial.print(F(" pc="));
+    Serial.print(saved.step);
+    Serial.print(F(" holding="));
+    Serial.print(holding);
+    Serial.print(F(" obstacles="));
+    Serial.print(obstacleCount);
+    Serial.print(F(" boot_ms="));
+    Serial.println(millis());
+  } else {
+    Serial.println();
+  }
+  State first = subscribeStep();
+  mission.begin(MISSION_BUDGET_MS, MISSION_RESERVE_MS, PLAN, sizeof(PLAN) / sizeof(PLAN[0]), first, millis());
+  transitionTo(first);
 }
 
 void loop() {
+  mission.update(millis(), odometerCm());
   processState();
-  delay(50);
+  
+  static uint8_t telemetryTick = 0;
+  if (TELEMETRY_EVERY > 0 && ++telemetryTick >= TELEMETRY_EVERY) {
+    telemetryTick = 0;
+    sendTelemetry();
+  }
+  
+  reportBoot();
+  
+  static uint32_t lastControlReport = 0;
+  if (CONTROL_REPORT_MS > 0 && millis() - lastControlReport >= CONTROL_REPORT_MS) {
+    lastControlReport = millis();
+    reportControl();
+    reportSensorQueue();
+    bus.report();
+    checkpoint.report();
+    mission.report();
+    power.report();
+    trace.report();
+  }
+  power.log();   // Budget conflicts the control interrupt resolved
+  trace.service();
+  
+  uint32_t writingMs = checkpoint.service(CHECKPOINT_BUDGET_US) / 1000;   // In the wait, not on top of it
+  trace.open(TRACE_IDLE);
+  delay(writingMs < 50 ? 50 - writingMs : 0);
+  trace.close(TRACE_IDLE);
 }
@@ -0,0 +1,81 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║              SPSC QUEUE: interrupt -> loop() without locking              ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * A fixed-size ring for exactly ONE producer (usually an interrupt) and ONE
+ * consumer (usually loop()). Neither side ever disables interrupts or waits:
+ *
+ *   producer (ISR):   if (!events.push(e)) { ...full: counted, e dropped... }
+ *   consumer (loop):  while (events.pop(e)) { ...handle e... }
+ *
+ * HOW IT STAYS CONSISTENT:
+ * head counts pushes and is written only by the producer; tail counts pops
+ * and is written only by the consumer. Both run freely (no modulo, they wrap
+ * at 2^32) and the slot is `count & (N - 1)`, so N must be a power of two and
+ * all N slots are usable. The element is written BEFORE head moves (release)
+ * and read only after head is seen to have moved (acquire); the same in the
+ * other direction for tail. On the Cortex-M4 that's a DMB around a plain
+ * 32-bit load/store, which the interrupt can never see half done.
+ *
+ * Arduino only compiles files inside the sketch folder, so every mission
+ * sketch carries an identical copy of this header. host/spsc_stress.cpp
+ * tests it from two threads on the PC.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#ifdef ARDUINO
+#define SPSC_ALIGN 4      // Single core: no cache lines to share
+#else
+#define SPSC_ALIGN 64     // Host threads: keep head and tail on separate cache lines
+#endif
+
+template <typename T, uint32_t N>
+class SpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+  /** Producer only. Returns false (and counts an overflow) when full. */
+  bool push(const T& item) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t used = head - tail_.load(std::memory_order_acquire);
+    if (used >= N) {
+      overflows_.store(overflows_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    slots_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    if (used + 1 > peak_.load(std::memory_order_relaxed)) peak_.store(used + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /** Consumer only. Returns false when empty. */
+  bool pop(T& out) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) return false;
+    out = slots_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** Items waiting. A snapshot: the other side may be moving. */
+  uint32_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+
+  uint32_t overflows() const { return overflows_.load(std::memory_order_relaxed); }   // Pushes dropped
+  uint32_t peak() const { return peak_.load(std::memory_order_relaxed); }             // Most ever waiting
+  static constexpr uint32_t capacity() { return N; }
+
+private:
+  alignas(SPSC_ALIGN) std::atomic<uint32_t> head_{0};   // Producer side
+  std::atomic<uint32_t> overflows_{0};
+  std::atomic<uint32_t> peak_{0};
+  alignas(SPSC_ALIGN) std::atomic<uint32_t> tail_{0};   // Consumer side
+  alignas(SPSC_ALIGN) T slots_[N];
+};
@@ -0,0 +1,229 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║           CHECKPOINT: resume the mission after a brownout reset           ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * A servo current spike can sag a 9V pack far enough to reset the board.
+ * setup() then runs again and, without this, the robot starts the section
+ * over from its first state - wherever it is, box in the claw or not.
+ *
+ * Every transitionTo() hands save() a small Checkpoint (section, state,
+ * holding, a counter, one sketch-specific number and the mission program's
+ * step). loop() writes it to
+ * the EEPROM in its idle time with service(); at boot, begin() finds the
+ * newest complete one and the sketch resumes from it if the reset was warm.
+ *
+ * WEAR LEVELING: the records go round a ring of CKPT_SLOTS slots, each save
+ * into the next one, so every slot takes 1/CKPT_SLOTS of the writes. The
+ * newest slot is the valid one (CRC) with the highest sequence number.
+ *
+ * OFF THE CONTROL PATH: save() only fills a RAM buffer. service() writes
+ * bytes, unchanged ones skipped, until it has spent its budget (at least
+ * one byte) and returns the time used, which loop() takes off its delay().
+ * The motor interrupt keeps running throughout; the CRC goes last, so a
+ * reset mid-write leaves the slot invalid and the previous one wins.
+ *
+ * WARM OR COLD: the RA4M1 clears RSTSR2.CWSF only at power-on; begin()
+ * sets it. Found set at the next boot, the reset was a brownout (LVD), the
+ * watchdog, software or the reset button - RAM-only trouble, the course is
+ * where we left it. Cleared: the robot was switched on, start fresh. A new
+ * upload changes the build stamp, so an old run is never resumed either.
+ *
+ * report() prints what the writes cost on this board:
+ *   CKPT: saves=<n> written=<bytes> skipped=<same> byte_us=<avg>/<max> durable_ms=<max> slot=<i>
+ *
+ * Arduino only compiles files inside the sketch folder, so every mission
+ * sketch carries an identical copy of this header.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#define CKPT_BASE   0     // First EEPROM byte of the ring
+#define CKPT_SLOTS  32    // 32 x 12 bytes
+
+enum ResetCause : uint8_t {
+  RESET_POWER_ON,   // Cold: switched on (or a dip deep enough to clear everything)
+  RESET_BROWNOUT,   // Voltage monitor (LVD0/1/2)
+  RESET_WATCHDOG,   // IWDT or WDT
+  RESET_SOFTWARE,   // NVIC_SystemReset(), e.g. after an upload
+  RESET_PIN         // Warm with no flag set: the reset button
+};
+
+/**
+ * readResetCause() - Why the board started, from the RA4M1 reset flags.
+ * Call once, early in setup(): it clears the flags and sets CWSF, so the
+ * next reset can tell it wasn't a power-on.
+ */
+inline ResetCause readResetCause() {
+  uint8_t rst0 = R_SYSTEM->RSTSR0, rst1 = R_SYSTEM->RSTSR1;
+  bool warm = R_SYSTEM->RSTSR2 & R_SYSTEM_RSTSR2_CWSF_Msk;
+  R_SYSTEM->RSTSR0 = 0;   // Flags clear by writing 0 after reading 1
+  R_SYSTEM->RSTSR1 = 0;
+  R_SYSTEM->RSTSR2 = R_SYSTEM_RSTSR2_CWSF_Msk;
+
+  if (!warm || (rst0 & R_SYSTEM_RSTSR0_PORF_Msk)) return RESET_POWER_ON;
+  if (rst0 & (R_SYSTEM_RSTSR0_LVD0RF_Msk | R_SYSTEM_RSTSR0_LVD1RF_Msk | R_SYSTEM_RSTSR0_LVD2RF_Msk))
+    return RESET_BROWNOUT;
+  if (rst1 & (R_SYSTEM_RSTSR1_IWDTRF_Msk | R_SYSTEM_RSTSR1_WDTRF_Msk)) return RESET_WATCHDOG;
+  if (rst1 & R_SYSTEM_RSTSR1_SWRF_Msk) return RESET_SOFTWARE;
+  return RESET_PIN;
+}
+
+inline const __FlashStringHelper* resetCauseName(ResetCause c) {
+  switch (c) {
+    case RESET_POWER_ON: return F("POWER_ON");
+    case RESET_BROWNOUT: return F("BROWNOUT");
+    case RESET_WATCHDOG: return F("WATCHDOG");
+    case RESET_SOFTWARE: return F("SOFTWARE");
+    case RESET_PIN:      return F("PIN");
+  }
+  return F("?");
+}
+
+struct Checkpoint {
+  uint16_t seq;        // Save number; the newest valid slot wins
+  uint16_t build;      // Firmware stamp (see begin())
+  uint8_t section;     // 1 start, 2 target, 3 obstacle
+  uint8_t state;       // The sketch's State
+  uint8_t holding;     // Box in the claw
+  uint8_t count;       // Sketch-specific counter (obstacleCount, a REPEAT's turns)
+  int16_t value;       // Sketch-specific number (cm since the red line)
+  uint8_t step;        // The mission program's resumePc() (see mission_program.h)
+  uint8_t crc;         // CRC-8 of everything above; written last
+};
+
+class CheckpointStore {
+public:
+  /**
+   * Find the newest complete checkpoint of this section and build.
+   * `stamp` identifies the firmware (__DATE__ " " __TIME__). Returns true
+   * if there is one; it's in last() then.
+   */
+  bool begin(uint8_t section, const char* stamp) {
+    section_ = section;
+    build_ = 0x811C;
+    for (const char* p = stamp; *p; p++) build_ = (build_ ^ (uint8_t)*p) * 0x0193;   // 16-bit FNV-1a
+
+    bool found = false;
+    uint16_t newestSeq = 0;
+    uint8_t newest = CKPT_SLOTS - 1;
+    for (uint8_t i = 0; i < CKPT_SLOTS; i++) {
+      Checkpoint c;
+      uint8_t* b = (uint8_t*)&c;
+      for (uint8_t k = 0; k < sizeof(Checkpoint); k++) b[k] = EEPROM.read(slotAddress(i) + k);
+      if (c.crc != crc8(b, sizeof(Checkpoint) - 1)) continue;
+      // The newest of any build decides where to write next
+      if (!found || (int16_t)(c.seq - newestSeq) > 0) {
+        found = true;
+        newestSeq = c.seq;
+        newest = i;
+        last_ = c;
+      }
+    }
+    slot_ = (newest + 1) % CKPT_SLOTS;
+    seq_ = found ? newestSeq + 1 : 0;
+    return found && last_.section == section_ && last_.build == build_;
+  }
+
+  const Checkpoint& last() const { return last_; }
+
+  /** Queue a checkpoint; a newer one replaces one still being written. */
+  void save(uint8_t state, bool holding, uint8_t count = 0, int16_t value = 0, uint8_t step = 0) {
+    if (writing_ && pos_ > 0) restarts_++;
+    Checkpoint& c = pending_;
+    c.seq = seq_;
+    c.build = build_;
+    c.section = section_;
+    c.state = state;
+    c.holding = holding;
+    c.count = count;
+    c.value = value;
+    c.step = step;
+    c.crc = crc8((const uint8_t*)&c, sizeof(Checkpoint) - 1);
+    pos_ = 0;
+    writing_ = true;
+    savedUs_ = micros();
+  }
+
+  /**
+   * Write the pending checkpoint for up to `budgetUs` (at least one byte).
+   * Returns the microseconds spent. Call from loop(), never the interrupt.
+   */
+  uint32_t service(uint32_t budgetUs) {
+    if (!writing_) return 0;
+    uint32_t start = micros();
+    const uint8_t* b = (const uint8_t*)&pending_;
+    int addr = slotAddress(slot_);
+    while (pos_ < sizeof(Checkpoint)) {
+      if (EEPROM.read(addr + pos_) == b[pos_]) {
+        skipped_++;
+      } else {
+        uint32_t t = micros();
+        EEPROM.write(addr + pos_, b[pos_]);
+        t = micros() - t;
+        written_++;
+        writeUs_ += t;
+        if (t > maxByteUs_) maxByteUs_ = t;
+      }
+      pos_++;
+      if ((uint32_t)micros() - start >= budgetUs) break;
+    }
+    if (pos_ >= sizeof(Checkpoint)) {
+      writing_ = false;
+      saves_++;
+      seq_++;
+      slot_ = (slot_ + 1) % CKPT_SLOTS;
+      uint32_t durable = micros() - savedUs_;
+      if (durable > maxDurableUs_) maxDurableUs_ = durable;
+    }
+    return micros() - start;
+  }
+
+  bool pending() const { return writing_; }
+
+  void report() const {
+    Serial.print(F("CKPT: saves="));
+    Serial.print(saves_);
+    Serial.print(F(" written="));
+    Serial.print(written_);
+    Serial.print(F(" skipped="));
+    Serial.print(skipped_);
+    Serial.print(F(" byte_us="));
+    Serial.print(written_ ? writeUs_ / written_ : 0);
+    Serial.print('/');
+    Serial.print(maxByteUs_);
+    Serial.print(F(" durable_ms="));
+    Serial.print(maxDurableUs_ / 1000);
+    Serial.print(F(" restarts="));
+    Serial.print(restarts_);
+    Serial.print(F(" slot="));
+    Serial.println(slot_);
+  }
+
+private:
+  static int slotAddress(uint8_t slot) { return CKPT_BASE + slot * sizeof(Checkpoint); }
+
+  static uint8_t crc8(const uint8_t* p, uint8_t n) {
+    uint8_t crc = 0xFF;
+    while (n--) {
+      crc ^= *p++;
+      for (uint8_t i = 0; i < 8; i++) crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+    }
+    return crc;
+  }
+
+  Checkpoint last_ = {};
+  Checkpoint pending_ = {};
+  uint8_t section_ = 0;
+  uint16_t build_ = 0;
+  uint16_t seq_ = 0;
+  uint8_t slot_ = 0;
+  uint8_t pos_ = 0;              // Next byte of pending_ to write
+  bool writing_ = false;
+  uint32_t savedUs_ = 0;         // micros() at save(), for durable_ms
+  uint32_t saves_ = 0, written_ = 0, skipped_ = 0, restarts_ = 0;
+  uint32_t writeUs_ = 0, maxByteUs_ = 0, maxDurableUs_ = 0;
+};
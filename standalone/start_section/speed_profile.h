@@ -0,0 +1,306 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║        SPEED PROFILE: line-following speeds learned in practice runs      ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * Every run used to follow every line at SPEED_NORMAL. The same course is
+ * driven many times in practice, so this keeps a speed per SEGMENT - a
+ * line-following state and PROFILE_SEGMENT_CM of odometer in it (the last
+ * segment runs on to the state's end) - as a percentage of the nominal
+ * speed, in EEPROM after the checkpoint ring.
+ *
+ * WHILE DRIVING: the sketch passes every line reading to sample(). A
+ * segment is LOST if the line was gone for PROFILE_LOST_CM on end (only
+ * one that began on the line: driving on while already searching isn't
+ * its fault), and CLEAN if it was off the line (tracking error) for at
+ * most PROFILE_OFF_MAX of its readings.
+ *
+ * LEARNING. A faster stretch that stays on the line can still leave the
+ * robot at an angle for the next one - the one-sensor follower only sees
+ * the line, not its heading - so a raise is a TRIAL the whole run has to
+ * survive:
+ *   lost        -> pct -= 2 x step, step / 2   (as soon as it happens)
+ *   run ends    -> every clean segment: pct += step; those are the trial
+ *   next boot   -> the trial run never finished: its raises are taken
+ *                  back and their steps halved
+ * within PROFILE_MIN_PCT..MAX_PCT. Steps start at PROFILE_STEP_PCT and
+ * halve at every setback; at 0 the segment is SETTLED and isn't raised
+ * again. So each segment closes in on the fastest speed runs still finish
+ * at, and the profile converges: a few failed runs at most, then none. The floor is
+ * the nominal speed: below it the wheels are near their deadband and the
+ * motor mismatch steers more, not less.
+ *
+ * A brownout-resumed run is the same run: begin() neither counts it nor
+ * judges the trial.
+ *
+ * WRITING: a change only marks its segment (or the header) dirty in RAM.
+ * service(), from loop() next to the checkpoint's, writes them in the
+ * idle time, a segment (2 bytes) at a time until its budget is spent;
+ * segments go before the header, so a reset mid-way leaves the header
+ * saying what still has to be judged. A loss costs the follower nothing,
+ * begin()'s rollback is written while waiting for the start cue, and
+ * finish() writes whatever is left before it returns.
+ *
+ * report() prints:
+ *   PROFILE: run=<n> losses=<n> off_pct=<%> rolled_back=<n> pct=<seg>/<seg>/..|<next state>..
+ *
+ * Start-only: the target and obstacle sketches don't learn their speeds,
+ * and their folders have no copy.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#define PROFILE_BASE       512   // First EEPROM byte (the checkpoint ring ends at 384)
+#define PROFILE_STATES     4     // Line-following states a sketch can learn...
+#define PROFILE_SEGMENTS   6     // ...each cut into this many segments...
+#define PROFILE_SEGMENT_CM 15    // ...this long
+#define PROFILE_MIN_PCT    100   // Never below nominal (see above)
+#define PROFILE_MAX_PCT    150
+#define PROFILE_STEP_PCT   8     // First raise; halves at every setback
+#define PROFILE_LOST_CM    4.0   // Off the line this far on end = lost it
+#define PROFILE_OFF_MAX    0.25  // Off the line more than this share of readings = not clean
+#define PROFILE_FLUSH_US   20000 // finish()'s writing per service() call
+
+struct SegmentSpeed {
+  uint8_t pct;         // Of the nominal speed
+  uint8_t step;        // Next raise, %; 0 = settled
+};
+
+class SpeedProfile {
+public:
+  /**
+   * Load the profile of this section (a new one if there is none or the
+   * layout changed; `forget` starts over). `states` are the sketch's
+   * line-following states, PROFILE_STATES at most. Judges the last run's
+   * trial, unless this is that run resumed.
+   */
+  void begin(uint8_t section, const uint8_t* states, uint8_t count, bool forget, bool resume) {
+    states_ = states;
+    count_ = count < PROFILE_STATES ? count : PROFILE_STATES;
+    resume_ = resume;
+    uint8_t key = layoutKey(section);
+    Header& h = header_;
+    EEPROM.get(PROFILE_BASE, h);
+    if (forget || h.magic != 'S' || h.key != key) {
+      for (uint8_t i = 0; i < PROFILE_STATES * PROFILE_SEGMENTS; i++) {
+        seg_[i].pct = 100;
+        seg_[i].step = PROFILE_STEP_PCT;
+        store(i);
+      }
+      h = Header{'S', key, 0, 0, 0};
+    } else {
+      EEPROM.get(PROFILE_BASE + sizeof(Header), seg_);
+    }
+    if (!resume) {
+      if (h.running) {   // The last run never got to finish(): its trial failed
+        rollBack(h.trial);
+        h.trial = 0;
+      }
+      h.running = 1;     // This run tests h.trial; finish() clears it
+      h.run++;
+    }
+    run_ = h.run;
+    storeHeader();
+  }
+
+  /**
+   * This run isn't the trial after all (a mission program runs, not the
+   * route the profile was learned on): takes back its count and leaves
+   * the last run's verdict in place; from here on nothing is learned.
+   * For the start cue, after which nothing can be loaded.
+   */
+  void cancel() {
+    if (!count_) return;   // Never began
+    count_ = 0;
+    state_ = 0;
+    if (resume_) return;   // A resumed run waits for no cue
+    header_.running = 0;
+    header_.run--;
+    run_ = header_.run;
+    storeHeader();
+  }
+
+  /** Call from transitionTo(): closes the segment we were in. */
+  void enter(uint8_t state, float cm) {
+    close();
+    state_ = stateIndex(state);
+    enteredCm_ = cm;
+    segment_ = 0;
+    reads_ = off_ = 0;
+    lostFrom_ = -1;
+    began_ = true;
+  }
+
+  /** A line reading at odometer `cm` (only in learned states). */
+  void sample(bool onLine, float cm) {
+    if (state_ >= count_) return;
+    uint8_t s = (cm - enteredCm_) / PROFILE_SEGMENT_CM;
+    if (s >= PROFILE_SEGMENTS) s = PROFILE_SEGMENTS - 1;
+    if (s != segment_) {
+      close();
+      segment_ = s;
+      reads_ = off_ = 0;
+      began_ = lostFrom_ < 0;
+    }
+    reads_++;
+    readsTotal_++;
+    if (onLine) {
+      lostFrom_ = -1;
+      return;
+    }
+    off_++;
+    offTotal_++;
+    if (lostFrom_ < 0) lostFrom_ = cm;
+    else if (cm - lostFrom_ >= PROFILE_LOST_CM && began_ && !(done_ & bit())) {
+      SegmentSpeed& g = seg_[index()];
+      uint8_t down = g.step ? 2 * g.step : 2;   // Settled ones still back off
+      g.pct = g.pct > PROFILE_MIN_PCT + down ? g.pct - down : PROFILE_MIN_PCT;
+      g.step /= 2;
+      store(index());
+      done_ |= bit();
+      losses_++;
+    }
+  }
+
+  /** The run made it: raise its clean segments, as the next run's trial. */
+  void finish() {
+    close();
+    state_ = count_;
+    for (uint8_t i = 0; i < count_ * PROFILE_SEGMENTS; i++) {
+      SegmentSpeed& g = seg_[i];
+      if (!(clean_ & 1UL << i) || !g.step || g.pct >= PROFILE_MAX_PCT) clean_ &= ~(1UL << i);
+      else {
+        g.pct = g.pct + g.step < PROFILE_MAX_PCT ? g.pct + g.step : PROFILE_MAX_PCT;
+        store(i);
+      }
+    }
+    header_.running = 0;
+    header_.trial = clean_;
+    storeHeader();
+    while (pending()) service(PROFILE_FLUSH_US);   // The run is over: nothing to steer
+  }
+
+  /**
+   * Write what changed for up to `budgetUs` (at least one segment or
+   * header byte). Returns the microseconds spent. Call from loop().
+   */
+  uint32_t service(uint32_t budgetUs) {
+    if (!pending()) return 0;
+    uint32_t start = micros();
+    do {
+      if (dirty_) {
+        uint8_t i = 0;
+        while (!(dirty_ & 1UL << i)) i++;
+        int addr = PROFILE_BASE + sizeof(Header) + i * sizeof(SegmentSpeed);
+        EEPROM.update(addr, seg_[i].pct);
+        EEPROM.update(addr + 1, seg_[i].step);
+        dirty_ &= ~(1UL << i);
+      } else {
+        EEPROM.update(PROFILE_BASE + headerPos_, ((const uint8_t*)&header_)[headerPos_]);
+        if (++headerPos_ == sizeof(Header)) headerDirty_ = false;
+      }
+    } while (pending() && (uint32_t)micros() - start < budgetUs);
+    return micros() - start;
+  }
+
+  bool pending() const { return dirty_ || headerDirty_; }
+
+  /** `nominal` scaled for where we are now; unlearned states get it as is. */
+  uint8_t speed(uint8_t nominal) const {
+    if (state_ >= count_) return nominal;
+    uint16_t pwm = (uint16_t)nominal * seg_[index()].pct / 100;
+    return pwm > 255 ? 255 : pwm;
+  }
+
+  void report() const {
+    Serial.print(F("PROFILE: run="));
+    Serial.print(run_);
+    Serial.print(F(" losses="));
+    Serial.print(losses_);
+    Serial.print(F(" off_pct="));
+    Serial.print(readsTotal_ ? offTotal_ * 100UL / readsTotal_ : 0);
+    Serial.print(F(" rolled_back="));
+    Serial.print(rolledBack_);
+    Serial.print(F(" pct="));
+    for (uint8_t i = 0; i < count_; i++) {
+      if (i) Serial.print('|');
+      for (uint8_t s = 0; s < PROFILE_SEGMENTS; s++) {
+        if (s) Serial.print('/');
+        Serial.print(seg_[i * PROFILE_SEGMENTS + s].pct);
+      }
+    }
+    Serial.println();
+  }
+
+private:
+  struct Header {
+    uint8_t magic;       // 'S'
+    uint8_t key;         // layoutKey()
+    uint16_t run;        // Runs started
+    uint8_t running;     // A run started and hasn't finished
+    uint32_t trial;      // Segments the last finished run raised, on trial
+  };
+
+  /** Judge the segment we're leaving, if it was driven and not judged yet. */
+  void close() {
+    if (state_ >= count_ || reads_ < 3 || (done_ & bit())) return;   // Barely driven: no verdict
+    done_ |= bit();
+    if (off_ <= reads_ * PROFILE_OFF_MAX) clean_ |= bit();
+  }
+
+  /** Take back the raises of a trial that didn't finish. */
+  void rollBack(uint32_t trial) {
+    for (uint8_t i = 0; i < PROFILE_STATES * PROFILE_SEGMENTS; i++) {
+      if (!(trial & 1UL << i)) continue;
+      SegmentSpeed& g = seg_[i];
+      g.pct = g.pct > PROFILE_MIN_PCT + g.step ? g.pct - g.step : PROFILE_MIN_PCT;
+      g.step /= 2;
+      store(i);
+      rolledBack_++;
+    }
+  }
+
+  uint8_t index() const { return state_ * PROFILE_SEGMENTS + segment_; }
+  uint32_t bit() const { return 1UL << index(); }
+
+  uint8_t stateIndex(uint8_t state) const {
+    for (uint8_t i = 0; i < count_; i++) if (states_[i] == state) return i;
+    return count_;
+  }
+
+  /** Mark for service() to write (segments before the header). */
+  void store(uint8_t i) { dirty_ |= 1UL << i; }
+  void storeHeader() {
+    headerDirty_ = true;
+    headerPos_ = 0;   // Changed mid-write: all of it again
+  }
+
+  /** Section, states and segment size: a different sketch's profile doesn't fit. */
+  uint8_t layoutKey(uint8_t section) const {
+    uint8_t k = section * 31 + PROFILE_SEGMENT_CM;
+    for (uint8_t i = 0; i < count_; i++) k = k * 31 + states_[i];
+    return k;
+  }
+
+  SegmentSpeed seg_[PROFILE_STATES * PROFILE_SEGMENTS];
+  const uint8_t* states_ = nullptr;
+  uint8_t count_ = 0;
+  uint8_t state_ = PROFILE_STATES;   // Index into states_; count_ = not learning here
+  uint8_t segment_ = 0;
+  float enteredCm_ = 0;
+  float lostFrom_ = -1;              // Odometer where the line went; < 0 = on it
+  bool began_ = true;                // This segment began on the line
+  uint16_t reads_ = 0, off_ = 0;     // This segment
+  uint32_t readsTotal_ = 0, offTotal_ = 0;
+  uint32_t done_ = 0;                // Segments judged this run
+  uint32_t clean_ = 0;               // ...of which driven cleanly
+  uint16_t run_ = 0, losses_ = 0, rolledBack_ = 0;
+  bool resume_ = false;
+  Header header_ = {};               // As it goes to EEPROM
+  uint32_t dirty_ = 0;               // Segments service() still has to write
+  bool headerDirty_ = false;         // ...and then the header,
+  uint8_t headerPos_ = 0;            // from this byte on
+};
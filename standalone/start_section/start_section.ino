@@ -37,6 +37,15 @@
  */
 
 #include <Servo.h>  // Library to control servo motors
+#include <FspTimer.h>  // UNO R4 core: hardware timers with an interrupt callback
+#include "spsc_queue.h"  // Lock-free queue: interrupt -> loop() (in this folder)
+#include "event_bus.h"    // Sensor changes -> state handlers (in this folder)
+#include "checkpoint.h"   // Mission state in EEPROM, to resume after a brownout (in this folder)
+#include "mission_clock.h" // The section's time budget: cruise speed and search times (in this folder)
+#include "speed_profile.h" // Line-following speeds learned in practice runs, in EEPROM (in this folder)
+#include "power_arbiter.h" // Motors and servos kept under one current budget (in this folder)
+#include "mission_program.h" // The route as bytecode, reloadable over Serial (in this folder)
+#include "trace.h"          // Begin/end spans for a Chrome trace of the run (in this folder)
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                           PIN DEFINITIONS                                  ║
@@ -91,6 +100,11 @@
 #define PIN_IR_LEFT       A2  // Left IR sensor
 #define PIN_IR_RIGHT      A3  // Right IR sensor
 
+// --- START BUTTON (optional, see START_TRIGGER) ---
+// A push button from this pin to GND. D0 is free: Serial is the USB port on
+// the R4, and pin 13 has the built-in LED on it (it would drag the pull-up down).
+#define PIN_START         0
+
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                              CONSTANTS                                     ║
@@ -124,6 +138,121 @@
 #define TIME_TURN_90      500   // How long to turn for ~90 degrees
 #define TIME_SERVO_MOVE   300   // Time to wait for servo to reach position
 
+// --- TELEMETRY ---
+// Every N loop ticks, print one compact "T:" line for the Coach App.
+// At 9600 baud a line costs ~25ms of Serial time, so don't go below ~3.
+#define TELEMETRY_EVERY   5     // 0 = off
+
+// --- TRACE ---
+// Which spans go out as "TRACE:" lines (see trace.h; host/trace_export
+// makes a Chrome trace of them): states 1, sensors 2, maneuvers 4,
+// servos 8, the loop's idle wait 16. Sensors and waits are a span every
+// tick: with those on, raise the baud rate or expect lost events.
+#define TRACE_MASK        13    // States, maneuvers, servos; 0 = off
+
+// Turns a #define's value into text, so the boot banner can report the
+// constants this build was compiled with (the Coach App logs them per run).
+#define STR_(x) #x
+#define STR(x)  STR_(x)
+
+// --- CONTROL INTERRUPT ---
+// A hardware timer calls controlTick() this many times a second, and only
+// that interrupt touches the motor pins. The motor functions just say what
+// they want; the interrupt applies it on the next tick. So the motors update
+// every 1 ms even while loop() is stuck in an 80 ms color read or a delay().
+#define CONTROL_HZ        1000  // 500-1000 is plenty; 0 = off (old behavior)
+#define CONTROL_SLEW      0     // Max PWM change per tick for soft starts (0 = instant)
+#define CONTROL_REPORT_MS 5000  // Print a "CTRL:" timing line this often (0 = never)
+
+// --- ULTRASONIC ECHO ---
+// An interrupt timestamps the echo pin's edges, so loop() doesn't have to
+// sit in pulseIn() for up to 25ms per reading (see readDistance()).
+#define ECHO_TIMEOUT_US   25000  // No echo by then = nothing in range (~4.25m)
+#define ECHO_FRESH_MS     150    // A result older than this is stale: wait for a new ping
+
+// --- STOPPING ---
+// A reading is already old when we act on it (a color read takes ~35ms,
+// an echo is one loop behind) and the wheels coast on after stopMotors().
+// A model of the drive (see MOTION MODEL) says how far we went meanwhile,
+// so a stop decision is made for where the robot WILL be, not where it was.
+#define DRIVE_CM_PER_PWM  0.29  // Wheel speed (cm/s) per PWM step above the deadband
+#define DRIVE_DEADBAND    50    // PWM below this doesn't turn the wheels
+#define DRIVE_TAU_MS      80    // Wheels get ~63% of the way to a new speed in this time
+#define STOP_COMPENSATION 1     // 0 = act on the raw readings (old behavior)
+#define BLUE_ENTRY_CM     8     // Stop this far past the blue edge to drop the box
+#define RANGE_BLEND       0.5   // Weight of a new echo in the tracked range (1 = no filter)
+#define RANGE_GATE_CM     10    // A reading this far off the track = a new object: jump to it
+
+// --- BOX APPROACH ---
+// APPROACH_BOX slows down as the box gets closer instead of creeping at
+// SPEED_SLOW the whole way: speed = gain x range still to go.
+#define APPROACH_GAIN     10.0  // cm/s of approach speed per cm to go
+#define APPROACH_MIN_PWM  80    // Never slower: the wheels stall near DRIVE_DEADBAND
+
+// --- BRANCH SELECTION ---
+// At the intersection the robot pivots on the junction while reading colors
+// and notes at which heading each branch passes under the sensor, then turns
+// to the middle of the green one (see selectBranch()).
+#define DRIVE_TRACK_CM    13    // Wheel spacing: turns the wheel speeds into a heading
+#define COLOR_FWD_CM      4     // Color sensor ahead of the wheel axle (the pivot)
+#define SPEED_SCAN        120   // Pivot PWM while scanning (~180°/s, a color read every 3-6°)
+#define BRANCH_SCAN_DEG   120   // Look this far to each side of the way we came in
+#define BRANCH_MIN_DEG    10    // A narrower green run is a stray reading
+#define BRANCH_STEP_CM    8     // Drive this far onto the branch for the second look
+#define BRANCH_LOOK_DEG   70    // ...which scans this far either side
+#define BRANCH_ALIGN_DEG  3     // Close enough to the branch's middle
+#define BRANCH_CORRECTIONS 2    // Nudges after the turn, at most
+
+// --- CHECKPOINT ---
+// Every state change is saved to EEPROM (see checkpoint.h). After a
+// brownout or watchdog reset the robot picks up from the saved state
+// instead of starting the section over. Switching on, the reset button
+// and a new upload always start fresh.
+#define CHECKPOINT_RESUME 1     // 0 = never resume
+#define CHECKPOINT_BUDGET_US 20000 // EEPROM writing per loop() tick, at most: well inside its 50ms wait
+
+// --- BOOT & START ---
+// setup() no longer sleeps 1 s "for everything to stabilize": it checks
+// that each part is ready (see waitUntilReady()) and then waits for the
+// start cue, so the robot doesn't drive off the moment it's switched on.
+#define START_NOW         0     // Cues: go as soon as everything is ready (old behavior)
+#define START_BUTTON      1     //   PIN_START pressed
+#define START_WAVE        2     //   a hand held in front of the ultrasonic, then taken away
+#define START_LINE        3     //   the color sensor sees the line appear (pull a white card out from under it)
+#define START_TRIGGER     START_WAVE
+#define START_WAVE_CM     10    // Closer than this is a hand
+#define START_HOLD_MS     300   // A cue must last this long (a passing reflection doesn't count)
+#define BOOT_SERVO_MS     450   // Worst servo move at power-on: 180° at 0.15 s / 60°
+#define BOOT_TIMEOUT_MS   1000  // Stop waiting for a part that never says ready (the old delay)
+
+// --- MISSION BUDGET ---
+// The clock starts at the start cue. If the run falls behind its PLAN (see
+// MISSION BUDGET below) the line following speeds up and the branch search
+// gives up sooner.
+#define MISSION_ADAPT     1     // 0 = fixed speeds and search times (the old way)
+#define MISSION_BUDGET_MS 18000 // This section's share of the competition time
+#define MISSION_RESERVE_MS 1500 // ...minus this, kept back for surprises
+#define SPEED_CRUISE_MAX  185   // Fastest the one-sensor line follower may go
+#define BRANCH_GIVE_UP_MS 8000  // Retrying the branch scan, at most...
+#define BRANCH_LEAST_MS   2000  // ...and at least, however late we are
+
+// --- SPEED PROFILE ---
+// Each run learns from the last: every stretch of line a finished run
+// followed cleanly goes a little faster next time, and back if that run
+// doesn't finish; where it lost the line it slows again, never below
+// SPEED_NORMAL (see speed_profile.h). The profile stays in EEPROM.
+#define SPEED_LEARN     1     // 0 = SPEED_NORMAL everywhere, nothing learned
+#define SPEED_FORGET    0     // 1 = start over from SPEED_NORMAL (upload once, then set back to 0)
+
+// --- POWER BUDGET ---
+// Motors starting or reversing while a servo slews can pull the battery
+// down far enough to reset the board. The control interrupt keeps what
+// they draw together under this (see power_arbiter.h): the motors ramp up
+// as fast as it allows and a servo waits or slews slower until they have.
+#define POWER_BUDGET_MA   1500  // The battery sags below the board's brownout at ~1.6 A
+#define SERVO_ARM         0     // Arbiter's servo numbers
+#define SERVO_CLAMP       1
+
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                           DATA TYPES                                       ║
@@ -158,7 +287,8 @@ enum State {
   STATE_APPROACH_BLUE,     // Moving into the blue drop zone
   STATE_DROP,              // Executing drop sequence
   STATE_TO_REUPLOAD,       // Heading to re-upload point
-  STATE_COMPLETE           // Section 1 finished!
+  STATE_COMPLETE,          // Section 1 finished!
+  STATE_TURN               // Pivoting for a program's TURN (after COMPLETE: the numbers above stay)
 };
 
 
@@ -169,9 +299,31 @@ enum State {
 
 Servo baseServo;              // Servo object for arm (up/down)
 Servo clampServo;             // Servo object for claw (open/close)
+PowerArbiter power;           // Moves both servos, caps the motors (control interrupt)
 State currentState;           // What the robot is currently doing
 bool holding = false;         // Is the robot holding a box?
 uint32_t stateStartTime = 0;  // When did we enter the current state?
+Color lastColor = COLOR_NONE; // Latest color reading (for telemetry)
+uint32_t colorSeenUs = 0;     // colorAtUs of the reading that ended the last FOLLOW (junction, blue edge)
+float lastDistance = 999.0;   // Latest distance reading (for telemetry)
+EventBus<8> bus;              // Sensor changes -> state handlers (see event_bus.h)
+CheckpointStore checkpoint;   // Where we are in the mission, in EEPROM (see checkpoint.h)
+MissionClock mission;         // Time used vs. the plan (see mission_clock.h)
+SpeedProfile profile;         // Learned line-following speeds (see speed_profile.h)
+MissionProgram program;       // The route, step by step (see mission_program.h)
+ProgramStep programStep;      // The step running now
+bool adapting = false;        // MISSION_ADAPT on the built-in route (set in setup())
+bool learning = false;        // SPEED_LEARN, likewise
+Tracer trace;                 // Spans of the run, sent as TRACE: lines (see trace.h)
+
+// Trace ids (named in setup()): a state's span is TRACE_STATE + its State
+enum TraceId : uint8_t {
+  TRACE_STATE = 0,
+  TRACE_COLOR = 16, TRACE_ECHO,
+  TRACE_TURN = 24, TRACE_STOP_PAST, TRACE_BRANCH, TRACE_PICKUP, TRACE_DROP,
+  TRACE_SERVO_WAIT = 40,
+  TRACE_IDLE = 48
+};
 
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
@@ -179,6 +331,106 @@ uint32_t stateStartTime = 0;  // When did we enter the current state?
 // ║  Functions to read data from sensors.                                     ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
 
+/**
+ * SENSOR EVENTS - Interrupts push, loop() pops.
+ * 
+ * An interrupt can fire in the middle of anything loop() does, so the two
+ * can't share a plain variable safely. sensorEvents is a lock-free queue
+ * (spsc_queue.h): the interrupt pushes, loop() pops, and neither ever has
+ * to switch interrupts off. If loop() falls 16 events behind, new events
+ * are dropped and counted (printed by reportSensorQueue()).
+ */
+enum EventKind : uint8_t {
+  EV_ECHO_RISE,      // Ultrasonic echo pin went HIGH (sound sent)
+  EV_ECHO_FALL       // ...and LOW again (echo came back)
+};
+struct SensorEvent {
+  uint32_t us;       // micros() at the edge
+  EventKind kind;
+};
+SpscQueue<SensorEvent, 16> sensorEvents;
+
+bool echoByInterrupt = false;   // false: the echo pin has no interrupt, use pulseIn()
+bool pingInFlight = false;      // Sent a ping, result not in yet
+bool echoStarted = false;       // Saw this ping's rising edge
+uint32_t pingSentUs = 0;        // When the ping went out
+uint32_t echoRiseUs = 0;        // When the echo pin went HIGH
+uint32_t resultPingUs = 0;      // When the ping behind echoDistance was sent
+float echoDistance = 999.0;     // Latest result (cm)
+uint32_t distanceAtUs = 0;      // When the sound hit what echoDistance measured
+uint32_t colorAtUs = 0;         // Middle of the latest readColor()
+
+/**
+ * echoEdge() - Interrupt on BOTH edges of the echo pin.
+ * Just writes down the time; all the math happens in loop().
+ */
+void echoEdge() {
+  SensorEvent e = {(uint32_t)micros(), digitalRead(PIN_ULTRA_ECHO) == HIGH ? EV_ECHO_RISE : EV_ECHO_FALL};
+  sensorEvents.push(e);   // Queue full? Dropped and counted
+}
+
+/**
+ * sendPing() - Fire the ultrasonic sensor (10µs pulse on TRIG).
+ */
+void sendPing() {
+  // Ensure trigger is LOW before starting
+  digitalWrite(PIN_ULTRA_TRIG, LOW);
+  delayMicroseconds(2);
+  
+  // Send 10µs pulse to trigger the sensor
+  digitalWrite(PIN_ULTRA_TRIG, HIGH);
+  delayMicroseconds(10);
+  digitalWrite(PIN_ULTRA_TRIG, LOW);
+  
+  pingSentUs = micros();
+  pingInFlight = true;
+  echoStarted = false;
+}
+
+/**
+ * serviceEcho() - Handle the queued echo edges.
+ * Rising edge + falling edge = one measurement. No falling edge within
+ * ECHO_TIMEOUT_US = nothing in range (999).
+ */
+void serviceEcho() {
+  SensorEvent e;
+  while (sensorEvents.pop(e)) {
+    if (e.kind == EV_ECHO_RISE) {
+      echoRiseUs = e.us;
+      echoStarted = true;
+    } else if (pingInFlight && echoStarted) {
+      // Speed of sound = 343 m/s = 0.034 cm/µs, and the sound went there AND back
+      echoDistance = ((e.us - echoRiseUs) * 0.034) / 2.0;
+      distanceAtUs = echoRiseUs + (e.us - echoRiseUs) / 2;   // Halfway there and back
+      resultPingUs = pingSentUs;
+      pingInFlight = false;
+      trace.complete(TRACE_ECHO, pingSentUs, e.us, echoDistance);
+    }
+  }
+  if (pingInFlight && micros() - pingSentUs > ECHO_TIMEOUT_US) {
+    echoDistance = 999.0;
+    resultPingUs = pingSentUs;
+    pingInFlight = false;
+    trace.complete(TRACE_ECHO, pingSentUs, pingSentUs + ECHO_TIMEOUT_US, 999);
+  }
+}
+
+/**
+ * startEcho() - Attach the echo interrupt and check that it works.
+ * A ping always raises the echo pin within a millisecond, so if nothing
+ * was queued after 5ms this pin can't interrupt: fall back to pulseIn().
+ */
+void startEcho() {
+  attachInterrupt(digitalPinToInterrupt(PIN_ULTRA_ECHO), echoEdge, CHANGE);
+  sendPing();
+  delay(5);
+  echoByInterrupt = !sensorEvents.empty();
+  if (!echoByInterrupt) {
+    detachInterrupt(digitalPinToInterrupt(PIN_ULTRA_ECHO));
+    Serial.println(F("ECHO: no interrupt on the echo pin, using pulseIn()"));
+  }
+}
+
 /**
  * readDistance() - Measure distance using ultrasonic sensor.
  * 
@@ -190,31 +442,50 @@ uint32_t stateStartTime = 0;  // When did we enter the current state?
  * 5. Calculate distance: distance = (time × speed_of_sound) / 2
  *    (divide by 2 because sound travels TO object AND back)
  * 
+ * Step 4 is done by echoEdge(), so we don't wait for it: each call
+ * returns the PREVIOUS ping's result (one loop old) and sends the next
+ * ping. Only when that result is older than ECHO_FRESH_MS (the first
+ * call, or after a long turn) do we wait for the new one.
+ * 
+ * distanceAtUs says when the returned distance was true (the moment
+ * the sound reached the object).
+ * 
  * RETURNS: Distance in centimeters (or 999 if no object detected)
  */
 float readDistance() {
-  // Ensure trigger is LOW before starting
-  digitalWrite(PIN_ULTRA_TRIG, LOW);
-  delayMicroseconds(2);
-  
-  // Send 10µs pulse to trigger the sensor
-  digitalWrite(PIN_ULTRA_TRIG, HIGH);
-  delayMicroseconds(10);
-  digitalWrite(PIN_ULTRA_TRIG, LOW);
+  if (!echoByInterrupt) {
+    // No interrupt on this pin: time the echo the old way
+    sendPing();
+    unsigned long duration = pulseIn(PIN_ULTRA_ECHO, HIGH, ECHO_TIMEOUT_US);
+    distanceAtUs = micros() - duration / 2;
+    float cm = duration == 0 ? 999.0 : (duration * 0.034) / 2.0;
+    trace.complete(TRACE_ECHO, pingSentUs, micros(), cm);
+    return cm;
+  }
   
-  // Measure how long the echo pulse is HIGH
-  // Timeout after 25000µs (~4.25m max distance)
-  unsigned long duration = pulseIn(PIN_ULTRA_ECHO, HIGH, 25000);
+  serviceEcho();
+  bool stale = micros() - resultPingUs > ECHO_FRESH_MS * 1000UL;
   
-  // If timeout (duration=0), return 999 to indicate "no object"
-  if (duration == 0) {
-    return 999.0;
-  }
+  // Next ping (the sensor ignores triggers while its echo pin is still HIGH)
+  if (!pingInFlight && digitalRead(PIN_ULTRA_ECHO) == LOW) sendPing();
   
-  // Convert time to distance
-  // Speed of sound = 343 m/s = 0.034 cm/µs
-  // Distance = (duration × 0.034) / 2
-  return (duration * 0.034) / 2.0;
+  // Nothing recent to return: wait for this ping (at most ECHO_TIMEOUT_US)
+  while (stale && pingInFlight) serviceEcho();
+  return echoDistance;
+}
+
+/**
+ * reportSensorQueue() - How full the event queue got:
+ *   QUEUE: sensor peak=2/16 overflows=0
+ * overflows > 0 means loop() fell behind and events were lost.
+ */
+void reportSensorQueue() {
+  Serial.print(F("QUEUE: sensor peak="));
+  Serial.print(sensorEvents.peak());
+  Serial.print('/');
+  Serial.print(sensorEvents.capacity());
+  Serial.print(F(" overflows="));
+  Serial.println(sensorEvents.overflows());
 }
 
 /**
@@ -234,9 +505,15 @@ float readDistance() {
  * We use pulseIn() to measure the pulse width (inverse of frequency).
  * HIGHER pulse width = LOWER frequency = MORE color detected.
  * 
+ * The three reads take ~35ms while the robot keeps moving, so colorAtUs
+ * is set to the middle of them: where the robot was when it saw this.
+ * 
  * RETURNS: Detected Color enum value
  */
 Color readColor() {
+  TraceSpan span(trace, TRACE_COLOR);
+  uint32_t startUs = micros();
+  
   // Read RED value (S2=LOW, S3=LOW)
   digitalWrite(PIN_COLOR_S2, LOW);
   digitalWrite(PIN_COLOR_S3, LOW);
@@ -254,6 +531,7 @@ Color readColor() {
   digitalWrite(PIN_COLOR_S3, HIGH);
   delay(10);
   uint16_t b = pulseIn(PIN_COLOR_OUT, LOW, 40000);
+  colorAtUs = startUs + (micros() - startUs) / 2;
   
   // Handle timeout (pulseIn returns 0 if no pulse detected)
   if (r == 0) r = 999;
@@ -308,6 +586,325 @@ void readIR(bool& left, bool& right) {
 }
 
 
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                         CONTROL INTERRUPT                                  ║
+// ║  A hardware timer drives the motors at a fixed rate.                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+FspTimer controlTimer;
+volatile bool controlRunning = false;
+volatile int16_t targetLeft = 0, targetRight = 0;   // Signed PWM: < 0 = backward
+int16_t outLeft = 0, outRight = 0;                  // What the pins are at (ISR only, once it runs)
+
+struct ControlStats {            // CPU cycles; written by the ISR, read by reportControl()
+  uint32_t ticks, late;
+  uint32_t periodMin, periodMax, periodSum;
+  uint32_t execMax, execSum;
+};
+const ControlStats CONTROL_STATS_EMPTY = {0, 0, UINT32_MAX, 0, 0, 0, 0};
+ControlStats ctrlStats = CONTROL_STATS_EMPTY;
+uint32_t ctrlLastStart = 0;
+uint32_t ctrlNominal = 0;        // Cycles per tick
+
+/**
+ * applyMotors() - Set direction pins and PWM for both motors.
+ * Positive = forward, negative = backward, 0 = stop. Once the control
+ * timer is running, ONLY controlTick() calls this (two writers fighting
+ * over the same pins would glitch them).
+ */
+void applyMotors(int16_t left, int16_t right) {
+  digitalWrite(PIN_MOTOR_IN1, left >= 0 ? HIGH : LOW);   // LEFT direction
+  digitalWrite(PIN_MOTOR_IN2, left >= 0 ? LOW : HIGH);
+  digitalWrite(PIN_MOTOR_IN3, right >= 0 ? HIGH : LOW);  // RIGHT direction
+  digitalWrite(PIN_MOTOR_IN4, right >= 0 ? LOW : HIGH);
+  analogWrite(PIN_MOTOR_ENA, abs(left));
+  analogWrite(PIN_MOTOR_ENB, abs(right));
+}
+
+int16_t slewToward(int16_t from, int16_t to) {
+  if (CONTROL_SLEW == 0) return to;
+  if (to > from + CONTROL_SLEW) return from + CONTROL_SLEW;
+  if (to < from - CONTROL_SLEW) return from - CONTROL_SLEW;
+  return to;
+}
+
+/**
+ * MOTION MODEL - How far we've driven, from what the motors were told.
+ * 
+ * There are no wheel encoders, so the odometer is a model: each wheel's
+ * speed follows its PWM (less the deadband) with a DRIVE_TAU_MS lag, and
+ * the odometer adds up the average of the two wheels (cm forward; a pivot
+ * adds nothing). Their difference turns the robot: modelHeading. The right
+ * wheel's PWM is divided by SPEED_COMPENSATION to get the speed it was
+ * meant to match.
+ * 
+ * Every few ticks the odometer goes into a short history, so the
+ * sensors only have to say WHEN they measured (colorAtUs, distanceAtUs)
+ * and travelledSince() works out how far we've gone since.
+ */
+#define ODO_HISTORY       64   // Samples kept...
+#define ODO_EVERY_TICKS   4    // ...one every 4 control ticks (256ms at 1 kHz)
+#define ODO_SPARE         2    // Oldest samples travelledSince() skips (the ISR may be writing them)
+
+struct OdoSample {
+  uint32_t us;
+  float cm;
+};
+OdoSample odoHistory[ODO_HISTORY];
+uint8_t odoNewest = 0;
+uint8_t odoTicks = 0;
+volatile float odometer = 0;     // cm driven forward (model)
+volatile float modelSpeed = 0;   // cm/s right now (model)
+volatile float wheelLeft = 0, wheelRight = 0;   // cm/s of each wheel (model)
+volatile float modelHeading = 0; // Degrees turned since power-on, counterclockwise (model)
+uint32_t modelUpdatedUs = 0;     // Without the control timer: when loop() last stepped it
+
+float wheelModelSpeed(float pwm) {
+  float over = (pwm < 0 ? -pwm : pwm) - DRIVE_DEADBAND;
+  if (over <= 0) return 0;
+  return (pwm < 0 ? -over : over) * DRIVE_CM_PER_PWM;
+}
+
+// Advance the model by dt seconds at these outputs
+void stepModel(int16_t left, int16_t right, float dt, uint32_t nowUs) {
+  float lag = dt / (DRIVE_TAU_MS / 1000.0f + dt);
+  wheelLeft += (wheelModelSpeed(left) - wheelLeft) * lag;
+  wheelRight += (wheelModelSpeed(right / SPEED_COMPENSATION) - wheelRight) * lag;
+  modelSpeed = (wheelLeft + wheelRight) / 2;
+  odometer += modelSpeed * dt;
+  modelHeading += (wheelRight - wheelLeft) / DRIVE_TRACK_CM * dt * 57.2958f;   // rad -> deg
+  if (++odoTicks < ODO_EVERY_TICKS && controlRunning) return;
+  odoTicks = 0;
+  odoNewest = (odoNewest + 1) % ODO_HISTORY;
+  odoHistory[odoNewest].us = nowUs;
+  odoHistory[odoNewest].cm = odometer;
+}
+
+/**
+ * controlTick() - The control interrupt. Runs CONTROL_HZ times a second.
+ * 
+ * 1. Time itself: how far apart the ticks really are (jitter) and how
+ *    long the tick takes, counted in CPU cycles (48 per microsecond).
+ * 2. Move the motor outputs toward what the mission asked for, as far
+ *    as the power budget allows, and step the servos.
+ * 3. Step the motion model.
+ * 
+ * Keep it SHORT: no Serial, no delay(), no pulseIn() in here.
+ */
+void controlTick(timer_callback_args_t*) {
+  uint32_t start = DWT->CYCCNT;
+  ControlStats& s = ctrlStats;
+  if (s.ticks++ > 0) {   // The first tick of a window has no period yet
+    uint32_t period = start - ctrlLastStart;
+    if (period < s.periodMin) s.periodMin = period;
+    if (period > s.periodMax) s.periodMax = period;
+    if (period > ctrlNominal + ctrlNominal / 2) s.late++;
+    s.periodSum += period;
+  }
+  ctrlLastStart = start;
+
+  int16_t wantLeft = targetLeft, wantRight = targetRight;
+  int16_t left = slewToward(outLeft, wantLeft);
+  int16_t right = slewToward(outRight, wantRight);
+  power.tick(left, right);   // Under POWER_BUDGET_MA; steps the servos
+  if (left != outLeft || right != outRight) {
+    applyMotors(left, right);
+    outLeft = left;
+    outRight = right;
+  }
+  stepModel(outLeft, outRight, 1.0f / CONTROL_HZ, micros());
+
+  uint32_t exec = DWT->CYCCNT - start;
+  s.execSum += exec;
+  if (exec > s.execMax) s.execMax = exec;
+}
+
+/**
+ * odometerCm() - The model's odometer now. Without the control timer,
+ * loop() steps the model itself, from the last call to now (coarser,
+ * but still counts the time spent in delay()).
+ */
+float odometerCm() {
+  if (!controlRunning) {
+    uint32_t now = micros();
+    stepModel(outLeft, outRight, (now - modelUpdatedUs) / 1000000.0f, now);
+    modelUpdatedUs = now;
+  }
+  return odometer;   // A float is one 32-bit read: the ISR can't tear it
+}
+
+/**
+ * travelledSince() - cm driven since micros() was `us`, from the
+ * odometer history (older than the history = the oldest sample).
+ */
+float travelledSince(uint32_t us) {
+  float now = odometerCm();
+  OdoSample newer = {(uint32_t)micros(), now};
+  OdoSample s = newer;
+  noInterrupts();   // The ISR writes the history: only the copies are guarded
+  uint8_t i = odoNewest;
+  interrupts();
+  // Newest to oldest. The ISR only overwrites the slots after odoNewest,
+  // the oldest, so the last ODO_SPARE are left alone
+  for (uint8_t n = 0; n < ODO_HISTORY - ODO_SPARE; n++) {
+    newer = s;
+    noInterrupts();
+    s = odoHistory[i];
+    interrupts();
+    if ((int32_t)(s.us - us) <= 0) break;
+    i = (i + ODO_HISTORY - 1) % ODO_HISTORY;
+  }
+  if ((int32_t)(s.us - us) > 0) return now - s.cm;   // Older than the history: the oldest we have
+  // us is between s and the newer sample: interpolate
+  uint32_t span = newer.us - s.us;
+  float then = span ? s.cm + (newer.cm - s.cm) * (us - s.us) / span : s.cm;
+  return now - then;
+}
+
+/**
+ * coastCm() - How far the robot would still roll if we stopped now.
+ * A first-order lag covers speed x DRIVE_TAU_MS before it stands still.
+ */
+float coastCm() {
+  float v = modelSpeed;
+  return v > 0 ? v * DRIVE_TAU_MS / 1000.0f : 0;
+}
+
+/**
+ * turnRate() - How fast the robot is turning now, in degrees per second
+ * (counterclockwise = positive). A pivot coasts on by turnRate() x
+ * DRIVE_TAU_MS, just like coastCm().
+ */
+float turnRate() {
+  return (wheelRight - wheelLeft) / DRIVE_TRACK_CM * 57.2958f;
+}
+
+/**
+ * trackRange() - The range to whatever is ahead, as of NOW.
+ * 
+ * Between echoes the odometer says how much closer we got; each new echo
+ * (moved forward to now the same way) is blended in by RANGE_BLEND, which
+ * smooths out the sensor's jitter without the lag of a plain average. An
+ * echo more than RANGE_GATE_CM off is something new in the beam: start
+ * over from it. Pass every readDistance() result, once per tick.
+ */
+float trackedRange = 999.0;
+float trackedOdo = 0;
+uint32_t trackedAtUs = 0;        // distanceAtUs of the last echo blended in
+
+float trackRange(float dist) {
+  float odo = odometerCm();
+  if (trackedRange < 999.0) trackedRange -= odo - trackedOdo;
+  trackedOdo = odo;
+  if (distanceAtUs == trackedAtUs) return trackedRange;   // No new echo
+  trackedAtUs = distanceAtUs;
+  
+  float now = dist >= 999.0 ? 999.0 : dist - travelledSince(distanceAtUs);
+  if (now >= 999.0 || trackedRange >= 999.0 || fabs(now - trackedRange) > RANGE_GATE_CM) {
+    trackedRange = now;
+  } else {
+    trackedRange += RANGE_BLEND * (now - trackedRange);
+  }
+  return trackedRange;
+}
+
+/**
+ * rangeAtStop() - What readDistance() would say once we've stopped, if
+ * we stopped right now: the tracked range less the coast. This is what
+ * the range events are decided on.
+ */
+float rangeAtStop(float dist) {
+  if (!STOP_COMPENSATION) return dist;
+  float range = trackRange(dist);
+  if (range >= 999.0) return range;
+  float ahead = range - coastCm();
+  return ahead > 0.1 ? ahead : 0.1;   // Already past: still "below" (0 = no reading)
+}
+
+uint32_t firstMotionMs = 0;      // millis() of the first drive command (see reportBoot())
+
+/**
+ * setDrive() - Ask for a motor output. Every motor function calls this.
+ * With the timer running it just stores the targets (the next tick
+ * applies them); without it, it writes the pins right away.
+ */
+void setDrive(int16_t left, int16_t right) {
+  if (!firstMotionMs && (left || right)) firstMotionMs = millis();
+  if (!controlRunning) {
+    odometerCm();   // The model catches up at the old outputs first
+    applyMotors(left, right);
+    outLeft = left;
+    outRight = right;
+    return;
+  }
+  noInterrupts();   // Both sides change on the same tick
+  targetLeft = left;
+  targetRight = right;
+  interrupts();
+}
+
+/**
+ * startControl() - Start the control timer. The UNO R4 core hands out a
+ * free GPT or AGT timer; call this AFTER stopMotors() so the PWM pins have
+ * claimed their timers first.
+ */
+void startControl() {
+  if (CONTROL_HZ == 0) return;
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;   // CPU cycle counter for the timing stats
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  ctrlNominal = SystemCoreClock / CONTROL_HZ;
+
+  uint8_t type;
+  int8_t channel = FspTimer::get_available_timer(type);
+  if (channel < 0 || !controlTimer.begin(TIMER_MODE_PERIODIC, type, channel, CONTROL_HZ, 0.0f, controlTick) ||
+      !controlTimer.setup_overflow_irq() || !controlTimer.open() || !controlTimer.start()) {
+    Serial.println(F("CTRL: no free timer, motors updated from loop()"));
+    return;
+  }
+  controlRunning = true;
+}
+
+/**
+ * reportControl() - Print the control timing since the last report:
+ * 
+ *   CTRL: hz=1000 ticks=5000 period_us=999.1/1000.0/1000.9 jitter_us=0.9 exec_us=3.2/6.0 late=0
+ * 
+ * period = time between ticks (min/avg/max), jitter = worst distance
+ * from the nominal period, exec = time spent inside the interrupt,
+ * late = ticks more than 1.5 periods apart.
+ */
+void reportControl() {
+  if (!controlRunning) return;
+  noInterrupts();
+  ControlStats s = ctrlStats;
+  ctrlStats = CONTROL_STATS_EMPTY;
+  interrupts();
+  if (s.ticks < 2) return;
+
+  float cyclesPerUs = SystemCoreClock / 1000000.0f;
+  float nominal = 1000000.0f / CONTROL_HZ;
+  float lo = s.periodMin / cyclesPerUs, hi = s.periodMax / cyclesPerUs;
+  Serial.print(F("CTRL: hz="));
+  Serial.print(CONTROL_HZ);
+  Serial.print(F(" ticks="));
+  Serial.print(s.ticks);
+  Serial.print(F(" period_us="));
+  Serial.print(lo, 1);
+  Serial.print('/');
+  Serial.print(s.periodSum / cyclesPerUs / (s.ticks - 1), 1);
+  Serial.print('/');
+  Serial.print(hi, 1);
+  Serial.print(F(" jitter_us="));
+  Serial.print(hi - nominal > nominal - lo ? hi - nominal : nominal - lo, 1);
+  Serial.print(F(" exec_us="));
+  Serial.print(s.execSum / cyclesPerUs / s.ticks, 1);
+  Serial.print('/');
+  Serial.print(s.execMax / cyclesPerUs, 1);
+  Serial.print(F(" late="));
+  Serial.println(s.late);
+}
+
+
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                          MOTOR FUNCTIONS                                   ║
 // ║  Functions to control the robot's movement.                               ║
@@ -318,8 +915,7 @@ void readIR(bool& left, bool& right) {
  * Sets PWM to 0 (no power to motors).
  */
 void stopMotors() {
-  analogWrite(PIN_MOTOR_ENA, 0);  // Stop Motor A (LEFT)
-  analogWrite(PIN_MOTOR_ENB, 0);  // Stop Motor B (RIGHT)
+  setDrive(0, 0);
 }
 
 /**
@@ -336,15 +932,7 @@ void stopMotors() {
  * Speed compensation applied to right motor (it's faster).
  */
 void moveForward(uint8_t speed) {
-  // Set direction: forward
-  digitalWrite(PIN_MOTOR_IN1, HIGH);
-  digitalWrite(PIN_MOTOR_IN2, LOW);
-  digitalWrite(PIN_MOTOR_IN3, HIGH);
-  digitalWrite(PIN_MOTOR_IN4, LOW);
-  
-  // Set speed with compensation (right motor is faster)
-  analogWrite(PIN_MOTOR_ENA, speed);                              // LEFT motor
-  analogWrite(PIN_MOTOR_ENB, (uint8_t)(speed * SPEED_COMPENSATION)); // RIGHT motor (reduced)
+  setDrive(speed, (uint8_t)(speed * SPEED_COMPENSATION));
 }
 
 /**
@@ -358,15 +946,7 @@ void moveForward(uint8_t speed) {
  * Used for gentle line-following corrections.
  */
 void curveLeft(uint8_t speed) {
-  // Direction: both forward
-  digitalWrite(PIN_MOTOR_IN1, HIGH);
-  digitalWrite(PIN_MOTOR_IN2, LOW);
-  digitalWrite(PIN_MOTOR_IN3, HIGH);
-  digitalWrite(PIN_MOTOR_IN4, LOW);
-  
-  // Left motor half speed, right motor full speed
-  analogWrite(PIN_MOTOR_ENA, speed / 2);                          // LEFT: half
-  analogWrite(PIN_MOTOR_ENB, (uint8_t)(speed * SPEED_COMPENSATION)); // RIGHT: full (compensated)
+  setDrive(speed / 2, (uint8_t)(speed * SPEED_COMPENSATION));     // LEFT half
 }
 
 /**
@@ -374,15 +954,7 @@ void curveLeft(uint8_t speed) {
  * Opposite of curveLeft: slow down the RIGHT motor.
  */
 void curveRight(uint8_t speed) {
-  // Direction: both forward
-  digitalWrite(PIN_MOTOR_IN1, HIGH);
-  digitalWrite(PIN_MOTOR_IN2, LOW);
-  digitalWrite(PIN_MOTOR_IN3, HIGH);
-  digitalWrite(PIN_MOTOR_IN4, LOW);
-  
-  // Left motor full speed, right motor half speed
-  analogWrite(PIN_MOTOR_ENA, speed);                                      // LEFT: full
-  analogWrite(PIN_MOTOR_ENB, (uint8_t)((speed / 2) * SPEED_COMPENSATION)); // RIGHT: half (compensated)
+  setDrive(speed, (uint8_t)((speed / 2) * SPEED_COMPENSATION));   // RIGHT half
 }
 
 /**
@@ -394,14 +966,7 @@ void curveRight(uint8_t speed) {
  * Used for sharp turns (like at intersections).
  */
 void turnLeft(uint8_t speed) {
-  // Left motor backward, right motor forward
-  digitalWrite(PIN_MOTOR_IN1, LOW);   // LEFT backward
-  digitalWrite(PIN_MOTOR_IN2, HIGH);
-  digitalWrite(PIN_MOTOR_IN3, HIGH);  // RIGHT forward
-  digitalWrite(PIN_MOTOR_IN4, LOW);
-  
-  analogWrite(PIN_MOTOR_ENA, speed);                              // LEFT
-  analogWrite(PIN_MOTOR_ENB, (uint8_t)(speed * SPEED_COMPENSATION)); // RIGHT (compensated)
+  setDrive(-speed, (uint8_t)(speed * SPEED_COMPENSATION));   // LEFT backward, RIGHT forward
 }
 
 /**
@@ -409,14 +974,38 @@ void turnLeft(uint8_t speed) {
  * Opposite of turnLeft.
  */
 void turnRight(uint8_t speed) {
-  // Left motor forward, right motor backward
-  digitalWrite(PIN_MOTOR_IN1, HIGH);  // LEFT forward
-  digitalWrite(PIN_MOTOR_IN2, LOW);
-  digitalWrite(PIN_MOTOR_IN3, LOW);   // RIGHT backward
-  digitalWrite(PIN_MOTOR_IN4, HIGH);
-  
-  analogWrite(PIN_MOTOR_ENA, speed);                              // LEFT
-  analogWrite(PIN_MOTOR_ENB, (uint8_t)(speed * SPEED_COMPENSATION)); // RIGHT (compensated)
+  setDrive(speed, -(uint8_t)(speed * SPEED_COMPENSATION));   // LEFT forward, RIGHT backward
+}
+
+/**
+ * stopPast() - Drive on (slowly, by default) and come to rest `cm` past
+ * where the robot was at micros() == atUs (e.g. where the color sensor
+ * saw the blue zone). Stops early enough for the coast to cover the rest.
+ * Gives up after 2s.
+ */
+void stopPast(uint32_t atUs, float cm, uint8_t speed = SPEED_SLOW) {
+  TraceSpan span(trace, TRACE_STOP_PAST);
+  uint32_t start = millis();
+  float from = odometerCm() - travelledSince(atUs);   // atUs drops out of the history soon
+  moveForward(speed);
+  while (odometerCm() - from + coastCm() < cm && millis() - start < 2000) {
+    delay(1);
+  }
+  stopMotors();
+}
+
+/**
+ * approachSpeed() - PWM for closing in on something `ahead` cm away
+ * (from rangeAtStop()) to stop `target` cm short of it.
+ * 
+ * Proportional: the speed asked for is APPROACH_GAIN x the cm still to
+ * go, turned into PWM with the motion model, so the robot comes in fast
+ * from far out and slows down into the grip pose. Capped at SPEED_NORMAL,
+ * and never below APPROACH_MIN_PWM so it doesn't stall short of it.
+ */
+uint8_t approachSpeed(float ahead, float target) {
+  float pwm = DRIVE_DEADBAND + APPROACH_GAIN * (ahead - target) / DRIVE_CM_PER_PWM;
+  return (uint8_t)constrain(pwm, APPROACH_MIN_PWM, SPEED_NORMAL);
 }
 
 
@@ -425,6 +1014,20 @@ void turnRight(uint8_t speed) {
 // ║  Functions to control the claw/arm mechanism.                             ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
 
+/**
+ * awaitServos() - Wait until the servos are there. The arbiter knows when
+ * (a move it had to stretch takes longer, a short one less); without the
+ * control timer it can only go by full speed, so `ms` - the old fixed
+ * wait - is still the least. Never more than 3 x `ms`: a move the motors
+ * keep starving is given up on rather than hanging the mission.
+ */
+void awaitServos(uint32_t ms) {
+  TraceSpan span(trace, TRACE_SERVO_WAIT);
+  uint32_t start = millis();
+  while (power.servosMoving() && millis() - start < 3 * ms) delay(5);
+  if (!controlRunning && millis() - start < ms) delay(ms - (millis() - start));
+}
+
 /**
  * pickup() - Execute the full box pickup sequence.
  * 
@@ -434,20 +1037,22 @@ void turnRight(uint8_t speed) {
  * 3. Raise arm to carrying position
  */
 void pickup() {
+  TraceSpan span(trace, TRACE_PICKUP);
   // Step 1: Lower arm
-  baseServo.write(SERVO_ARM_DOWN);
-  delay(TIME_SERVO_MOVE + 200);  // Extra time for larger movement
+  power.moveServo(SERVO_ARM, SERVO_ARM_DOWN);
+  awaitServos(TIME_SERVO_MOVE + 200);  // Extra time for larger movement
   
   // Step 2: Close claw
-  clampServo.write(SERVO_CLAMP_CLOSED);
-  delay(TIME_SERVO_MOVE);
+  power.moveServo(SERVO_CLAMP, SERVO_CLAMP_CLOSED);
+  awaitServos(TIME_SERVO_MOVE);
   
   // Step 3: Raise arm
-  baseServo.write(SERVO_ARM_CARRY);
-  delay(TIME_SERVO_MOVE);
+  power.moveServo(SERVO_ARM, SERVO_ARM_CARRY);
+  awaitServos(TIME_SERVO_MOVE);
   
-  // Update state
+  // Update state, and tell the state machine the arm is back up
   holding = true;
+  bus.publish(EVT_SERVO_ARRIVED, SERVO_ARM_CARRY);
 }
 
 /**
@@ -459,20 +1064,79 @@ void pickup() {
  * 3. Raise arm back up
  */
 void drop() {
+  TraceSpan span(trace, TRACE_DROP);
   // Step 1: Lower arm
-  baseServo.write(SERVO_ARM_DOWN);
-  delay(TIME_SERVO_MOVE + 200);
+  power.moveServo(SERVO_ARM, SERVO_ARM_DOWN);
+  awaitServos(TIME_SERVO_MOVE + 200);
   
   // Step 2: Open claw
-  clampServo.write(SERVO_CLAMP_OPEN);
-  delay(TIME_SERVO_MOVE);
+  power.moveServo(SERVO_CLAMP, SERVO_CLAMP_OPEN);
+  awaitServos(TIME_SERVO_MOVE);
   
   // Step 3: Raise arm
-  baseServo.write(SERVO_ARM_CARRY);
-  delay(TIME_SERVO_MOVE);
+  power.moveServo(SERVO_ARM, SERVO_ARM_CARRY);
+  awaitServos(TIME_SERVO_MOVE);
   
-  // Update state
+  // Update state, and tell the state machine the arm is back up
   holding = false;
+  bus.publish(EVT_SERVO_ARRIVED, SERVO_ARM_CARRY);
+}
+
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                          MISSION BUDGET                                    ║
+// ║  Where a normal run spends its time (see mission_clock.h).                ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/*
+ * Measured in the simulator (host/sim, --noise 0): how long each state
+ * takes and, where it drives a known stretch, how far. The clock reads
+ * progress off this; re-measure it when the course or the speeds change.
+ * It is the built-in route's: a loaded program runs states in another
+ * order and over other stretches, so it runs without the clock.
+ */
+const Leg PLAN[] = {
+  // state                  ms     cm
+  { STATE_FOLLOW_BLACK,      1250,  33 },
+  { STATE_APPROACH_BOX,       400,   0 },
+  { STATE_PICKUP,             550,   0 },
+  { STATE_FIND_INTERSECTION, 2550,  68 },
+  { STATE_SELECT_GREEN,      3400,   0 },
+  { STATE_FOLLOW_GREEN,      1950,  51 },
+  { STATE_APPROACH_BLUE,      300,   0 },
+  { STATE_DROP,               700,   0 },
+  { STATE_TO_REUPLOAD,       3050,   0 },
+  { STATE_COMPLETE,             0,   0 },
+};
+
+/** Cruising speed for the time left (SPEED_CRUISE_MAX at most), or just `nominal`. */
+uint8_t cruiseSpeed(uint8_t nominal) {
+  return adapting ? mission.cruise(nominal, SPEED_CRUISE_MAX) : nominal;
+}
+
+/** An optional search in this state has run `nominal` ms (less when late, `least` at the least). */
+bool searchOver(uint32_t nominal, uint32_t least) {
+  return adapting ? mission.searchOver(nominal, least) : millis() - stateStartTime >= nominal;
+}
+
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                           SPEED PROFILE                                    ║
+// ║  Line-following speeds learned over practice runs (see speed_profile.h).  ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+// The states that follow a line: each gets its own speeds, stretch by stretch
+// (not TO_REUPLOAD: it drives on past the end of the green line). Keyed by
+// state, so they fit only the built-in route: a loaded program learns nothing
+const uint8_t LEARNED[] = { STATE_FOLLOW_BLACK, STATE_FIND_INTERSECTION, STATE_FOLLOW_GREEN };
+
+/**
+ * learnedSpeed() - The on-line speed for where we are on the course:
+ * `nominal` scaled by the profile (when not learning, profile.begin()
+ * never ran or was cancelled, and this is `nominal`). The mission clock scales it after.
+ */
+uint8_t learnedSpeed(uint8_t nominal) {
+  return profile.speed(nominal);
 }
 
 
@@ -492,27 +1156,32 @@ void drop() {
  * 
  * Since we only have ONE sensor, we can't tell which side we drifted.
  * We use a simple strategy: alternate search direction each time we lose the line.
+ *
+ * Takes the color processState() already read this tick (reading it
+ * again costs another ~30 ms of pulseIn). Losing the line is published
+ * as EVT_LINE_LOST, and the black line's steps answer it with
+ * onLineLost(): the search turns the other way once per loss. (Flipping
+ * it every tick, as this did, only wiggled on straight ahead.)
  */
 static bool searchDirection = false;  // Alternates left/right when searching
 
-void followBlackLine() {
-  Color c = readColor();
+void followBlackLine(Color c) {
+  bus.sampleLine(c == COLOR_BLACK);
+  profile.sample(c == COLOR_BLACK, odometerCm());   // Tracking error and losses, per stretch
   
   if (c == COLOR_BLACK) {
     // On the black line - go straight!
-    moveForward(SPEED_NORMAL);
+    moveForward(cruiseSpeed(learnedSpeed(SPEED_NORMAL)));
     // Reset search direction for next time we lose line
   }
   else {
     // Lost the line - search for it
-    // Alternate between curving left and right
+    // Curve the way onLineLost() picked for this loss
     if (searchDirection) {
       curveLeft(SPEED_SLOW);
     } else {
       curveRight(SPEED_SLOW);
     }
-    // Toggle direction for next search attempt
-    searchDirection = !searchDirection;
   }
 }
 
@@ -522,13 +1191,15 @@ void followBlackLine() {
  * Unlike black line following (which uses IR), colored lines
  * use the color sensor. This is simpler - just check if we're
  * on green, and if so, go forward. If not, go slower.
+ * Like followBlackLine(), it takes this tick's color reading.
  */
-void followGreenLine() {
-  Color c = readColor();
+void followGreenLine(Color c) {
+  bus.sampleLine(c == COLOR_GREEN);
+  profile.sample(c == COLOR_GREEN, odometerCm());
   
   if (c == COLOR_GREEN) {
     // On the green line - full speed ahead!
-    moveForward(SPEED_NORMAL);
+    moveForward(cruiseSpeed(learnedSpeed(SPEED_NORMAL)));
   }
   else {
     // Not on green - go slower to avoid overshooting
@@ -537,33 +1208,381 @@ void followGreenLine() {
 }
 
 
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                          BRANCH SELECTION                                  ║
+// ║  Finding the green path at the intersection.                              ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/**
+ * BranchScan - The green run seen so far while pivoting.
+ * 
+ * Every color read during a scan is added with the heading it was taken
+ * at. Consecutive GREEN reads make a run; when the first non-green read
+ * after it arrives, the run is over. Its middle is where the green line's
+ * center passes under the sensor's circle around the axle.
+ */
+struct BranchScan {
+  uint8_t color;            // The branch's Color
+  float from = 0, to = 0;   // Headings of the first and last green read
+  uint8_t reads = 0;        // Green reads in the run
+  uint8_t total = 0;        // Reads of any color
+  bool cut = false;         // The run began on the first read: its near edge is behind us
+  bool done = false;        // Seen its far edge
+  
+  BranchScan(uint8_t c = COLOR_GREEN) : color(c) {}
+  
+  // Returns true once the run is over (stop scanning)
+  bool add(Color c, float heading) {
+    if (total < 255) total++;
+    if (c == color) {
+      if (reads == 0) {
+        from = heading;
+        cut = total == 1;
+      }
+      to = heading;
+      reads++;
+    } else if (reads > 0 && fabs(to - from) >= BRANCH_MIN_DEG) {
+      done = true;
+    } else {
+      reads = 0;   // Too narrow to be a line: a stray reading
+    }
+    return done;
+  }
+  
+  bool found() const { return reads > 0 && fabs(to - from) >= BRANCH_MIN_DEG; }
+  float middle() const { return (from + to) / 2; }
+};
+
+/**
+ * turnTo() - Pivot to face `heading` (modelHeading, degrees).
+ * 
+ * Cuts the motors turnRate() x DRIVE_TAU_MS early, so the coast ends on
+ * the heading instead of overshooting it. With a `scan`, reads colors all
+ * the way and stops early once the scan has what it wants. Returns right
+ * after stopMotors(): the wheels are still coasting.
+ */
+void turnTo(float heading, BranchScan* scan = nullptr) {
+  TraceSpan span(trace, TRACE_TURN);
+  bool left = heading > modelHeading;
+  if (left) turnLeft(SPEED_SCAN);
+  else turnRight(SPEED_SCAN);
+  uint32_t start = millis();
+  while (millis() - start < 3000) {
+    odometerCm();   // Steps the model when the control timer isn't running
+    float rest = modelHeading + turnRate() * DRIVE_TAU_MS / 1000.0f;
+    if (left ? rest >= heading : rest <= heading) break;
+    if (!scan) continue;
+    Color c = readColor();
+    // The read took ~35ms: it belongs to the heading at colorAtUs
+    if (scan->add(c, modelHeading - turnRate() * (micros() - colorAtUs) / 1000000.0f)) break;
+  }
+  stopMotors();
+}
+
+// Let a pivot coast out, then bring the model up to date
+void settle() {
+  delay(DRIVE_TAU_MS * 2);
+  odometerCm();
+}
+
+// Still driving (a program's GRIP/RELEASE right after a FOLLOW)? Stop and coast out
+void standStill() {
+  if (!targetLeft && !targetRight) return;
+  stopMotors();
+  settle();
+}
+
+/**
+ * selectBranch() - Face down the green branch (or the `want` one: a
+ * program's BRANCH). Returns false if there was none within
+ * BRANCH_SCAN_DEG either side.
+ * 
+ * The old way (turn left 300ms, look once, else turn right 600ms) could
+ * only find green where the map said, and went on even when it hadn't.
+ * Instead:
+ * 
+ * 1. Roll on until the axle is over the junction (the sensor saw it
+ *    COLOR_FWD_CM ahead), so a pivot sweeps the sensor around it.
+ * 2. Pivot left (the map says green is left) reading colors; stop as
+ *    soon as a green run is over. Nothing? Sweep across to the right.
+ *    The run's middle is a point on the branch: P1.
+ * 3. Face P1, drive BRANCH_STEP_CM onto the branch and scan across it
+ *    again for a second point, P2. The branch runs from P1 to P2.
+ * 4. Turn to that, then nudge (at most BRANCH_CORRECTIONS times) until
+ *    within BRANCH_ALIGN_DEG.
+ * 
+ * Why two points: the sensor circles the axle at only COLOR_FWD_CM, so
+ * 1 cm off the line's center moves a branch's middle by ~15° as seen
+ * from the axle. Two points on the line don't care where the axle is.
+ * 
+ * Prints "BRANCH: green_deg=48.2 first_deg=55.0 error_deg=0.8
+ * corrections=0 ms=2712" (degrees from the way we came in; green_deg is
+ * the branch's, whatever its color).
+ */
+bool selectBranch(Color want = COLOR_GREEN) {
+  TraceSpan span(trace, TRACE_BRANCH);
+  uint32_t start = millis();
+  stopPast(colorSeenUs, COLOR_FWD_CM);
+  settle();
+  float center = modelHeading;
+  
+  BranchScan scan(want);
+  turnTo(center + BRANCH_SCAN_DEG, &scan);
+  if (!scan.found()) {
+    scan = BranchScan(want);
+    turnTo(center - BRANCH_SCAN_DEG, &scan);
+  }
+  if (!scan.found()) {
+    turnTo(center);
+    Serial.println(F("BRANCH: none found"));
+    return false;
+  }
+  
+  // P1, with the axle at (0, 0)
+  float first = scan.middle();
+  float x1 = COLOR_FWD_CM * cos(first / 57.2958f), y1 = COLOR_FWD_CM * sin(first / 57.2958f);
+  
+  // Onto the branch, and P2 from there: usually the sensor starts on the
+  // line, so scan left off it, then right across it
+  turnTo(first);
+  settle();
+  float heading = modelHeading, from = odometerCm();
+  stopPast(micros(), BRANCH_STEP_CM, SPEED_NORMAL);
+  settle();
+  float step = odometerCm() - from;
+  BranchScan across(want);
+  turnTo(heading + BRANCH_LOOK_DEG, &across);
+  if (!across.done || across.cut) {
+    across = BranchScan(want);
+    turnTo(heading - BRANCH_LOOK_DEG, &across);
+  }
+  float target = first;
+  if (across.found()) {
+    float second = across.middle() / 57.2958f;
+    float x2 = step * cos(heading / 57.2958f) + COLOR_FWD_CM * cos(second);
+    float y2 = step * sin(heading / 57.2958f) + COLOR_FWD_CM * sin(second);
+    float turn = atan2(y2 - y1, x2 - x1) * 57.2958f - heading;
+    while (turn > 180) turn -= 360;    // atan2 is -180..180; modelHeading keeps counting
+    while (turn < -180) turn += 360;
+    target = heading + turn;
+  }
+  
+  uint8_t corrections = 0;
+  turnTo(target);
+  for (;;) {
+    settle();
+    if (fabs(target - modelHeading) <= BRANCH_ALIGN_DEG || corrections >= BRANCH_CORRECTIONS) break;
+    turnTo(target);
+    corrections++;
+  }
+  
+  Serial.print(F("BRANCH: green_deg="));
+  Serial.print(target - center, 1);
+  Serial.print(F(" first_deg="));
+  Serial.print(first - center, 1);
+  Serial.print(F(" error_deg="));
+  Serial.print(modelHeading - target, 1);
+  Serial.print(F(" corrections="));
+  Serial.print(corrections);
+  Serial.print(F(" ms="));
+  Serial.println(millis() - start);
+  return true;
+}
+
+
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                           STATE MACHINE                                    ║
 // ║  The brain of the robot. Decides what to do based on current state.       ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
 
+/**
+ * stateName() - Human-readable name of a state, for the Serial log.
+ * The Coach App and the host tools read these names, so keep this list
+ * in sync with the State enum.
+ */
+const __FlashStringHelper* stateName(State s) {
+  switch (s) {
+    case STATE_FOLLOW_BLACK:      return F("FOLLOW_BLACK");
+    case STATE_APPROACH_BOX:      return F("APPROACH_BOX");
+    case STATE_PICKUP:            return F("PICKUP");
+    case STATE_FIND_INTERSECTION: return F("FIND_INTERSECTION");
+    case STATE_SELECT_GREEN:      return F("SELECT_GREEN");
+    case STATE_FOLLOW_GREEN:      return F("FOLLOW_GREEN");
+    case STATE_APPROACH_BLUE:     return F("APPROACH_BLUE");
+    case STATE_DROP:              return F("DROP");
+    case STATE_TO_REUPLOAD:       return F("TO_REUPLOAD");
+    case STATE_COMPLETE:          return F("COMPLETE");
+    case STATE_TURN:              return F("TURN");
+  }
+  return F("?");
+}
+
 /**
  * transitionTo() - Change to a new state.
  * Records when we entered the state (for timeouts).
+ * Queues a checkpoint (loop() writes it to EEPROM when it's idle).
  * Prints state to Serial Monitor for debugging.
  */
 void transitionTo(State newState) {
   currentState = newState;
   stateStartTime = millis();  // Record when we entered this state
+  bus.enter(newState, stateStartTime);  // Drop the old state's events, re-arm edges
+  checkpoint.save(newState, holding, program.loops(), 0, program.resumePc());
+  mission.enter(newState, stateStartTime, odometerCm());
+  profile.enter(newState, odometerCm());
+  trace.switchTo(TRACE_STATE + newState);
   
   // Print state name for debugging
   Serial.print(F("STATE: "));
-  Serial.println(newState);
+  Serial.print(newState);
+  Serial.print(' ');
+  Serial.print(stateName(newState));
+  Serial.print(F(" ms="));   // Robot time: a log without host stamps still times each state
+  Serial.println(stateStartTime);
+}
+
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                        MISSION PROGRAM                                     ║
+// ║  The route as steps (see mission_program.h), and the events ending each.  ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/*
+ * Each step of the program runs as one of the states, and gets the
+ * subscriptions that end it (subscribeStep() builds them): each handler runs
+ * only when its event arrives, instead of every state re-checking every
+ * condition on every tick. The bus re-publishes the current readings on
+ * entering a state, so "already on green" still fires.
+ *
+ *   step       state                            ends on
+ *   FOLLOW     FIND_INTERSECTION (FOLLOW_GREEN)  a color of its set: onStepColor
+ *   NEAR       FOLLOW_BLACK (FOLLOW_GREEN)       something within cm
+ *   FOR        FOLLOW_BLACK (TO_REUPLOAD)        its time
+ *   APPROACH   APPROACH_BOX                     within cm: onInReach
+ *   PAST       APPROACH_BLUE                    its action (stopPast)
+ *   GRIP       PICKUP                           the servos arrived
+ *   RELEASE    DROP                             the servos arrived
+ *   BRANCH     SELECT_GREEN                     its action (found, or onNoBranch)
+ *   TURN       TURN                             its action
+ *   HALT       COMPLETE
+ *
+ * (in brackets: following green). The followers only know black and green.
+ */
+
+// The course as it is; a program loaded over Serial replaces it
+const uint8_t BUILTIN_PROGRAM[] = {
+  OP_NEAR,     COLOR_BLACK, DIST_BOX_PICKUP + 10,              // follow black until 15cm
+  OP_APPROACH, DIST_BOX_PICKUP,                                 // approach 5cm
+  OP_GRIP,                                                      // grip
+  OP_FOLLOW,   COLOR_BLACK, 1 << COLOR_GREEN | 1 << COLOR_RED,  // follow black until green|red
+  OP_BRANCH,   COLOR_GREEN,                                     // branch green
+  OP_FOLLOW,   COLOR_GREEN, 1 << COLOR_BLUE,                    // follow green until blue
+  OP_PAST,     BLUE_ENTRY_CM,                                   // past 8cm
+  OP_RELEASE,                                                   // release
+  OP_FOR,      COLOR_GREEN, 3000 & 0xFF, 3000 >> 8,             // follow green for 3000ms
+  OP_HALT,                                                      // halt
+};
+
+// The steps this sketch has states for (a program with others is rejected)
+const uint32_t STEP_OPS = PROGRAM_OP(OP_FOLLOW) | PROGRAM_OP(OP_NEAR) | PROGRAM_OP(OP_FOR) |
+                          PROGRAM_OP(OP_APPROACH) | PROGRAM_OP(OP_PAST) | PROGRAM_OP(OP_GRIP) |
+                          PROGRAM_OP(OP_RELEASE) | PROGRAM_OP(OP_BRANCH) | PROGRAM_OP(OP_TURN);
+
+Subscription stepSubscriptions[7];   // The running step's (a FOLLOW: one per color, and the line lost)
+
+/** The state that runs step `s`. */
+State stepState(const ProgramStep& s) {
+  bool green = s.line == COLOR_GREEN;
+  switch (s.op) {
+    case OP_FOLLOW:   return green ? STATE_FOLLOW_GREEN : STATE_FIND_INTERSECTION;
+    case OP_NEAR:     return green ? STATE_FOLLOW_GREEN : STATE_FOLLOW_BLACK;
+    case OP_FOR:      return green ? STATE_TO_REUPLOAD : STATE_FOLLOW_BLACK;
+    case OP_APPROACH: return STATE_APPROACH_BOX;
+    case OP_PAST:     return STATE_APPROACH_BLUE;
+    case OP_GRIP:     return STATE_PICKUP;
+    case OP_RELEASE:  return STATE_DROP;
+    case OP_BRANCH:   return STATE_SELECT_GREEN;
+    case OP_TURN:     return STATE_TURN;
+    default:          return STATE_COMPLETE;
+  }
+}
+
+void nextStep();   // The handlers end their step with it; it subscribes them (below)
+
+// The step is over (a NEAR, a FOR, the servos of a GRIP/RELEASE)
+void onStepDone(const BusEvent&) { nextStep(); }
+
+// A FOLLOW's color: we're at the junction, the blue edge... Stop, unless a
+// PAST measures from here on the move
+void onStepColor(const BusEvent&) {
+  colorSeenUs = colorAtUs;
+  if (program.peek() != OP_PAST) stopMotors();
+  nextStep();
+}
+
+// Close enough to grab: stop first, the pickup happens next tick
+void onInReach(const BusEvent&) {
+  stopMotors();
+  nextStep();
+}
+
+// Off the line: search the other way from last time (followBlackLine())
+void onLineLost(const BusEvent&) { searchDirection = !searchDirection; }
+
+// Scanned and scanned and no branch: go on the way we're facing
+void onNoBranch(const BusEvent&) {
+  Serial.println(F("BRANCH: giving up"));
+  nextStep();
+}
+
+/** subscribeStep() - Take the program's next step and subscribe what ends it. Returns its state. */
+State subscribeStep() {
+  programStep = program.next();
+  const ProgramStep& s = programStep;
+  State state = stepState(s);
+  uint8_t n = 0;
+  bool black = (s.op == OP_FOLLOW || s.op == OP_NEAR || s.op == OP_FOR) && s.line == COLOR_BLACK;
+  if (black) stepSubscriptions[n++] = {state, EVT_LINE_LOST, BUS_ANY, onLineLost};   // followBlackLine()'s search
+  switch (s.op) {
+    case OP_FOLLOW:
+      for (uint8_t c = 0; c < 8 && n < 7; c++) {
+        if (s.arg & 1 << c) stepSubscriptions[n++] = {state, EVT_COLOR_CHANGED, c, onStepColor};
+      }
+      break;
+    case OP_NEAR:     stepSubscriptions[n++] = {state, EVT_RANGE_BELOW, s.arg, onStepDone}; break;
+    case OP_FOR:      stepSubscriptions[n++] = {state, EVT_TIMEOUT, s.value, onStepDone}; break;
+    case OP_APPROACH: stepSubscriptions[n++] = {state, EVT_RANGE_BELOW, s.arg, onInReach}; break;
+    case OP_GRIP:
+    case OP_RELEASE:  stepSubscriptions[n++] = {state, EVT_SERVO_ARRIVED, BUS_ANY, onStepDone}; break;
+    default:          break;   // PAST, BRANCH, TURN: their action moves on; HALT: over
+  }
+  bus.begin(stepSubscriptions, n);
+  return state;
 }
 
+/**
+ * nextStep() - On to the program's next step. After a brownout, setup()
+ * resumes the program where the checkpoint says (see mission_program.h).
+ */
+void nextStep() {
+  transitionTo(subscribeStep());
+}
+
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                           STATE ACTIONS                                    ║
+// ║  What each state does while nothing has moved it on.                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
 /**
  * processState() - Main decision-making function.
  * 
  * This is called every loop iteration. It:
- * 1. Reads sensors
- * 2. Checks what state we're in
- * 3. Performs actions for that state
- * 4. Checks if conditions are met to transition to next state
+ * 1. Reads sensors ONCE and feeds the readings to the event bus
+ * 2. Lets the bus run any handler whose event just happened
+ *    (that's where the steps end, see nextStep() above)
+ * 3. If we're still in the same state, performs its action
+ * 4. Delivers events the action itself raised (e.g. pickup finished)
  * 
  * This is the HEART of the robot's autonomous behavior.
  */
@@ -571,6 +1590,17 @@ void processState() {
   // Read sensors (used by multiple states)
   float dist = readDistance();
   Color color = readColor();
+  float ahead = rangeAtStop(dist);   // Where we'd stop, not where we were
+  lastColor = color;
+  lastDistance = dist;
+  
+  // Publish what changed; a handler may move us to a new state
+  bus.sampleColor(color);
+  bus.sampleRange(ahead);
+  bus.sampleTime(millis());
+  if (bus.dispatch()) {
+    return;  // The new state starts acting on the next tick
+  }
   
   // Act based on current state
   switch (currentState) {
@@ -579,90 +1609,60 @@ void processState() {
     // STATE: Follow the initial black line, looking for box
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_FOLLOW_BLACK:
-      // Keep following the black line
-      followBlackLine();
-      
-      // Check if we detect a box ahead (distance < 15cm)
-      if (dist < DIST_BOX_PICKUP + 10 && dist > 0) {
-        transitionTo(STATE_APPROACH_BOX);
-      }
+      // Keep following the black line (box < 15cm ahead: onStepDone)
+      followBlackLine(color);
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
     // STATE: Slowly approach the box until close enough to grab
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_APPROACH_BOX:
-      if (dist <= DIST_BOX_PICKUP) {
-        // Close enough! Stop and pick up
-        stopMotors();
-        transitionTo(STATE_PICKUP);
-      }
-      else {
-        // Not close enough, keep moving slowly
-        moveForward(SPEED_SLOW);
-      }
+      // Not close enough yet: slow down as we get there (onInReach stops us)
+      moveForward(approachSpeed(ahead, programStep.arg));
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
     // STATE: Execute the pickup sequence
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_PICKUP:
-      pickup();  // This function handles the full sequence
-      transitionTo(STATE_FIND_INTERSECTION);
+      standStill();
+      pickup();  // Handles the full sequence, then publishes EVT_SERVO_ARRIVED
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
     // STATE: Continue on black line until we reach green/red intersection
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_FIND_INTERSECTION:
-      followBlackLine();
-      
-      // Check if color sensor sees green or red (intersection!)
-      if (color == COLOR_GREEN || color == COLOR_RED) {
-        stopMotors();
-        transitionTo(STATE_SELECT_GREEN);
-      }
+      followBlackLine(color);
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
     // STATE: We're at the intersection - find and select the GREEN path
+    // (even if we arrived on green: that's the junction, not the way out)
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_SELECT_GREEN:
-      // Already on green? Great, start following it!
-      if (color == COLOR_GREEN) {
-        transitionTo(STATE_FOLLOW_GREEN);
+      // Scan around the junction and face down the green branch
+      if (selectBranch((Color)programStep.arg)) {
+        nextStep();
         break;
       }
       
-      // Not on green - search for it
-      // First, try turning LEFT (based on competition map, green is left)
-      turnLeft(SPEED_TURN);
-      delay(300);
-      stopMotors();
-      
-      // Check if we found green
-      if (readColor() == COLOR_GREEN) {
-        transitionTo(STATE_FOLLOW_GREEN);
-      }
-      else {
-        // Green wasn't on left - try right
-        turnRight(SPEED_TURN);
-        delay(600);  // Turn past center to the right
-        stopMotors();
-        transitionTo(STATE_FOLLOW_GREEN);
+      // No green around here: move up a little and scan again next tick
+      // (gives up after 8 seconds, sooner when time is short)
+      if (searchOver(BRANCH_GIVE_UP_MS, BRANCH_LEAST_MS)) {
+        onNoBranch(BusEvent());
+        break;
       }
+      moveForward(SPEED_SLOW);
+      delay(150);
+      stopMotors();
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
     // STATE: Follow the green line, looking for blue drop zone
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_FOLLOW_GREEN:
-      followGreenLine();
-      
-      // Check if we've reached the blue drop zone
-      if (color == COLOR_BLUE) {
-        transitionTo(STATE_APPROACH_BLUE);
-      }
+      followGreenLine(color);
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
@@ -670,31 +1670,29 @@ void processState() {
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_APPROACH_BLUE:
       // Move forward a bit to get fully into blue zone
-      moveForward(SPEED_SLOW);
-      delay(500);
-      stopMotors();
-      transitionTo(STATE_DROP);
+      if (STOP_COMPENSATION) {
+        stopPast(colorSeenUs, programStep.arg);   // Measured from where blue was seen
+      } else {
+        moveForward(SPEED_SLOW);               // Old way: a blind half second
+        delay(500);
+        stopMotors();
+      }
+      nextStep();
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
     // STATE: Drop the box
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_DROP:
-      drop();  // This function handles the full sequence
-      transitionTo(STATE_TO_REUPLOAD);
+      standStill();
+      drop();  // Handles the full sequence, then publishes EVT_SERVO_ARRIVED
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
-    // STATE: Continue to re-upload point
+    // STATE: Continue to re-upload point (onStepDone after 3 seconds)
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_TO_REUPLOAD:
-      followGreenLine();
-      
-      // After 3 seconds, assume we've reached the re-upload point
-      if (millis() - stateStartTime > 3000) {
-        stopMotors();
-        transitionTo(STATE_COMPLETE);
-      }
+      followGreenLine(color);
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
@@ -702,6 +1700,21 @@ void processState() {
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_COMPLETE:
       stopMotors();
+      reportControl();  // Final control timing for this run
+      reportSensorQueue();
+      bus.report();     // Event counts and dispatch latency
+      while (checkpoint.pending()) checkpoint.service(CHECKPOINT_BUDGET_US);  // Nothing left to steer
+      checkpoint.report();
+      mission.report();   // Time used against the budget
+      if (learning) {
+        profile.finish();   // Keep the raises it earned
+        profile.report();   // What this run learned
+      }
+      power.log();
+      power.report();     // Current drawn against the budget
+      program.report();   // Which program ran, and how fast it decoded
+      trace.flush();      // The spans still queued
+      trace.report();
       
       Serial.println(F("\n============================="));
       Serial.println(F("   SECTION 1 COMPLETE!"));
@@ -713,9 +1726,149 @@ void processState() {
         delay(1000);
       }
       break;
+    
+    // ─────────────────────────────────────────────────────────────────────────
+    // STATE: A program's TURN (pivot, let it coast out, next step)
+    // ─────────────────────────────────────────────────────────────────────────
+    case STATE_TURN:
+      turnTo(modelHeading + programStep.value);
+      settle();
+      nextStep();
+      break;
+  }
+  
+  // Deliver events the action itself raised (pickup/drop finished)
+  bus.dispatch();
+}
+
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                             TELEMETRY                                      ║
+// ║  Machine-readable status for the Coach App (Coach_App/telemetry.py).      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/**
+ * sendTelemetry() - Print one line: T:<millis>,<state>,<color>,<distance>
+ * 
+ * Example: "T:15230,5,4,23.4" = 15.23s after boot, FOLLOW_GREEN,
+ * seeing GREEN, something 23.4cm ahead. Numbers are the enum values.
+ */
+void sendTelemetry() {
+  Serial.print(F("T:"));
+  Serial.print(millis());
+  Serial.print(',');
+  Serial.print(currentState);
+  Serial.print(',');
+  Serial.print(lastColor);
+  Serial.print(',');
+  Serial.println(lastDistance, 1);
+}
+
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                            BOOT & START                                    ║
+// ║  Ready as soon as the parts are, then go on the start cue.                ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+// waitUntilReady() bits: the parts that didn't get ready in time
+#define READY_SERVO   1
+#define READY_ECHO    2
+#define READY_COLOR   4
+#define READY_CONTROL 8
+
+uint32_t servosWrittenMs = 0;    // When setup() sent the servos their first position
+uint32_t bootReadyMs = 0;        // millis() when waitUntilReady() returned
+uint32_t startCueMs = 0;         // ...and when the start cue came
+uint8_t bootNotReady = 0;        // READY_ bits that timed out
+
+/**
+ * waitUntilReady() - Instead of a fixed delay(1000), check each part
+ * until it's ready, at most BOOT_TIMEOUT_MS:
+ *   servo    had BOOT_SERVO_MS since setup() sent it its first position
+ *            (the rest of setup() ran in the meantime)
+ *   echo     the HC-SR04 answered a ping
+ *   color    the TCS3200 puts out pulses
+ *   control  the motor interrupt has ticked
+ * Returns the READY_ bits that never passed (0 = all ready).
+ */
+uint8_t waitUntilReady() {
+  uint32_t start = millis();
+  uint8_t missing;
+  bool colorSeen = false;
+  do {
+    missing = 0;
+    if (millis() - servosWrittenMs < BOOT_SERVO_MS) missing |= READY_SERVO;
+    readDistance();
+    if (echoByInterrupt && (!echoRiseUs || !resultPingUs)) missing |= READY_ECHO;
+    if (!colorSeen) colorSeen = pulseIn(PIN_COLOR_OUT, LOW, 5000) > 0;
+    if (!colorSeen) missing |= READY_COLOR;
+    if (controlRunning && ctrlStats.ticks == 0) missing |= READY_CONTROL;
+  } while (missing && millis() - start < BOOT_TIMEOUT_MS);
+  return missing;
+}
+
+/**
+ * waitForStart() - Hold still until the START_TRIGGER cue. Each cue has to
+ * last START_HOLD_MS:
+ *   START_BUTTON  PIN_START held LOW
+ *   START_WAVE    something closer than START_WAVE_CM, then gone again
+ *                 (we go when the hand is out of the way)
+ *   START_LINE    a color (the line), after none: set the robot down
+ *                 on a white card over the line and pull the card
+ * Meanwhile a mission program can be loaded over Serial (mission_program.h).
+ */
+void waitForStart() {
+  if (START_TRIGGER == START_NOW) return;
+  Serial.println(F("START: waiting for the cue"));
+  bool seen = false;        // The cue is on right now
+  bool armed = false;       // START_LINE: white seen first / START_WAVE: hand held long enough
+  uint32_t since = 0;
+  for (;;) {
+    program.service();   // A new program over Serial (host/mission_asm.cpp)?
+    profile.service(CHECKPOINT_BUDGET_US);   // What profile.begin() changed
+    if (START_TRIGGER == START_BUTTON) {
+      seen = digitalRead(PIN_START) == LOW;
+    } else if (START_TRIGGER == START_WAVE) {
+      float dist = readDistance();
+      seen = dist > 0 && dist < START_WAVE_CM;
+      if (!seen && armed) return;   // Hand taken away: go
+    } else {
+      Color c = readColor();
+      if (c == COLOR_NONE) armed = true;   // White reads as no color
+      seen = armed && c != COLOR_NONE;
+    }
+    uint32_t now = millis();
+    if (!seen) since = now;
+    if (seen && now - since >= START_HOLD_MS) {
+      if (START_TRIGGER != START_WAVE) return;
+      armed = true;
+    }
+    delay(10);
   }
 }
 
+/**
+ * reportBoot() - Once, when the wheels first move:
+ * 
+ *   BOOT: ready_ms=452 start_ms=1873 motion_ms=1890 not_ready=0
+ * 
+ * All times are millis() since the reset: parts ready, start cue, first
+ * drive command. not_ready = the READY_ bits that timed out.
+ */
+void reportBoot() {
+  static bool reported = false;
+  if (reported || !firstMotionMs) return;
+  reported = true;
+  Serial.print(F("BOOT: ready_ms="));
+  Serial.print(bootReadyMs);
+  Serial.print(F(" start_ms="));
+  Serial.print(startCueMs);
+  Serial.print(F(" motion_ms="));
+  Serial.print(firstMotionMs);
+  Serial.print(F(" not_ready="));
+  Serial.println(bootNotReady);
+}
+
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                          SETUP & MAIN LOOP                                 ║
@@ -727,9 +1880,35 @@ void processState() {
  * This runs ONCE when the Arduino is powered on or reset.
  */
 void setup() {
+  // Why did we start? Read before anything else: this clears the flags
+  ResetCause cause = readResetCause();
+  
   // Start Serial communication for debugging
   Serial.begin(9600);
   
+  // A brownout mid-run: carry on from the last checkpoint instead of the start
+  bool resume = checkpoint.begin(1, __DATE__ " " __TIME__) && CHECKPOINT_RESUME &&
+                (cause == RESET_BROWNOUT || cause == RESET_WATCHDOG);
+  if (resume) holding = checkpoint.last().holding;
+  
+  // The route: the program loaded over Serial, else the built-in one
+  program.begin(1, BUILTIN_PROGRAM, sizeof(BUILTIN_PROGRAM), STEP_OPS);
+  
+  // The speeds earlier runs learned (a resumed run is still the same run).
+  // Its EEPROM writes happen here, not between the start cue and moving
+  if (SPEED_LEARN) profile.begin(1, LEARNED, sizeof(LEARNED), SPEED_FORGET, resume);
+  
+  // --- Initialize Servos ---
+  // First: they take the longest to get there, and the rest of setup()
+  // runs while they move.
+  baseServo.attach(PIN_SERVO_BASE);
+  clampServo.attach(PIN_SERVO_CLAMP);
+  
+  // Set initial positions: arm down, claw open (or keep carrying the box)
+  power.attachServo(SERVO_ARM, baseServo, holding ? SERVO_ARM_CARRY : SERVO_ARM_DOWN);
+  power.attachServo(SERVO_CLAMP, clampServo, holding ? SERVO_CLAMP_CLOSED : SERVO_CLAMP_OPEN);
+  servosWrittenMs = millis();
+  
   // --- Initialize Color Sensor Pins ---
   pinMode(PIN_COLOR_S0, OUTPUT);
   pinMode(PIN_COLOR_S1, OUTPUT);
@@ -745,10 +1924,12 @@ void setup() {
   // --- Initialize Ultrasonic Sensor Pins ---
   pinMode(PIN_ULTRA_TRIG, OUTPUT);
   pinMode(PIN_ULTRA_ECHO, INPUT);
+  startEcho();  // Echo timing by interrupt (falls back to pulseIn)
   
   // --- Initialize IR Sensor Pins ---
   pinMode(PIN_IR_LEFT, INPUT);
   pinMode(PIN_IR_RIGHT, INPUT);
+  pinMode(PIN_START, INPUT_PULLUP);  // Start button (if START_TRIGGER uses it)
   
   // --- Initialize Motor Pins ---
   pinMode(PIN_MOTOR_ENA, OUTPUT);
@@ -758,29 +1939,82 @@ void setup() {
   pinMode(PIN_MOTOR_IN3, OUTPUT);
   pinMode(PIN_MOTOR_IN4, OUTPUT);
   
-  // --- Initialize Servos ---
-  baseServo.attach(PIN_SERVO_BASE);
-  clampServo.attach(PIN_SERVO_CLAMP);
-  
-  // Set initial positions: arm down, claw open
-  baseServo.write(SERVO_ARM_DOWN);
-  clampServo.write(SERVO_CLAMP_OPEN);
-  
   // Make sure motors are stopped
   stopMotors();
   
-  // Wait a moment for everything to stabilize
-  delay(1000);
+  // Start the motor control interrupt (after stopMotors: PWM pins first),
+  // with the power budget set before its first tick
+  power.begin(POWER_BUDGET_MA, DRIVE_DEADBAND, DRIVE_TAU_MS, CONTROL_HZ);
+  startControl();
+  power.start(controlRunning);
   
   // --- Start the mission! ---
   Serial.println(F("============================="));
   Serial.println(F("   SECTION 1: START"));
   Serial.println(F("============================="));
   Serial.println(F("Mission: Black line -> Box -> Green -> Blue"));
+  // Build stamp + tuning constants, so logged runs can be compared per firmware
+  Serial.println(F("FW: " __DATE__ " " __TIME__));
+  Serial.println(F("PARAMS: SPEED_NORMAL=" STR(SPEED_NORMAL) ",SPEED_SLOW=" STR(SPEED_SLOW) ",SPEED_TURN=" STR(SPEED_TURN)
+                 ",SPEED_COMPENSATION=" STR(SPEED_COMPENSATION) ",TIME_TURN_90=" STR(TIME_TURN_90)
+                 ",DIST_BOX_PICKUP=" STR(DIST_BOX_PICKUP) ",COLOR_FREQ_MAX=" STR(COLOR_FREQ_MAX)
+                 ",COLOR_FREQ_BLACK=" STR(COLOR_FREQ_BLACK) ",COLOR_MARGIN=" STR(COLOR_MARGIN) ",CONTROL_HZ=" STR(CONTROL_HZ)
+                 ",STOP_COMPENSATION=" STR(STOP_COMPENSATION) ",DRIVE_TAU_MS=" STR(DRIVE_TAU_MS)
+                 ",APPROACH_GAIN=" STR(APPROACH_GAIN) ",APPROACH_MIN_PWM=" STR(APPROACH_MIN_PWM)
+                 ",SPEED_SCAN=" STR(SPEED_SCAN) ",BRANCH_SCAN_DEG=" STR(BRANCH_SCAN_DEG)
+                 ",START_TRIGGER=" STR(START_TRIGGER) ",SPEED_LEARN=" STR(SPEED_LEARN)
+                 ",POWER_BUDGET_MA=" STR(POWER_BUDGET_MA) ",TRACE_MASK=" STR(TRACE_MASK)));
+  
+  // The trace's legend: every span's id, kind and name
+  trace.begin(TRACE_MASK);
+  for (uint8_t s = 0; s <= STATE_TURN; s++) trace.name(TRACE_STATE + s, TRACE_STATES, stateName((State)s));
+  trace.name(TRACE_COLOR, TRACE_SENSORS, F("readColor"));
+  trace.name(TRACE_ECHO, TRACE_SENSORS, F("echo"));
+  trace.name(TRACE_TURN, TRACE_MANEUVERS, F("turnTo"));
+  trace.name(TRACE_STOP_PAST, TRACE_MANEUVERS, F("stopPast"));
+  trace.name(TRACE_BRANCH, TRACE_MANEUVERS, F("selectBranch"));
+  trace.name(TRACE_PICKUP, TRACE_MANEUVERS, F("pickup"));
+  trace.name(TRACE_DROP, TRACE_MANEUVERS, F("drop"));
+  trace.name(TRACE_SERVO_WAIT, TRACE_SERVOS, F("awaitServos"));
+  trace.name(TRACE_IDLE, TRACE_WAITS, F("idle"));
   Serial.println();
   
-  // Begin in the first state
-  transitionTo(STATE_FOLLOW_BLACK);
+  // Everything ready? Then wait for the start cue (not when resuming: we're under way)
+  if (!resume) {
+    bootNotReady = waitUntilReady();
+    bootReadyMs = millis();
+    waitForStart();
+  }
+  startCueMs = millis();
+  
+  // PLAN and LEARNED are per state, measured on the built-in route. A
+  // loaded program (final now: none loads after the start cue) runs at
+  // fixed speeds and search times, and takes back the run
+  // profile.begin() opened
+  adapting = MISSION_ADAPT && !program.loaded();
+  learning = SPEED_LEARN && !program.loaded();
+  if (SPEED_LEARN && !learning) profile.cancel();
+  
+  // Begin at the program's first step (or the saved one)
+  Serial.print(F("RESET: cause="));
+  Serial.print(resetCauseName(cause));
+  if (resume) {
+    const Checkpoint& saved = checkpoint.last();
+    program.resumeAt(saved.step, saved.count);
+    Serial.print(F(" resume="));
+    Serial.print(stateName((State)saved.state));
+    Serial.print(F(" pc="));
+    Serial.print(saved.step);
+    Serial.print(F(" holding="));
+    Serial.print(holding);
+    Serial.print(F(" boot_ms="));
+    Serial.println(millis());
+  } else {
+    Serial.println();
+  }
+  State first = subscribeStep();
+  mission.begin(MISSION_BUDGET_MS, MISSION_RESERVE_MS, PLAN, sizeof(PLAN) / sizeof(PLAN[0]), first, millis());
+  transitionTo(first);
 }
 
 /**
@@ -789,9 +2023,48 @@ void setup() {
  * 
  * Each iteration:
  * 1. Process current state (read sensors, make decisions, act)
- * 2. Wait a short time (50ms = 20 times per second)
+ * 2. Every few ticks, print a telemetry line
+ * 3. Every few seconds, print the control interrupt's timing
+ *    (and once, how long it took from reset to moving)
+ * 4. Send the trace spans recorded, a line at a time
+ * 5. Write the latest checkpoint (else the profile's changes) to EEPROM, in the time we'd wait anyway
+ * 6. Wait a short time (50ms = 20 times per second)
  */
 void loop() {
+  mission.update(millis(), odometerCm());   // Where we are vs. the plan
   processState();  // Do the state machine stuff
-  delay(50);       // Small delay to prevent overwhelming sensors
+  
+  // Every TELEMETRY_EVERY ticks, report status
+  static uint8_t telemetryTick = 0;
+  if (TELEMETRY_EVERY > 0 && ++telemetryTick >= TELEMETRY_EVERY) {
+    telemetryTick = 0;
+    sendTelemetry();
+  }
+  
+  reportBoot();    // Once, when the wheels first move
+  
+  // Every CONTROL_REPORT_MS, report how steady the control interrupt is
+  static uint32_t lastControlReport = 0;
+  if (CONTROL_REPORT_MS > 0 && millis() - lastControlReport >= CONTROL_REPORT_MS) {
+    lastControlReport = millis();
+    reportControl();
+    reportSensorQueue();
+    bus.report();
+    checkpoint.report();
+    mission.report();
+    if (learning) profile.report();
+    power.report();
+    trace.report();
+  }
+  power.log();     // Budget conflicts the control interrupt resolved
+  trace.service(); // A line of spans, when one is due
+  
+  // EEPROM writes are slow: do them here, and wait that much less (the
+  // profile's when no checkpoint is being written)
+  uint32_t writingUs = checkpoint.service(CHECKPOINT_BUDGET_US);
+  if (!writingUs) writingUs = profile.service(CHECKPOINT_BUDGET_US);
+  uint32_t writingMs = writingUs / 1000;
+  trace.open(TRACE_IDLE);
+  delay(writingMs < 50 ? 50 - writingMs : 0);  // Small delay to prevent overwhelming sensors
+  trace.close(TRACE_IDLE);
 }
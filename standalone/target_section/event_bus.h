@@ -0,0 +1,236 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║             EVENT BUS: sensors publish changes, states subscribe          ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * Instead of every state re-testing every condition on every tick, the
+ * sensor code reports EDGES (the color changed, the distance dropped under
+ * a threshold, the line was lost, a servo move finished, the state timed
+ * out) and each state lists the ones it cares about in a fixed table:
+ *
+ *   const Subscription SUBSCRIPTIONS[] = {
+ *     // state             event              match            handler
+ *     { STATE_FOLLOW_RED, EVT_RANGE_BELOW,   DIST_OBSTACLE,   onObstacleAhead },
+ *     { STATE_FIND_BLUE,  EVT_COLOR_CHANGED, COLOR_BLUE,      onBlueZone },
+ *   };
+ *
+ * Nothing is allocated: the table is const (flash) and events wait in an
+ * SpscQueue of N slots. loop() feeds readings in (sampleColor() etc.), then
+ * dispatch() hands each event to the matching handlers of the CURRENT state.
+ *
+ * STATE CHANGES: call enter() from transitionTo(). It drops events still
+ * queued for the old state and re-arms every edge, so the first reading in
+ * the new state is published even if it didn't change ("already on blue"
+ * still fires). Range thresholds and timeouts are taken from the current
+ * state's subscriptions, so only crossings somebody listens for are made;
+ * a lost line, likewise, only when the state listens for it.
+ *
+ * report() prints, per event type, how many were delivered and how long
+ * they waited between publish() and the handler (avg/max microseconds).
+ *
+ * Arduino only compiles files inside the sketch folder, so every mission
+ * sketch carries an identical copy of this header.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "spsc_queue.h"
+
+#define BUS_ANY  -1   // Subscription.match: any value
+
+enum BusEventType : uint8_t {
+  EVT_COLOR_CHANGED,   // value = the new Color
+  EVT_RANGE_BELOW,     // value = threshold (cm) the distance just dropped under
+  EVT_LINE_LOST,       // value = 0: the line sensors just lost the line
+  EVT_SERVO_ARRIVED,   // value = final arm angle of a servo sequence
+  EVT_TIMEOUT,         // value = ms spent in the state
+  EVT_TYPE_COUNT
+};
+
+struct BusEvent {
+  uint32_t us;         // micros() at publish()
+  int16_t value;
+  BusEventType type;
+};
+
+typedef void (*BusHandler)(const BusEvent& e);
+
+struct Subscription {
+  uint8_t state;       // The sketch's State
+  BusEventType type;
+  int16_t match;       // Color, threshold (cm) or timeout (ms); BUS_ANY = all
+  BusHandler handler;  // Usually ends in transitionTo()
+};
+
+template <uint32_t N>
+class EventBus {
+public:
+  /** The subscription table; at most 32 entries (timeout bits). */
+  void begin(const Subscription* table, uint8_t count) {
+    table_ = table;
+    count_ = count > 32 ? 32 : count;
+  }
+
+  /** New state: forget the old state's events and re-arm every edge. */
+  void enter(uint8_t state, uint32_t nowMs) {
+    BusEvent e;
+    while (queue_.pop(e)) flushed_++;
+    state_ = state;
+    entries_++;
+    enteredMs_ = nowMs;
+    timeoutsFired_ = 0;
+    lastColor_ = BUS_ANY;
+    lastRange_ = 0;
+    onLine_ = true;
+  }
+
+  void publish(BusEventType type, int16_t value) {
+    BusEvent e = {(uint32_t)micros(), value, type};
+    if (queue_.push(e)) published_++;   // Full: dropped and counted by the queue
+  }
+
+  void sampleColor(int16_t color) {
+    if (color == lastColor_) return;
+    lastColor_ = color;
+    publish(EVT_COLOR_CHANGED, color);
+  }
+
+  /** cm <= 0 is "no reading" and never counts as below. */
+  void sampleRange(float cm) {
+    for (uint8_t i = 0; i < count_; i++) {
+      int16_t t = table_[i].match;
+      if (!listening(i, EVT_RANGE_BELOW) || sharedThreshold(i)) continue;
+      bool below = cm > 0 && cm < t;
+      bool was = lastRange_ > 0 && lastRange_ < t;
+      if (below && !was) publish(EVT_RANGE_BELOW, t);
+    }
+    lastRange_ = cm;
+  }
+
+  void sampleLine(bool onLine) {
+    if (onLine_ && !onLine && listensFor(EVT_LINE_LOST)) publish(EVT_LINE_LOST, 0);
+    onLine_ = onLine;
+  }
+
+  void sampleTime(uint32_t nowMs) {
+    for (uint8_t i = 0; i < count_; i++) {
+      if (!listening(i, EVT_TIMEOUT) || (timeoutsFired_ & (1UL << i))) continue;
+      if (nowMs - enteredMs_ > (uint32_t)table_[i].match) {
+        timeoutsFired_ |= 1UL << i;
+        publish(EVT_TIMEOUT, table_[i].match);
+      }
+    }
+  }
+
+  /**
+   * Deliver queued events to the current state's handlers, oldest first.
+   * Returns true as soon as a handler changed the state, or entered the
+   * same one again (the rest of the queue belonged to the old state and
+   * has been flushed by enter()).
+   */
+  bool dispatch() {
+    uint8_t state = state_;
+    uint16_t entries = entries_;
+    BusEvent e;
+    while (queue_.pop(e)) {
+      bool heard = false;
+      for (uint8_t i = 0; i < count_; i++) {
+        const Subscription& s = table_[i];
+        if (s.state != state || s.type != e.type || (s.match != BUS_ANY && s.match != e.value)) continue;
+        if (!heard) {
+          heard = true;
+          uint32_t wait = (uint32_t)micros() - e.us;
+          Latency& l = latency_[e.type];
+          l.count++;
+          l.totalUs += wait;
+          if (wait > l.maxUs) l.maxUs = wait;
+        }
+        s.handler(e);
+        if (entries_ != entries) return true;
+      }
+      if (!heard) unheard_++;
+    }
+    return false;
+  }
+
+  /** BUS: events=<published> unheard=<no subscriber> flushed=<dropped by a transition>
+   *  peak=<most queued>/<N> overflows=<n> <TYPE>=<delivered>,<avg>/<max us> ... */
+  void report() const {
+    Serial.print(F("BUS: events="));
+    Serial.print(published_);
+    Serial.print(F(" unheard="));
+    Serial.print(unheard_);
+    Serial.print(F(" flushed="));
+    Serial.print(flushed_);
+    Serial.print(F(" peak="));
+    Serial.print(queue_.peak());
+    Serial.print('/');
+    Serial.print(N);
+    Serial.print(F(" overflows="));
+    Serial.print(queue_.overflows());
+    for (uint8_t t = 0; t < EVT_TYPE_COUNT; t++) {
+      const Latency& l = latency_[t];
+      if (!l.count) continue;
+      Serial.print(' ');
+      Serial.print(typeName(t));
+      Serial.print('=');
+      Serial.print(l.count);
+      Serial.print(',');
+      Serial.print(l.totalUs / l.count);
+      Serial.print('/');
+      Serial.print(l.maxUs);
+    }
+    Serial.println();
+  }
+
+private:
+  struct Latency {
+    uint32_t count;
+    uint32_t totalUs;
+    uint32_t maxUs;
+  };
+
+  bool listening(uint8_t i, BusEventType type) const {
+    return table_[i].state == state_ && table_[i].type == type;
+  }
+
+  bool listensFor(BusEventType type) const {
+    for (uint8_t i = 0; i < count_; i++) {
+      if (listening(i, type)) return true;
+    }
+    return false;
+  }
+
+  /** An earlier subscription of this state already watches the same range threshold. */
+  bool sharedThreshold(uint8_t i) const {
+    for (uint8_t j = 0; j < i; j++) {
+      if (listening(j, EVT_RANGE_BELOW) && table_[j].match == table_[i].match) return true;
+    }
+    return false;
+  }
+
+  static const __FlashStringHelper* typeName(uint8_t t) {
+    switch (t) {
+      case EVT_COLOR_CHANGED: return F("COLOR");
+      case EVT_RANGE_BELOW:   return F("RANGE");
+      case EVT_LINE_LOST:     return F("LINE");
+      case EVT_SERVO_ARRIVED: return F("SERVO");
+      case EVT_TIMEOUT:       return F("TIMEOUT");
+    }
+    return F("?");
+  }
+
+  SpscQueue<BusEvent, N> queue_;   // Loop-only here, but it's the queue we have
+  const Subscription* table_ = nullptr;
+  uint8_t count_ = 0;
+  uint8_t state_ = 0;
+  uint16_t entries_ = 0;         // enter() calls, so dispatch() sees a state entered again
+  uint32_t enteredMs_ = 0;
+  uint32_t timeoutsFired_ = 0;     // Bit i: subscription i's timeout already published
+  int16_t lastColor_ = BUS_ANY;
+  float lastRange_ = 0;
+  bool onLine_ = true;
+  uint32_t published_ = 0, unheard_ = 0, flushed_ = 0;
+  Latency latency_[EVT_TYPE_COUNT] = {};
+};
@@ -0,0 +1,275 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║          POWER ARBITER: motors and servos share one current budget        ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * One battery feeds the L298N, both servos and the board. Its internal
+ * resistance turns a current spike into a voltage sag, and a deep enough
+ * sag resets the board (the "brownout" in checkpoint.h). The spikes come
+ * from actuators starting at once: a motor draws the most at a standing
+ * start and about twice that thrown into reverse, and a servo draws its
+ * most while it slews.
+ *
+ * The control interrupt passes its motor outputs through tick() every
+ * tick, and servo moves go through moveServo() instead of Servo::write().
+ * tick() estimates what everything would draw and keeps it under the
+ * budget given to begin():
+ *
+ *   motor   POWER_MOTOR_STALL_MA x (duty - back-EMF) + FREE_MA x duty.
+ *           The back-EMF is the motor's speed as a share of its top speed,
+ *           from its PWM through the same deadband and lag as the motion
+ *           model. Motors go first: a spike lasts one lag (~80 ms) and
+ *           delaying it would delay the mission, so the servos wait. If
+ *           the motors alone are over, both PWMs are scaled by the same
+ *           share, the largest the budget allows at their present speeds,
+ *           which ramps them up (or, reversing, down through 0) as fast as
+ *           the battery can take. The same share for both keeps the turn
+ *           that was asked for: capping only the wheel starting from rest
+ *           would steer a "straight on" after a curve off the line.
+ *   servo   POWER_SERVO_MA x its speed as a share of full speed. tick()
+ *           moves each servo's position in steps (a servo driven slower
+ *           draws less), at full speed when it fits and slower or not at
+ *           all when it doesn't.
+ *
+ * Nothing is refused, only stretched, and only while demand is over the
+ * budget. Each CONFLICT - from demand first going over to it fitting
+ * again - is queued for loop() to print with log():
+ *
+ *   POWER: conflict at_ms=<t> demand_ma=<most asked> ms=<long> limited=motors|servos
+ *
+ * and report() prints the totals:
+ *
+ *   POWER: budget_ma=<b> peak_ma=<most drawn> conflicts=<n> worst_ma=<most asked> motor_ms=<capped> servo_ms=<held back> lost=<n>
+ *
+ * Without the control timer nothing is arbitrated: moveServo() writes at
+ * once and servosMoving() goes by the time a full-speed move takes.
+ *
+ * Arduino only compiles files inside the sketch folder, so every mission
+ * sketch carries an identical copy of this header.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Servo.h>
+
+#include "spsc_queue.h"
+
+#define POWER_BOARD_MA        80    // The board and the sensors, always
+#define POWER_MOTOR_STALL_MA  1200  // A TT gearmotor at full PWM, not turning
+#define POWER_MOTOR_FREE_MA   120   // ...at full PWM, running free
+#define POWER_SERVO_MA        650   // An SG90 slewing at full speed
+#define POWER_SERVO_DEG_S     400   // ...which is 60° in 0.15 s
+#define POWER_SERVO_SETTLE_MS 40    // After the last step, for the servo to catch up
+#define POWER_SERVOS          2
+
+#define POWER_LIMITED_MOTORS  1
+#define POWER_LIMITED_SERVOS  2
+
+struct PowerConflict {
+  uint32_t atMs;       // When demand went over the budget
+  uint16_t demandMa;   // The most it asked for
+  uint16_t ms;         // How long until it fit again
+  uint8_t limited;     // POWER_LIMITED_*
+};
+
+class PowerArbiter {
+public:
+  /** The budget and motor model: before the control timer starts, whose first tick() uses them. */
+  void begin(uint16_t budgetMa, uint8_t deadband, uint16_t tauMs, uint16_t hz) {
+    budgetMa_ = budgetMa;
+    deadband_ = deadband;
+    dt_ = hz ? 1.0f / hz : 0;
+    lag_ = dt_ / (tauMs / 1000.0f + dt_);
+  }
+
+  /** `running`: the control timer did start and calls tick() (else nothing is arbitrated). */
+  void start(bool running) { running_ = running; }
+
+  /** A servo to arbitrate, and where it is now (written at once: the boot position). */
+  void attachServo(uint8_t i, Servo& servo, uint8_t deg) {
+    servo_[i] = &servo;
+    pos_[i] = deg;
+    target_[i] = deg;
+    written_[i] = deg;
+    settledMs_[i] = 1;
+    servo.write(deg);
+  }
+
+  /** Move servo `i` to `deg`; tick() gets it there. */
+  void moveServo(uint8_t i, uint8_t deg) {
+    if (!running_) {
+      movedMs_ = millis();
+      moveDeg_ = abs((int)deg - (int)target_[i]);
+      servo_[i]->write(deg);
+    }
+    noInterrupts();
+    target_[i] = deg;
+    settledMs_[i] = 0;   // tick() takes it from here
+    interrupts();
+  }
+
+  /** A servo still on its way (or settling). */
+  bool servosMoving() const {
+    if (!running_) return millis() - movedMs_ < moveDeg_ * 1000UL / POWER_SERVO_DEG_S + POWER_SERVO_SETTLE_MS;
+    for (uint8_t i = 0; i < POWER_SERVOS; i++) {
+      noInterrupts();
+      uint32_t settled = settledMs_[i];
+      interrupts();
+      if (servo_[i] && (!settled || millis() - settled < POWER_SERVO_SETTLE_MS)) return true;
+    }
+    return false;
+  }
+
+  /**
+   * From the control interrupt, with the motor outputs about to be
+   * applied: caps them, steps the servos, keeps the books.
+   */
+  void tick(int16_t& left, int16_t& right) {
+    float avail = budgetMa_ - POWER_BOARD_MA;
+    float askLeft = motorMa(left, emfLeft_), askRight = motorMa(right, emfRight_);
+    float motors = askLeft + askRight;
+    uint8_t limited = 0;
+    if (motors > avail) {
+      float scale = fitMotors(left, right, avail);
+      left = left * scale;
+      right = right * scale;
+      motors = motorMa(left, emfLeft_) + motorMa(right, emfRight_);
+      limited |= POWER_LIMITED_MOTORS;
+    }
+    emfLeft_ += (emfTarget(left) - emfLeft_) * lag_;
+    emfRight_ += (emfTarget(right) - emfRight_) * lag_;
+
+    // The servos get what's left
+    float servos = 0;
+    for (uint8_t i = 0; i < POWER_SERVOS; i++) {
+      if (servo_[i] && !settledMs_[i] && pos_[i] != target_[i]) servos += POWER_SERVO_MA;
+    }
+    float share = 1;
+    if (servos > 0 && motors + servos > avail) {
+      share = motors < avail ? (avail - motors) / servos : 0;
+      limited |= POWER_LIMITED_SERVOS;
+    }
+    float step = share * POWER_SERVO_DEG_S * dt_;
+    for (uint8_t i = 0; i < POWER_SERVOS; i++) {
+      if (!servo_[i] || settledMs_[i]) continue;
+      float to = target_[i];
+      if (pos_[i] < to) pos_[i] = pos_[i] + step < to ? pos_[i] + step : to;
+      else pos_[i] = pos_[i] - step > to ? pos_[i] - step : to;
+      uint8_t deg = (uint8_t)(pos_[i] + 0.5f);
+      if (deg != written_[i]) {
+        servo_[i]->write(deg);
+        written_[i] = deg;
+      }
+      if (pos_[i] == to) {
+        uint32_t now = millis();
+        settledMs_[i] = now ? now : 1;   // 0 is "on its way"
+      }
+    }
+
+    // The books
+    float drawn = POWER_BOARD_MA + motors + servos * share;
+    float asked = POWER_BOARD_MA + askLeft + askRight + servos;
+    if (drawn > peakMa_) peakMa_ = drawn;
+    if (limited & POWER_LIMITED_MOTORS) motorTicks_++;
+    if (limited & POWER_LIMITED_SERVOS) servoTicks_ += 1 - share;
+    if (limited) {
+      if (!open_.atMs) open_ = PowerConflict{(uint32_t)millis() | 1, 0, 0, 0};
+      if (asked > open_.demandMa) open_.demandMa = asked;
+      if (asked > worstMa_) worstMa_ = asked;
+      open_.limited |= limited;
+      openTicks_++;
+    } else if (open_.atMs) {
+      open_.ms = openTicks_ * dt_ * 1000;
+      conflicts_++;
+      if (!log_.push(open_)) lost_++;
+      open_.atMs = 0;
+      openTicks_ = 0;
+    }
+  }
+
+  /** From loop(): print the conflicts tick() resolved since the last call. */
+  void log() {
+    PowerConflict c;
+    while (log_.pop(c)) {
+      Serial.print(F("POWER: conflict at_ms="));
+      Serial.print(c.atMs);
+      Serial.print(F(" demand_ma="));
+      Serial.print(c.demandMa);
+      Serial.print(F(" ms="));
+      Serial.print(c.ms);
+      Serial.print(F(" limited="));
+      if (c.limited & POWER_LIMITED_MOTORS) Serial.print(F("motors"));
+      if (c.limited == (POWER_LIMITED_MOTORS | POWER_LIMITED_SERVOS)) Serial.print('|');
+      if (c.limited & POWER_LIMITED_SERVOS) Serial.print(F("servos"));
+      Serial.println();
+    }
+  }
+
+  void report() const {
+    Serial.print(F("POWER: budget_ma="));
+    Serial.print(budgetMa_);
+    Serial.print(F(" peak_ma="));
+    Serial.print((uint16_t)peakMa_);
+    Serial.print(F(" conflicts="));
+    Serial.print(conflicts_);
+    Serial.print(F(" worst_ma="));
+    Serial.print((uint16_t)worstMa_);
+    Serial.print(F(" motor_ms="));
+    Serial.print((uint32_t)(motorTicks_ * dt_ * 1000));
+    Serial.print(F(" servo_ms="));
+    Serial.print((uint32_t)(servoTicks_ * dt_ * 1000));
+    Serial.print(F(" lost="));
+    Serial.println(lost_);
+  }
+
+private:
+  /** The share of top speed a motor settles at for this PWM (signed). */
+  float emfTarget(int16_t pwm) const {
+    int16_t over = abs(pwm) - deadband_;
+    if (over <= 0) return 0;
+    float f = (float)over / (255 - deadband_);
+    return pwm < 0 ? -f : f;
+  }
+
+  /** mA a motor draws at this PWM, turning at `emf` (see above); generating = 0. */
+  static float motorMa(int16_t pwm, float emf) {
+    if (!pwm) return 0;
+    float duty = abs(pwm) / 255.0f;
+    float drive = duty - (pwm < 0 ? -emf : emf);
+    return POWER_MOTOR_STALL_MA * (drive > 0 ? drive : 0) + POWER_MOTOR_FREE_MA * duty;
+  }
+
+  /** The largest share of both PWMs (0..1) that draws at most `ma` at the motors' present speeds. */
+  float fitMotors(int16_t left, int16_t right, float ma) const {
+    float lo = 0, hi = 1;
+    for (uint8_t i = 0; i < 8; i++) {   // Halving: to within one PWM step of 255
+      float k = (lo + hi) / 2;
+      if (motorMa(left * k, emfLeft_) + motorMa(right * k, emfRight_) <= ma) lo = k;
+      else hi = k;
+    }
+    return lo;
+  }
+
+  uint16_t budgetMa_ = 0;
+  uint8_t deadband_ = 0;
+  float dt_ = 0, lag_ = 0;
+  bool running_ = false;
+  float emfLeft_ = 0, emfRight_ = 0;   // Each motor's speed, share of top speed (model)
+
+  Servo* servo_[POWER_SERVOS] = {};
+  float pos_[POWER_SERVOS] = {};       // Where tick() has each servo (deg; the ISR's)
+  volatile uint8_t target_[POWER_SERVOS] = {};
+  uint8_t written_[POWER_SERVOS] = {};
+  volatile uint32_t settledMs_[POWER_SERVOS] = {};   // When it got to target_; 0 = on its way
+  uint32_t movedMs_ = 0;               // Without the timer: the last move...
+  uint16_t moveDeg_ = 0;               // ...and how far
+
+  float peakMa_ = 0, worstMa_ = 0;
+  uint32_t motorTicks_ = 0;
+  float servoTicks_ = 0;               // Ticks of servo time held back
+  PowerConflict open_ = {0, 0, 0, 0};  // The conflict going on; atMs 0 = none
+  uint32_t openTicks_ = 0;
+  uint16_t conflicts_ = 0, lost_ = 0;
+  SpscQueue<PowerConflict, 8> log_;
+};
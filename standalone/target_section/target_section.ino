@@ -28,10 +28,21 @@
  * ===========
  *   [CLIMB RAMP] → [ON TARGET] → [NAV BLUE] → [NAV RED] → [NAV GREEN]
  *                                                              ↓
- *   [COMPLETE] ← [RETURN] ← [SHOOT] ← [FIND BALL] ← [REACH CENTER]
+ *   [COMPLETE] ← [RETURN] ← [TURN] ← [SHOOT] ← [FIND BALL] ← [REACH CENTER]
+ *
+ * This is the built-in mission program (see MISSION PROGRAM below): each
+ * step runs as one or more of these states.
  */
 
 #include <Servo.h>
+#include <FspTimer.h>
+#include "spsc_queue.h"
+#include "event_bus.h"
+#include "checkpoint.h"
+#include "mission_clock.h"
+#include "power_arbiter.h"
+#include "trace.h"
+#include "mission_program.h"
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                           PIN DEFINITIONS                                  ║
@@ -64,6 +75,9 @@
 #define PIN_ULTRA_TRIG    A0
 #define PIN_ULTRA_ECHO    A1
 
+// --- START BUTTON (optional, to GND; see START_TRIGGER). D0: free, Serial is USB ---
+#define PIN_START         0
+
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                              CONSTANTS                                     ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
@@ -87,6 +101,67 @@
 // Timing
 #define TIME_TURN_90      500   // ms for 90° turn
 
+// Telemetry: print a "T:" line every N loop ticks (0 = off)
+#define TELEMETRY_EVERY   5
+// Spans sent as "TRACE:" lines (see trace.h): states 1, sensors 2,
+// maneuvers 4, servos 8, the loop's idle wait 16
+#define TRACE_MASK        13    // States, maneuvers, servos; 0 = off
+#define STR_(x) #x      // Stringify a #define for the boot banner
+#define STR(x)  STR_(x)
+
+// Control interrupt: a hardware timer updates the motors at a fixed rate
+#define CONTROL_HZ        1000  // 0 = off: motor functions write the pins directly
+#define CONTROL_SLEW      0     // Max PWM change per tick (0 = jump to the target)
+#define CONTROL_REPORT_MS 5000  // Print a "CTRL:" timing line this often (0 = never)
+
+// Checkpoint: every state change goes to EEPROM and a brownout or watchdog
+// reset resumes from it (see checkpoint.h); power-on and the reset button start fresh.
+// Timed moves (SHOOT, TURN, RETURN) restart from their beginning.
+#define CHECKPOINT_RESUME 1     // 0 = never resume
+#define CHECKPOINT_BUDGET_US 20000 // EEPROM writing per loop() tick, at most
+
+// Boot & start: check the parts are ready instead of a fixed delay(1000),
+// then wait for a start cue (see waitForStart())
+#define START_NOW         0     // Go as soon as everything is ready
+#define START_BUTTON      1     // PIN_START pressed
+#define START_WAVE        2     // A hand in front of the ultrasonic, then away
+#define START_LINE        3     // The color sensor sees the line after white (pull a card)
+#define START_TRIGGER     START_WAVE
+#define START_WAVE_CM     10    // Closer than this is a hand
+#define START_HOLD_MS     300   // A cue must last this long
+#define BOOT_SERVO_MS     450   // Worst servo move at power-on (180° at 0.15 s / 60°)
+#define BOOT_TIMEOUT_MS   1000  // Give up waiting for a part after this
+
+// Mission budget: behind the PLAN, the climb and the return go faster and
+// the ball search gives up sooner (see mission_clock.h)
+#define MISSION_ADAPT     1     // 0 = fixed speeds and search times
+#define MISSION_BUDGET_MS 20000 // This section's share of the competition time
+#define MISSION_RESERVE_MS 1500 // ...minus this, kept back
+#define SPEED_CRUISE_MAX  230   // Fastest the climb and the return may go
+#define BALL_SEARCH_MS    3000  // Look for the ball this long, then shoot anyway...
+#define BALL_LEAST_MS     1000  // ...but at least this long
+
+// Arc turn: TURN turns around on an arc with the outer wheel at full
+// speed and RETURN drives straight on out of it, instead of pivot, stop,
+// drive. No motion model in this sketch: the arc is timed from the kinematics.
+#define ARC_TURNS         1     // 0 = pivot TIME_TURN_90 per 90° (old behavior)
+#define ARC_RADIUS_CM     10    // Axle center (> DRIVE_TRACK_CM / 2: both wheels forward)
+#define DRIVE_CM_PER_PWM  0.29  // Wheel cm/s per PWM step above the deadband...
+#define DRIVE_DEADBAND    50    // ...PWM below this doesn't turn the wheels...
+#define DRIVE_TRACK_CM    13    // ...and wheel spacing: the drive of sections 1 and 3
+
+// Power budget: the ram and the arm share one battery. The control
+// interrupt keeps what motors and servos draw under this (see
+// power_arbiter.h): the motors ramp as fast as it allows, the arm waits.
+#define POWER_BUDGET_MA   1500  // The battery sags below the board's brownout at ~1.6 A
+#define DRIVE_TAU_MS      80    // Wheel speed lag, for the arbiter's motor model (as sections 1 and 3)
+#define SERVO_ARM         0     // Arbiter's servo numbers
+#define SERVO_CLAMP       1
+
+// Ultrasonic echo (timed by interrupt, see readDistance())
+#define ECHO_TIMEOUT_US   25000  // No echo by then = nothing in range
+#define ECHO_FRESH_MS     150    // Older results make readDistance() wait for a new ping
+
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                              DATA TYPES                                    ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
@@ -110,7 +185,8 @@ enum State {
   STATE_FIND_BALL,      // Looking for the ball
   STATE_SHOOT,          // Launching the ball
   STATE_RETURN,         // Going back down the ramp
-  STATE_COMPLETE        // Section done
+  STATE_COMPLETE,       // Section done
+  STATE_TURN            // Turning for a program's TURN (after COMPLETE: the numbers above stay)
 };
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
@@ -120,31 +196,133 @@ enum State {
 Servo baseServo, clampServo;
 State currentState = STATE_CLIMB_RAMP;
 uint32_t stateStartTime = 0;
-int8_t searchDir = 1;      // Direction to search: 1=right, -1=left
+int8_t searchDir = 1;      // Direction of the first search swing: 1=right, -1=left
+int8_t searchSide = 0;     // Swung to, from the way we came in: 1=right, -1=left, 0=straight
 uint8_t searchCount = 0;   // Counter for search pattern
+Color lastColor = COLOR_NONE;  // Latest readings (for telemetry)
+float lastDistance = 999.0;
+EventBus<8> bus;               // Sensor edges -> state handlers (see event_bus.h)
+CheckpointStore checkpoint;    // Mission state in EEPROM (see checkpoint.h)
+MissionClock mission;          // Time used vs. the plan (see mission_clock.h)
+PowerArbiter power;            // Moves the servos, caps the motors (see power_arbiter.h)
+Tracer trace;                  // Spans of the run, sent as TRACE: lines (see trace.h)
+MissionProgram program;        // The route, step by step (see mission_program.h)
+ProgramStep programStep;       // The step running now
+bool adapting = false;         // MISSION_ADAPT on the built-in route (set in setup())
+
+// Trace ids (named in setup()): a state's span is TRACE_STATE + its State
+enum TraceId : uint8_t {
+  TRACE_STATE = 0,
+  TRACE_COLOR = 16, TRACE_ECHO,
+  TRACE_ARC = 24, TRACE_NAVIGATE,
+  TRACE_SERVO_WAIT = 40,
+  TRACE_IDLE = 48
+};
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                          SENSOR FUNCTIONS                                  ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
 
-/**
- * Read distance from ultrasonic sensor (in cm)
- */
-float readDistance() {
+// Sensor events: interrupts push, loop() pops (no locking, see spsc_queue.h)
+enum EventKind : uint8_t { EV_ECHO_RISE, EV_ECHO_FALL };
+struct SensorEvent {
+  uint32_t us;       // micros() at the edge
+  EventKind kind;
+};
+SpscQueue<SensorEvent, 16> sensorEvents;
+
+bool echoByInterrupt = false;   // false: the echo pin has no interrupt, use pulseIn()
+bool pingInFlight = false, echoStarted = false;
+uint32_t pingSentUs = 0, echoRiseUs = 0;
+uint32_t resultPingUs = 0;      // When the ping behind echoDistance was sent
+float echoDistance = 999.0;
+
+/** Interrupt on both echo edges: just timestamp and queue. */
+void echoEdge() {
+  SensorEvent e = {(uint32_t)micros(), digitalRead(PIN_ULTRA_ECHO) == HIGH ? EV_ECHO_RISE : EV_ECHO_FALL};
+  sensorEvents.push(e);   // Full: dropped and counted
+}
+
+void sendPing() {
   digitalWrite(PIN_ULTRA_TRIG, LOW);
   delayMicroseconds(2);
   digitalWrite(PIN_ULTRA_TRIG, HIGH);
   delayMicroseconds(10);
   digitalWrite(PIN_ULTRA_TRIG, LOW);
-  
-  unsigned long duration = pulseIn(PIN_ULTRA_ECHO, HIGH, 25000);
-  return duration == 0 ? 999.0 : (duration * 0.034) / 2.0;
+  pingSentUs = micros();
+  pingInFlight = true;
+  echoStarted = false;
+}
+
+/** Turn queued echo edges into a distance; give up on a ping after ECHO_TIMEOUT_US. */
+void serviceEcho() {
+  SensorEvent e;
+  while (sensorEvents.pop(e)) {
+    if (e.kind == EV_ECHO_RISE) {
+      echoRiseUs = e.us;
+      echoStarted = true;
+    } else if (pingInFlight && echoStarted) {
+      echoDistance = ((e.us - echoRiseUs) * 0.034) / 2.0;
+      resultPingUs = pingSentUs;
+      pingInFlight = false;
+      trace.complete(TRACE_ECHO, pingSentUs, e.us, echoDistance);
+    }
+  }
+  if (pingInFlight && micros() - pingSentUs > ECHO_TIMEOUT_US) {
+    echoDistance = 999.0;
+    resultPingUs = pingSentUs;
+    pingInFlight = false;
+    trace.complete(TRACE_ECHO, pingSentUs, pingSentUs + ECHO_TIMEOUT_US, 999);
+  }
+}
+
+/** Attach the echo interrupt, then check a ping really produces an edge. */
+void startEcho() {
+  attachInterrupt(digitalPinToInterrupt(PIN_ULTRA_ECHO), echoEdge, CHANGE);
+  sendPing();
+  delay(5);
+  echoByInterrupt = !sensorEvents.empty();
+  if (!echoByInterrupt) {
+    detachInterrupt(digitalPinToInterrupt(PIN_ULTRA_ECHO));
+    Serial.println(F("ECHO: no interrupt on the echo pin, using pulseIn()"));
+  }
+}
+
+/**
+ * Read distance from ultrasonic sensor (in cm). Returns the previous
+ * ping's result and sends the next one; only waits when that result is
+ * older than ECHO_FRESH_MS (first call, after a long maneuver).
+ */
+float readDistance() {
+  if (!echoByInterrupt) {
+    sendPing();
+    unsigned long duration = pulseIn(PIN_ULTRA_ECHO, HIGH, ECHO_TIMEOUT_US);
+    float cm = duration == 0 ? 999.0 : (duration * 0.034) / 2.0;
+    trace.complete(TRACE_ECHO, pingSentUs, micros(), cm);
+    return cm;
+  }
+  serviceEcho();
+  bool stale = micros() - resultPingUs > ECHO_FRESH_MS * 1000UL;
+  if (!pingInFlight && digitalRead(PIN_ULTRA_ECHO) == LOW) sendPing();
+  while (stale && pingInFlight) serviceEcho();
+  return echoDistance;
+}
+
+/** QUEUE: sensor peak=<most waiting>/<capacity> overflows=<dropped events> */
+void reportSensorQueue() {
+  Serial.print(F("QUEUE: sensor peak="));
+  Serial.print(sensorEvents.peak());
+  Serial.print('/');
+  Serial.print(sensorEvents.capacity());
+  Serial.print(F(" overflows="));
+  Serial.println(sensorEvents.overflows());
 }
 
 /**
  * Read color from TCS3200 sensor
  */
 Color readColor() {
+  TraceSpan span(trace, TRACE_COLOR);
   // Read RED
   digitalWrite(PIN_COLOR_S2, LOW);
   digitalWrite(PIN_COLOR_S3, LOW);
@@ -181,41 +359,189 @@ Color readColor() {
   return COLOR_NONE;
 }
 
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                         CONTROL INTERRUPT                                  ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+FspTimer controlTimer;
+volatile bool controlRunning = false;
+volatile int16_t targetLeft = 0, targetRight = 0;   // Signed PWM: < 0 = backward
+int16_t outLeft = 0, outRight = 0;                  // What the pins are at (ISR only)
+
+struct ControlStats {            // CPU cycles; written by the ISR, read by reportControl()
+  uint32_t ticks, late;
+  uint32_t periodMin, periodMax, periodSum;
+  uint32_t execMax, execSum;
+};
+const ControlStats CONTROL_STATS_EMPTY = {0, 0, UINT32_MAX, 0, 0, 0, 0};
+ControlStats ctrlStats = CONTROL_STATS_EMPTY;
+uint32_t ctrlLastStart = 0;
+uint32_t ctrlNominal = 0;        // Cycles per tick
+
+/** Writes the pins. Only controlTick() calls this once the timer runs. */
+void applyMotors(int16_t left, int16_t right) {
+  digitalWrite(PIN_MOTOR_IN1, left >= 0 ? HIGH : LOW);   // LEFT direction
+  digitalWrite(PIN_MOTOR_IN2, left >= 0 ? LOW : HIGH);
+  digitalWrite(PIN_MOTOR_IN3, right >= 0 ? HIGH : LOW);  // RIGHT direction
+  digitalWrite(PIN_MOTOR_IN4, right >= 0 ? LOW : HIGH);
+  analogWrite(PIN_MOTOR_ENA, abs(left));
+  analogWrite(PIN_MOTOR_ENB, abs(right));
+}
+
+int16_t slewToward(int16_t from, int16_t to) {
+  if (CONTROL_SLEW == 0) return to;
+  if (to > from + CONTROL_SLEW) return from + CONTROL_SLEW;
+  if (to < from - CONTROL_SLEW) return from - CONTROL_SLEW;
+  return to;
+}
+
+/**
+ * Timer interrupt: move the outputs toward the targets (within the power
+ * budget), step the servos and time itself.
+ * Must stay short; it runs CONTROL_HZ times a second whatever loop() does.
+ */
+void controlTick(timer_callback_args_t*) {
+  uint32_t start = DWT->CYCCNT;
+  ControlStats& s = ctrlStats;
+  if (s.ticks++ > 0) {   // The first tick of a window has no period yet
+    uint32_t period = start - ctrlLastStart;
+    if (period < s.periodMin) s.periodMin = period;
+    if (period > s.periodMax) s.periodMax = period;
+    if (period > ctrlNominal + ctrlNominal / 2) s.late++;
+    s.periodSum += period;
+  }
+  ctrlLastStart = start;
+
+  int16_t wantLeft = targetLeft, wantRight = targetRight;
+  int16_t left = slewToward(outLeft, wantLeft);
+  int16_t right = slewToward(outRight, wantRight);
+  power.tick(left, right);   // Under POWER_BUDGET_MA; steps the servos
+  if (left != outLeft || right != outRight) {
+    applyMotors(left, right);
+    outLeft = left;
+    outRight = right;
+  }
+
+  uint32_t exec = DWT->CYCCNT - start;
+  s.execSum += exec;
+  if (exec > s.execMax) s.execMax = exec;
+}
+
+uint32_t firstMotionMs = 0;      // millis() of the first drive command (see reportBoot())
+
+/** What the motor functions call: targets for the next tick. */
+void setDrive(int16_t left, int16_t right) {
+  if (!firstMotionMs && (left || right)) firstMotionMs = millis();
+  if (!controlRunning) {
+    applyMotors(left, right);
+    return;
+  }
+  noInterrupts();   // Both sides change on the same tick
+  targetLeft = left;
+  targetRight = right;
+  interrupts();
+}
+
+/** Start the timer (call after the motors are stopped and PWM is set up). */
+void startControl() {
+  if (CONTROL_HZ == 0) return;
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;   // CPU cycle counter for the timing stats
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  ctrlNominal = SystemCoreClock / CONTROL_HZ;
+
+  uint8_t type;
+  int8_t channel = FspTimer::get_available_timer(type);
+  if (channel < 0 || !controlTimer.begin(TIMER_MODE_PERIODIC, type, channel, CONTROL_HZ, 0.0f, controlTick) ||
+      !controlTimer.setup_overflow_irq() || !controlTimer.open() || !controlTimer.start()) {
+    Serial.println(F("CTRL: no free timer, motors updated from loop()"));
+    return;
+  }
+  controlRunning = true;
+}
+
+/**
+ * CTRL: hz=1000 ticks=5000 period_us=min/avg/max jitter_us=.. exec_us=avg/max late=..
+ * Stats since the previous report. late = ticks more than 1.5 periods apart.
+ */
+void reportControl() {
+  if (!controlRunning) return;
+  noInterrupts();
+  ControlStats s = ctrlStats;
+  ctrlStats = CONTROL_STATS_EMPTY;
+  interrupts();
+  if (s.ticks < 2) return;
+
+  float cyclesPerUs = SystemCoreClock / 1000000.0f;
+  float nominal = 1000000.0f / CONTROL_HZ;
+  float lo = s.periodMin / cyclesPerUs, hi = s.periodMax / cyclesPerUs;
+  Serial.print(F("CTRL: hz="));
+  Serial.print(CONTROL_HZ);
+  Serial.print(F(" ticks="));
+  Serial.print(s.ticks);
+  Serial.print(F(" period_us="));
+  Serial.print(lo, 1);
+  Serial.print('/');
+  Serial.print(s.periodSum / cyclesPerUs / (s.ticks - 1), 1);
+  Serial.print('/');
+  Serial.print(hi, 1);
+  Serial.print(F(" jitter_us="));
+  Serial.print(hi - nominal > nominal - lo ? hi - nominal : nominal - lo, 1);
+  Serial.print(F(" exec_us="));
+  Serial.print(s.execSum / cyclesPerUs / s.ticks, 1);
+  Serial.print('/');
+  Serial.print(s.execMax / cyclesPerUs, 1);
+  Serial.print(F(" late="));
+  Serial.println(s.late);
+}
+
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                          MOTOR FUNCTIONS                                   ║
 // ║              Motor A = LEFT wheel, Motor B = RIGHT wheel                  ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
 
 void stopMotors() {
-  analogWrite(PIN_MOTOR_ENA, 0);
-  analogWrite(PIN_MOTOR_ENB, 0);
+  setDrive(0, 0);
 }
 
 void moveForward(uint8_t speed) {
-  digitalWrite(PIN_MOTOR_IN1, HIGH);  // LEFT forward
-  digitalWrite(PIN_MOTOR_IN2, LOW);
-  digitalWrite(PIN_MOTOR_IN3, HIGH);  // RIGHT forward
-  digitalWrite(PIN_MOTOR_IN4, LOW);
-  analogWrite(PIN_MOTOR_ENA, speed);
-  analogWrite(PIN_MOTOR_ENB, (uint8_t)(speed * SPEED_COMPENSATION));
+  setDrive(speed, (uint8_t)(speed * SPEED_COMPENSATION));
 }
 
 void turnLeft(uint8_t speed) {
-  digitalWrite(PIN_MOTOR_IN1, LOW);   // LEFT backward
-  digitalWrite(PIN_MOTOR_IN2, HIGH);
-  digitalWrite(PIN_MOTOR_IN3, HIGH);  // RIGHT forward
-  digitalWrite(PIN_MOTOR_IN4, LOW);
-  analogWrite(PIN_MOTOR_ENA, speed);
-  analogWrite(PIN_MOTOR_ENB, (uint8_t)(speed * SPEED_COMPENSATION));
+  setDrive(-speed, (uint8_t)(speed * SPEED_COMPENSATION));   // LEFT backward, RIGHT forward
 }
 
 void turnRight(uint8_t speed) {
-  digitalWrite(PIN_MOTOR_IN1, HIGH);  // LEFT forward
-  digitalWrite(PIN_MOTOR_IN2, LOW);
-  digitalWrite(PIN_MOTOR_IN3, LOW);   // RIGHT backward
-  digitalWrite(PIN_MOTOR_IN4, HIGH);
-  analogWrite(PIN_MOTOR_ENA, speed);
-  analogWrite(PIN_MOTOR_ENB, (uint8_t)(speed * SPEED_COMPENSATION));
+  setDrive(speed, -(uint8_t)(speed * SPEED_COMPENSATION));   // LEFT forward, RIGHT backward
+}
+
+/**
+ * Turn through `deg` (+ = left) on an arc of `radiusCm`, the outer wheel
+ * at full PWM. Wheel speeds from the differential-drive kinematics,
+ *   v_outer = v (R + T/2) / R    v_inner = v (R - T/2) / R
+ * and the time from the turn rate v / R. Returns still turning: drive on
+ * (blended, no stop) or stop.
+ */
+void arcTurn(float radiusCm, float deg) {
+  TraceSpan span(trace, TRACE_ARC);
+  float outer = (255 - DRIVE_DEADBAND) * DRIVE_CM_PER_PWM;   // cm/s
+  float v = outer * radiusCm / (radiusCm + DRIVE_TRACK_CM / 2.0f);
+  float inner = v * (radiusCm - DRIVE_TRACK_CM / 2.0f) / radiusCm;
+  float innerPwm = DRIVE_DEADBAND + inner / DRIVE_CM_PER_PWM;
+  if (deg < 0) setDrive(255, (int16_t)(innerPwm * SPEED_COMPENSATION));
+  else setDrive((int16_t)innerPwm, (int16_t)(255 * SPEED_COMPENSATION));
+  delay((uint32_t)(fabsf(deg) / 57.2958f * radiusCm / v * 1000));
+}
+
+/**
+ * Wait for the servos to get there: as long as the arbiter needs, `ms` at
+ * least without the control timer, 3 x `ms` at most.
+ */
+void awaitServos(uint32_t ms) {
+  TraceSpan span(trace, TRACE_SERVO_WAIT);
+  uint32_t start = millis();
+  while (power.servosMoving() && millis() - start < 3 * ms) delay(5);
+  if (!controlRunning && millis() - start < ms) delay(ms - (millis() - start));
 }
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
@@ -224,23 +550,28 @@ void turnRight(uint8_t speed) {
 
 /**
  * Navigate toward the center of the target using a search pattern.
- * Moves forward, then alternates turning left/right to find inner colors.
+ * Moves forward, then swings to the other side of the way we came in to
+ * find inner colors: a zigzag around the course. (Swinging the same turn
+ * each way only went back and forth between straight and one side, and
+ * drifted past the center on that side.)
  */
 void navigateToCenter() {
+  TraceSpan span(trace, TRACE_NAVIGATE);
   moveForward(SPEED_SLOW);
   delay(100);
   
   searchCount++;
   if (searchCount > 5) {
-    // Alternate search direction
-    if (searchDir > 0) {
+    // From straight ahead one swing, from one side two to the other
+    int8_t to = searchSide == 0 ? searchDir : -searchSide;
+    if (to > 0) {
       turnRight(SPEED_TURN);
     } else {
       turnLeft(SPEED_TURN);
     }
-    delay(200);
+    delay(200 * abs(to - searchSide));
     stopMotors();
-    searchDir *= -1;  // Flip direction
+    searchSide = to;
     searchCount = 0;
   }
 }
@@ -249,81 +580,227 @@ void navigateToCenter() {
 // ║                           STATE MACHINE                                    ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
 
+/**
+ * State names for the Serial log (Coach App / host tools read these).
+ * Keep in sync with the State enum.
+ */
+const __FlashStringHelper* stateName(State s) {
+  switch (s) {
+    case STATE_CLIMB_RAMP:   return F("CLIMB_RAMP");
+    case STATE_ON_TARGET:    return F("ON_TARGET");
+    case STATE_NAV_BLUE:     return F("NAV_BLUE");
+    case STATE_NAV_RED:      return F("NAV_RED");
+    case STATE_NAV_GREEN:    return F("NAV_GREEN");
+    case STATE_REACH_CENTER: return F("REACH_CENTER");
+    case STATE_FIND_BALL:    return F("FIND_BALL");
+    case STATE_SHOOT:        return F("SHOOT");
+    case STATE_RETURN:       return F("RETURN");
+    case STATE_COMPLETE:     return F("COMPLETE");
+    case STATE_TURN:         return F("TURN");
+  }
+  return F("?");
+}
+
 void transitionTo(State newState) {
   currentState = newState;
   stateStartTime = millis();
   searchCount = 0;
+  bus.enter(newState, stateStartTime);
+  checkpoint.save(newState, false, program.loops(), 0, program.resumePc());
+  mission.enter(newState, stateStartTime, 0);   // No odometer: progress by time
+  trace.switchTo(TRACE_STATE + newState);
   Serial.print(F("STATE: "));
-  Serial.println(newState);
+  Serial.print(newState);
+  Serial.print(' ');
+  Serial.print(stateName(newState));
+  Serial.print(F(" ms="));   // Robot time: a log without host stamps still times each state
+  Serial.println(stateStartTime);
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                        MISSION PROGRAM                                     ║
+// ║  The route as steps (see mission_program.h), and the events ending each.  ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/*
+ * Each step runs as one or more states, with the subscriptions that end
+ * it (subscribeStep() builds them, see event_bus.h):
+ *
+ *   step     states                                ends on
+ *   CLIMB    CLIMB_RAMP                            a color, or its time: onLanded
+ *   CENTER   ON_TARGET, NAV_* (onZoneColor),       its action
+ *            REACH_CENTER
+ *   SEEK     FIND_BALL                             something within cm, or BALL_SEARCH_MS
+ *                                                  (less when late: its action)
+ *   SHOOT    SHOOT                                 its action
+ *   TURN     TURN                                  its action
+ *   DRIVE    RETURN                                its action
+ *   HALT     COMPLETE
+ */
+
+// The course as it is; a program loaded over Serial replaces it
+const uint8_t BUILTIN_PROGRAM[] = {
+  OP_CLIMB,  5000 & 0xFF, 5000 >> 8,          // climb 5000ms
+  OP_CENTER,                                  // center
+  OP_SEEK,   DIST_BALL,                       // seek 20cm
+  OP_SHOOT,                                   // shoot
+  OP_TURN,   -180 & 0xFF, (-180 >> 8) & 0xFF, // turn -180deg
+  OP_DRIVE,  4000 & 0xFF, 4000 >> 8,          // drive 4000ms
+  OP_HALT,                                    // halt
+};
+
+// The steps this sketch has states for (a program with others is rejected)
+const uint32_t STEP_OPS = PROGRAM_OP(OP_CLIMB) | PROGRAM_OP(OP_CENTER) | PROGRAM_OP(OP_SEEK) |
+                          PROGRAM_OP(OP_SHOOT) | PROGRAM_OP(OP_TURN) | PROGRAM_OP(OP_DRIVE);
+
+Subscription stepSubscriptions[7];   // The running step's (CENTER: one per inward move)
+
+/** The state that runs step `s` (CENTER: the first of its states). */
+State stepState(const ProgramStep& s) {
+  switch (s.op) {
+    case OP_CLIMB:  return STATE_CLIMB_RAMP;
+    case OP_CENTER: return STATE_ON_TARGET;
+    case OP_SEEK:   return STATE_FIND_BALL;
+    case OP_SHOOT:  return STATE_SHOOT;
+    case OP_TURN:   return STATE_TURN;
+    case OP_DRIVE:  return STATE_RETURN;
+    default:        return STATE_COMPLETE;
+  }
+}
+
+void nextStep();   // The handlers end their step with it; it subscribes them (below)
+
+// The step is over (a SEEK's ball in range, or its time)
+void onStepDone(const BusEvent&) { nextStep(); }
+
+/** Any real color means we're on the target (or the climb timed out). */
+void onLanded(const BusEvent& e) {
+  if (e.type == EVT_COLOR_CHANGED && (e.value == COLOR_NONE || e.value == COLOR_WHITE)) return;
+  stopMotors();
+  nextStep();
+}
+
+/** Ring colors, outermost first: the zone we're in now. */
+void onZoneColor(const BusEvent& e) {
+  if (e.value == COLOR_BLUE)       transitionTo(STATE_NAV_BLUE);
+  else if (e.value == COLOR_RED)   transitionTo(STATE_NAV_RED);
+  else if (e.value == COLOR_GREEN) transitionTo(STATE_NAV_GREEN);
+  else if (e.value == COLOR_BLACK) transitionTo(STATE_REACH_CENTER);
 }
 
+/** subscribeStep() - Take the program's next step and subscribe what ends it. Returns its state. */
+State subscribeStep() {
+  programStep = program.next();
+  const ProgramStep& s = programStep;
+  State state = stepState(s);
+  uint8_t n = 0;
+  switch (s.op) {
+    case OP_CLIMB:
+      stepSubscriptions[n++] = {state, EVT_COLOR_CHANGED, BUS_ANY, onLanded};
+      stepSubscriptions[n++] = {state, EVT_TIMEOUT, s.value, onLanded};
+      break;
+    case OP_CENTER:
+      stepSubscriptions[n++] = {STATE_ON_TARGET, EVT_COLOR_CHANGED, BUS_ANY,     onZoneColor};
+      stepSubscriptions[n++] = {STATE_NAV_BLUE,  EVT_COLOR_CHANGED, COLOR_RED,   onZoneColor};   // Only inward moves
+      stepSubscriptions[n++] = {STATE_NAV_BLUE,  EVT_COLOR_CHANGED, COLOR_GREEN, onZoneColor};
+      stepSubscriptions[n++] = {STATE_NAV_BLUE,  EVT_COLOR_CHANGED, COLOR_BLACK, onZoneColor};
+      stepSubscriptions[n++] = {STATE_NAV_RED,   EVT_COLOR_CHANGED, COLOR_GREEN, onZoneColor};
+      stepSubscriptions[n++] = {STATE_NAV_RED,   EVT_COLOR_CHANGED, COLOR_BLACK, onZoneColor};
+      stepSubscriptions[n++] = {STATE_NAV_GREEN, EVT_COLOR_CHANGED, COLOR_BLACK, onZoneColor};
+      break;
+    case OP_SEEK:
+      stepSubscriptions[n++] = {state, EVT_RANGE_BELOW, s.arg, onStepDone};
+      stepSubscriptions[n++] = {state, EVT_TIMEOUT, BALL_SEARCH_MS, onStepDone};
+      break;
+    default:      break;   // SHOOT, TURN, DRIVE: their action moves on; HALT: over
+  }
+  bus.begin(stepSubscriptions, n);
+  return state;
+}
+
+/**
+ * nextStep() - On to the program's next step. After a brownout, setup()
+ * resumes the program where the checkpoint says (see mission_program.h).
+ */
+void nextStep() {
+  transitionTo(subscribeStep());
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                          MISSION BUDGET                                    ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+// A normal run, measured in the simulator (host/sim): ms per state, the
+// median of the completed runs over 60 seeds. It is the built-in route's:
+// a loaded program runs without it (fixed speeds and search times).
+const Leg PLAN[] = {
+  { STATE_CLIMB_RAMP,   2100, 0 },
+  { STATE_ON_TARGET,     100, 0 },
+  { STATE_NAV_BLUE,     1800, 0 },
+  { STATE_NAV_RED,      2150, 0 },
+  { STATE_NAV_GREEN,    1100, 0 },
+  { STATE_REACH_CENTER,  600, 0 },
+  { STATE_FIND_BALL,    3150, 0 },
+  { STATE_SHOOT,        1500, 0 },
+  { STATE_TURN,          950, 0 },
+  { STATE_RETURN,       4000, 0 },
+  { STATE_COMPLETE,        0, 0 },
+};
+
+/** Faster or slower for the time left (SPEED_CRUISE_MAX at most), or `nominal`. */
+uint8_t cruiseSpeed(uint8_t nominal) {
+  return adapting ? mission.cruise(nominal, SPEED_CRUISE_MAX) : nominal;
+}
+
+/** This state's optional search has had its time (less when late). */
+bool searchOver(uint32_t nominal, uint32_t least) {
+  return adapting ? mission.searchOver(nominal, least) : millis() - stateStartTime >= nominal;
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                          STATE ACTIONS                                     ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/**
+ * Read the sensors once, let the bus move us on if something changed,
+ * otherwise keep doing what the current state does.
+ */
 void processState() {
   Color color = readColor();
   float dist = readDistance();
+  lastColor = color;
+  lastDistance = dist;
+  bus.sampleColor(color);
+  bus.sampleRange(dist);
+  bus.sampleTime(millis());
+  if (bus.dispatch()) return;   // New state acts next tick
   
   switch (currentState) {
     
     // ─────────────────────────────────────────────────────────────────────────
-    // CLIMB RAMP: Go up fast until we reach the target
+    // CLIMB RAMP: Go up fast until we see a color (or the step's time passes)
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_CLIMB_RAMP:
-      moveForward(SPEED_FAST);
-      // Stop when we see a color (we're on the target)
-      if (color != COLOR_NONE && color != COLOR_WHITE) {
-        stopMotors();
-        transitionTo(STATE_ON_TARGET);
-      }
-      // Timeout after 5 seconds
-      if (millis() - stateStartTime > 5000) {
-        stopMotors();
-        transitionTo(STATE_ON_TARGET);
-      }
+      moveForward(cruiseSpeed(SPEED_FAST));
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
-    // ON TARGET: Figure out which zone we landed on
+    // ON TARGET: No zone color yet, move forward a bit
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_ON_TARGET:
-      if (color == COLOR_BLUE)       transitionTo(STATE_NAV_BLUE);
-      else if (color == COLOR_RED)   transitionTo(STATE_NAV_RED);
-      else if (color == COLOR_GREEN) transitionTo(STATE_NAV_GREEN);
-      else if (color == COLOR_BLACK) transitionTo(STATE_REACH_CENTER);
-      else {
-        // Can't determine color, move forward a bit
-        moveForward(SPEED_SLOW);
-        delay(200);
-        stopMotors();
-      }
+      moveForward(SPEED_SLOW);
+      delay(200);
+      stopMotors();
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
-    // NAV BLUE: We're in the outer ring, navigate inward
+    // NAV BLUE / RED / GREEN: Work inward ring by ring; the next ring's
+    // color arrives as an event
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_NAV_BLUE:
-      navigateToCenter();
-      color = readColor();
-      if (color == COLOR_RED)        transitionTo(STATE_NAV_RED);
-      else if (color == COLOR_GREEN) transitionTo(STATE_NAV_GREEN);
-      else if (color == COLOR_BLACK) transitionTo(STATE_REACH_CENTER);
-      break;
-    
-    // ─────────────────────────────────────────────────────────────────────────
-    // NAV RED: We're in the middle ring, navigate inward
-    // ─────────────────────────────────────────────────────────────────────────
     case STATE_NAV_RED:
-      navigateToCenter();
-      color = readColor();
-      if (color == COLOR_GREEN)      transitionTo(STATE_NAV_GREEN);
-      else if (color == COLOR_BLACK) transitionTo(STATE_REACH_CENTER);
-      break;
-    
-    // ─────────────────────────────────────────────────────────────────────────
-    // NAV GREEN: We're in the inner ring, navigate to center
-    // ─────────────────────────────────────────────────────────────────────────
     case STATE_NAV_GREEN:
       navigateToCenter();
-      color = readColor();
-      if (color == COLOR_BLACK) transitionTo(STATE_REACH_CENTER);
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
@@ -333,26 +810,21 @@ void processState() {
       stopMotors();
       Serial.println(F(">>> CENTER REACHED <<<"));
       delay(500);
-      transitionTo(STATE_FIND_BALL);
+      nextStep();
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
     // FIND BALL: Look for the ball using ultrasonic sensor
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_FIND_BALL:
-      if (dist < DIST_BALL && dist > 0) {
-        // Ball found!
-        transitionTo(STATE_SHOOT);
-      } else {
-        // Keep searching
-        moveForward(SPEED_SLOW);
-        delay(200);
-        stopMotors();
-        // Timeout after 3 seconds
-        if (millis() - stateStartTime > 3000) {
-          transitionTo(STATE_SHOOT);
-        }
+      // Keep searching (ball in range or 3 seconds, less when late: shoot)
+      if (searchOver(BALL_SEARCH_MS, BALL_LEAST_MS)) {
+        nextStep();
+        break;
       }
+      moveForward(SPEED_SLOW);
+      delay(200);
+      stopMotors();
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
@@ -362,45 +834,68 @@ void processState() {
       Serial.println(F(">>> SHOOTING BALL <<<"));
       
       // Lower arm to push ball
-      baseServo.write(SERVO_ARM_DOWN);
-      delay(300);
+      power.moveServo(SERVO_ARM, SERVO_ARM_DOWN);
+      awaitServos(300);
       
       // Ram forward to launch
       moveForward(SPEED_FAST);
       delay(400);
       stopMotors();
       
-      // Raise arm back up
-      baseServo.write(SERVO_ARM_UP);
-      delay(150);
+      // Raise arm back up (it gets there while the ball rolls)
+      power.moveServo(SERVO_ARM, SERVO_ARM_UP);
       
       Serial.println(F(">>> BALL LAUNCHED <<<"));
       delay(1000);
-      transitionTo(STATE_RETURN);
+      nextStep();
       break;
     
     // ─────────────────────────────────────────────────────────────────────────
-    // RETURN: Turn around and go back down the ramp
+    // TURN: On an arc (2 x ARC_RADIUS_CM to the side of where we stood),
+    // rolling straight on out of it into a DRIVE, or a pivot
     // ─────────────────────────────────────────────────────────────────────────
-    case STATE_RETURN:
-      // Turn 180 degrees
-      turnRight(SPEED_TURN);
-      delay(TIME_TURN_90 * 2);
-      stopMotors();
-      
-      // Drive down the ramp
-      moveForward(SPEED_NORMAL);
-      delay(4000);
+    case STATE_TURN:
+      if (ARC_TURNS) {
+        arcTurn(ARC_RADIUS_CM, programStep.value);
+        if (program.peek() != OP_DRIVE) stopMotors();
+      } else {
+        if (programStep.value < 0) turnRight(SPEED_TURN);
+        else turnLeft(SPEED_TURN);
+        delay((uint32_t)TIME_TURN_90 * abs(programStep.value) / 90);
+        stopMotors();
+      }
+      nextStep();
+      if (currentState != STATE_RETURN) break;
+      [[fallthrough]];   // Out of the arc straight into the DRIVE, not a tick later
+    
+    // ─────────────────────────────────────────────────────────────────────────
+    // RETURN: Drive back down the ramp (about as far at any speed)
+    // ─────────────────────────────────────────────────────────────────────────
+    case STATE_RETURN: {
+      uint8_t speed = cruiseSpeed(SPEED_NORMAL);
+      moveForward(speed);
+      delay((uint32_t)programStep.value * SPEED_NORMAL / speed);
       stopMotors();
-      
-      transitionTo(STATE_COMPLETE);
+      nextStep();
       break;
+    }
     
     // ─────────────────────────────────────────────────────────────────────────
     // COMPLETE: Section 2 done!
     // ─────────────────────────────────────────────────────────────────────────
     case STATE_COMPLETE:
       stopMotors();
+      reportControl();
+      reportSensorQueue();
+      bus.report();
+      while (checkpoint.pending()) checkpoint.service(CHECKPOINT_BUDGET_US);
+      checkpoint.report();
+      mission.report();
+      power.log();
+      power.report();
+      program.report();
+      trace.flush();
+      trace.report();
       Serial.println(F("\n============================="));
       Serial.println(F("   SECTION 2 COMPLETE!"));
       Serial.println(F("============================="));
@@ -410,12 +905,120 @@ void processState() {
   }
 }
 
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                             TELEMETRY                                      ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+/**
+ * T:<millis>,<state>,<color>,<distance>  (enum values; read by the Coach App)
+ */
+void sendTelemetry() {
+  Serial.print(F("T:"));
+  Serial.print(millis());
+  Serial.print(',');
+  Serial.print(currentState);
+  Serial.print(',');
+  Serial.print(lastColor);
+  Serial.print(',');
+  Serial.println(lastDistance, 1);
+}
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                            BOOT & START                                    ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+#define READY_SERVO   1    // waitUntilReady() bits: parts that timed out
+#define READY_ECHO    2
+#define READY_COLOR   4
+#define READY_CONTROL 8
+
+uint32_t servosWrittenMs = 0, bootReadyMs = 0, startCueMs = 0;
+uint8_t bootNotReady = 0;
+
+/**
+ * Poll the parts until all are ready, at most BOOT_TIMEOUT_MS: servos had
+ * BOOT_SERVO_MS to get there, the ultrasonic answered, the color sensor
+ * pulses, the control interrupt ticks. Returns the READY_ bits that didn't.
+ */
+uint8_t waitUntilReady() {
+  uint32_t start = millis();
+  uint8_t missing;
+  bool colorSeen = false;
+  do {
+    missing = 0;
+    if (millis() - servosWrittenMs < BOOT_SERVO_MS) missing |= READY_SERVO;
+    readDistance();
+    if (echoByInterrupt && (!echoRiseUs || !resultPingUs)) missing |= READY_ECHO;
+    if (!colorSeen) colorSeen = pulseIn(PIN_COLOR_OUT, LOW, 5000) > 0;
+    if (!colorSeen) missing |= READY_COLOR;
+    if (controlRunning && ctrlStats.ticks == 0) missing |= READY_CONTROL;
+  } while (missing && millis() - start < BOOT_TIMEOUT_MS);
+  return missing;
+}
+
+/**
+ * Hold still until the START_TRIGGER cue has lasted START_HOLD_MS.
+ * Meanwhile a mission program can be loaded over Serial (mission_program.h).
+ */
+void waitForStart() {
+  if (START_TRIGGER == START_NOW) return;
+  Serial.println(F("START: waiting for the cue"));
+  bool seen = false, armed = false;   // armed: card seen (LINE) / hand held (WAVE)
+  uint32_t since = 0;
+  for (;;) {
+    program.service();   // A new program over Serial (host/mission_asm.cpp)?
+    if (START_TRIGGER == START_BUTTON) {
+      seen = digitalRead(PIN_START) == LOW;
+    } else if (START_TRIGGER == START_WAVE) {
+      float dist = readDistance();
+      seen = dist > 0 && dist < START_WAVE_CM;
+      if (!seen && armed) return;   // Hand gone: go
+    } else {
+      Color c = readColor();
+      if (c == COLOR_NONE) armed = true;   // White reads as no color
+      seen = armed && c != COLOR_NONE;
+    }
+    uint32_t now = millis();
+    if (!seen) since = now;
+    if (seen && now - since >= START_HOLD_MS) {
+      if (START_TRIGGER != START_WAVE) return;
+      armed = true;
+    }
+    delay(10);
+  }
+}
+
+/** Once, when the wheels first move: BOOT: ready_ms= start_ms= motion_ms= not_ready= */
+void reportBoot() {
+  static bool reported = false;
+  if (reported || !firstMotionMs) return;
+  reported = true;
+  Serial.print(F("BOOT: ready_ms="));
+  Serial.print(bootReadyMs);
+  Serial.print(F(" start_ms="));
+  Serial.print(startCueMs);
+  Serial.print(F(" motion_ms="));
+  Serial.print(firstMotionMs);
+  Serial.print(F(" not_ready="));
+  Serial.println(bootNotReady);
+}
+
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                          SETUP & MAIN LOOP                                 ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
 
 void setup() {
+  ResetCause cause = readResetCause();   // First: this clears the flags
   Serial.begin(9600);
+  bool resume = checkpoint.begin(2, __DATE__ " " __TIME__) && CHECKPOINT_RESUME &&
+                (cause == RESET_BROWNOUT || cause == RESET_WATCHDOG);
+  program.begin(2, BUILTIN_PROGRAM, sizeof(BUILTIN_PROGRAM), STEP_OPS);   // Loaded over Serial, else built-in
+  
+  // Servos first: they take longest, the rest of setup() runs meanwhile
+  baseServo.attach(PIN_SERVO_BASE);
+  clampServo.attach(PIN_SERVO_CLAMP);
+  power.attachServo(SERVO_ARM, baseServo, SERVO_ARM_DOWN);
+  servosWrittenMs = millis();
   
   // Color sensor pins
   pinMode(PIN_COLOR_S0, OUTPUT);
@@ -429,6 +1032,9 @@ void setup() {
   // Ultrasonic pins
   pinMode(PIN_ULTRA_TRIG, OUTPUT);
   pinMode(PIN_ULTRA_ECHO, INPUT);
+  startEcho();
+  
+  pinMode(PIN_START, INPUT_PULLUP);   // Start button
   
   // Motor pins
   pinMode(PIN_MOTOR_ENA, OUTPUT);
@@ -438,24 +1044,92 @@ void setup() {
   pinMode(PIN_MOTOR_IN3, OUTPUT);
   pinMode(PIN_MOTOR_IN4, OUTPUT);
   
-  // Servos
-  baseServo.attach(PIN_SERVO_BASE);
-  clampServo.attach(PIN_SERVO_CLAMP);
-  baseServo.write(SERVO_ARM_DOWN);
-  
   stopMotors();
-  delay(1000);
+  power.begin(POWER_BUDGET_MA, DRIVE_DEADBAND, DRIVE_TAU_MS, CONTROL_HZ);   // Before the timer's first tick
+  startControl();
+  power.start(controlRunning);
   
   Serial.println(F("============================="));
   Serial.println(F("  SECTION 2: TARGET SHOOTING"));
   Serial.println(F("============================="));
   Serial.println(F("Mission: Ramp -> Center -> Shoot -> Return"));
+  Serial.println(F("FW: " __DATE__ " " __TIME__));
+  Serial.println(F("PARAMS: SPEED_NORMAL=" STR(SPEED_NORMAL) ",SPEED_FAST=" STR(SPEED_FAST) ",SPEED_TURN=" STR(SPEED_TURN)
+                 ",SPEED_COMPENSATION=" STR(SPEED_COMPENSATION) ",TIME_TURN_90=" STR(TIME_TURN_90)
+                 ",ARC_TURNS=" STR(ARC_TURNS) ",ARC_RADIUS_CM=" STR(ARC_RADIUS_CM)
+                 ",DIST_BALL=" STR(DIST_BALL) ",COLOR_FREQ_MAX=" STR(COLOR_FREQ_MAX)
+                 ",COLOR_FREQ_BLACK=" STR(COLOR_FREQ_BLACK) ",COLOR_MARGIN=" STR(COLOR_MARGIN) ",CONTROL_HZ=" STR(CONTROL_HZ)
+                 ",START_TRIGGER=" STR(START_TRIGGER) ",POWER_BUDGET_MA=" STR(POWER_BUDGET_MA)
+                 ",TRACE_MASK=" STR(TRACE_MASK)));
+  
+  // The trace's legend: every span's id, kind and name
+  trace.begin(TRACE_MASK);
+  for (uint8_t s = 0; s <= STATE_TURN; s++) trace.name(TRACE_STATE + s, TRACE_STATES, stateName((State)s));
+  trace.name(TRACE_COLOR, TRACE_SENSORS, F("readColor"));
+  trace.name(TRACE_ECHO, TRACE_SENSORS, F("echo"));
+  trace.name(TRACE_ARC, TRACE_MANEUVERS, F("arcTurn"));
+  trace.name(TRACE_NAVIGATE, TRACE_MANEUVERS, F("navigateToCenter"));
+  trace.name(TRACE_SERVO_WAIT, TRACE_SERVOS, F("awaitServos"));
+  trace.name(TRACE_IDLE, TRACE_WAITS, F("idle"));
   Serial.println();
   
-  transitionTo(STATE_CLIMB_RAMP);
+  if (!resume) {   // Resuming: we're under way, no waiting
+    bootNotReady = waitUntilReady();
+    bootReadyMs = millis();
+    waitForStart();
+  }
+  startCueMs = millis();
+  adapting = MISSION_ADAPT && !program.loaded();   // PLAN is the built-in route's
+  
+  // Begin at the program's first step, or the saved one
+  Serial.print(F("RESET: cause="));
+  Serial.print(resetCauseName(cause));
+  if (resume) {
+    const Checkpoint& saved = checkpoint.last();
+    program.resumeAt(saved.step, saved.count);
+    Serial.print(F(" resume="));
+    Serial.print(stateName((State)saved.state));
+    Serial.print(F(" pc="));
+    Serial.print(saved.step);
+    Serial.print(F(" boot_ms="));
+    Serial.println(millis());
+  } else {
+    Serial.println();
+  }
+  State first = subscribeStep();
+  if (resume && programStep.op == OP_CENTER) first = (State)checkpoint.last().state;   // In the zone we were in
+  mission.begin(MISSION_BUDGET_MS, MISSION_RESERVE_MS, PLAN, sizeof(PLAN) / sizeof(PLAN[0]), first, millis());
+  transitionTo(first);
 }
 
 void loop() {
+  mission.update(millis(), 0);
   processState();
-  delay(50);
+  
+  static uint8_t telemetryTick = 0;
+  if (TELEMETRY_EVERY > 0 && ++telemetryTick >= TELEMETRY_EVERY) {
+    telemetryTick = 0;
+    sendTelemetry();
+  }
+  
+  reportBoot();
+  
+  static uint32_t lastControlReport = 0;
+  if (CONTROL_REPORT_MS > 0 && millis() - lastControlReport >= CONTROL_REPORT_MS) {
+    lastControlReport = millis();
+    reportControl();
+    reportSensorQueue();
+    bus.report();
+    checkpoint.report();
+    mission.report();
+    power.report();
+    trace.report();
+  }
+  power.log();   // Budget conflicts the control interrupt resolved
+  trace.service();
+  
+  uint32_t writingMs = checkpoint.service(CHECKPOINT_BUDGET_US) / 1000;   // In the wait, not on top of it
+  trace.open(TRACE_IDLE);
+  delay(writingMs < 50 ? 50 - writingMs : 0);
+  trace.close(TRACE_IDLE);
 }
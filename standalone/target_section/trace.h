@@ -0,0 +1,242 @@
+/**
+ * ╔═══════════════════════════════════════════════════════════════════════════╗
+ * ║          TRACE: begin/end spans of what the robot was doing, when         ║
+ * ╚═══════════════════════════════════════════════════════════════════════════╝
+ *
+ * The STATE: and T: lines say where the run was every few ticks; a trace
+ * says how long each thing took, to the microsecond: every state, maneuver,
+ * servo wait, sensor conversion and idle wait as a span with a begin and an
+ * end. host/trace_export turns the log into a Chrome trace (chrome://tracing
+ * or ui.perfetto.dev opens it), one track per kind of span.
+ *
+ * The sketch names its spans once, in setup(), each with its kind:
+ *
+ *   trace.begin(TRACE_MASK);
+ *   trace.name(TRACE_TURN, TRACE_MANEUVERS, F("turnTo"));   // -> TRACE: id=24 cat=maneuver name=turnTo
+ *
+ * and then marks them where they happen:
+ *
+ *   trace.switchTo(TRACE_STATE + newState);   // Ends the previous state's span
+ *   { TraceSpan span(trace, TRACE_TURN); ... }   // Begin here, end at the }
+ *   trace.open(TRACE_ECHO); ... trace.close(TRACE_ECHO, cm);   // An end can carry a value
+ *   trace.complete(TRACE_ECHO, sentUs, fallUs, cm);   // Both ends after the fact
+ *
+ * Recording is a push of 8 bytes into an SpscQueue, from loop() context
+ * only (never from an interrupt: the queue has one producer). A kind left
+ * out of the mask costs one test. service(), every loop(), sends what was
+ * recorded once a line's worth is waiting or the oldest event is
+ * TRACE_FLUSH_MS old; flush() sends the rest.
+ *
+ * WIRE FORMAT: one line per batch, base64 of
+ *
+ *   varint  micros() of the line's first event
+ *   per event:
+ *     byte    phase << 6 | id      (phase: 0 begin, 1 end, 2 end with value, 3 instant)
+ *     varint  zigzag µs since the previous event (complete() may go back)
+ *     varint  zigzag value         (phases 2 and 3 only)
+ *
+ *   TRACE: ev=9ZvmAhoAGQRZ5NAKGILEE1jE6D8YAliElR4ZhMQTWcbsIRiCxBNY7qQaGAJYirE/GAJYyJ8lWuTHE0QGBQA=
+ *
+ * about 4 bytes an event, and each line stands alone, so a log joined late
+ * still converts. At 9600 baud that leaves room for ~150 events a second
+ * next to the telemetry: the sensor and wait kinds (spans every tick) are
+ * off in the default mask, and a long maneuver (loop() not sending) can
+ * fill the queue with them. What the queue couldn't hold is
+ * counted, not waited for. begin() prints the mask (a new run for the
+ * converter) and report() prints:
+ *   TRACE: events=<sent> lines=<n> bytes=<n> lost=<n> peak=<n>/<capacity>
+ *
+ * Arduino only compiles files inside the sketch folder, so every mission
+ * sketch carries an identical copy of this header.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "spsc_queue.h"
+
+// Kinds of span (TRACE_MASK is a sum of these)
+#define TRACE_STATES     1    // States of the state machine
+#define TRACE_SENSORS    2    // Color readings, echo pings
+#define TRACE_MANEUVERS  4    // Turns, approaches, pickups...
+#define TRACE_SERVOS     8    // Waiting for the servos
+#define TRACE_WAITS     16    // The idle wait at the end of loop()
+#define TRACE_ALL       31
+
+#define TRACE_EVENTS       128    // Queued events (8 bytes each)
+#define TRACE_LINE_EVENTS   24    // Events per line (~100 characters)
+#define TRACE_FLUSH_MS    1000    // Send a part line after this long
+#define TRACE_IDS           64    // Ids fit 6 bits of the tag byte
+
+enum TracePhase : uint8_t { TRACE_BEGIN, TRACE_END, TRACE_END_ARG, TRACE_INSTANT };
+
+struct TraceEvent {
+  uint32_t us;
+  int16_t arg;
+  uint8_t id;
+  uint8_t phase;
+};
+
+class Tracer {
+public:
+  void begin(uint8_t mask) {
+    mask_ = mask;
+    Serial.print(F("TRACE: mask="));
+    Serial.println(mask_);
+  }
+
+  /** Give `id` its kind and a name for the converter. Kinds not in the mask stay unnamed and silent. */
+  void name(uint8_t id, uint8_t kind, const __FlashStringHelper* name) {
+    if (id >= TRACE_IDS) return;
+    kind_[id] = kind;
+    if (!(mask_ & kind)) return;
+    Serial.print(F("TRACE: id="));
+    Serial.print(id);
+    Serial.print(F(" cat="));
+    Serial.print(kindName(kind));
+    Serial.print(F(" name="));
+    Serial.println(name);
+  }
+
+  bool on(uint8_t id) const { return id < TRACE_IDS && (mask_ & kind_[id]); }
+
+  void open(uint8_t id) {
+    if (on(id)) record(id, TRACE_BEGIN, micros(), 0);
+  }
+  void close(uint8_t id) {
+    if (on(id)) record(id, TRACE_END, micros(), 0);
+  }
+  void close(uint8_t id, int16_t arg) {
+    if (on(id)) record(id, TRACE_END_ARG, micros(), arg);
+  }
+  void instant(uint8_t id, int16_t arg) {
+    if (on(id)) record(id, TRACE_INSTANT, micros(), arg);
+  }
+
+  /** A span timed elsewhere (an interrupt's timestamps): both ends at once. */
+  void complete(uint8_t id, uint32_t beginUs, uint32_t endUs, int16_t arg) {
+    record(id, TRACE_BEGIN, beginUs, 0);
+    record(id, TRACE_END_ARG, endUs, arg);
+  }
+
+  /** The state machine moved on: end the last state's span, begin this one's. */
+  void switchTo(uint8_t id) {
+    if (!(mask_ & TRACE_STATES)) return;
+    uint32_t now = micros();
+    if (state_ < TRACE_IDS) record(state_, TRACE_END, now, 0);
+    state_ = id;
+    record(id, TRACE_BEGIN, now, 0);
+  }
+
+  /** Call every loop(): sends at most one line, and only a full or an old one. */
+  void service() {
+    uint32_t waiting = events_.size();
+    if (!waiting) return;
+    if (waiting < TRACE_LINE_EVENTS && millis() - sentMs_ < TRACE_FLUSH_MS) return;
+    sendLine();
+  }
+
+  /** Send everything recorded (at COMPLETE, before the reports). */
+  void flush() {
+    while (!events_.empty()) sendLine();
+  }
+
+  void report() {
+    Serial.print(F("TRACE: events="));
+    Serial.print(sent_);
+    Serial.print(F(" lines="));
+    Serial.print(lines_);
+    Serial.print(F(" bytes="));
+    Serial.print(bytes_);
+    Serial.print(F(" lost="));
+    Serial.print(events_.overflows());
+    Serial.print(F(" peak="));
+    Serial.print(events_.peak());
+    Serial.print('/');
+    Serial.println(events_.capacity());
+  }
+
+private:
+  void record(uint8_t id, uint8_t phase, uint32_t us, int16_t arg) {
+    if (!on(id)) return;
+    TraceEvent e = {us, arg, id, phase};
+    events_.push(e);   // Full: counted as lost
+  }
+
+  static const __FlashStringHelper* kindName(uint8_t kind) {
+    switch (kind) {
+      case TRACE_STATES:    return F("state");
+      case TRACE_SENSORS:   return F("sensor");
+      case TRACE_MANEUVERS: return F("maneuver");
+      case TRACE_SERVOS:    return F("servo");
+      default:              return F("wait");
+    }
+  }
+
+  static uint8_t putVarint(uint8_t* out, uint32_t v) {
+    uint8_t n = 0;
+    while (v >= 0x80) {
+      out[n++] = (uint8_t)(v | 0x80);
+      v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+  }
+  static uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+
+  /** Pack up to TRACE_LINE_EVENTS events and print them as one base64 line. */
+  void sendLine() {
+    uint8_t buf[5 + TRACE_LINE_EVENTS * 9];   // Worst case: every varint its longest
+    uint8_t len = 0;
+    TraceEvent e;
+    uint32_t lastUs = 0;
+    uint8_t count = 0;
+    while (count < TRACE_LINE_EVENTS && events_.pop(e)) {
+      if (count == 0) {
+        len += putVarint(buf + len, e.us);
+        lastUs = e.us;
+      }
+      buf[len++] = (uint8_t)(e.phase << 6 | e.id);
+      len += putVarint(buf + len, zigzag((int32_t)(e.us - lastUs)));
+      if (e.phase >= TRACE_END_ARG) len += putVarint(buf + len, zigzag(e.arg));
+      lastUs = e.us;
+      count++;
+    }
+    if (!count) return;
+
+    static const char B64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    Serial.print(F("TRACE: ev="));
+    for (uint8_t i = 0; i < len; i += 3) {
+      uint32_t word = (uint32_t)buf[i] << 16;
+      if (i + 1 < len) word |= (uint32_t)buf[i + 1] << 8;
+      if (i + 2 < len) word |= buf[i + 2];
+      char quad[5] = {B64[word >> 18 & 63], B64[word >> 12 & 63],
+                      i + 1 < len ? B64[word >> 6 & 63] : '=', i + 2 < len ? B64[word & 63] : '=', 0};
+      Serial.print(quad);
+    }
+    Serial.println();
+
+    sent_ += count;
+    lines_++;
+    bytes_ += len;
+    sentMs_ = millis();
+  }
+
+  SpscQueue<TraceEvent, TRACE_EVENTS> events_;
+  uint8_t kind_[TRACE_IDS] = {};   // 0 = unnamed: never recorded
+  uint8_t mask_ = 0;
+  uint8_t state_ = TRACE_IDS;      // The open state span (none yet)
+  uint32_t sent_ = 0, lines_ = 0, bytes_ = 0;
+  uint32_t sentMs_ = 0;
+};
+
+/** Begins `id` now, ends it where it goes out of scope (every return). */
+class TraceSpan {
+public:
+  TraceSpan(Tracer& tracer, uint8_t id) : tracer_(tracer), id_(id) { tracer_.open(id_); }
+  ~TraceSpan() { tracer_.close(id_); }
+
+private:
+  Tracer& tracer_;
+  uint8_t id_;
+};